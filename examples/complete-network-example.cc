@@ -295,6 +295,7 @@ main (int argc, char *argv[])
 
   // Create a NS for the network
   nsHelper.SetEndDevices (endDevices);
+  nsHelper.SetAddressGenerator (addrGen);
   nsHelper.SetGateways (gateways);
   nsHelper.Install (networkServer);
 
@@ -243,9 +243,10 @@ int main (int argc, char *argv[]){
 	string endDevFile="./TestResult/test";
 	string gwFile="./TestResult/test";
 	bool flagRtx=true; //, sizeStatus=0;
+	bool capacityAware=false;
   	uint32_t nSeed=1;
 	uint8_t trial=1, numClass=0; //, nCount=0, nClass1=0, nClass2=0, nClass3=0;
-	vector<uint8_t> sfQuant(6,0);
+	vector<uint32_t> sfQuant(6,0);
 	double packLoss=0, sent=0, received=0, avgDelay=0;
 	double angle=0, sAngle=M_PI; //, radius1=4200; //, radius2=4900;
 	double throughput=0, probSucc=0, probLoss=0;
@@ -262,6 +263,7 @@ int main (int argc, char *argv[]){
   	cmd.AddValue ("file2", "files containing result information", fileData);
   	cmd.AddValue ("print", "Whether or not to print various informations", print);
   	cmd.AddValue ("trial", "set trial parameter", trial);
+  	cmd.AddValue ("capacityAware", "Whether to balance the airtime load among SFs and gateways", capacityAware);
   	cmd.Parse (argc, argv);
 
 	endDevFile += to_string(trial) + "/endDevices" + to_string(nDevices) + ".dat";
@@ -454,7 +456,12 @@ int main (int argc, char *argv[]){
    	*  Set up the end device's spreading factor  *
    	**********************************************/
 
-  	sfQuant = macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel, flagRtx);
+  	if (capacityAware){
+		// Applications are installed below: use the same traffic
+		sfQuant = macHelper.SetSpreadingFactorsCapacityAware (endDevices, gateways, channel, Seconds (appPeriodSeconds), 19);
+	}else{
+  		sfQuant = macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel, flagRtx);
+	}
 	//sfQuant = macHelper.SetSpreadingFactorsEIB (endDevices, radius);
 	//sfQuant = macHelper.SetSpreadingFactorsEAB (endDevices, radius);
 	//sfQuant = macHelper.SetSpreadingFactorsProp (endDevices, 0.4, 0, radius);
@@ -527,20 +534,22 @@ int main (int argc, char *argv[]){
    	NS_LOG_INFO("SF Allocation: 6 -> "<< "SF7=" << (unsigned)sfQuant.at(0) << " SF8=" << (unsigned)sfQuant.at(1) << " SF9=" << (unsigned)sfQuant.at(2)
 				<< " SF10=" << (unsigned)sfQuant.at(3) << " SF11=" << (unsigned)sfQuant.at(4) << " SF12=" << (unsigned)sfQuant.at(5));
 	
+	LoraPacketTracker &tracker = helper.GetPacketTracker ();
+	TrackerMetrics metrics = tracker.GetMetrics (Seconds (0), appStopTime + Hours (1));
+
 	for(uint8_t i=SF7;i<SF7+numClass;i++)
 	{
     	NS_LOG_INFO (endl <<"//////////////////////////////////////////////");
     	NS_LOG_INFO ("//  Computing SF-"<<(unsigned)i<<" performance metrics  //");
     	NS_LOG_INFO ("//////////////////////////////////////////////" << endl);
 
-  		LoraPacketTracker &tracker = helper.GetPacketTracker ();
-
-		stringstream(tracker.CountMacPacketsGlobally (Seconds (0), appStopTime + Hours (1), i)) >> sent >> received;
+		sent = metrics.GetMacCounters (i).sent;
+		received = metrics.GetMacCounters (i).received;
 
 		if(flagRtx)
-    		stringstream(tracker.CountMacPacketsGloballyCpsr (Seconds (0), appStopTime + Hours (1))) >> avgDelay;
+    		avgDelay = metrics.reTx.sent;
 		else
-			stringstream(tracker.CountMacPacketsGloballyDelay (Seconds (0), appStopTime + Hours (1), (unsigned)nDevices, (unsigned)nGateways, i)) >> avgDelay;
+			avgDelay = TrackerMetrics::GetAverageDelay (metrics.GetDelay ((unsigned)nDevices, (unsigned)nGateways, i)).GetSeconds ();
 
 	
 		packLoss = sent - received;
@@ -27,6 +27,7 @@
 #include "ns3/building-allocator.h"
 #include "ns3/buildings-helper.h"
 #include "ns3/forwarder-helper.h"
+#include "ns3/lora-event-profiler.h"
 #include <algorithm>
 #include <ctime>
 
@@ -158,9 +159,10 @@ int main (int argc, char *argv[]){
 	string endDevFile="./TestResult/test";
 	string gwFile="./TestResult/test";
 	bool rtxEnable=false;
+	bool profileEvents=false;
   	uint32_t nSeed=1;
 	uint8_t trial=1; //, numRTX=0;
-	vector<uint8_t> sfQuant(6,0);
+	vector<uint32_t> sfQuant(6,0);
 	double packLoss=0, sent=0, received=0, avgDelay=0;
 	double angle=0, sAngle=M_PI;
 	double throughput=0, probSucc=0, probLoss=0; 
@@ -178,8 +180,11 @@ int main (int argc, char *argv[]){
   	cmd.AddValue ("file2", "files containing result information", fileData);
   	cmd.AddValue ("print", "Whether or not to print various informations", print);
   	cmd.AddValue ("trial", "set trial parameter", trial);
+  	cmd.AddValue ("profileEvents", "Whether to report the wall clock time spent per type of event", profileEvents);
   	cmd.Parse (argc, argv);
 
+  	LoraEventProfiler::Enable (profileEvents);
+
 	endDevFile += to_string(trial) + "/endDevices" + to_string(nDevices) + ".dat";
 	gwFile += to_string(trial) + "/GWs" + to_string(nGateways) + ".dat";
 
@@ -440,9 +445,11 @@ int main (int argc, char *argv[]){
   
   	LoraPacketTracker &tracker = helper.GetPacketTracker ();
   
-  	stringstream(tracker.CountMacPacketsGlobally (Seconds (0), appStopTime + Hours (1))) >> sent >> received;
+  	TrackerMetrics metrics = tracker.GetMetrics (Seconds (0), appStopTime + Hours (1));
+  	sent = metrics.GetMacCounters ().sent;
+  	received = metrics.GetMacCounters ().received;
 
-	stringstream(tracker.CountMacPacketsGloballyDelay(Seconds(0), appStopTime + Hours(1), (unsigned)nDevices, (unsigned)nGateways)) >> avgDelay;
+	avgDelay = TrackerMetrics::GetAverageDelay (metrics.GetDelay ((unsigned)nDevices, (unsigned)nGateways)).GetSeconds ();
 
 	packLoss = sent - received;
   	throughput = received/simulationTime;
@@ -166,6 +166,7 @@ int main (int argc, char *argv[])
   NetworkServerHelper networkServerHelper;
   networkServerHelper.SetGateways (gateways);
   networkServerHelper.SetEndDevices (endDevices);
+  networkServerHelper.SetAddressGenerator (addrGen);
   networkServerHelper.Install (networkServers);
 
   // Install the Forwarder application on the gateways
@@ -0,0 +1,29 @@
+/*
+ * This program converts a CSV file of uplink packets, with lines of the form
+ * device,time,size (time in seconds, size in bytes), into the binary trace
+ * replayed by TraceReplaySender.
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/trace-replay-helper.h"
+#include <iostream>
+
+using namespace ns3;
+using namespace lorawan;
+
+int
+main (int argc, char *argv[])
+{
+  std::string csvFile = "uplink.csv";
+  std::string traceFile = "uplink.bin";
+
+  CommandLine cmd;
+  cmd.AddValue ("csv", "The CSV file to convert", csvFile);
+  cmd.AddValue ("trace", "The trace file to write", traceFile);
+  cmd.Parse (argc, argv);
+
+  uint64_t nRecords = TraceReplayHelper::ConvertCsv (csvFile, traceFile);
+  std::cout << "Wrote " << nRecords << " packets to " << traceFile << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+"""Read the binary packet traces written by LoraPacketTraceWriter.
+
+Usage::
+
+    import lora_trace
+    trace = lora_trace.load("packets.bin")
+    received = (trace["outcome"] == lora_trace.RECEIVED).any(axis=1)
+
+See helper/lora-packet-trace-writer.h for a description of the format.
+"""
+
+import numpy as np
+
+MAGIC = b"LORATRK1"
+VERSION = 1
+
+# PhyPacketOutcome values, in the order of the enum
+OUTCOMES = ["RECEIVED", "INTERFERED", "NO_MORE_RECEIVERS", "UNDER_SENSITIVITY",
+            "LOST_BECAUSE_TX", "UNSET"]
+(RECEIVED, INTERFERED, NO_MORE_RECEIVERS, UNDER_SENSITIVITY, LOST_BECAUSE_TX,
+ UNSET) = range(len(OUTCOMES))
+
+
+def _align(offset):
+    return (offset + 7) // 8 * 8
+
+
+def blocks(filename):
+    """Yield each block of a trace as a dictionary of arrays.
+
+    Arrays are views on the memory-mapped file. Per-gateway columns have
+    shape (gateways, records).
+    """
+    data = np.memmap(filename, dtype=np.uint8, mode="r")
+    if bytes(data[:8]) != MAGIC:
+        raise ValueError("%s is not a packet trace" % filename)
+    version = int(data[8:12].view(np.uint32)[0])
+    if version != VERSION:
+        raise ValueError("Unsupported trace version %d" % version)
+
+    offset = 16
+    while offset < len(data):
+        n, g = (int(x) for x in data[offset:offset + 8].view(np.uint32))
+        offset += 8
+        gateways = data[offset:offset + 4 * g].view(np.uint32)
+        offset = _align(offset + 4 * g)
+
+        def column(dtype, rows=None):
+            nonlocal offset
+            count = n if rows is None else n * rows
+            size = np.dtype(dtype).itemsize * count
+            values = data[offset:offset + size].view(dtype)
+            offset += size
+            return values if rows is None else values.reshape(rows, n)
+
+        block = {"gateways": gateways}
+        block["send_time"] = column(np.int64)
+        block["delay"] = column(np.int64, g)
+        block["frequency"] = column(np.float64)
+        block["rx_power"] = column(np.float64, g)
+        block["device"] = column(np.uint32)
+        block["sf"] = column(np.uint8)
+        block["outcome"] = column(np.uint8, g)
+        offset = _align(offset)
+        yield block
+
+
+def load(filename):
+    """Load a whole trace.
+
+    Return a dictionary of arrays with one row per packet: send_time (s),
+    device, sf, frequency (MHz), and, with one column per gateway of
+    "gateways", outcome (UNSET if the gateway never saw the packet),
+    rx_power (dBm, NaN if not received) and delay (s, NaN if not received).
+    """
+    parts = list(blocks(filename))
+    gateways = sorted(set(int(gw) for block in parts
+                          for gw in block["gateways"]))
+    column = {gw: i for i, gw in enumerate(gateways)}
+    total = sum(len(block["send_time"]) for block in parts)
+
+    trace = {
+        "gateways": np.array(gateways, dtype=np.uint32),
+        "send_time": np.empty(total),
+        "device": np.empty(total, dtype=np.uint32),
+        "sf": np.empty(total, dtype=np.uint8),
+        "frequency": np.empty(total),
+        "outcome": np.full((total, len(gateways)), UNSET, dtype=np.uint8),
+        "rx_power": np.full((total, len(gateways)), np.nan),
+        "delay": np.full((total, len(gateways)), np.nan),
+    }
+
+    start = 0
+    for block in parts:
+        stop = start + len(block["send_time"])
+        trace["send_time"][start:stop] = block["send_time"] * 1e-9
+        trace["device"][start:stop] = block["device"]
+        trace["sf"][start:stop] = block["sf"]
+        trace["frequency"][start:stop] = block["frequency"]
+        for i, gw in enumerate(block["gateways"]):
+            j = column[int(gw)]
+            trace["outcome"][start:stop, j] = block["outcome"][i]
+            trace["rx_power"][start:stop, j] = block["rx_power"][i]
+            delay = block["delay"][i]
+            trace["delay"][start:stop, j] = np.where(delay >= 0, delay * 1e-9,
+                                                     np.nan)
+        start = stop
+    return trace
@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/async-file-writer.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("AsyncFileWriter");
+
+AsyncFileWriter::AsyncFileWriter (uint32_t bufferSize) :
+  m_bufferSize (bufferSize),
+  m_flushRequested (false),
+  m_stop (false)
+{
+  NS_LOG_FUNCTION (this << bufferSize);
+
+  m_thread = std::thread (&AsyncFileWriter::Run, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter ()
+{
+  NS_LOG_FUNCTION (this);
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_queued.notify_one ();
+  m_thread.join ();
+
+  // The thread wrote all blocks before exiting
+  m_files.clear ();
+}
+
+void
+AsyncFileWriter::Write (std::string filename, std::string data, bool truncate)
+{
+  NS_LOG_FUNCTION (this << filename << data.size () << truncate);
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_queue.push_back (Block {std::move (filename), std::move (data), truncate});
+  }
+  m_queued.notify_one ();
+}
+
+void
+AsyncFileWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_flushRequested = true;
+  m_queued.notify_one ();
+  m_idle.wait (lock, [this] { return !m_flushRequested; });
+}
+
+void
+AsyncFileWriter::Run (void)
+{
+  // No logging here: the logging system is not thread-safe
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      m_queued.wait (lock, [this]
+                     { return m_stop || m_flushRequested || !m_queue.empty (); });
+
+      while (!m_queue.empty ())
+        {
+          Block block = std::move (m_queue.front ());
+          m_queue.pop_front ();
+          lock.unlock ();
+          DoWrite (block);
+          lock.lock ();
+        }
+
+      if (m_flushRequested)
+        {
+          for (auto &file : m_files)
+            {
+              file.second.stream.flush ();
+            }
+          m_flushRequested = false;
+          m_idle.notify_all ();
+        }
+
+      if (m_stop)
+        {
+          return;
+        }
+    }
+}
+
+void
+AsyncFileWriter::DoWrite (Block &block)
+{
+  auto it = m_files.find (block.filename);
+  if (it == m_files.end () || block.truncate)
+    {
+      File &file = m_files[block.filename];
+      if (file.stream.is_open ())
+        {
+          file.stream.close ();
+        }
+      if (!file.buffer)
+        {
+          // The buffer must be set before the file is opened
+          file.buffer.reset (new char[m_bufferSize]);
+          file.stream.rdbuf ()->pubsetbuf (file.buffer.get (), m_bufferSize);
+        }
+      file.stream.open (block.filename.c_str (),
+                        std::ofstream::out | (block.truncate ?
+                                              std::ofstream::trunc :
+                                              std::ofstream::app));
+      it = m_files.find (block.filename);
+    }
+
+  it->second.stream.write (block.data.data (), block.data.size ());
+}
+
+}
+}
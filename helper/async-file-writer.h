@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ASYNC_FILE_WRITER_H
+#define ASYNC_FILE_WRITER_H
+
+#include "ns3/simple-ref-count.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Appends blocks of text to files from a background thread.
+ *
+ * The simulation formats a whole snapshot in memory and hands it over with a
+ * single call, so that the event loop never waits for the disk. Files are
+ * kept open, with a large buffer, until the writer is destroyed; Flush waits
+ * until all blocks queued so far are written.
+ */
+class AsyncFileWriter : public SimpleRefCount<AsyncFileWriter>
+{
+public:
+  /**
+   * Create a writer and start its thread.
+   *
+   * \param bufferSize The size of the output buffer of each file, in bytes.
+   */
+  AsyncFileWriter (uint32_t bufferSize = 1 << 20);
+  ~AsyncFileWriter ();
+
+  /**
+   * Queue a block of data to be written to a file.
+   *
+   * \param filename The path of the file.
+   * \param data The data to append.
+   * \param truncate Whether to delete the contents of the file before
+   * writing the block.
+   */
+  void Write (std::string filename, std::string data, bool truncate);
+
+  /**
+   * Wait until all queued blocks are written, and flush the files.
+   */
+  void Flush (void);
+
+private:
+  /**
+   * A block of data waiting to be written.
+   */
+  struct Block
+  {
+    std::string filename;
+    std::string data;
+    bool truncate;
+  };
+
+  /**
+   * An open file, with its buffer.
+   */
+  struct File
+  {
+    std::unique_ptr<char[]> buffer;   //!< Declared first, to outlive stream
+    std::ofstream stream;
+  };
+
+  /**
+   * The loop of the background thread.
+   */
+  void Run (void);
+
+  /**
+   * Write a block, from the background thread.
+   */
+  void DoWrite (Block &block);
+
+  uint32_t m_bufferSize;   //!< Output buffer of each file
+  std::map<std::string, File> m_files;   //!< Only used by the thread
+
+  std::mutex m_mutex;   //!< Protects the members below
+  std::condition_variable m_queued;   //!< Signals new blocks or m_stop
+  std::condition_variable m_idle;   //!< Signals that the thread is idle
+  std::deque<Block> m_queue;   //!< Blocks waiting to be written
+  bool m_flushRequested;   //!< Whether files should be flushed
+  bool m_stop;   //!< Whether the thread should exit
+
+  std::thread m_thread;
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* ASYNC_FILE_WRITER_H */
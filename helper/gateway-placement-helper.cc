@@ -0,0 +1,396 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/gateway-placement-helper.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/gateway-lora-phy.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("GatewayPlacementHelper");
+
+GatewayPlacementHelper::GatewayPlacementHelper ()
+  : m_siteSpacing (1000),
+  m_gatewayHeight (15),
+  m_txPowerDbm (14),
+  m_loadWeight (0.1),
+  m_iterations (10),
+  m_nThreads (1)
+{
+}
+
+GatewayPlacementHelper::~GatewayPlacementHelper ()
+{
+}
+
+void
+GatewayPlacementHelper::SetChannel (Ptr<LoraChannel> channel)
+{
+  m_channel = channel;
+}
+
+void
+GatewayPlacementHelper::SetSiteSpacing (double spacing)
+{
+  m_siteSpacing = spacing;
+}
+
+void
+GatewayPlacementHelper::SetGatewayHeight (double height)
+{
+  m_gatewayHeight = height;
+}
+
+void
+GatewayPlacementHelper::SetTxPower (double txPowerDbm)
+{
+  m_txPowerDbm = txPowerDbm;
+}
+
+void
+GatewayPlacementHelper::SetLoadWeight (double loadWeight)
+{
+  m_loadWeight = loadWeight;
+}
+
+void
+GatewayPlacementHelper::SetIterations (uint32_t iterations)
+{
+  m_iterations = iterations;
+}
+
+void
+GatewayPlacementHelper::SetThreads (uint32_t nThreads)
+{
+  m_nThreads = nThreads;
+}
+
+std::vector<uint32_t>
+GatewayPlacementHelper::GetSfQuantity (void) const
+{
+  return m_sfQuantity;
+}
+
+std::vector<double>
+GatewayPlacementHelper::GetLoads (void) const
+{
+  return m_loads;
+}
+
+Ptr<ListPositionAllocator>
+GatewayPlacementHelper::Optimize (NodeContainer endDevices, uint32_t nGateways)
+{
+  std::vector<Vector> devicePositions;
+  for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
+    {
+      Ptr<MobilityModel> mobility = (*j)->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != NULL);
+      devicePositions.push_back (mobility->GetPosition ());
+    }
+  return Optimize (devicePositions, nGateways);
+}
+
+Ptr<ListPositionAllocator>
+GatewayPlacementHelper::Optimize (const std::vector<Vector> &devicePositions,
+                                  uint32_t nGateways)
+{
+  NS_LOG_FUNCTION (this << devicePositions.size () << nGateways);
+
+  NS_ASSERT_MSG (m_channel != 0, "No channel to compute link budgets");
+  NS_ASSERT_MSG (!devicePositions.empty (), "No devices to place gateways for");
+  NS_ASSERT_MSG (nGateways > 0, "No gateways to place");
+
+  // Candidate sites: a hex grid centered on the bounding box of the devices
+  double xMin = std::numeric_limits<double>::infinity ();
+  double xMax = -xMin;
+  double yMin = xMin;
+  double yMax = -xMin;
+  for (const auto &position : devicePositions)
+    {
+      xMin = std::min (xMin, position.x);
+      xMax = std::max (xMax, position.x);
+      yMin = std::min (yMin, position.y);
+      yMax = std::max (yMax, position.y);
+    }
+  // The lattice of a HexGridPositionAllocator, with sites at m_siteSpacing
+  // from each other in columns m_siteSpacing * sqrt (3) / 2 apart, every
+  // other column shifted by half a spacing, generated over the whole enlarged
+  // box instead of a fixed number of rings
+  double columnSpacing = m_siteSpacing * std::sqrt (3.0) / 2;
+  int64_t nColumns = std::ceil (((xMax - xMin) / 2 + m_siteSpacing) / columnSpacing);
+  int64_t nRows = std::ceil (((yMax - yMin) / 2 + m_siteSpacing) / m_siteSpacing) + 1;
+  std::vector<Vector> candidates;
+  for (int64_t j = -nColumns; j <= nColumns; j++)
+    {
+      for (int64_t i = -nRows; i <= nRows; i++)
+        {
+          Vector site ((xMin + xMax) / 2 + j * columnSpacing,
+                       (yMin + yMax) / 2 + (i + (j % 2 != 0 ? 0.5 : 0)) * m_siteSpacing,
+                       m_gatewayHeight);
+          if (site.x >= xMin - m_siteSpacing && site.x <= xMax + m_siteSpacing
+              && site.y >= yMin - m_siteSpacing && site.y <= yMax + m_siteSpacing)
+            {
+              candidates.push_back (site);
+            }
+        }
+    }
+  NS_ASSERT_MSG (candidates.size () >= nGateways,
+                 "Only " << candidates.size () << " candidate sites for " <<
+                 nGateways << " gateways: decrease the site spacing");
+  NS_LOG_DEBUG (candidates.size () << " candidate sites");
+
+  uint32_t nDevices = devicePositions.size ();
+  std::vector<uint8_t> sfIndex;
+  ComputeLinkBudgets (candidates, devicePositions, sfIndex);
+
+  // Greedily pick the sites improving the score of the devices the most
+  std::vector<uint32_t> sites;
+  std::vector<bool> picked (candidates.size (), false);
+  std::vector<uint8_t> best (nDevices, 6);
+  for (uint32_t k = 0; k < nGateways; k++)
+    {
+      double bestGain = -1;
+      uint32_t bestSite = 0;
+      for (uint32_t c = 0; c < candidates.size (); c++)
+        {
+          if (picked[c])
+            {
+              continue;
+            }
+          const uint8_t *row = &sfIndex[(uint64_t) c * nDevices];
+          double gain = 0;
+          for (uint32_t d = 0; d < nDevices; d++)
+            {
+              if (row[d] < best[d])
+                {
+                  gain += GetScore (row[d]) - GetScore (best[d]);
+                }
+            }
+          if (gain > bestGain)
+            {
+              bestGain = gain;
+              bestSite = c;
+            }
+        }
+      picked[bestSite] = true;
+      sites.push_back (bestSite);
+      const uint8_t *row = &sfIndex[(uint64_t) bestSite * nDevices];
+      for (uint32_t d = 0; d < nDevices; d++)
+        {
+          best[d] = std::min (best[d], row[d]);
+        }
+      NS_LOG_DEBUG ("Picked site " << candidates[bestSite] << ", gain " << bestGain);
+    }
+
+  // Move gateways to neighboring sites, as long as the objective improves
+  double current = Evaluate (sites, nDevices, sfIndex);
+  for (uint32_t iteration = 0; iteration < m_iterations; iteration++)
+    {
+      bool improved = false;
+      for (uint32_t g = 0; g < sites.size (); g++)
+        {
+          for (uint32_t c = 0; c < candidates.size (); c++)
+            {
+              if (picked[c]
+                  || CalculateDistance (candidates[c], candidates[sites[g]])
+                  > 1.1 * m_siteSpacing)
+                {
+                  continue;
+                }
+              uint32_t previous = sites[g];
+              sites[g] = c;
+              double objective = Evaluate (sites, nDevices, sfIndex);
+              if (objective > current + 1e-9)
+                {
+                  NS_LOG_DEBUG ("Moved gateway " << g << " to " << candidates[c] <<
+                                ", objective " << objective);
+                  picked[previous] = false;
+                  picked[c] = true;
+                  current = objective;
+                  improved = true;
+                }
+              else
+                {
+                  sites[g] = previous;
+                }
+            }
+        }
+      if (!improved)
+        {
+          break;
+        }
+    }
+
+  // Leave the statistics of the final placement
+  Evaluate (sites, nDevices, sfIndex);
+
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  for (uint32_t site : sites)
+    {
+      allocator->Add (candidates[site]);
+    }
+  return allocator;
+}
+
+void
+GatewayPlacementHelper::ComputeLinkBudgets (const std::vector<Vector> &candidates,
+                                            const std::vector<Vector> &devicePositions,
+                                            std::vector<uint8_t> &sfIndex) const
+{
+  NS_LOG_FUNCTION (this << candidates.size () << devicePositions.size ());
+
+  uint32_t nDevices = devicePositions.size ();
+  sfIndex.assign ((uint64_t) candidates.size () * nDevices, 6);
+
+  uint32_t nThreads = m_nThreads;
+  if (nThreads == 0)
+    {
+      nThreads = std::max (std::thread::hardware_concurrency (), 1u);
+    }
+  nThreads = std::min<uint32_t> (nThreads, candidates.size ());
+  if (nThreads > 1 && !IsStateless (m_channel->GetPropagationLossModel ()))
+    {
+      NS_LOG_WARN ("The propagation loss models keep state: computing the " <<
+                   "link budgets on one thread");
+      nThreads = 1;
+    }
+
+  // Each thread moves its own pair of mobility models, created here since
+  // objects can't be created by several threads at once
+  std::vector<Ptr<ConstantPositionMobilityModel> > deviceMobility;
+  std::vector<Ptr<ConstantPositionMobilityModel> > gatewayMobility;
+  for (uint32_t t = 0; t < nThreads; t++)
+    {
+      deviceMobility.push_back (CreateObject<ConstantPositionMobilityModel> ());
+      gatewayMobility.push_back (CreateObject<ConstantPositionMobilityModel> ());
+    }
+
+  auto compute = [&] (uint32_t t, uint32_t begin, uint32_t end)
+    {
+      for (uint32_t c = begin; c < end; c++)
+        {
+          gatewayMobility[t]->SetPosition (candidates[c]);
+          uint8_t *row = &sfIndex[(uint64_t) c * nDevices];
+          for (uint32_t d = 0; d < nDevices; d++)
+            {
+              deviceMobility[t]->SetPosition (devicePositions[d]);
+              double rxPower = m_channel->GetRxPower (m_txPowerDbm, deviceMobility[t],
+                                                      gatewayMobility[t]);
+              uint8_t sf = 0;
+              while (sf < 6 && rxPower <= GatewayLoraPhy::sensitivity[sf])
+                {
+                  sf++;
+                }
+              row[d] = sf;
+            }
+        }
+    };
+
+  if (nThreads <= 1)
+    {
+      compute (0, 0, candidates.size ());
+      return;
+    }
+
+  std::vector<std::thread> threads;
+  uint32_t chunk = (candidates.size () + nThreads - 1) / nThreads;
+  for (uint32_t t = 0; t * chunk < candidates.size (); t++)
+    {
+      threads.push_back (std::thread (compute, t, t * chunk,
+                                      std::min<uint32_t> ((t + 1) * chunk,
+                                                          candidates.size ())));
+    }
+  for (auto &thread : threads)
+    {
+      thread.join ();
+    }
+}
+
+bool
+GatewayPlacementHelper::IsStateless (Ptr<PropagationLossModel> loss)
+{
+  // Models that only compute a function of the positions, without random
+  // variables or caches, and can thus be evaluated by several threads
+  for (; loss; loss = loss->GetNext ())
+    {
+      TypeId tid = loss->GetInstanceTypeId ();
+      if (tid != LogDistancePropagationLossModel::GetTypeId ()
+          && tid != ThreeLogDistancePropagationLossModel::GetTypeId ()
+          && tid != FriisPropagationLossModel::GetTypeId ()
+          && tid != TwoRayGroundPropagationLossModel::GetTypeId ()
+          && tid != FixedRssLossModel::GetTypeId ()
+          && tid != RangePropagationLossModel::GetTypeId ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+double
+GatewayPlacementHelper::GetScore (uint8_t sfIndex)
+{
+  return sfIndex < 6 ? 1 + (5 - sfIndex) / 5.0 : 0;
+}
+
+double
+GatewayPlacementHelper::Evaluate (const std::vector<uint32_t> &sites, uint32_t nDevices,
+                                  const std::vector<uint8_t> &sfIndex)
+{
+  m_sfQuantity.assign (7, 0);
+  m_loads.assign (sites.size (), 0);
+
+  double score = 0;
+  for (uint32_t d = 0; d < nDevices; d++)
+    {
+      // The device is served by the gateway receiving it at the lowest SF
+      uint8_t best = 6;
+      uint32_t server = 0;
+      for (uint32_t g = 0; g < sites.size (); g++)
+        {
+          uint8_t sf = sfIndex[(uint64_t) sites[g] * nDevices + d];
+          if (sf < best)
+            {
+              best = sf;
+              server = g;
+            }
+        }
+      m_sfQuantity[best]++;
+      if (best < 6)
+        {
+          score += GetScore (best);
+          m_loads[server] += 1 << best;
+        }
+    }
+
+  double peak = *std::max_element (m_loads.begin (), m_loads.end ());
+  double mean = 0;
+  for (double load : m_loads)
+    {
+      mean += load / m_loads.size ();
+    }
+  return score - m_loadWeight * (peak - mean);
+}
+
+}
+}
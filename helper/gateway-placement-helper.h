@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GATEWAY_PLACEMENT_HELPER_H
+#define GATEWAY_PLACEMENT_HELPER_H
+
+#include "ns3/position-allocator.h"
+#include "ns3/node-container.h"
+#include "ns3/lora-channel.h"
+#include "ns3/vector.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * This class chooses the positions of a number of gateways, before the
+ * simulation, given the positions of the end devices and the channel.
+ *
+ * Candidate sites are the nodes of a hexagonal lattice, laid out as by a
+ * HexGridPositionAllocator and centered on the devices, covering their
+ * bounding box enlarged by one site spacing, however large it is. The
+ * lowest SF at which each site receives each device, transmitting at TxPower,
+ * is computed once, possibly by several threads. Sites are then picked
+ * greedily, each one maximizing the gain in score of the devices, a device
+ * scoring 1 at SF12 and 2 at SF7, and 0 out of range. Finally, each gateway is
+ * moved to a neighboring site as long as this improves the total score minus
+ * LoadWeight times the difference between the peak and mean load of the
+ * gateways, a device loading the gateway that receives it at the lowest SF
+ * with its relative time on air (1 at SF7, 32 at SF12).
+ *
+ * The link budgets are computed with mobility models of the helper, without
+ * objects aggregated to them, so loss models that need some, like
+ * BuildingPenetrationLoss, can't be used. Several threads are only used if
+ * all loss models of the channel are deterministic ns-3 models without state,
+ * like LogDistancePropagationLossModel; otherwise, for instance with a
+ * CorrelatedShadowingPropagationLossModel, the link budgets are computed on
+ * one thread.
+ */
+class GatewayPlacementHelper
+{
+public:
+  GatewayPlacementHelper ();
+
+  ~GatewayPlacementHelper ();
+
+  /**
+   * Set the channel whose loss models give the link budgets.
+   */
+  void SetChannel (Ptr<LoraChannel> channel);
+
+  /**
+   * Set the distance between two neighboring candidate sites, in meters.
+   */
+  void SetSiteSpacing (double spacing);
+
+  /**
+   * Set the height of the gateways, in meters.
+   */
+  void SetGatewayHeight (double height);
+
+  /**
+   * Set the transmission power of the devices, in dBm.
+   */
+  void SetTxPower (double txPowerDbm);
+
+  /**
+   * Set the weight of load balancing against coverage: the score a single
+   * device is worth in SF7 time on air of peak load above the mean.
+   */
+  void SetLoadWeight (double loadWeight);
+
+  /**
+   * Set the maximum number of passes moving gateways to neighboring sites.
+   */
+  void SetIterations (uint32_t iterations);
+
+  /**
+   * Set the number of threads computing the link budgets, 0 for one per
+   * core. Channels with loss models that keep state always use one thread.
+   */
+  void SetThreads (uint32_t nThreads);
+
+  /**
+   * Choose the positions of the gateways serving a set of end devices.
+   *
+   * \param endDevices The end devices, with a MobilityModel.
+   * \param nGateways The number of gateways.
+   * \return An allocator giving the position of each gateway.
+   */
+  Ptr<ListPositionAllocator> Optimize (NodeContainer endDevices, uint32_t nGateways);
+
+  /**
+   * Choose the positions of the gateways serving devices at some positions.
+   */
+  Ptr<ListPositionAllocator> Optimize (const std::vector<Vector> &devicePositions,
+                                       uint32_t nGateways);
+
+  /**
+   * Get the number of devices reached at each SF by the last placement, from
+   * SF7 to SF12, followed by the number of devices out of range.
+   */
+  std::vector<uint32_t> GetSfQuantity (void) const;
+
+  /**
+   * Get the load of each gateway of the last placement, in SF7 time on air.
+   */
+  std::vector<double> GetLoads (void) const;
+
+private:
+  /**
+   * Compute the lowest SF index (0 for SF7, 6 if out of range) at which each
+   * candidate site receives each device.
+   */
+  void ComputeLinkBudgets (const std::vector<Vector> &candidates,
+                           const std::vector<Vector> &devicePositions,
+                           std::vector<uint8_t> &sfIndex) const;
+
+  /**
+   * Return whether a chain of loss models can be evaluated by several
+   * threads at once, because none of its models keeps state.
+   */
+  static bool IsStateless (Ptr<PropagationLossModel> loss);
+
+  /**
+   * Get the score of a device received at some SF index.
+   */
+  static double GetScore (uint8_t sfIndex);
+
+  /**
+   * Evaluate a set of sites, filling m_sfQuantity and m_loads.
+   *
+   * \return The total score of the devices, minus the load penalty.
+   */
+  double Evaluate (const std::vector<uint32_t> &sites, uint32_t nDevices,
+                   const std::vector<uint8_t> &sfIndex);
+
+  Ptr<LoraChannel> m_channel;   //!< The channel giving the link budgets
+  double m_siteSpacing;   //!< The distance between neighboring sites
+  double m_gatewayHeight;   //!< The height of the gateways
+  double m_txPowerDbm;   //!< The transmission power of the devices
+  double m_loadWeight;   //!< The weight of the load penalty
+  uint32_t m_iterations;   //!< The maximum number of refinement passes
+  uint32_t m_nThreads;   //!< The threads computing the link budgets
+
+  std::vector<uint32_t> m_sfQuantity;   //!< Devices per SF of the last placement
+  std::vector<double> m_loads;   //!< Load of each gateway of the last placement
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* GATEWAY_PLACEMENT_HELPER_H */
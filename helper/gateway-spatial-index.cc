@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/gateway-spatial-index.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("GatewaySpatialIndex");
+
+GatewaySpatialIndex::GatewaySpatialIndex (const std::vector<Vector> &positions) :
+  m_positions (positions),
+  m_xMin (0),
+  m_yMin (0),
+  m_cellSize (1),
+  m_nx (1),
+  m_ny (1)
+{
+  NS_LOG_FUNCTION (this << positions.size ());
+
+  if (m_positions.empty ())
+    {
+      m_cellStart.assign (2, 0);
+      return;
+    }
+
+  double xMax = m_positions[0].x;
+  double yMax = m_positions[0].y;
+  m_xMin = xMax;
+  m_yMin = yMax;
+  for (auto &position : m_positions)
+    {
+      m_xMin = std::min (m_xMin, position.x);
+      m_yMin = std::min (m_yMin, position.y);
+      xMax = std::max (xMax, position.x);
+      yMax = std::max (yMax, position.y);
+    }
+
+  // About one gateway per cell, with square cells
+  double width = xMax - m_xMin;
+  double height = yMax - m_yMin;
+  double area = width * height;
+  if (area > 0)
+    {
+      m_cellSize = std::sqrt (area / m_positions.size ());
+    }
+  else if (width + height > 0)
+    {
+      // Gateways on a line
+      m_cellSize = (width + height) / m_positions.size ();
+    }
+  m_nx = uint32_t (width / m_cellSize) + 1;
+  m_ny = uint32_t (height / m_cellSize) + 1;
+
+  // Sort the gateways by cell
+  std::vector<uint32_t> cells (m_positions.size ());
+  m_cellStart.assign (m_nx * m_ny + 1, 0);
+  for (uint32_t i = 0; i < m_positions.size (); i++)
+    {
+      uint32_t cx = std::min (uint32_t ((m_positions[i].x - m_xMin) / m_cellSize),
+                              m_nx - 1);
+      uint32_t cy = std::min (uint32_t ((m_positions[i].y - m_yMin) / m_cellSize),
+                              m_ny - 1);
+      cells[i] = cy * m_nx + cx;
+      m_cellStart[cells[i] + 1]++;
+    }
+  for (uint32_t c = 0; c < m_nx * m_ny; c++)
+    {
+      m_cellStart[c + 1] += m_cellStart[c];
+    }
+  m_cellItems.resize (m_positions.size ());
+  std::vector<uint32_t> next (m_cellStart.begin (), m_cellStart.end () - 1);
+  for (uint32_t i = 0; i < m_positions.size (); i++)
+    {
+      m_cellItems[next[cells[i]]++] = i;
+    }
+
+  NS_LOG_DEBUG ("Grid of " << m_nx << "x" << m_ny << " cells of " <<
+                m_cellSize << " m");
+}
+
+uint32_t
+GatewaySpatialIndex::GetN (void) const
+{
+  return m_positions.size ();
+}
+
+void
+GatewaySpatialIndex::GetNearest (const Vector &position, uint32_t k,
+                                 std::vector<uint32_t> &nearest) const
+{
+  nearest.clear ();
+  k = std::min<uint32_t> (k, m_positions.size ());
+  if (k == 0)
+    {
+      return;
+    }
+
+  // The cell of the position, or the closest one if outside of the grid.
+  // Since the grid is convex, no gateway is closer to the position than to
+  // its projection on the grid, so the bounds below hold for both.
+  int64_t cx = std::min<int64_t> (std::max<int64_t> (std::floor ((position.x - m_xMin) / m_cellSize), 0),
+                                  m_nx - 1);
+  int64_t cy = std::min<int64_t> (std::max<int64_t> (std::floor ((position.y - m_yMin) / m_cellSize), 0),
+                                  m_ny - 1);
+
+  // Visit rings of cells around the position, until no farther cell can
+  // hold a gateway closer than the k-th found so far
+  std::vector<std::pair<double, uint32_t> > found;
+  int64_t maxRing = std::max (m_nx, m_ny);
+  for (int64_t ring = 0; ring <= maxRing; ring++)
+    {
+      for (int64_t y = cy - ring; y <= cy + ring; y++)
+        {
+          if (y < 0 || y >= m_ny)
+            {
+              continue;
+            }
+          bool edge = (y == cy - ring || y == cy + ring);
+          for (int64_t x = cx - ring; x <= cx + ring; x += (edge ? 1 : 2 * ring))
+            {
+              if (x >= 0 && x < m_nx)
+                {
+                  uint32_t cell = y * m_nx + x;
+                  for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; i++)
+                    {
+                      uint32_t gw = m_cellItems[i];
+                      double dx = m_positions[gw].x - position.x;
+                      double dy = m_positions[gw].y - position.y;
+                      double dz = m_positions[gw].z - position.z;
+                      found.push_back (std::make_pair (dx * dx + dy * dy + dz * dz, gw));
+                    }
+                }
+            }
+        }
+
+      if (found.size () >= k)
+        {
+          std::nth_element (found.begin (), found.begin () + k - 1, found.end ());
+          double bound = ring * m_cellSize;
+          if (found[k - 1].first < bound * bound)
+            {
+              break;
+            }
+        }
+    }
+
+  std::partial_sort (found.begin (), found.begin () + k, found.end ());
+  for (uint32_t i = 0; i < k; i++)
+    {
+      nearest.push_back (found[i].second);
+    }
+}
+
+}
+}
@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GATEWAY_SPATIAL_INDEX_H
+#define GATEWAY_SPATIAL_INDEX_H
+
+#include "ns3/vector.h"
+
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * A uniform grid over the positions of a set of gateways, to find the ones
+ * closest to a point without measuring the distance to all of them.
+ *
+ * The grid is built on the x and y coordinates, with about one gateway per
+ * cell, while distances are measured in three dimensions. The index only
+ * holds copies of the positions, so that it can be queried from several
+ * threads at once.
+ */
+class GatewaySpatialIndex
+{
+public:
+  /**
+   * Build the index.
+   *
+   * \param positions The positions of the gateways.
+   */
+  GatewaySpatialIndex (const std::vector<Vector> &positions);
+
+  /**
+   * Get the number of gateways in the index.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * Find the gateways closest to a position.
+   *
+   * \param position The position.
+   * \param k The number of gateways to find.
+   * \param nearest Filled with the indexes of the min (k, GetN ()) closest
+   * gateways, by increasing distance. Gateways at the same distance are
+   * sorted by index.
+   */
+  void GetNearest (const Vector &position, uint32_t k,
+                   std::vector<uint32_t> &nearest) const;
+
+private:
+  std::vector<Vector> m_positions;   //!< The positions of the gateways
+  double m_xMin;   //!< The smallest x coordinate
+  double m_yMin;   //!< The smallest y coordinate
+  double m_cellSize;   //!< The side of a cell, in meters
+  uint32_t m_nx;   //!< The number of columns of cells
+  uint32_t m_ny;   //!< The number of rows of cells
+  std::vector<uint32_t> m_cellStart;   //!< Where each cell starts in m_cellItems
+  std::vector<uint32_t> m_cellItems;   //!< The gateways, sorted by cell
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* GATEWAY_SPATIAL_INDEX_H */
@@ -0,0 +1,230 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/latency-histogram.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LatencyHistogram");
+
+// Largest tracked latency, in microseconds
+static const uint64_t MAX_VALUE = (uint64_t (1) << 36) - 1;
+
+LatencyHistogram::LatencyHistogram (uint8_t significantBits) :
+  m_significantBits (significantBits),
+  m_count (0),
+  m_sum (0),
+  m_min (std::numeric_limits<uint64_t>::max ()),
+  m_max (0)
+{
+  NS_ASSERT (significantBits > 0 && significantBits < 16);
+}
+
+void
+LatencyHistogram::Record (Time latency)
+{
+  uint64_t value = std::min<uint64_t> (std::max<int64_t>
+                                         (latency.GetMicroSeconds (), 0),
+                                       MAX_VALUE);
+
+  uint32_t index = GetIndex (value);
+  if (index >= m_counts.size ())
+    {
+      m_counts.resize (index + 1, 0);
+    }
+  m_counts[index]++;
+
+  m_count++;
+  m_sum += value;
+  m_min = std::min (m_min, value);
+  m_max = std::max (m_max, value);
+}
+
+void
+LatencyHistogram::Merge (const LatencyHistogram &other)
+{
+  NS_ABORT_MSG_UNLESS (m_significantBits == other.m_significantBits,
+                       "Cannot merge histograms with a different resolution");
+
+  if (m_counts.size () < other.m_counts.size ())
+    {
+      m_counts.resize (other.m_counts.size (), 0);
+    }
+  for (uint32_t i = 0; i < other.m_counts.size (); i++)
+    {
+      m_counts[i] += other.m_counts[i];
+    }
+
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+  m_min = std::min (m_min, other.m_min);
+  m_max = std::max (m_max, other.m_max);
+}
+
+void
+LatencyHistogram::Reset (void)
+{
+  m_counts.clear ();
+  m_count = 0;
+  m_sum = 0;
+  m_min = std::numeric_limits<uint64_t>::max ();
+  m_max = 0;
+}
+
+uint64_t
+LatencyHistogram::GetCount (void) const
+{
+  return m_count;
+}
+
+Time
+LatencyHistogram::GetMin (void) const
+{
+  return m_count ? MicroSeconds (m_min) : Seconds (0);
+}
+
+Time
+LatencyHistogram::GetMax (void) const
+{
+  return MicroSeconds (m_max);
+}
+
+Time
+LatencyHistogram::GetMean (void) const
+{
+  return m_count ? MicroSeconds (m_sum / m_count) : Seconds (0);
+}
+
+Time
+LatencyHistogram::GetPercentile (double percentile) const
+{
+  NS_ASSERT (percentile >= 0 && percentile <= 100);
+
+  if (m_count == 0)
+    {
+      return Seconds (0);
+    }
+
+  // The rank of the latency we are looking for, starting from 1
+  uint64_t rank = std::max<uint64_t> (std::ceil (percentile / 100 * m_count),
+                                      1);
+
+  uint64_t seen = 0;
+  uint32_t index = 0;
+  for (; index < m_counts.size (); index++)
+    {
+      seen += m_counts[index];
+      if (seen >= rank)
+        {
+          break;
+        }
+    }
+
+  uint64_t value = GetLowestValue (index) + GetWidth (index) / 2;
+  return MicroSeconds (std::min (std::max (value, m_min), m_max));
+}
+
+void
+LatencyHistogram::Serialize (std::ostream &os) const
+{
+  os << unsigned (m_significantBits) << " " << m_count << " " << m_sum << " "
+     << m_min << " " << m_max;
+
+  // Only non-empty buckets, as index-count pairs
+  for (uint32_t i = 0; i < m_counts.size (); i++)
+    {
+      if (m_counts[i])
+        {
+          os << " " << i << " " << m_counts[i];
+        }
+    }
+  os << std::endl;
+}
+
+void
+LatencyHistogram::Deserialize (std::istream &is)
+{
+  std::string line;
+  std::getline (is, line);
+  std::istringstream ss (line);
+
+  unsigned significantBits;
+  ss >> significantBits >> m_count >> m_sum >> m_min >> m_max;
+  NS_ABORT_MSG_IF (ss.fail () || significantBits == 0 || significantBits >= 16,
+                   "Malformed latency histogram: " << line);
+  m_significantBits = significantBits;
+
+  m_counts.clear ();
+  uint32_t index;
+  uint64_t count;
+  while (ss >> index >> count)
+    {
+      NS_ABORT_MSG_IF (index > GetIndex (MAX_VALUE),
+                       "Malformed latency histogram: " << line);
+      if (index >= m_counts.size ())
+        {
+          m_counts.resize (index + 1, 0);
+        }
+      m_counts[index] = count;
+    }
+}
+
+uint32_t
+LatencyHistogram::GetIndex (uint64_t value) const
+{
+  // Values in [2^(m + b), 2^(m + b + 1)) are split in 2^b buckets of width
+  // 2^m, and values below 2^(b + 1) have a bucket each
+  const uint64_t subBuckets = uint64_t (1) << m_significantBits;
+  uint32_t magnitude = 0;
+  while ((value >> magnitude) >= 2 * subBuckets)
+    {
+      magnitude++;
+    }
+  return magnitude * subBuckets + (value >> magnitude);
+}
+
+uint64_t
+LatencyHistogram::GetLowestValue (uint32_t index) const
+{
+  const uint64_t subBuckets = uint64_t (1) << m_significantBits;
+  if (index < 2 * subBuckets)
+    {
+      return index;
+    }
+  uint32_t magnitude = index / subBuckets - 1;
+  return (index - magnitude * subBuckets) << magnitude;
+}
+
+uint64_t
+LatencyHistogram::GetWidth (uint32_t index) const
+{
+  const uint64_t subBuckets = uint64_t (1) << m_significantBits;
+  if (index < 2 * subBuckets)
+    {
+      return 1;
+    }
+  return uint64_t (1) << (index / subBuckets - 1);
+}
+
+}
+}
@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include "ns3/nstime.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * A histogram of latencies with logarithmic buckets, to estimate percentiles
+ * in bounded memory.
+ *
+ * Latencies are recorded with microsecond resolution. Each power of two is
+ * split into 2^significantBits buckets of equal width, so that the relative
+ * error of a percentile is below 2^-(significantBits + 1). Latencies up to
+ * 2^36 microseconds (about 19 hours) are tracked, and larger ones are counted
+ * in the last bucket. Buckets are only allocated up to the largest latency
+ * recorded so far.
+ *
+ * Histograms with the same number of significant bits can be merged, for
+ * instance to combine several time windows, or several replications of a
+ * simulation through Serialize and Deserialize.
+ */
+class LatencyHistogram
+{
+public:
+  /**
+   * Create an empty histogram.
+   *
+   * \param significantBits The log2 of the number of buckets per power of two.
+   */
+  LatencyHistogram (uint8_t significantBits = 5);
+
+  /**
+   * Add a latency to the histogram.
+   *
+   * \param latency The latency. Negative latencies are counted as 0.
+   */
+  void Record (Time latency);
+
+  /**
+   * Add the latencies of another histogram to this one.
+   *
+   * \param other A histogram with the same number of significant bits.
+   */
+  void Merge (const LatencyHistogram &other);
+
+  /**
+   * Remove all latencies from the histogram.
+   */
+  void Reset (void);
+
+  /**
+   * Get the number of latencies in the histogram.
+   */
+  uint64_t GetCount (void) const;
+
+  /**
+   * Get the smallest latency, or 0 if the histogram is empty.
+   */
+  Time GetMin (void) const;
+
+  /**
+   * Get the largest latency, or 0 if the histogram is empty.
+   */
+  Time GetMax (void) const;
+
+  /**
+   * Get the average latency, or 0 if the histogram is empty.
+   */
+  Time GetMean (void) const;
+
+  /**
+   * Estimate a percentile of the latencies.
+   *
+   * \param percentile The percentile, between 0 and 100.
+   * \return The middle of the bucket the percentile falls in, or 0 if the
+   * histogram is empty.
+   */
+  Time GetPercentile (double percentile) const;
+
+  /**
+   * Write the histogram to a stream, on a single line of text.
+   */
+  void Serialize (std::ostream &os) const;
+
+  /**
+   * Replace the histogram with one read from a stream, as written by
+   * Serialize.
+   */
+  void Deserialize (std::istream &is);
+
+private:
+  /**
+   * Get the bucket of a latency, in microseconds.
+   */
+  uint32_t GetIndex (uint64_t value) const;
+
+  /**
+   * Get the smallest latency, in microseconds, of a bucket.
+   */
+  uint64_t GetLowestValue (uint32_t index) const;
+
+  /**
+   * Get the width, in microseconds, of a bucket.
+   */
+  uint64_t GetWidth (uint32_t index) const;
+
+  uint8_t m_significantBits;   //!< Log2 of the buckets per power of two
+  std::vector<uint64_t> m_counts;   //!< Latencies per bucket
+  uint64_t m_count;   //!< Number of latencies
+  uint64_t m_sum;   //!< Sum of the latencies, in microseconds
+  uint64_t m_min;   //!< Smallest latency, in microseconds
+  uint64_t m_max;   //!< Largest latency, in microseconds
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* LATENCY_HISTOGRAM_H */
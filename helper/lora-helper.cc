@@ -20,8 +20,15 @@
 
 #include "ns3/lora-helper.h"
 #include "ns3/log.h"
+#include "ns3/lora-interference-helper.h"
+#include "ns3/simple-gateway-lora-phy.h"
+#include "ns3/simple-end-device-lora-phy.h"
+#include "ns3/virtual-end-device-population.h"
+#include "ns3/trace-source-accessor.h"
 
 #include <fstream>
+#include <sstream>
+#include <unistd.h>
 
 namespace ns3 {
 namespace lorawan {
@@ -30,7 +37,10 @@ NS_LOG_COMPONENT_DEFINE ("LoraHelper");
 
   LoraHelper::LoraHelper () :
     m_lastPhyPerformanceUpdate (Seconds (0)),
-    m_lastGlobalPerformanceUpdate (Seconds (0))
+    m_lastGlobalPerformanceUpdate (Seconds (0)),
+    m_lastReportEvents (0),
+    m_lastReportSimTime (Seconds (0)),
+    m_stopTime (Seconds (0))
   {
   }
 
@@ -38,6 +48,38 @@ NS_LOG_COMPONENT_DEFINE ("LoraHelper");
   {
   }
 
+namespace {
+
+/**
+ * A trace source to connect on every device of an Install call.
+ */
+struct TraceConnection
+{
+  std::string name;   //!< The name of the trace source
+  CallbackBase callback;   //!< The callback, built once
+  Ptr<const TraceSourceAccessor> accessor;   //!< Resolved on the first device
+};
+
+/**
+ * Connect the trace sources of an object, resolving their names only once.
+ */
+void
+ConnectTraces (Ptr<Object> object, std::vector<TraceConnection> &traces)
+{
+  for (auto &trace : traces)
+    {
+      if (trace.accessor == 0)
+        {
+          // All devices of an Install call have the same type
+          trace.accessor = object->GetInstanceTypeId ().LookupTraceSourceByName (trace.name);
+          NS_ASSERT_MSG (trace.accessor != 0, "No trace source " << trace.name);
+        }
+      trace.accessor->ConnectWithoutContext (PeekPointer (object), trace.callback);
+    }
+}
+
+}
+
   NetDeviceContainer
   LoraHelper::Install ( const LoraPhyHelper &phyHelper,
                         const LorawanMacHelper &macHelper,
@@ -47,6 +89,56 @@ NS_LOG_COMPONENT_DEFINE ("LoraHelper");
 
     NetDeviceContainer devices;
 
+    // Decide once which trace sources to connect, rather than once per
+    // device, since installs of a million devices are not uncommon
+    std::vector<TraceConnection> phyTraces;
+    std::vector<TraceConnection> macTraces;
+    if (m_packetTracker)
+      {
+        TypeId phyType = phyHelper.GetDeviceType ();
+        if (phyType == SimpleEndDeviceLoraPhy::GetTypeId ())
+          {
+            phyTraces.push_back ({"StartSending",
+                                  MakeCallback (&LoraPacketTracker::TransmissionCallback,
+                                                m_packetTracker)});
+
+            macTraces.push_back ({"SentNewPacket",
+                                  MakeCallback (&LoraPacketTracker::MacTransmissionCallback,
+                                                m_packetTracker)});
+            macTraces.push_back ({"RequiredTransmissions",
+                                  MakeCallback (&LoraPacketTracker::RequiredTransmissionsCallback,
+                                                m_packetTracker)});
+          }
+        else if (phyType == SimpleGatewayLoraPhy::GetTypeId ())
+          {
+            phyTraces.push_back ({"StartSending",
+                                  MakeCallback (&LoraPacketTracker::TransmissionCallback,
+                                                m_packetTracker)});
+            phyTraces.push_back ({"ReceivedPacket",
+                                  MakeCallback (&LoraPacketTracker::PacketReceptionCallback,
+                                                m_packetTracker)});
+            phyTraces.push_back ({"LostPacketBecauseInterference",
+                                  MakeCallback (&LoraPacketTracker::InterferenceCallback,
+                                                m_packetTracker)});
+            phyTraces.push_back ({"LostPacketBecauseNoMoreReceivers",
+                                  MakeCallback (&LoraPacketTracker::NoMoreReceiversCallback,
+                                                m_packetTracker)});
+            phyTraces.push_back ({"LostPacketBecauseUnderSensitivity",
+                                  MakeCallback (&LoraPacketTracker::UnderSensitivityCallback,
+                                                m_packetTracker)});
+            phyTraces.push_back ({"NoReceptionBecauseTransmitting",
+                                  MakeCallback (&LoraPacketTracker::LostBecauseTxCallback,
+                                                m_packetTracker)});
+
+            macTraces.push_back ({"SentNewPacket",
+                                  MakeCallback (&LoraPacketTracker::MacTransmissionCallback,
+                                                m_packetTracker)});
+            macTraces.push_back ({"ReceivedPacket",
+                                  MakeCallback (&LoraPacketTracker::MacGwReceptionCallback,
+                                                m_packetTracker)});
+          }
+      }
+
     // Go over the various nodes in which to install the NetDevice
     for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
       {
@@ -62,45 +154,7 @@ NS_LOG_COMPONENT_DEFINE ("LoraHelper");
         NS_LOG_DEBUG ("Done creating the PHY");
 
         // Connect Trace Sources if necessary
-        if (m_packetTracker)
-          {
-            if (phyHelper.GetDeviceType () ==
-                TypeId::LookupByName ("ns3::SimpleEndDeviceLoraPhy"))
-              {
-                phy->TraceConnectWithoutContext ("StartSending",
-                                                 MakeCallback
-                                                 (&LoraPacketTracker::TransmissionCallback,
-                                                  m_packetTracker));
-              }
-            else if (phyHelper.GetDeviceType () ==
-                     TypeId::LookupByName ("ns3::SimpleGatewayLoraPhy"))
-            {
-              phy->TraceConnectWithoutContext ("StartSending",
-                                               MakeCallback
-                                               (&LoraPacketTracker::TransmissionCallback,
-                                                m_packetTracker));
-              phy->TraceConnectWithoutContext ("ReceivedPacket",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::PacketReceptionCallback,
-                                                 m_packetTracker));
-              phy->TraceConnectWithoutContext ("LostPacketBecauseInterference",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::InterferenceCallback,
-                                                 m_packetTracker));
-              phy->TraceConnectWithoutContext ("LostPacketBecauseNoMoreReceivers",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::NoMoreReceiversCallback,
-                                                 m_packetTracker));
-              phy->TraceConnectWithoutContext ("LostPacketBecauseUnderSensitivity",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::UnderSensitivityCallback,
-                                                 m_packetTracker));
-              phy->TraceConnectWithoutContext ("NoReceptionBecauseTransmitting",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::LostBecauseTxCallback,
-                                                 m_packetTracker));
-            }
-        }
+        ConnectTraces (phy, phyTraces);
 
       // Create the MAC
       Ptr<LorawanMac> mac = macHelper.Create (node, device);
@@ -109,35 +163,7 @@ NS_LOG_COMPONENT_DEFINE ("LoraHelper");
       NS_LOG_DEBUG ("Done creating the MAC");
       device->SetMac (mac);
 
-      if (m_packetTracker)
-        {
-          if (phyHelper.GetDeviceType () ==
-              TypeId::LookupByName ("ns3::SimpleEndDeviceLoraPhy"))
-            {
-              mac->TraceConnectWithoutContext ("SentNewPacket",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::MacTransmissionCallback,
-                                                 m_packetTracker));
-
-              mac->TraceConnectWithoutContext ("RequiredTransmissions",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::RequiredTransmissionsCallback,
-                                                 m_packetTracker));
-            }
-          else if (phyHelper.GetDeviceType () ==
-                   TypeId::LookupByName ("ns3::SimpleGatewayLoraPhy"))
-            {
-              mac->TraceConnectWithoutContext ("SentNewPacket",
-                                               MakeCallback
-                                               (&LoraPacketTracker::MacTransmissionCallback,
-                                                m_packetTracker));
-
-              mac->TraceConnectWithoutContext ("ReceivedPacket",
-                                               MakeCallback
-                                               (&LoraPacketTracker::MacGwReceptionCallback,
-                                                m_packetTracker));
-            }
-        }
+      ConnectTraces (mac, macTraces);
 
       node->AddDevice (device);
       devices.Add (device);
@@ -163,6 +189,22 @@ LoraHelper::EnablePacketTracking ()
   m_packetTracker = new LoraPacketTracker ();
 }
 
+void
+LoraHelper::ConnectPacketTracker (Ptr<VirtualEndDevicePopulation> population) const
+{
+  NS_LOG_FUNCTION (this << population);
+
+  if (m_packetTracker)
+    {
+      population->TraceConnectWithoutContext
+        ("StartSending", MakeCallback (&LoraPacketTracker::TransmissionCallback,
+                                       m_packetTracker));
+      population->TraceConnectWithoutContext
+        ("SentNewPacket", MakeCallback (&LoraPacketTracker::MacTransmissionCallback,
+                                        m_packetTracker));
+    }
+}
+
 LoraPacketTracker&
 LoraHelper::GetPacketTracker (void)
 {
@@ -172,9 +214,24 @@ LoraHelper::GetPacketTracker (void)
 }
 
 void
-LoraHelper::EnableSimulationTimePrinting (Time interval)
+LoraHelper::EnableSimulationTimePrinting (Time interval, Time stopTime,
+                                          std::string filename)
 {
   m_oldtime = std::time (0);
+  m_lastReportTime = std::chrono::steady_clock::now ();
+  m_lastReportEvents = Simulator::GetEventCount ();
+  m_lastReportSimTime = Simulator::Now ();
+  m_stopTime = stopTime;
+  m_telemetryFilename = filename;
+
+  if (!m_telemetryFilename.empty ())
+    {
+      GetWriter ().Write (m_telemetryFilename,
+                          "# realTime simTime events eventsPerSecond "
+                          "residentMemory interferenceEvents trackerRecords "
+                          "remainingRealTime\n", true);
+    }
+
   Simulator::Schedule (Seconds (0), &LoraHelper::DoPrintSimulationTime, this,
                        interval);
 }
@@ -199,47 +256,42 @@ void
 LoraHelper::DoPrintDeviceStatus (NodeContainer endDevices, NodeContainer gateways,
                                  std::string filename)
 {
-  const char * c = filename.c_str ();
-  std::ofstream outputFile;
-  if (Simulator::Now () == Seconds (0))
-    {
-      // Delete contents of the file as it is opened
-      outputFile.open (c, std::ofstream::out | std::ofstream::trunc);
-    }
-  else
+  NS_LOG_FUNCTION (this);
+
+  std::vector<DeviceStatusEntry> &entries = m_deviceStatusCache[filename];
+  if (entries.size () != endDevices.GetN ())
     {
-      // Only append to the file
-      outputFile.open (c, std::ofstream::out | std::ofstream::app);
+      entries.clear ();
+      entries.reserve (endDevices.GetN ());
+      for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
+        {
+          DeviceStatusEntry entry;
+          entry.node = *j;
+          entry.mobility = entry.node->GetObject<MobilityModel> ();
+          NS_ASSERT (entry.mobility != NULL);
+          Ptr<LoraNetDevice> loraNetDevice =
+            entry.node->GetDevice (0)->GetObject<LoraNetDevice> ();
+          NS_ASSERT (loraNetDevice != NULL);
+          entry.mac = loraNetDevice->GetMac ()->GetObject<ClassAEndDeviceLorawanMac> ();
+          entries.push_back (entry);
+        }
     }
 
-  Time currentTime = Simulator::Now();
-  for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
+  std::ostringstream output;
+  double currentTime = Simulator::Now ().GetSeconds ();
+  for (auto &entry : entries)
     {
-      Ptr<Node> object = *j;
-      Ptr<MobilityModel> position = object->GetObject<MobilityModel> ();
-      NS_ASSERT (position != NULL);
-      Ptr<NetDevice> netDevice = object->GetDevice (0);
-      Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice> ();
-      NS_ASSERT (loraNetDevice != NULL);
-      Ptr<ClassAEndDeviceLorawanMac> mac = loraNetDevice->GetMac ()->GetObject<ClassAEndDeviceLorawanMac> ();
-      int dr = int(mac->GetDataRate ());
-      double txPower = mac->GetTransmissionPower ();
-      Vector pos = position->GetPosition ();
-      outputFile << currentTime.GetSeconds () << " "
-                 << object->GetId () <<  " "
-                 << pos.x << " " << pos.y << " " << dr << " "
-                 << unsigned(txPower) << std::endl;
+      int dr = int(entry.mac->GetDataRate ());
+      double txPower = entry.mac->GetTransmissionPower ();
+      Vector pos = entry.mobility->GetPosition ();
+      output << currentTime << " "
+             << entry.node->GetId () <<  " "
+             << pos.x << " " << pos.y << " " << dr << " "
+             << unsigned(txPower) << "\n";
     }
-  // for (NodeContainer::Iterator j = gateways.Begin (); j != gateways.End (); ++j)
-  //   {
-  //     Ptr<Node> object = *j;
-  //     Ptr<MobilityModel> position = object->GetObject<MobilityModel> ();
-  //     Vector pos = position->GetPosition ();
-  //     outputFile << currentTime.GetSeconds () << " "
-  //                << object->GetId () <<  " "
-  //                << pos.x << " " << pos.y << " " << "-1 -1" << std::endl;
-  //   }
-  outputFile.close ();
+
+  // Delete contents of the file at the first snapshot, append afterwards
+  GetWriter ().Write (filename, output.str (), Simulator::Now () == Seconds (0));
 }
 
 
@@ -264,32 +316,48 @@ LoraHelper::DoPrintPhyPerformance (NodeContainer gateways,
 {
   NS_LOG_FUNCTION (this);
 
-  const char * c = filename.c_str ();
-  std::ofstream outputFile;
-  if (Simulator::Now () == Seconds (0))
-    {
-      // Delete contents of the file as it is opened
-      outputFile.open (c, std::ofstream::out | std::ofstream::trunc);
-    }
-  else
+  std::ostringstream output;
+
+  if (!m_packetTracker)
     {
-      // Only append to the file
-      outputFile.open (c, std::ofstream::out | std::ofstream::app);
+      // Snapshot the counters kept by the gateways themselves
+      for (auto it = gateways.Begin (); it != gateways.End (); ++it)
+        {
+          Ptr<SimpleGatewayLoraPhy> phy = (*it)->GetDevice (0)->GetObject<LoraNetDevice> ()
+            ->GetPhy ()->GetObject<SimpleGatewayLoraPhy> ();
+          NS_ASSERT (phy != NULL);
+          for (uint8_t sf = 7; sf <= 12; sf++)
+            {
+              const SimpleGatewayLoraPhy::PerformanceCounters &counters =
+                phy->GetPerformanceCounters (sf);
+              output << Simulator::Now ().GetSeconds () << " " <<
+                (*it)->GetId () << " " << unsigned (sf) << " " <<
+                counters.received << " " << counters.interfered << " " <<
+                counters.noMoreDemodulators << " " <<
+                counters.underSensitivity << " " << counters.lostBecauseTx <<
+                " " << counters.occupancy.GetSeconds () << "\n";
+            }
+        }
+
+      GetWriter ().Write (filename, output.str (), Simulator::Now () == Seconds (0));
+      return;
     }
 
+  // Count once for all gateways
+  TrackerMetrics metrics =
+    m_packetTracker->GetMetrics (m_lastPhyPerformanceUpdate, Simulator::Now ());
   for (auto it = gateways.Begin (); it != gateways.End (); ++it)
     {
       int systemId = (*it)->GetId ();
-      outputFile << Simulator::Now ().GetSeconds () << " " <<
+      output << Simulator::Now ().GetSeconds () << " " <<
         std::to_string(systemId) << " " <<
-        m_packetTracker->PrintPhyPacketsPerGw(m_lastPhyPerformanceUpdate,
-                                              Simulator::Now (),
-                                              systemId) << std::endl;
+        metrics.PrintPhyPackets (systemId) << "\n";
     }
 
   m_lastPhyPerformanceUpdate = Simulator::Now ();
 
-  outputFile.close();
+  // Delete contents of the file at the first snapshot, append afterwards
+  GetWriter ().Write (filename, output.str (), Simulator::Now () == Seconds (0));
 }
 
 void
@@ -311,27 +379,28 @@ LoraHelper::DoPrintGlobalPerformance (std::string filename)
 {
   NS_LOG_FUNCTION (this);
 
-  const char * c = filename.c_str ();
-  std::ofstream outputFile;
-  if (Simulator::Now () == Seconds (0))
-    {
-      // Delete contents of the file as it is opened
-      outputFile.open (c, std::ofstream::out | std::ofstream::trunc);
-    }
-  else
-    {
-      // Only append to the file
-      outputFile.open (c, std::ofstream::out | std::ofstream::app);
-    }
-
-  outputFile << Simulator::Now ().GetSeconds () << " " <<
+  std::ostringstream output;
+  output << Simulator::Now ().GetSeconds () << " " <<
     m_packetTracker->CountMacPacketsGlobally (m_lastGlobalPerformanceUpdate,
-                                              Simulator::Now ()) <<
-    std::endl;
+                                              Simulator::Now ()) << "\n";
 
   m_lastGlobalPerformanceUpdate = Simulator::Now ();
 
-  outputFile.close();
+  // Delete contents of the file at the first snapshot, append afterwards
+  GetWriter ().Write (filename, output.str (), Simulator::Now () == Seconds (0));
+}
+
+AsyncFileWriter &
+LoraHelper::GetWriter (void)
+{
+  if (!m_writer)
+    {
+      m_writer = Create<AsyncFileWriter> ();
+
+      // Make sure files are complete when the simulation is over
+      Simulator::ScheduleDestroy (&AsyncFileWriter::Flush, m_writer);
+    }
+  return *m_writer;
 }
 
 void
@@ -341,8 +410,70 @@ LoraHelper::DoPrintSimulationTime (Time interval)
   std::cout << "Simulated time: " << Simulator::Now ().GetHours () << " hours" << std::endl;
   std::cout << "Real time from last call: " << std::time (0) - m_oldtime << " seconds" << std::endl;
   m_oldtime = std::time (0);
+
+  // Rates over the last interval
+  auto now = std::chrono::steady_clock::now ();
+  double realSeconds =
+    std::chrono::duration<double> (now - m_lastReportTime).count ();
+  uint64_t events = Simulator::GetEventCount ();
+  double eventsPerSecond = 0;
+  double remainingSeconds = -1;
+  if (realSeconds > 0)
+    {
+      eventsPerSecond = (events - m_lastReportEvents) / realSeconds;
+      double speed = (Simulator::Now () - m_lastReportSimTime).GetSeconds () /
+        realSeconds;
+      if (m_stopTime.IsStrictlyPositive () && speed > 0)
+        {
+          remainingSeconds = (m_stopTime - Simulator::Now ()).GetSeconds () /
+            speed;
+        }
+    }
+  m_lastReportTime = now;
+  m_lastReportEvents = events;
+  m_lastReportSimTime = Simulator::Now ();
+
+  uint64_t memory = GetResidentMemory ();
+  uint64_t interferenceEvents = LoraInterferenceHelper::GetActiveEventCount ();
+  uint64_t trackerRecords = m_packetTracker ?
+    m_packetTracker->GetRecordCount () : 0;
+
+  std::cout << "Events: " << events << " (" << eventsPerSecond << " per second)"
+            << ", memory: " << memory / 1048576.0 << " MB"
+            << ", interference events: " << interferenceEvents
+            << ", tracker records: " << trackerRecords;
+  if (remainingSeconds >= 0)
+    {
+      std::cout << ", projected end in " << remainingSeconds << " seconds";
+    }
+  std::cout << std::endl;
+
+  if (!m_telemetryFilename.empty ())
+    {
+      std::ostringstream output;
+      output << m_oldtime << " "
+             << Simulator::Now ().GetSeconds () << " " << events << " "
+             << eventsPerSecond << " " << memory << " " << interferenceEvents
+             << " " << trackerRecords << " " << remainingSeconds << "\n";
+      GetWriter ().Write (m_telemetryFilename, output.str (), false);
+    }
+
   Simulator::Schedule (interval, &LoraHelper::DoPrintSimulationTime, this, interval);
 }
 
+uint64_t
+LoraHelper::GetResidentMemory (void)
+{
+  // The second field of statm is the number of resident pages (Linux only)
+  std::ifstream statm ("/proc/self/statm");
+  uint64_t size = 0;
+  uint64_t resident = 0;
+  if (statm >> size >> resident)
+    {
+      return resident * sysconf (_SC_PAGESIZE);
+    }
+  return 0;
+}
+
 }
 }
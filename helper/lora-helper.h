@@ -28,12 +28,20 @@
 #include "ns3/net-device.h"
 #include "ns3/lora-net-device.h"
 #include "ns3/lora-packet-tracker.h"
+#include "ns3/async-file-writer.h"
+#include "ns3/class-a-end-device-lorawan-mac.h"
+#include "ns3/mobility-model.h"
 
+#include <chrono>
 #include <ctime>
+#include <map>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
 
+class VirtualEndDevicePopulation;
+
 /**
  * Helps to create LoraNetDevice objects
  *
@@ -81,10 +89,30 @@ public:
    */
   void EnablePacketTracking (void);
 
+  /**
+   * Connect the packet tracker, if packet tracking is enabled, to the trace
+   * sources of a VirtualEndDevicePopulation, so that the packets of its
+   * devices are tracked like the ones of installed devices.
+   */
+  void ConnectPacketTracker (Ptr<VirtualEndDevicePopulation> population) const;
+
   /**
    * Periodically prints the simulation time to the standard output.
+   *
+   * Besides the simulated and real time, each report includes the number of
+   * events executed per second, the resident memory, the number of events
+   * kept by LoraInterferenceHelper instances, the number of records kept by
+   * the packet tracker and, if the stop time is known, the projected real time
+   * until the end of the simulation.
+   *
+   * \param interval The simulated time between two reports.
+   * \param stopTime The time at which the simulation will stop, or 0 if
+   * unknown.
+   * \param filename If not empty, also append each report to this file, as a
+   * line of space-separated values.
    */
-  void EnableSimulationTimePrinting (Time interval);
+  void EnableSimulationTimePrinting (Time interval, Time stopTime = Seconds (0),
+                                     std::string filename = "");
 
   /**
    * Periodically prints the status of devices in the network to a file.
@@ -101,6 +129,17 @@ public:
                                              std::string filename,
                                              Time interval);
 
+  /**
+   * Print the PHY-level performance of every gateway in the container.
+   *
+   * If packet tracking is enabled, each line holds the counts of the packets
+   * sent since the last call, as given by
+   * LoraPacketTracker::PrintPhyPacketsPerGw. Otherwise, each line holds the
+   * counters kept by a SimpleGatewayLoraPhy for a spreading factor since the
+   * start of the simulation: time, gateway id, SF, received, interfered, no
+   * more demodulators, under sensitivity, lost because transmitting, and
+   * reception path occupancy in seconds.
+   */
   void DoPrintPhyPerformance (NodeContainer gateways, std::string filename);
 
   /**
@@ -119,19 +158,53 @@ public:
 
   /**
    * Print a summary of the status of all devices in the network.
+   *
+   * The objects of each device are looked up the first time a container is
+   * printed to a file, and reused afterwards. Like the other printing
+   * functions, this formats the output in memory and leaves the writing to a
+   * background thread: files are complete after Simulator::Destroy.
    */
   void DoPrintDeviceStatus (NodeContainer endDevices, NodeContainer gateways,
                             std::string filename);
 
 private:
+  /**
+   * The objects of an end device whose status is printed.
+   */
+  struct DeviceStatusEntry
+  {
+    Ptr<Node> node;
+    Ptr<MobilityModel> mobility;
+    Ptr<ClassAEndDeviceLorawanMac> mac;
+  };
+
+  /**
+   * Get the writer of the output files, creating it if necessary.
+   */
+  AsyncFileWriter &GetWriter (void);
+
   /**
    * Actually print the simulation time and re-schedule execution of this
    * function.
    */
   void DoPrintSimulationTime (Time interval);
 
+  /**
+   * Get the resident memory of the process in bytes, or 0 if unknown.
+   */
+  static uint64_t GetResidentMemory (void);
+
   Time m_lastPhyPerformanceUpdate;
   Time m_lastGlobalPerformanceUpdate;
+
+  Ptr<AsyncFileWriter> m_writer;   //!< Writes the output files
+
+  std::chrono::steady_clock::time_point m_lastReportTime;   //!< Real time of the last report
+  uint64_t m_lastReportEvents;   //!< Events executed at the last report
+  Time m_lastReportSimTime;   //!< Simulated time of the last report
+  Time m_stopTime;   //!< Expected stop time of the simulation, or 0
+  std::string m_telemetryFilename;   //!< Machine-readable reports, if not empty
+  std::map<std::string, std::vector<DeviceStatusEntry> > m_deviceStatusCache;   //!< Per file
 };
 
 } //namespace ns3
@@ -0,0 +1,223 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lora-packet-trace-writer.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <limits>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LoraPacketTraceWriter");
+
+template <typename T>
+void
+LoraPacketTraceWriter::WriteValues (const T *values, std::size_t count)
+{
+  m_file.write (reinterpret_cast<const char *> (values), sizeof (T) * count);
+  m_offset += sizeof (T) * count;
+}
+
+LoraPacketTraceWriter::LoraPacketTraceWriter (std::string filename,
+                                              uint32_t blockSize) :
+  m_offset (0),
+  m_blockSize (blockSize)
+{
+  NS_LOG_FUNCTION (this << filename << blockSize);
+
+  NS_ASSERT (blockSize > 0);
+
+  m_file.open (filename.c_str (), std::ofstream::out | std::ofstream::trunc |
+               std::ofstream::binary);
+  NS_ABORT_MSG_UNLESS (m_file.is_open (), "Cannot open " << filename);
+
+  const char magic[8] = {'L', 'O', 'R', 'A', 'T', 'R', 'K', '1'};
+  const uint32_t header[2] = {1, 0};   // Version, reserved
+  WriteValues (magic, 8);
+  WriteValues (header, 2);
+
+  m_rows.reserve (m_blockSize);
+}
+
+LoraPacketTraceWriter::~LoraPacketTraceWriter ()
+{
+  NS_LOG_FUNCTION (this);
+
+  Close ();
+}
+
+void
+LoraPacketTraceWriter::Write (const PacketStatus &phyStatus,
+                              const MacPacketStatus *macStatus,
+                              const std::vector<int> &gwIds)
+{
+  NS_LOG_FUNCTION (this << phyStatus.uid);
+
+  if (!m_file.is_open ())
+    {
+      NS_LOG_WARN ("Writing a record after the file was closed, ignoring it");
+      return;
+    }
+
+  // Records of a block all have a column for each gateway known when it is
+  // written, so gateways that appear later start a new block
+  if (!m_rows.empty () && gwIds.size () != m_gwIds.size ())
+    {
+      WriteBlock ();
+    }
+  m_gwIds = gwIds;
+
+  Row row;
+  row.sendTime = phyStatus.sendTime.GetNanoSeconds ();
+  row.senderId = phyStatus.senderId;
+  row.sf = macStatus ? macStatus->sf : 0;
+  row.frequency = macStatus ? macStatus->frequency : 0;
+  row.outcomes.assign (gwIds.size (), UNSET);
+  row.delays.assign (gwIds.size (), -1);
+  row.receivePowers.assign (gwIds.size (),
+                            std::numeric_limits<double>::quiet_NaN ());
+
+  for (uint32_t gwIndex = 0; gwIndex < phyStatus.outcomes.size (); gwIndex++)
+    {
+      row.outcomes[gwIndex] = phyStatus.outcomes[gwIndex];
+    }
+
+  if (macStatus)
+    {
+      for (uint32_t gwIndex = 0; gwIndex < macStatus->receptionTimes.size ();
+           gwIndex++)
+        {
+          if (macStatus->receptionTimes[gwIndex] != Time::Max ())
+            {
+              row.delays[gwIndex] = (macStatus->receptionTimes[gwIndex] -
+                                     macStatus->sendTime).GetNanoSeconds ();
+              row.receivePowers[gwIndex] = macStatus->receivePowers[gwIndex];
+            }
+        }
+    }
+
+  m_rows.push_back (row);
+
+  if (m_rows.size () == m_blockSize)
+    {
+      WriteBlock ();
+    }
+}
+
+void
+LoraPacketTraceWriter::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_file.is_open ())
+    {
+      WriteBlock ();
+      m_file.close ();
+    }
+}
+
+void
+LoraPacketTraceWriter::WriteBlock (void)
+{
+  NS_LOG_FUNCTION (this << m_rows.size ());
+
+  if (m_rows.empty ())
+    {
+      return;
+    }
+
+  const uint32_t n = m_rows.size ();
+  const uint32_t nGateways = m_gwIds.size ();
+
+  // Header
+  const uint32_t sizes[2] = {n, nGateways};
+  WriteValues (sizes, 2);
+  std::vector<uint32_t> gwIds (m_gwIds.begin (), m_gwIds.end ());
+  WriteValues (gwIds.data (), gwIds.size ());
+  Pad ();
+
+  // Columns, from the widest to the narrowest type to keep them aligned
+  std::vector<int64_t> int64Column (n);
+  std::vector<double> doubleColumn (n);
+  std::vector<uint32_t> uint32Column (n);
+  std::vector<uint8_t> uint8Column (n);
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      int64Column[i] = m_rows[i].sendTime;
+    }
+  WriteValues (int64Column.data (), n);
+
+  for (uint32_t gwIndex = 0; gwIndex < nGateways; gwIndex++)
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          int64Column[i] = m_rows[i].delays[gwIndex];
+        }
+      WriteValues (int64Column.data (), n);
+    }
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      doubleColumn[i] = m_rows[i].frequency;
+    }
+  WriteValues (doubleColumn.data (), n);
+
+  for (uint32_t gwIndex = 0; gwIndex < nGateways; gwIndex++)
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          doubleColumn[i] = m_rows[i].receivePowers[gwIndex];
+        }
+      WriteValues (doubleColumn.data (), n);
+    }
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32Column[i] = m_rows[i].senderId;
+    }
+  WriteValues (uint32Column.data (), n);
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint8Column[i] = m_rows[i].sf;
+    }
+  WriteValues (uint8Column.data (), n);
+
+  for (uint32_t gwIndex = 0; gwIndex < nGateways; gwIndex++)
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          uint8Column[i] = m_rows[i].outcomes[gwIndex];
+        }
+      WriteValues (uint8Column.data (), n);
+    }
+
+  Pad ();
+
+  m_rows.clear ();
+}
+
+void
+LoraPacketTraceWriter::Pad (void)
+{
+  const char zeros[8] = {0};
+  WriteValues (zeros, (8 - m_offset % 8) % 8);
+}
+
+}
+}
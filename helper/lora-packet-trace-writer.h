@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORA_PACKET_TRACE_WRITER_H
+#define LORA_PACKET_TRACE_WRITER_H
+
+#include "ns3/simple-ref-count.h"
+#include "ns3/lora-packet-tracker.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Writes the outcome of each uplink packet to a binary file.
+ *
+ * The file starts with the 8-byte magic "LORATRK1", followed by a 32-bit
+ * version number and 4 reserved bytes. Records follow in blocks, each made
+ * of:
+ *
+ * - the number of records n and of gateways g, as 32-bit unsigned integers;
+ * - the id of each of the g gateways, as 32-bit unsigned integers;
+ * - the columns, each holding one fixed-width value per record, in this
+ *   order: send time (int64, ns), delay at each gateway (g columns of int64,
+ *   ns, -1 if not received), frequency (double, MHz, 0 if not received),
+ *   receive power at each gateway (g columns of double, dBm, NaN if not
+ *   received), sender id (uint32), SF (uint8), PhyPacketOutcome at each
+ *   gateway (g columns of uint8).
+ *
+ * The block header and each block are padded with zeros to a multiple of 8
+ * bytes, so that all columns are aligned when the file is memory-mapped. All
+ * values are written in the byte order of the host. The
+ * experiments/lora_trace.py module reads these files.
+ */
+class LoraPacketTraceWriter : public SimpleRefCount<LoraPacketTraceWriter>
+{
+public:
+  /**
+   * Create a writer and open its file, truncating it.
+   *
+   * \param filename The path of the file.
+   * \param blockSize The number of records in a block.
+   */
+  LoraPacketTraceWriter (std::string filename, uint32_t blockSize = 4096);
+  ~LoraPacketTraceWriter ();
+
+  /**
+   * Append the record of a packet.
+   *
+   * \param phyStatus The PHY record of the packet.
+   * \param macStatus The MAC record of the packet, or 0 if there is none.
+   * \param gwIds The id of each gateway, by the dense index used in the
+   * records.
+   */
+  void Write (const PacketStatus &phyStatus, const MacPacketStatus *macStatus,
+              const std::vector<int> &gwIds);
+
+  /**
+   * Write the last block and close the file.
+   */
+  void Close (void);
+
+private:
+  /**
+   * A buffered record.
+   */
+  struct Row
+  {
+    int64_t sendTime;
+    uint32_t senderId;
+    uint8_t sf;
+    double frequency;
+    std::vector<uint8_t> outcomes;
+    std::vector<int64_t> delays;
+    std::vector<double> receivePowers;
+  };
+
+  /**
+   * Write the buffered records as a block.
+   */
+  void WriteBlock (void);
+
+  /**
+   * Write raw values to the file.
+   */
+  template <typename T>
+  void WriteValues (const T *values, std::size_t count);
+
+  /**
+   * Pad the file with zeros up to a multiple of 8 bytes.
+   */
+  void Pad (void);
+
+  std::ofstream m_file;
+  uint64_t m_offset;   //!< Bytes written so far
+  uint32_t m_blockSize;   //!< Number of records in a block
+  std::vector<Row> m_rows;   //!< Records of the current block
+  std::vector<int> m_gwIds;   //!< Gateway ids of the current block
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* LORA_PACKET_TRACE_WRITER_H */
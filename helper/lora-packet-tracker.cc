@@ -22,6 +22,9 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-packet-trace-writer.h"
+#include "ns3/lora-tag.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -29,7 +32,40 @@ namespace ns3 {
 namespace lorawan {
 NS_LOG_COMPONENT_DEFINE ("LoraPacketTracker");
 
-LoraPacketTracker::LoraPacketTracker ()
+namespace {
+
+// First record sent at or after time
+template <typename T>
+typename std::vector<T>::const_iterator
+FirstSentAtOrAfter (const std::vector<T> &records, Time time)
+{
+  return std::lower_bound (records.begin (), records.end (), time,
+                           [] (const T &record, Time t)
+                           { return record.sendTime < t; });
+}
+
+// First record sent after time
+template <typename T>
+typename std::vector<T>::const_iterator
+FirstSentAfter (const std::vector<T> &records, Time time)
+{
+  return std::upper_bound (records.begin (), records.end (), time,
+                           [] (Time t, const T &record)
+                           { return t < record.sendTime; });
+}
+
+}
+
+LoraPacketTracker::LoraPacketTracker () :
+  m_phyOffset (0),
+  m_macOffset (0),
+  m_reTransmissionSorted (true),
+  m_streaming (false),
+  m_bucketDuration (Seconds (0)),
+  m_completionDelay (Seconds (10)),
+  m_nextFlush (Seconds (0)),
+  m_phyWritten (0),
+  m_latencyWindowDuration (Seconds (0))
 {
   NS_LOG_FUNCTION (this);
 }
@@ -37,6 +73,9 @@ LoraPacketTracker::LoraPacketTracker ()
 LoraPacketTracker::~LoraPacketTracker ()
 {
   NS_LOG_FUNCTION (this);
+
+  Simulator::Cancel (m_closeTraceFileEvent);
+  CloseTraceFile ();
 }
 
 /////////////////
@@ -50,15 +89,22 @@ LoraPacketTracker::MacTransmissionCallback (Ptr<Packet const> packet, uint8_t sf
     {
       NS_LOG_INFO ("A new packet was sent by the MAC layer");
 
+      FlushCompleted ();
+
+      if (m_macIndex.count (packet->GetUid ()))
+        {
+          return;
+        }
+
       MacPacketStatus status;
-      status.packet = packet;
+      status.uid = packet->GetUid ();
       status.sendTime = Simulator::Now ();
       status.senderId = Simulator::GetContext ();
       status.receivedTime = Time::Max ();
-	  status.sf = sf;
+      status.sf = sf;
 
-      m_macPacketTracker.insert (std::pair<Ptr<Packet const>, MacPacketStatus>
-                                   (packet, status));
+      m_macIndex[status.uid] = m_macOffset + m_macPacketTracker.size ();
+      m_macPacketTracker.push_back (status);
     }
 }
 
@@ -72,14 +118,44 @@ LoraPacketTracker::RequiredTransmissionsCallback (uint8_t reqTx, bool success,
                 ", succ: " << success << ", firstAttempt: " <<
                 firstAttempt.GetSeconds ());
 
+  if (success && !m_latencyWindowDuration.IsZero ())
+    {
+      LatencyWindow &window = GetLatencyWindow (firstAttempt);
+      Time latency = Simulator::Now () - firstAttempt;
+      window.retransmission.Record (latency);
+      MacPacketStatus *status = FindMacStatus (packet);
+      if (status)
+        {
+          window.retransmissionPerSf[status->sf].Record (latency);
+        }
+    }
+
+  if (m_streaming)
+    {
+      // No need to wait for other outcomes: count the packet right away
+      TrackerBucket &bucket = GetBucket (firstAttempt);
+      bucket.reTxSent++;
+      if (success)
+        {
+          bucket.reTxSuccessful++;
+        }
+      return;
+    }
+
   RetransmissionStatus entry;
   entry.firstAttempt = firstAttempt;
   entry.finishTime = Simulator::Now ();
   entry.reTxAttempts = reqTx;
   entry.successful = success;
 
-  m_reTransmissionTracker.insert (std::pair<Ptr<Packet>, RetransmissionStatus>
-                                    (packet, entry));
+  // Records arrive when the procedure finishes, which may not be in the order
+  // of their first attempt
+  if (!m_reTransmissionTracker.empty ()
+      && m_reTransmissionTracker.back ().firstAttempt > firstAttempt)
+    {
+      m_reTransmissionSorted = false;
+    }
+  m_reTransmissionTracker.push_back (entry);
 }
 
 void
@@ -92,12 +168,45 @@ LoraPacketTracker::MacGwReceptionCallback (Ptr<Packet const> packet)
                    Simulator::GetContext ());
 
       // Find the received packet in the m_macPacketTracker
-      auto it = m_macPacketTracker.find (packet);
-      if (it != m_macPacketTracker.end ())
+      MacPacketStatus *status = FindMacStatus (packet);
+      if (status)
         {
-          (*it).second.receptionTimes.insert (std::pair<int, Time>
-                                                (Simulator::GetContext (),
-                                                Simulator::Now ()));
+          uint32_t gwIndex = GetGatewayIndex (Simulator::GetContext ());
+          if (status->receptionTimes.size () <= gwIndex)
+            {
+              status->receptionTimes.resize (gwIndex + 1, Time::Max ());
+            }
+          if (status->receptionTimes[gwIndex] == Time::Max ())
+            {
+              // The gateway tagged the packet with its reception information
+              LoraTag tag;
+              packet->PeekPacketTag (tag);
+              if (!IsReceived (*status))
+                {
+                  status->frequency = tag.GetFrequency ();
+                }
+              if (!m_latencyWindowDuration.IsZero ())
+                {
+                  LatencyWindow &window = GetLatencyWindow (status->sendTime);
+                  Time latency = Simulator::Now () - status->sendTime;
+                  if (!IsReceived (*status))
+                    {
+                      window.uplink.Record (latency);
+                      window.uplinkPerSf[status->sf].Record (latency);
+                    }
+                  window.uplinkPerGw[Simulator::GetContext ()].Record (latency);
+                }
+              if (status->receivePowers.size () <= gwIndex)
+                {
+                  status->receivePowers.resize (gwIndex + 1, 0);
+                }
+              status->receivePowers[gwIndex] = tag.GetReceivePower ();
+              status->receptionTimes[gwIndex] = Simulator::Now ();
+            }
+        }
+      else if (m_streaming)
+        {
+          NS_LOG_WARN ("Reception of a packet that was already folded, ignoring it");
         }
       else
         {
@@ -118,13 +227,31 @@ LoraPacketTracker::TransmissionCallback (Ptr<Packet const> packet, uint32_t edId
       NS_LOG_INFO ("PHY packet " << packet
                                  << " was transmitted by device "
                                  << edId);
+
+      FlushCompleted ();
+
+      if (m_phyIndex.count (packet->GetUid ()))
+        {
+          return;
+        }
+
+      // The MAC record is created by the first transmission of the packet:
+      // without it, this is a retransmission of a packet that was already
+      // folded, which must not be counted again
+      if (m_streaming && !m_macIndex.count (packet->GetUid ()))
+        {
+          NS_LOG_WARN ("Retransmission of a packet that was already folded, ignoring it");
+          return;
+        }
+
       // Create a packetStatus
       PacketStatus status;
-      status.packet = packet;
+      status.uid = packet->GetUid ();
       status.sendTime = Simulator::Now ();
       status.senderId = edId;
 
-      m_packetTracker.insert (std::pair<Ptr<Packet const>, PacketStatus> (packet, status));
+      m_phyIndex[status.uid] = m_phyOffset + m_packetTracker.size ();
+      m_packetTracker.push_back (status);
     }
 }
 
@@ -138,9 +265,7 @@ LoraPacketTracker::PacketReceptionCallback (Ptr<Packet const> packet, uint32_t g
                                  << " was successfully received at gateway "
                                  << gwId);
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           RECEIVED));
+      SetPhyOutcome (packet, gwId, RECEIVED);
     }
 }
 
@@ -153,9 +278,7 @@ LoraPacketTracker::InterferenceCallback (Ptr<Packet const> packet, uint32_t gwId
                                  << " was interfered at gateway "
                                  << gwId);
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           INTERFERED));
+      SetPhyOutcome (packet, gwId, INTERFERED);
     }
 }
 
@@ -167,9 +290,8 @@ LoraPacketTracker::NoMoreReceiversCallback (Ptr<Packet const> packet, uint32_t g
       NS_LOG_INFO ("PHY packet " << packet
                                  << " was lost because no more receivers at gateway "
                                  << gwId);
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           NO_MORE_RECEIVERS));
+
+      SetPhyOutcome (packet, gwId, NO_MORE_RECEIVERS);
     }
 }
 
@@ -182,9 +304,7 @@ LoraPacketTracker::UnderSensitivityCallback (Ptr<Packet const> packet, uint32_t
                                  << " was lost because under sensitivity at gateway "
                                  << gwId);
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           UNDER_SENSITIVITY));
+      SetPhyOutcome (packet, gwId, UNDER_SENSITIVITY);
     }
 }
 
@@ -197,9 +317,7 @@ LoraPacketTracker::LostBecauseTxCallback (Ptr<Packet const> packet, uint32_t gwI
                                  << " was lost because of GW transmission at gateway "
                                  << gwId);
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           LOST_BECAUSE_TX));
+      SetPhyOutcome (packet, gwId, LOST_BECAUSE_TX);
     }
 }
 
@@ -209,317 +327,706 @@ LoraPacketTracker::IsUplink (Ptr<Packet const> packet)
   NS_LOG_FUNCTION (this);
 
   LorawanMacHeader mHdr;
-  Ptr<Packet> copy = packet->Copy ();
-  copy->RemoveHeader (mHdr);
+  packet->PeekHeader (mHdr);
   return mHdr.IsUplink ();
 }
 
+PacketStatus *
+LoraPacketTracker::FindPhyStatus (Ptr<Packet const> packet)
+{
+  auto it = m_phyIndex.find (packet->GetUid ());
+  if (it == m_phyIndex.end ())
+    {
+      return 0;
+    }
+  return &m_packetTracker.at (it->second - m_phyOffset);
+}
+
+MacPacketStatus *
+LoraPacketTracker::FindMacStatus (Ptr<Packet const> packet)
+{
+  auto it = m_macIndex.find (packet->GetUid ());
+  if (it == m_macIndex.end ())
+    {
+      return 0;
+    }
+  return &m_macPacketTracker.at (it->second - m_macOffset);
+}
+
+void
+LoraPacketTracker::SetPhyOutcome (Ptr<Packet const> packet, int gwId,
+                                  enum PhyPacketOutcome outcome)
+{
+  PacketStatus *status = FindPhyStatus (packet);
+  if (!status)
+    {
+      NS_LOG_WARN ("Outcome of a packet that was already folded, ignoring it");
+      return;
+    }
+
+  uint32_t gwIndex = GetGatewayIndex (gwId);
+  if (status->outcomes.size () <= gwIndex)
+    {
+      status->outcomes.resize (gwIndex + 1, UNSET);
+    }
+  if (status->outcomes[gwIndex] == UNSET)
+    {
+      status->outcomes[gwIndex] = outcome;
+    }
+}
+
+uint32_t
+LoraPacketTracker::GetGatewayIndex (int gwId)
+{
+  auto it = m_gwIndex.find (gwId);
+  if (it != m_gwIndex.end ())
+    {
+      return it->second;
+    }
+
+  uint32_t gwIndex = m_gwIds.size ();
+  m_gwIds.push_back (gwId);
+  m_gwIndex[gwId] = gwIndex;
+  return gwIndex;
+}
+
+bool
+LoraPacketTracker::IsReceived (const MacPacketStatus &status)
+{
+  for (auto time : status.receptionTimes)
+    {
+      if (time != Time::Max ())
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+LoraPacketTracker::SortRetransmissions (void)
+{
+  if (!m_reTransmissionSorted)
+    {
+      std::stable_sort (m_reTransmissionTracker.begin (),
+                        m_reTransmissionTracker.end (),
+                        [] (const RetransmissionStatus &a,
+                            const RetransmissionStatus &b)
+                        { return a.firstAttempt < b.firstAttempt; });
+      m_reTransmissionSorted = true;
+    }
+}
+
 ////////////////////////
 // Counting Functions //
 ////////////////////////
 
-std::vector<int>
-LoraPacketTracker::CountPhyPacketsPerGw (Time startTime, Time stopTime,
-                                         int gwId)
+TrackerMetrics
+LoraPacketTracker::GetMetrics (Time startTime, Time stopTime)
 {
-  // Vector packetCounts will contain - for the interval given in the input of
-  // the function, the following fields: totPacketsSent receivedPackets
-  // interferedPackets noMoreGwPackets underSensitivityPackets lostBecauseTxPackets
+  NS_LOG_FUNCTION (this << startTime << stopTime);
 
-  std::vector<int> packetCounts (6, 0);
+  TrackerMetrics metrics;
 
-  for (auto itPhy = m_packetTracker.begin ();
-       itPhy != m_packetTracker.end ();
-       ++itPhy)
+  // PHY outcomes are accumulated by dense gateway index, and moved to the
+  // per-gateway map at the end
+  std::vector<std::vector<uint64_t> > phyOutcomes (m_gwIds.size ());
+  auto lastPhy = FirstSentAfter (m_packetTracker, stopTime);
+  for (auto it = FirstSentAtOrAfter (m_packetTracker, startTime);
+       it != lastPhy;
+       ++it)
+    {
+      metrics.phySent++;
+      for (uint32_t gwIndex = 0; gwIndex < it->outcomes.size (); gwIndex++)
+        {
+          if (it->outcomes[gwIndex] != UNSET)
+            {
+              phyOutcomes[gwIndex].resize (UNSET, 0);
+              phyOutcomes[gwIndex][it->outcomes[gwIndex]]++;
+            }
+        }
+    }
+  for (uint32_t gwIndex = 0; gwIndex < phyOutcomes.size (); gwIndex++)
     {
-      if ((*itPhy).second.sendTime >= startTime && (*itPhy).second.sendTime <= stopTime)
+      if (!phyOutcomes[gwIndex].empty ())
         {
-          packetCounts.at (0)++;
+          metrics.phyOutcomes[m_gwIds[gwIndex]].swap (phyOutcomes[gwIndex]);
+        }
+    }
 
-          NS_LOG_DEBUG ("Dealing with packet " << (*itPhy).second.packet);
-          NS_LOG_DEBUG ("This packet was received by " <<
-                        (*itPhy).second.outcomes.size () << " gateways");
+  auto lastMac = FirstSentAfter (m_macPacketTracker, stopTime);
+  for (auto it = FirstSentAtOrAfter (m_macPacketTracker, startTime);
+       it != lastMac;
+       ++it)
+    {
+      TrackerMetrics::Counters &counters = metrics.mac[it->sf];
+      counters.sent++;
+      if (IsReceived (*it))
+        {
+          counters.received++;
+        }
 
-          if ((*itPhy).second.outcomes.count (gwId) > 0)
+      // Delays only count packets sent strictly inside the window
+      if (it->sendTime == startTime || it->sendTime == stopTime)
+        {
+          continue;
+        }
+      for (uint32_t gwIndex = 0; gwIndex < it->receptionTimes.size ();
+           gwIndex++)
+        {
+          Time receptionTime = it->receptionTimes[gwIndex];
+          if (receptionTime != Time::Max () && receptionTime >= it->sendTime)
             {
-              switch ((*itPhy).second.outcomes.at (gwId))
+              TrackerMetrics::DelayCounters &delay =
+                metrics.delays[m_gwIds[gwIndex]][it->sf];
+              delay.received++;
+              delay.delaySum += receptionTime - it->sendTime;
+            }
+        }
+    }
+
+  SortRetransmissions ();
+  auto firstReTx = std::lower_bound (m_reTransmissionTracker.begin (),
+                                     m_reTransmissionTracker.end (), startTime,
+                                     [] (const RetransmissionStatus &entry,
+                                         Time t)
+                                     { return entry.firstAttempt < t; });
+  auto lastReTx = std::upper_bound (firstReTx, m_reTransmissionTracker.end (),
+                                    stopTime,
+                                    [] (Time t,
+                                        const RetransmissionStatus &entry)
+                                    { return t < entry.firstAttempt; });
+  for (auto it = firstReTx; it != lastReTx; ++it)
+    {
+      NS_LOG_DEBUG ("Number of attempts: " << unsigned(it->reTxAttempts) <<
+                    ", successful: " << it->successful);
+      metrics.reTx.sent++;
+      if (it->successful)
+        {
+          metrics.reTx.received++;
+        }
+    }
+
+  if (m_streaming)
+    {
+      // Add the packets that were already folded
+      auto last = GetLastBucket (stopTime);
+      for (auto it = GetFirstBucket (startTime); it != last; ++it)
+        {
+          const TrackerBucket &bucket = it->second;
+
+          metrics.phySent += bucket.phySent;
+          for (auto &gw : bucket.phyOutcomes)
+            {
+              std::vector<uint64_t> &counts = metrics.phyOutcomes[gw.first];
+              counts.resize (UNSET, 0);
+              for (int outcome = RECEIVED; outcome < UNSET; ++outcome)
                 {
-                case RECEIVED:
-                  {
-                    packetCounts.at (1)++;
-                    break;
-                  }
-                case INTERFERED:
-                  {
-                    packetCounts.at (2)++;
-                    break;
-                  }
-                case NO_MORE_RECEIVERS:
-                  {
-                    packetCounts.at (3)++;
-                    break;
-                  }
-                case UNDER_SENSITIVITY:
-                  {
-                    packetCounts.at (4)++;
-                    break;
-                  }
-                case LOST_BECAUSE_TX:
-                  {
-                    packetCounts.at (5)++;
-                    break;
-                  }
-                case UNSET:
-                  {
-                    break;
-                  }
+                  counts.at (outcome) += gw.second.at (outcome);
                 }
             }
+
+          for (auto &sf : bucket.macSent)
+            {
+              metrics.mac[sf.first].sent += sf.second;
+            }
+          for (auto &sf : bucket.macReceived)
+            {
+              metrics.mac[sf.first].received += sf.second;
+            }
+
+          for (auto &gw : bucket.delays)
+            {
+              for (auto &sf : gw.second)
+                {
+                  TrackerMetrics::DelayCounters &delay =
+                    metrics.delays[gw.first][sf.first];
+                  delay.received += sf.second.received;
+                  delay.delaySum += sf.second.delaySum;
+                }
+            }
+
+          metrics.reTx.sent += bucket.reTxSent;
+          metrics.reTx.received += bucket.reTxSuccessful;
         }
     }
 
-  return packetCounts;
+  return metrics;
 }
-std::string
-LoraPacketTracker::PrintPhyPacketsPerGw (Time startTime, Time stopTime,
+
+std::vector<int>
+LoraPacketTracker::CountPhyPacketsPerGw (Time startTime, Time stopTime,
                                          int gwId)
 {
   // Vector packetCounts will contain - for the interval given in the input of
   // the function, the following fields: totPacketsSent receivedPackets
   // interferedPackets noMoreGwPackets underSensitivityPackets lostBecauseTxPackets
 
-  std::vector<int> packetCounts (6, 0);
+  std::vector<uint64_t> packetCounts =
+    GetMetrics (startTime, stopTime).GetPhyPackets (gwId);
+
+  return std::vector<int> (packetCounts.begin (), packetCounts.end ());
+}
+
+std::string
+LoraPacketTracker::PrintPhyPacketsPerGw (Time startTime, Time stopTime,
+                                         int gwId)
+{
+  return GetMetrics (startTime, stopTime).PrintPhyPackets (gwId);
+}
+
+std::string
+LoraPacketTracker::CountMacPacketsGlobally (Time startTime, Time stopTime)
+{
+  NS_LOG_FUNCTION (this << startTime << stopTime);
+
+  TrackerMetrics::Counters counters =
+    GetMetrics (startTime, stopTime).GetMacCounters ();
+
+  return std::to_string (double (counters.sent)) + " " +
+    std::to_string (double (counters.received));
+}
+
+std::string
+LoraPacketTracker::CountMacPacketsGlobally (Time startTime, Time stopTime, uint8_t sf)
+{
+  NS_LOG_FUNCTION (this << startTime << stopTime);
+
+  TrackerMetrics::Counters counters =
+    GetMetrics (startTime, stopTime).GetMacCounters (sf);
+
+  return std::to_string (double (counters.sent)) + " " +
+    std::to_string (double (counters.received));
+}
+
+std::string
+LoraPacketTracker::CountMacPacketsGloballyCpsr (Time startTime, Time stopTime)
+{
+  NS_LOG_FUNCTION (this << startTime << stopTime);
+
+  TrackerMetrics::Counters counters = GetMetrics (startTime, stopTime).reTx;
+
+  return std::to_string (double (counters.sent)) + " " +
+    std::to_string (double (counters.received));
+}
+
+std::string
+LoraPacketTracker::CountMacPacketsGloballyDelay (Time startTime, Time stopTime,
+                                                 uint32_t gwId, uint32_t gwNum)
+{
+  TrackerMetrics::DelayCounters delay =
+    GetMetrics (startTime, stopTime).GetDelay (gwId, gwNum);
+
+  return std::to_string (TrackerMetrics::GetAverageDelay (delay).GetSeconds ());
+}
+
+std::string
+LoraPacketTracker::CountMacPacketsGloballyDelay (Time startTime, Time stopTime,
+                                                 uint32_t gwId, uint32_t gwNum,
+                                                 uint8_t sf)
+{
+  TrackerMetrics::DelayCounters delay =
+    GetMetrics (startTime, stopTime).GetDelay (gwId, gwNum, sf);
+
+  return std::to_string (TrackerMetrics::GetAverageDelay (delay).GetSeconds ());
+}
+
+////////////////////
+// TrackerMetrics //
+////////////////////
+
+double
+TrackerMetrics::Counters::GetSuccessRate (void) const
+{
+  return sent ? double (received) / sent : 0;
+}
+
+TrackerMetrics::Counters
+TrackerMetrics::GetMacCounters (void) const
+{
+  Counters total;
+  for (auto &sf : mac)
+    {
+      total.sent += sf.second.sent;
+      total.received += sf.second.received;
+    }
+  return total;
+}
+
+TrackerMetrics::Counters
+TrackerMetrics::GetMacCounters (uint8_t sf) const
+{
+  auto it = mac.find (sf);
+  return it != mac.end () ? it->second : Counters ();
+}
+
+TrackerMetrics::DelayCounters
+TrackerMetrics::GetDelay (uint32_t gwId, uint32_t gwNum) const
+{
+  DelayCounters total;
+  for (auto gw = delays.lower_bound (gwId);
+       gw != delays.end () && gw->first < int (gwId + gwNum);
+       ++gw)
+    {
+      for (auto &sf : gw->second)
+        {
+          total.received += sf.second.received;
+          total.delaySum += sf.second.delaySum;
+        }
+    }
+  return total;
+}
+
+TrackerMetrics::DelayCounters
+TrackerMetrics::GetDelay (uint32_t gwId, uint32_t gwNum, uint8_t sf) const
+{
+  DelayCounters total;
+  for (auto gw = delays.lower_bound (gwId);
+       gw != delays.end () && gw->first < int (gwId + gwNum);
+       ++gw)
+    {
+      auto it = gw->second.find (sf);
+      if (it != gw->second.end ())
+        {
+          total.received += it->second.received;
+          total.delaySum += it->second.delaySum;
+        }
+    }
+  return total;
+}
+
+Time
+TrackerMetrics::GetAverageDelay (const DelayCounters &delay)
+{
+  if (delay.received == 0)
+    {
+      return Seconds (0);
+    }
+  return delay.delaySum / int64x64_t (delay.received);
+}
+
+std::vector<uint64_t>
+TrackerMetrics::GetPhyPackets (int gwId) const
+{
+  std::vector<uint64_t> packetCounts (UNSET + 1, 0);
+  packetCounts.at (0) = phySent;
+
+  auto gw = phyOutcomes.find (gwId);
+  if (gw != phyOutcomes.end ())
+    {
+      // Outcomes are listed in the same order as the counts
+      for (int outcome = RECEIVED; outcome < UNSET; ++outcome)
+        {
+          packetCounts.at (outcome + 1) = gw->second.at (outcome);
+        }
+    }
+  return packetCounts;
+}
+
+std::string
+TrackerMetrics::PrintPhyPackets (int gwId) const
+{
+  std::string output ("");
+  for (auto count : GetPhyPackets (gwId))
+    {
+      output += std::to_string (count) + " ";
+    }
+  return output;
+}
+
+////////////////////
+// Streaming mode //
+////////////////////
+
+void
+LoraPacketTracker::EnableStreaming (Time bucketDuration, Time completionDelay)
+{
+  NS_LOG_FUNCTION (this << bucketDuration << completionDelay);
+
+  NS_ASSERT (bucketDuration.IsStrictlyPositive ());
+  NS_ASSERT_MSG (m_packetTracker.empty () && m_macPacketTracker.empty (),
+                 "Streaming must be enabled before packets are tracked");
+
+  m_streaming = true;
+  m_bucketDuration = bucketDuration;
+  m_completionDelay = completionDelay;
+  m_nextFlush = Simulator::Now () + m_completionDelay;
+}
+
+bool
+LoraPacketTracker::IsStreaming (void) const
+{
+  return m_streaming;
+}
+
+uint64_t
+LoraPacketTracker::GetRecordCount (void) const
+{
+  return m_packetTracker.size () + m_macPacketTracker.size () +
+    m_reTransmissionTracker.size ();
+}
+
+void
+LoraPacketTracker::EnableLatencyHistograms (Time windowDuration)
+{
+  NS_LOG_FUNCTION (this << windowDuration);
+
+  NS_ASSERT (windowDuration.IsStrictlyPositive ());
+  NS_ASSERT_MSG (m_latencyWindows.empty (),
+                 "Latency histograms are already being recorded");
+
+  m_latencyWindowDuration = windowDuration;
+}
+
+LatencyHistogram
+LoraPacketTracker::GetUplinkLatency (Time startTime, Time stopTime) const
+{
+  LatencyHistogram histogram;
+  auto last = GetFirstLatencyWindow (stopTime);
+  for (auto it = GetFirstLatencyWindow (startTime); it != last; ++it)
+    {
+      histogram.Merge (it->second.uplink);
+    }
+  return histogram;
+}
+
+LatencyHistogram
+LoraPacketTracker::GetUplinkLatencyPerSf (Time startTime, Time stopTime,
+                                          uint8_t sf) const
+{
+  LatencyHistogram histogram;
+  auto last = GetFirstLatencyWindow (stopTime);
+  for (auto it = GetFirstLatencyWindow (startTime); it != last; ++it)
+    {
+      auto sfIt = it->second.uplinkPerSf.find (sf);
+      if (sfIt != it->second.uplinkPerSf.end ())
+        {
+          histogram.Merge (sfIt->second);
+        }
+    }
+  return histogram;
+}
+
+LatencyHistogram
+LoraPacketTracker::GetUplinkLatencyPerGw (Time startTime, Time stopTime,
+                                          int gwId) const
+{
+  LatencyHistogram histogram;
+  auto last = GetFirstLatencyWindow (stopTime);
+  for (auto it = GetFirstLatencyWindow (startTime); it != last; ++it)
+    {
+      auto gwIt = it->second.uplinkPerGw.find (gwId);
+      if (gwIt != it->second.uplinkPerGw.end ())
+        {
+          histogram.Merge (gwIt->second);
+        }
+    }
+  return histogram;
+}
+
+LatencyHistogram
+LoraPacketTracker::GetRetransmissionLatency (Time startTime,
+                                             Time stopTime) const
+{
+  LatencyHistogram histogram;
+  auto last = GetFirstLatencyWindow (stopTime);
+  for (auto it = GetFirstLatencyWindow (startTime); it != last; ++it)
+    {
+      histogram.Merge (it->second.retransmission);
+    }
+  return histogram;
+}
 
-  for (auto itPhy = m_packetTracker.begin ();
-       itPhy != m_packetTracker.end ();
-       ++itPhy)
+LatencyHistogram
+LoraPacketTracker::GetRetransmissionLatencyPerSf (Time startTime,
+                                                  Time stopTime,
+                                                  uint8_t sf) const
+{
+  LatencyHistogram histogram;
+  auto last = GetFirstLatencyWindow (stopTime);
+  for (auto it = GetFirstLatencyWindow (startTime); it != last; ++it)
     {
-      if ((*itPhy).second.sendTime >= startTime && (*itPhy).second.sendTime <= stopTime)
+      auto sfIt = it->second.retransmissionPerSf.find (sf);
+      if (sfIt != it->second.retransmissionPerSf.end ())
         {
-          packetCounts.at (0)++;
+          histogram.Merge (sfIt->second);
+        }
+    }
+  return histogram;
+}
 
-          NS_LOG_DEBUG ("Dealing with packet " << (*itPhy).second.packet);
-          NS_LOG_DEBUG ("This packet was received by " <<
-                        (*itPhy).second.outcomes.size () << " gateways");
+void
+LoraPacketTracker::EnableTraceFile (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+
+  CloseTraceFile ();
+
+  m_traceWriter = Create<LoraPacketTraceWriter> (filename);
+  m_phyWritten = m_phyOffset + m_packetTracker.size ();
+  m_nextFlush = Simulator::Now () + m_completionDelay;
+  m_closeTraceFileEvent =
+    Simulator::ScheduleDestroy (&LoraPacketTracker::CloseTraceFile, this);
+}
+
+void
+LoraPacketTracker::CloseTraceFile (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_traceWriter)
+    {
+      WriteCompleted (Time::Max ());
+      m_traceWriter->Close ();
+      m_traceWriter = 0;
+    }
+}
+
+void
+LoraPacketTracker::FlushCompleted (void)
+{
+  if ((!m_streaming && !m_traceWriter) || Simulator::Now () < m_nextFlush)
+    {
+      return;
+    }
+
+  NS_LOG_FUNCTION (this);
+
+  Time threshold = Simulator::Now () - m_completionDelay;
+
+  if (m_traceWriter)
+    {
+      WriteCompleted (threshold);
+    }
+  if (m_streaming)
+    {
+      FoldCompleted (threshold);
+    }
+
+  m_nextFlush = Simulator::Now () + m_completionDelay;
+}
 
-          if ((*itPhy).second.outcomes.count (gwId) > 0)
+void
+LoraPacketTracker::WriteCompleted (Time threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+
+  auto last = FirstSentAtOrAfter (m_packetTracker, threshold);
+  for (auto it = m_packetTracker.cbegin () + (m_phyWritten - m_phyOffset);
+       it < last;
+       ++it)
+    {
+      const MacPacketStatus *macStatus = 0;
+      auto macIt = m_macIndex.find (it->uid);
+      if (macIt != m_macIndex.end ())
+        {
+          macStatus = &m_macPacketTracker.at (macIt->second - m_macOffset);
+        }
+      m_traceWriter->Write (*it, macStatus, m_gwIds);
+      m_phyWritten++;
+    }
+}
+
+void
+LoraPacketTracker::FoldCompleted (Time threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+
+  // Records are sorted by send time, so the complete ones are at the front
+  auto lastPhy = FirstSentAtOrAfter (m_packetTracker, threshold);
+  for (auto it = m_packetTracker.cbegin (); it != lastPhy; ++it)
+    {
+      TrackerBucket &bucket = GetBucket (it->sendTime);
+      bucket.phySent++;
+      for (uint32_t gwIndex = 0; gwIndex < it->outcomes.size (); gwIndex++)
+        {
+          if (it->outcomes[gwIndex] == UNSET)
             {
-              switch ((*itPhy).second.outcomes.at (gwId))
-                {
-                case RECEIVED:
-                  {
-                    packetCounts.at (1)++;
-                    break;
-                  }
-                case INTERFERED:
-                  {
-                    packetCounts.at (2)++;
-                    break;
-                  }
-                case NO_MORE_RECEIVERS:
-                  {
-                    packetCounts.at (3)++;
-                    break;
-                  }
-                case UNDER_SENSITIVITY:
-                  {
-                    packetCounts.at (4)++;
-                    break;
-                  }
-                case LOST_BECAUSE_TX:
-                  {
-                    packetCounts.at (5)++;
-                    break;
-                  }
-                case UNSET:
-                  {
-                    break;
-                  }
-                }
+              continue;
             }
+          std::vector<uint64_t> &counts = bucket.phyOutcomes[m_gwIds[gwIndex]];
+          counts.resize (UNSET, 0);
+          counts.at (it->outcomes[gwIndex])++;
         }
+      m_phyIndex.erase (it->uid);
     }
+  m_phyOffset += lastPhy - m_packetTracker.cbegin ();
+  m_packetTracker.erase (m_packetTracker.cbegin (), lastPhy);
 
-  std::string output ("");
-  for (int i = 0; i < 6; ++i)
+  auto lastMac = FirstSentAtOrAfter (m_macPacketTracker, threshold);
+  for (auto it = m_macPacketTracker.cbegin (); it != lastMac; ++it)
+    {
+      TrackerBucket &bucket = GetBucket (it->sendTime);
+      bucket.macSent[it->sf]++;
+      if (IsReceived (*it))
+        {
+          bucket.macReceived[it->sf]++;
+        }
+      for (uint32_t gwIndex = 0; gwIndex < it->receptionTimes.size (); gwIndex++)
+        {
+          Time receptionTime = it->receptionTimes[gwIndex];
+          if (receptionTime == Time::Max () || receptionTime < it->sendTime)
+            {
+              continue;
+            }
+          TrackerBucket::DelayCounters &delay =
+            bucket.delays[m_gwIds[gwIndex]][it->sf];
+          delay.received++;
+          delay.delaySum += receptionTime - it->sendTime;
+        }
+      m_macIndex.erase (it->uid);
+    }
+  m_macOffset += lastMac - m_macPacketTracker.cbegin ();
+  m_macPacketTracker.erase (m_macPacketTracker.cbegin (), lastMac);
+}
+
+TrackerBucket &
+LoraPacketTracker::GetBucket (Time time)
+{
+  return m_buckets[time.GetTimeStep () / m_bucketDuration.GetTimeStep ()];
+}
+
+std::map<int64_t, TrackerBucket>::const_iterator
+LoraPacketTracker::GetFirstBucket (Time startTime) const
+{
+  // First bucket starting at or after startTime
+  int64_t index = startTime.GetTimeStep () / m_bucketDuration.GetTimeStep ();
+  if (index * m_bucketDuration.GetTimeStep () < startTime.GetTimeStep ())
     {
-      output += std::to_string (packetCounts.at (i)) + " ";
+      index++;
     }
+  return m_buckets.lower_bound (index);
+}
 
-  return output;
+std::map<int64_t, TrackerBucket>::const_iterator
+LoraPacketTracker::GetLastBucket (Time stopTime) const
+{
+  // Buckets starting at or after stopTime are not counted
+  return GetFirstBucket (stopTime);
 }
 
-  std::string
-  LoraPacketTracker::CountMacPacketsGlobally (Time startTime, Time stopTime)
-  {
-    NS_LOG_FUNCTION (this << startTime << stopTime);
-
-    double sent = 0;
-    double received = 0;
-    for (auto it = m_macPacketTracker.begin ();
-         it != m_macPacketTracker.end ();
-         ++it)
-      {
-        if ((*it).second.sendTime >= startTime && (*it).second.sendTime <= stopTime)
-          {
-            sent++;
-            if ((*it).second.receptionTimes.size ())
-              {
-                received++;
-              }
-          }
-      }
-
-    return std::to_string (sent) + " " +
-      std::to_string (received);
-  }
-
-
-  std::string
-  LoraPacketTracker::CountMacPacketsGlobally (Time startTime, Time stopTime, uint8_t sf)
-  {
-    NS_LOG_FUNCTION (this << startTime << stopTime);
-
-  	double sent = 0;
-  	double received = 0;
- 
-    for (auto it = m_macPacketTracker.begin ();
-         it != m_macPacketTracker.end ();
-         ++it)
-    {
-		//cout << "id: " << (*it).second.senderId << endl;
-		if ((*it).second.sf == sf)
-		{
-        	if ((*it).second.sendTime >= startTime && (*it).second.sendTime <= stopTime)
-          	{
-            	sent++;
-            	if ((*it).second.receptionTimes.size ())
-              	{
-              		received++;
-              	}
-          	}
-      	}
-	}
-    return std::to_string (sent) + " " +
-      std::to_string (received);
-  }
-
-  std::string
-  LoraPacketTracker::CountMacPacketsGloballyCpsr (Time startTime, Time stopTime)
-  {
-    NS_LOG_FUNCTION (this << startTime << stopTime);
-
-    double sent = 0;
-    double received = 0;
-    for (auto it = m_reTransmissionTracker.begin ();
-         it != m_reTransmissionTracker.end ();
-         ++it)
-      {
-        if ((*it).second.firstAttempt >= startTime && (*it).second.firstAttempt <= stopTime)
-          {
-            sent++;
-            NS_LOG_DEBUG ("Found a packet");
-            NS_LOG_DEBUG ("Number of attempts: " << unsigned(it->second.reTxAttempts) <<
-                          ", successful: " << it->second.successful);
-            if (it->second.successful)
-              {
-                received++;
-              }
-          }
-      }
-
-    return std::to_string (sent) + " " +
-      std::to_string (received);
-  }
-
-
-  std::string
-  LoraPacketTracker::CountMacPacketsGloballyDelay (Time startTime, Time stopTime, uint32_t gwId, uint32_t gwNum)
-  {
-  	Time delaySum = Seconds (0);
-  	double avgDelay = 0;
-  	int packetsOutsideTransient = 0;
-
-	for (uint32_t i = gwId; i < (gwId+gwNum); i++)
-	{
-  		for (auto itMac = m_macPacketTracker.begin (); itMac != m_macPacketTracker.end (); ++itMac)
-    	{
-      	// NS_LOG_DEBUG ("Dealing with packet " << (*itMac).first);
-
-      		if ((*itMac).second.sendTime > startTime && (*itMac).second.sendTime < stopTime)
-        	{
-          		packetsOutsideTransient++;
-
-          		// Compute delays
-          		/////////////////
-          		if ((*itMac).second.receptionTimes.find(gwId)->second == Time::Max () || (*itMac).second.receptionTimes.find(gwId)->second < (*itMac).second.sendTime )
-            	{
-              		// NS_LOG_DEBUG ("Packet never received, ignoring it");
-              		packetsOutsideTransient--;
-           	 	}
-          		else
-            	{
-              		delaySum += (*itMac).second.receptionTimes.find(gwId)->second  - (*itMac).second.sendTime;
-            	}
-
-        	}
-    	}
-	}
-	//cout << "trans: " << packetsOutsideTransient << " d: " << delaySum.GetSeconds() << endl;
-
-  	if (packetsOutsideTransient != 0)
-    {
-      avgDelay = (delaySum/packetsOutsideTransient).GetSeconds ();
-    }
-	
-	return(std::to_string(avgDelay));
-
-  }
-
-  std::string
-  LoraPacketTracker::CountMacPacketsGloballyDelay (Time startTime, Time stopTime, uint32_t gwId, uint32_t gwNum, uint8_t sf)
-  {
-  	Time delaySum = Seconds (0);
-  	double avgDelay = 0;
-  	int packetsOutsideTransient = 0;
-
-	for (uint32_t i = gwId; i < (gwId+gwNum); i++)
-	{
-  		for (auto itMac = m_macPacketTracker.begin (); itMac != m_macPacketTracker.end (); ++itMac)
-    	{
-      	// NS_LOG_DEBUG ("Dealing with packet " << (*itMac).first);
-			if ((*itMac).second.sf == sf){
-      			if ((*itMac).second.sendTime > startTime && (*itMac).second.sendTime < stopTime)
-        		{
-          			packetsOutsideTransient++;
-
-          			// Compute delays
-          			/////////////////
-          			if ((*itMac).second.receptionTimes.find(gwId)->second == Time::Max () || (*itMac).second.receptionTimes.find(gwId)->second < (*itMac).second.sendTime )
-            		{
-              			// NS_LOG_DEBUG ("Packet never received, ignoring it");
-              			packetsOutsideTransient--;
-           	 		}
-          			else
-            		{
-              			delaySum += (*itMac).second.receptionTimes.find(gwId)->second  - (*itMac).second.sendTime;
-            		}
-
-        		}
-			}
-    	}
-	}
-	//cout << "trans: " << packetsOutsideTransient << " d: " << delaySum.GetSeconds() << endl;
-
-  	if (packetsOutsideTransient != 0)
-    {
-      avgDelay = (delaySum/packetsOutsideTransient).GetSeconds ();
-    }
-	
-	return(std::to_string(avgDelay));
-
-  }
+LatencyWindow &
+LoraPacketTracker::GetLatencyWindow (Time time)
+{
+  return m_latencyWindows[time.GetTimeStep () /
+                          m_latencyWindowDuration.GetTimeStep ()];
+}
 
+std::map<int64_t, LatencyWindow>::const_iterator
+LoraPacketTracker::GetFirstLatencyWindow (Time startTime) const
+{
+  if (m_latencyWindowDuration.IsZero ())
+    {
+      return m_latencyWindows.end ();
+    }
 
+  int64_t index = startTime.GetTimeStep () /
+    m_latencyWindowDuration.GetTimeStep ();
+  if (index * m_latencyWindowDuration.GetTimeStep () < startTime.GetTimeStep ())
+    {
+      index++;
+    }
+  return m_latencyWindows.lower_bound (index);
+}
 }
 }
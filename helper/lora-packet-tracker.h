@@ -23,13 +23,19 @@
 
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/latency-histogram.h"
 
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
 
+class LoraPacketTraceWriter;
+
 enum PhyPacketOutcome
 {
   RECEIVED,
@@ -40,22 +46,28 @@ enum PhyPacketOutcome
   UNSET
 };
 
+// Per-gateway information is stored in arrays indexed by the dense index the
+// tracker assigns to each gateway, in the order in which gateways are first
+// seen. Arrays only extend up to the last gateway that reported the packet.
+
 struct PacketStatus
 {
-  Ptr<Packet const> packet;
+  uint64_t uid;   //!< The Packet::GetUid of the packet
   uint32_t senderId;
   Time sendTime;
-  std::map<int, enum PhyPacketOutcome> outcomes;
+  std::vector<uint8_t> outcomes;   //!< PhyPacketOutcome, per gateway index
 };
 
 struct MacPacketStatus
 {
-  Ptr<Packet const> packet;
+  uint64_t uid;   //!< The Packet::GetUid of the packet
   uint32_t senderId;
   uint8_t sf;
   Time sendTime;
   Time receivedTime;
-  std::map<int, Time> receptionTimes;
+  double frequency = 0;   //!< The frequency, as seen by the first receiving gateway
+  std::vector<Time> receptionTimes;   //!< Time::Max () if not received, per gateway index
+  std::vector<double> receivePowers;   //!< Receive power in dBm, per gateway index
 };
 
 struct RetransmissionStatus
@@ -66,9 +78,115 @@ struct RetransmissionStatus
   bool successful;
 };
 
-typedef std::map<Ptr<Packet const>, MacPacketStatus> MacPacketData;
-typedef std::map<Ptr<Packet const>, PacketStatus> PhyPacketData;
-typedef std::map<Ptr<Packet const>, RetransmissionStatus> RetransmissionData;
+// Records are kept in the order in which packets were sent, so that time
+// windows can be found with a binary search
+typedef std::vector<MacPacketStatus> MacPacketData;
+typedef std::vector<PacketStatus> PhyPacketData;
+typedef std::vector<RetransmissionStatus> RetransmissionData;
+
+/**
+ * Counters of the packets sent in a time bucket, used by the streaming mode
+ * of the LoraPacketTracker.
+ */
+struct TrackerBucket
+{
+  /**
+   * The counters of a gateway, for a spreading factor.
+   */
+  struct DelayCounters
+  {
+    uint64_t received = 0;   //!< MAC packets received by the gateway
+    Time delaySum = Seconds (0);   //!< Sum of their delays
+  };
+
+  uint64_t phySent = 0;   //!< PHY packets sent by end devices
+  std::map<int, std::vector<uint64_t> > phyOutcomes;   //!< Per gateway, per PhyPacketOutcome
+  std::map<uint8_t, uint64_t> macSent;   //!< MAC packets sent, per SF
+  std::map<uint8_t, uint64_t> macReceived;   //!< MAC packets received by at least one gateway, per SF
+  std::map<int, std::map<uint8_t, DelayCounters> > delays;   //!< Per gateway, per SF
+  uint64_t reTxSent = 0;   //!< Packets whose retransmission procedure started
+  uint64_t reTxSuccessful = 0;   //!< Of which, acknowledged
+};
+
+/**
+ * Latency histograms of the packets sent in a time window.
+ */
+struct LatencyWindow
+{
+  LatencyHistogram uplink;   //!< Until the first reception by a gateway
+  std::map<uint8_t, LatencyHistogram> uplinkPerSf;   //!< Same, per SF
+  std::map<int, LatencyHistogram> uplinkPerGw;   //!< Until the reception by each gateway
+  LatencyHistogram retransmission;   //!< From the first attempt to the end of successful procedures
+  std::map<uint8_t, LatencyHistogram> retransmissionPerSf;   //!< Same, per SF
+};
+
+/**
+ * The counters of the LoraPacketTracker for a time window, for all spreading
+ * factors and gateways.
+ */
+struct TrackerMetrics
+{
+  /**
+   * Packets sent, and of which successful.
+   */
+  struct Counters
+  {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+
+    /**
+     * The fraction of successful packets, or 0 if none was sent.
+     */
+    double GetSuccessRate (void) const;
+  };
+
+  typedef TrackerBucket::DelayCounters DelayCounters;
+
+  /**
+   * Get the MAC counters of all spreading factors.
+   */
+  Counters GetMacCounters (void) const;
+
+  /**
+   * Get the MAC counters of a spreading factor.
+   */
+  Counters GetMacCounters (uint8_t sf) const;
+
+  /**
+   * Get the delay counters of the receptions at gateways gwId, ..., gwId +
+   * gwNum - 1.
+   */
+  DelayCounters GetDelay (uint32_t gwId, uint32_t gwNum) const;
+
+  /**
+   * Get the delay counters of the receptions of packets sent with a certain SF
+   * at gateways gwId, ..., gwId + gwNum - 1.
+   */
+  DelayCounters GetDelay (uint32_t gwId, uint32_t gwNum, uint8_t sf) const;
+
+  /**
+   * Get the average delay of a set of receptions, or 0 if there was none.
+   */
+  static Time GetAverageDelay (const DelayCounters &delay);
+
+  /**
+   * Get the PHY counters of a gateway: the total number of packets sent, and
+   * the number of packets for each PhyPacketOutcome.
+   */
+  std::vector<uint64_t> GetPhyPackets (int gwId) const;
+
+  /**
+   * Print the PHY counters of a gateway, in the format of
+   * LoraPacketTracker::PrintPhyPacketsPerGw.
+   */
+  std::string PrintPhyPackets (int gwId) const;
+
+  uint64_t phySent = 0;   //!< PHY packets sent by end devices
+  std::map<int, std::vector<uint64_t> > phyOutcomes;   //!< Per gateway, per PhyPacketOutcome
+  std::map<uint8_t, Counters> mac;   //!< MAC packets, and of which received by at least one gateway, per SF
+  std::map<int, std::map<uint8_t, DelayCounters> > delays;   //!< Per gateway, per SF
+  Counters reTx;   //!< Retransmission procedures, and of which acknowledged
+};
 
 
 class LoraPacketTracker
@@ -108,6 +226,17 @@ public:
   //                            macPacketTracker, RetransmissionData reTransmissionTracker,
   //                            PhyPacketData packetTracker);
 
+  /**
+   * Compute all counters of the packets sent in a time window, in a single
+   * pass over the records.
+   *
+   * Packets and retransmission procedures started in [startTime, stopTime]
+   * are counted, except for delays, which only count packets sent in
+   * (startTime, stopTime). The string-returning counting functions below are
+   * computed from these counters.
+   */
+  TrackerMetrics GetMetrics (Time startTime, Time stopTime);
+
   /**
    * Count packets to evaluate the performance at PHY level of a specific
    * gateway.
@@ -163,17 +292,229 @@ public:
    */
   std::string CountMacPacketsGloballyCpsr (Time startTime, Time stopTime);
 
+  /**
+   * Compute the average delay between the transmission of a MAC packet sent
+   * in (startTime, stopTime) and its reception at gateways gwId, ...,
+   * gwId + gwNum - 1, over all receptions at those gateways.
+   *
+   * This returns a string containing the average delay in seconds.
+   */
+  std::string CountMacPacketsGloballyDelay (Time startTime, Time stopTime,
+                                            uint32_t gwId, uint32_t gwNum);
+
+  /* by spreading factor */
+  std::string CountMacPacketsGloballyDelay (Time startTime, Time stopTime,
+                                            uint32_t gwId, uint32_t gwNum,
+                                            uint8_t sf);
+
+  /**
+   * Enable the streaming mode.
+   *
+   * Instead of keeping the status of each packet until the end of the
+   * simulation, the tracker folds it into the counters of the time bucket its
+   * transmission falls in once all of its outcomes are known, and then
+   * discards it. This way, memory grows with the simulated time instead of
+   * with the traffic. Counting functions keep working, but they resolve the
+   * start of the packets that were already folded with the granularity of a
+   * bucket: a bucket is counted if its start time is in [startTime,
+   * stopTime).
+   *
+   * This must be called before the first packet is sent.
+   *
+   * In this mode, the PHY transmissions of a packet are only tracked if its
+   * MAC transmission is (through MacTransmissionCallback, called first), so
+   * that retransmissions of a packet whose records were already folded are
+   * ignored instead of being counted as a new packet.
+   *
+   * \param bucketDuration The duration of a time bucket.
+   * \param completionDelay The time after its transmission after which a
+   * packet is considered complete.
+   */
+  void EnableStreaming (Time bucketDuration,
+                        Time completionDelay = Seconds (10));
 
-  std::string CountMacPacketsGloballyDelay (Time startTime, Time stopTime, 
-											uint32_t gwId, uint32_t gwNum);
+  /**
+   * Whether the tracker is in streaming mode.
+   */
+  bool IsStreaming (void) const;
 
-  std::string CountMacPacketsGloballyDelay (Time startTime, Time stopTime, 
-											uint32_t gwId, uint32_t gwNum, uint8_t sf);
+  /**
+   * Get the number of PHY, MAC and retransmission records currently kept.
+   */
+  uint64_t GetRecordCount (void) const;
+
+  /**
+   * Write the outcome of each uplink packet to a binary file, through a
+   * LoraPacketTraceWriter.
+   *
+   * A packet is written once it is complete, i.e., after the completion delay
+   * of EnableStreaming (10 seconds by default) has elapsed since its
+   * transmission. The remaining packets are written, and the file is closed,
+   * by CloseTraceFile, which is called automatically at Simulator::Destroy.
+   *
+   * \param filename The path of the file.
+   */
+  void EnableTraceFile (std::string filename);
+
+  /**
+   * Write all remaining packets to the trace file and close it.
+   */
+  void CloseTraceFile (void);
+
+  /**
+   * Keep histograms of the latency of the packets, updated as they are
+   * received, in windows of a fixed duration. Packets are assigned to the
+   * window of their first transmission.
+   *
+   * The uplink latency goes from the transmission of a packet to its reception
+   * by the MAC layer of a gateway, and the retransmission latency goes from
+   * the first transmission of a packet to the end of its successful
+   * retransmission procedure.
+   *
+   * \param windowDuration The duration of a window.
+   */
+  void EnableLatencyHistograms (Time windowDuration);
+
+  /**
+   * Get the uplink latency of the packets sent in windows starting in
+   * [startTime, stopTime), until their first reception by a gateway.
+   */
+  LatencyHistogram GetUplinkLatency (Time startTime, Time stopTime) const;
+
+  /**
+   * Get the uplink latency of the packets sent with a certain SF in windows
+   * starting in [startTime, stopTime), until their first reception by a
+   * gateway.
+   */
+  LatencyHistogram GetUplinkLatencyPerSf (Time startTime, Time stopTime,
+                                          uint8_t sf) const;
+
+  /**
+   * Get the uplink latency of the packets sent in windows starting in
+   * [startTime, stopTime), until their reception by a certain gateway.
+   */
+  LatencyHistogram GetUplinkLatencyPerGw (Time startTime, Time stopTime,
+                                          int gwId) const;
+
+  /**
+   * Get the retransmission latency of the packets sent in windows starting in
+   * [startTime, stopTime).
+   */
+  LatencyHistogram GetRetransmissionLatency (Time startTime,
+                                             Time stopTime) const;
+
+  /**
+   * Get the retransmission latency of the packets sent with a certain SF in
+   * windows starting in [startTime, stopTime).
+   *
+   * The SF of a packet is only known while its record is kept by the tracker,
+   * so in streaming mode retransmission procedures lasting longer than the
+   * completion delay are only counted by GetRetransmissionLatency.
+   */
+  LatencyHistogram GetRetransmissionLatencyPerSf (Time startTime,
+                                                  Time stopTime,
+                                                  uint8_t sf) const;
 
 private:
+  /**
+   * Get the PHY record of a packet, or 0 if it is not tracked.
+   */
+  PacketStatus *FindPhyStatus (Ptr<Packet const> packet);
+
+  /**
+   * Get the MAC record of a packet, or 0 if it is not tracked.
+   */
+  MacPacketStatus *FindMacStatus (Ptr<Packet const> packet);
+
+  /**
+   * Get the dense index of a gateway, assigning one if it is new.
+   */
+  uint32_t GetGatewayIndex (int gwId);
+
+  /**
+   * Whether a MAC packet was received by at least one gateway.
+   */
+  static bool IsReceived (const MacPacketStatus &status);
+
+  /**
+   * Set the outcome of a packet at a gateway, unless it was already set.
+   */
+  void SetPhyOutcome (Ptr<Packet const> packet, int gwId,
+                      enum PhyPacketOutcome outcome);
+
+  /**
+   * Sort the retransmission records by time of first attempt, if needed.
+   */
+  void SortRetransmissions (void);
+
+  /**
+   * Write and, in streaming mode, fold the packets that are complete.
+   */
+  void FlushCompleted (void);
+
+  /**
+   * Write the packets sent before a certain time that were not written yet.
+   */
+  void WriteCompleted (Time threshold);
+
+  /**
+   * Fold the packets sent before a certain time into the bucket counters.
+   */
+  void FoldCompleted (Time threshold);
+
+  /**
+   * Get the bucket counters of a certain time.
+   */
+  TrackerBucket &GetBucket (Time time);
+
+  /**
+   * Get the range of buckets whose start time is in [startTime, stopTime).
+   */
+  std::map<int64_t, TrackerBucket>::const_iterator
+  GetFirstBucket (Time startTime) const;
+  std::map<int64_t, TrackerBucket>::const_iterator
+  GetLastBucket (Time stopTime) const;
+
+  /**
+   * Get the latency histograms of a certain time.
+   */
+  LatencyWindow &GetLatencyWindow (Time time);
+
+  /**
+   * Get the first latency window starting at or after a certain time.
+   */
+  std::map<int64_t, LatencyWindow>::const_iterator
+  GetFirstLatencyWindow (Time startTime) const;
+
   PhyPacketData m_packetTracker;
   MacPacketData m_macPacketTracker;
   RetransmissionData m_reTransmissionTracker;
+
+  // Position of each packet's record, by packet UID, counted from the first
+  // record ever inserted: records folded in streaming mode are removed from
+  // the front
+  std::unordered_map<uint64_t, uint64_t> m_phyIndex;
+  std::unordered_map<uint64_t, uint64_t> m_macIndex;
+  uint64_t m_phyOffset;   //!< Number of PHY records removed from the front
+  uint64_t m_macOffset;   //!< Number of MAC records removed from the front
+
+  bool m_reTransmissionSorted;   //!< Whether retransmissions are sorted
+
+  std::vector<int> m_gwIds;   //!< Gateway id, by dense index
+  std::unordered_map<int, uint32_t> m_gwIndex;   //!< Dense index, by gateway id
+
+  bool m_streaming;   //!< Whether the streaming mode is enabled
+  Time m_bucketDuration;   //!< The duration of a bucket
+  Time m_completionDelay;   //!< After this, a packet is complete
+  Time m_nextFlush;   //!< Time at which complete packets are folded next
+  std::map<int64_t, TrackerBucket> m_buckets;   //!< Counters, by bucket index
+
+  Ptr<LoraPacketTraceWriter> m_traceWriter;   //!< Sink for complete packets
+  uint64_t m_phyWritten;   //!< Number of PHY records written to the sink
+  EventId m_closeTraceFileEvent;   //!< Closes the trace file at Destroy
+
+  Time m_latencyWindowDuration;   //!< Zero if histograms are disabled
+  std::map<int64_t, LatencyWindow> m_latencyWindows;   //!< By window index
 };
 }
 }
@@ -76,10 +76,13 @@ LoraPhyHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
   Ptr<LoraPhy> phy = m_phy.Create<LoraPhy> ();
   phy->SetChannel (m_channel);
 
-  // Configuration is different based on the kind of device we have to create
-  std::string typeId = m_phy.GetTypeId ().GetName ();
-  if (typeId == "ns3::SimpleGatewayLoraPhy")
+  // Configuration is different based on the kind of device we have to create.
+  // Compare TypeIds rather than their names, since this runs once per device.
+  TypeId typeId = m_phy.GetTypeId ();
+  if (typeId == SimpleGatewayLoraPhy::GetTypeId ())
     {
+      Ptr<SimpleGatewayLoraPhy> gatewayPhy = phy->GetObject<SimpleGatewayLoraPhy> ();
+
       // Inform the channel of the presence of this PHY
       m_channel->Add (phy);
 
@@ -109,7 +112,7 @@ LoraPhyHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
 
       for (auto &f : frequencies)
         {
-          phy->GetObject<SimpleGatewayLoraPhy> ()->AddFrequency (f);
+          gatewayPhy->AddFrequency (f);
         }
 
       int receptionPaths = 0;
@@ -117,11 +120,11 @@ LoraPhyHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
       // int maxReceptionPaths = 8;
       while (receptionPaths < m_maxReceptionPaths)
         {
-          phy->GetObject<SimpleGatewayLoraPhy> ()->AddReceptionPath ();
+          gatewayPhy->AddReceptionPath ();
           receptionPaths++;
         }
     }
-  else if (typeId == "ns3::SimpleEndDeviceLoraPhy")
+  else if (typeId == SimpleEndDeviceLoraPhy::GetTypeId ())
     {
       // The line below can be commented to speed up uplink-only simulations.
       // This implies that the LoraChannel instance will only know about
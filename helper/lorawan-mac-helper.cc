@@ -24,6 +24,16 @@
 #include "ns3/lora-net-device.h"
 #include "ns3/log.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/gateway-spatial-index.h"
+#include "ns3/lora-substream-rng.h"
+#include "ns3/periodic-sender.h"
+#include "ns3/random-sender.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lorawan-mac-header.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <thread>
 
 namespace ns3 {
 namespace lorawan {
@@ -70,23 +80,30 @@ LorawanMacHelper::SetRegion (enum LorawanMacHelper::Regions region)
   m_region = region;
 }
 
+Ptr<const LoraRegionalPlan>
+LorawanMacHelper::GetRegionalPlan (void) const
+{
+  return GetRegionalPlan (m_region);
+}
+
 Ptr<LorawanMac>
 LorawanMacHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
 {
   Ptr<LorawanMac> mac = m_mac.Create<LorawanMac> ();
   mac->SetDevice (device);
 
-  // If we are operating on an end device, add an address to it
-  if (m_deviceType == ED_A && m_addrGen != NULL)
-    {
-      mac->GetObject<ClassAEndDeviceLorawanMac> ()->SetDeviceAddress (m_addrGen->NextAddress ());
-    }
-
   // Add a basic list of channels based on the region where the device is
   // operating
   if (m_deviceType == ED_A)
     {
       Ptr<ClassAEndDeviceLorawanMac> edMac = mac->GetObject<ClassAEndDeviceLorawanMac> ();
+
+      // If we are operating on an end device, add an address to it
+      if (m_addrGen != NULL)
+        {
+          edMac->SetDeviceAddress (m_addrGen->NextAddress ());
+        }
+
       switch (m_region)
         {
           case LorawanMacHelper::EU: {
@@ -133,30 +150,64 @@ LorawanMacHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
   return mac;
 }
 
+Ptr<const LoraRegionalPlan>
+LorawanMacHelper::GetRegionalPlan (enum Regions region) const
+{
+  NS_LOG_FUNCTION (this << region);
+
+  // All the MACs of a region share the same plan
+  auto it = m_regionalPlans.find (region);
+  if (it != m_regionalPlans.end ())
+    {
+      return it->second;
+    }
+
+  Ptr<const LoraRegionalPlan> plan;
+  switch (region)
+    {
+      case LorawanMacHelper::EU: {
+        plan = CreateEuRegionalPlan ();
+        break;
+      }
+      case LorawanMacHelper::SingleChannel: {
+        plan = CreateSingleChannelRegionalPlan ();
+        break;
+      }
+      case LorawanMacHelper::ALOHA: {
+        plan = CreateAlohaRegionalPlan ();
+        break;
+      }
+      default: {
+        NS_LOG_ERROR ("This region isn't supported yet!");
+        return 0;
+      }
+    }
+
+  m_regionalPlans[region] = plan;
+  return plan;
+}
+
 void
-LorawanMacHelper::ConfigureForAlohaRegion (Ptr<ClassAEndDeviceLorawanMac> edMac) const
+LorawanMacHelper::ApplyRegionalPlan (Ptr<GatewayLorawanMac> gwMac,
+                                     Ptr<const LoraRegionalPlan> plan) const
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  ApplyCommonAlohaConfigurations (edMac);
+  gwMac->SetRegionalPlan (plan);
 
-  /////////////////////////////////////////////////////
-  // TxPower -> Transmission power in dBm conversion //
-  /////////////////////////////////////////////////////
-  edMac->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
+  // The gateway gets SubBands of its own, since GatewayStatus follows the
+  // duty cycle of the gateway through them
+  LogicalLoraChannelHelper channelHelper;
+  channelHelper.CopyRegionalPlan (plan);
+  gwMac->SetLogicalLoraChannelHelper (channelHelper);
+}
 
-  ////////////////////////////////////////////////////////////
-  // Matrix to know which DataRate the GW will respond with //
-  ////////////////////////////////////////////////////////////
-  LorawanMac::ReplyDataRateMatrix matrix = {{{{0, 0, 0, 0, 0, 0}},
-                                             {{1, 0, 0, 0, 0, 0}},
-                                             {{2, 1, 0, 0, 0, 0}},
-                                             {{3, 2, 1, 0, 0, 0}},
-                                             {{4, 3, 2, 1, 0, 0}},
-                                             {{5, 4, 3, 2, 1, 0}},
-                                             {{6, 5, 4, 3, 2, 1}},
-                                             {{7, 6, 5, 4, 3, 2}}}};
-  edMac->SetReplyDataRateMatrix (matrix);
+void
+LorawanMacHelper::ConfigureForAlohaRegion (Ptr<ClassAEndDeviceLorawanMac> edMac) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  edMac->SetRegionalPlan (GetRegionalPlan (LorawanMacHelper::ALOHA));
 
   /////////////////////
   // Preamble length //
@@ -181,7 +232,7 @@ LorawanMacHelper::ConfigureForAlohaRegion (Ptr<GatewayLorawanMac> gwMac) const
   Ptr<GatewayLoraPhy> gwPhy =
       gwMac->GetDevice ()->GetObject<LoraNetDevice> ()->GetPhy ()->GetObject<GatewayLoraPhy> ();
 
-  ApplyCommonAlohaConfigurations (gwMac);
+  ApplyRegionalPlan (gwMac, GetRegionalPlan (LorawanMacHelper::ALOHA));
 
   if (gwPhy) // If cast is successful, there's a GatewayLoraPhy
     {
@@ -199,61 +250,61 @@ LorawanMacHelper::ConfigureForAlohaRegion (Ptr<GatewayLorawanMac> gwMac) const
     }
 }
 
-void
-LorawanMacHelper::ApplyCommonAlohaConfigurations (Ptr<LorawanMac> lorawanMac) const
+Ptr<LoraRegionalPlan>
+LorawanMacHelper::CreateAlohaRegionalPlan (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  Ptr<LoraRegionalPlan> plan = Create<LoraRegionalPlan> ();
+
   //////////////
   // SubBands //
   //////////////
 
-  LogicalLoraChannelHelper channelHelper;
-  channelHelper.AddSubBand (868, 868.6, 1, 14);
+  plan->AddSubBand (868, 868.6, 1, 14);
 
   //////////////////////
   // Default channels //
   //////////////////////
-  Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel> (868.1, 0, 5);
-  channelHelper.AddChannel (lc1);
-
-  lorawanMac->SetLogicalLoraChannelHelper (channelHelper);
+  plan->AddChannel (868.1, 0, 5);
 
   ///////////////////////////////////////////////
   // DataRate -> SF, DataRate -> Bandwidth     //
   // and DataRate -> MaxAppPayload conversions //
   ///////////////////////////////////////////////
-  lorawanMac->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
-  lorawanMac->SetBandwidthForDataRate (
+  plan->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
+  plan->SetBandwidthForDataRate (
       std::vector<double>{125000, 125000, 125000, 125000, 125000, 125000, 250000});
-  lorawanMac->SetMaxAppPayloadForDataRate (
+  plan->SetMaxAppPayloadForDataRate (
       std::vector<uint32_t>{59, 59, 59, 123, 230, 230, 230, 230});
-}
-
-void
-LorawanMacHelper::ConfigureForEuRegion (Ptr<ClassAEndDeviceLorawanMac> edMac) const
-{
-  NS_LOG_FUNCTION_NOARGS ();
-
-  ApplyCommonEuConfigurations (edMac);
 
   /////////////////////////////////////////////////////
   // TxPower -> Transmission power in dBm conversion //
   /////////////////////////////////////////////////////
-  edMac->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
+  plan->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
 
   ////////////////////////////////////////////////////////////
   // Matrix to know which DataRate the GW will respond with //
   ////////////////////////////////////////////////////////////
-  LorawanMac::ReplyDataRateMatrix matrix = {{{{0, 0, 0, 0, 0, 0}},
-                                             {{1, 0, 0, 0, 0, 0}},
-                                             {{2, 1, 0, 0, 0, 0}},
-                                             {{3, 2, 1, 0, 0, 0}},
-                                             {{4, 3, 2, 1, 0, 0}},
-                                             {{5, 4, 3, 2, 1, 0}},
-                                             {{6, 5, 4, 3, 2, 1}},
-                                             {{7, 6, 5, 4, 3, 2}}}};
-  edMac->SetReplyDataRateMatrix (matrix);
+  LoraRegionalPlan::ReplyDataRateMatrix matrix = {{{{0, 0, 0, 0, 0, 0}},
+                                                   {{1, 0, 0, 0, 0, 0}},
+                                                   {{2, 1, 0, 0, 0, 0}},
+                                                   {{3, 2, 1, 0, 0, 0}},
+                                                   {{4, 3, 2, 1, 0, 0}},
+                                                   {{5, 4, 3, 2, 1, 0}},
+                                                   {{6, 5, 4, 3, 2, 1}},
+                                                   {{7, 6, 5, 4, 3, 2}}}};
+  plan->SetReplyDataRateMatrix (matrix);
+
+  return plan;
+}
+
+void
+LorawanMacHelper::ConfigureForEuRegion (Ptr<ClassAEndDeviceLorawanMac> edMac) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  edMac->SetRegionalPlan (GetRegionalPlan (LorawanMacHelper::EU));
 
   /////////////////////
   // Preamble length //
@@ -278,7 +329,7 @@ LorawanMacHelper::ConfigureForEuRegion (Ptr<GatewayLorawanMac> gwMac) const
   Ptr<GatewayLoraPhy> gwPhy =
       gwMac->GetDevice ()->GetObject<LoraNetDevice> ()->GetPhy ()->GetObject<GatewayLoraPhy> ();
 
-  ApplyCommonEuConfigurations (gwMac);
+  ApplyRegionalPlan (gwMac, GetRegionalPlan (LorawanMacHelper::EU));
 
   if (gwPhy) // If cast is successful, there's a GatewayLoraPhy
     {
@@ -310,51 +361,62 @@ LorawanMacHelper::ConfigureForEuRegion (Ptr<GatewayLorawanMac> gwMac) const
     }
 }
 
-void
-LorawanMacHelper::ApplyCommonEuConfigurations (Ptr<LorawanMac> lorawanMac) const
+Ptr<LoraRegionalPlan>
+LorawanMacHelper::CreateEuRegionalPlan (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  Ptr<LoraRegionalPlan> plan = Create<LoraRegionalPlan> ();
+
   //////////////
   // SubBands //
   //////////////
 
-  LogicalLoraChannelHelper channelHelper;
-  channelHelper.AddSubBand (867, 868.6, 0.01, 14);
-  channelHelper.AddSubBand (868.7, 869.2, 0.1, 14);
-  channelHelper.AddSubBand (869.4, 869.65, 0.1, 27);
+  plan->AddSubBand (867, 868.6, 0.01, 14);
+  plan->AddSubBand (868.7, 869.2, 0.1, 14);
+  plan->AddSubBand (869.4, 869.65, 0.1, 27);
 
   //////////////////////
   // Default channels //
   //////////////////////
-  Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel> (867.1, 0, 5);
-  Ptr<LogicalLoraChannel> lc2 = CreateObject<LogicalLoraChannel> (867.3, 0, 5);
-  Ptr<LogicalLoraChannel> lc3 = CreateObject<LogicalLoraChannel> (867.5, 0, 5);
-  Ptr<LogicalLoraChannel> lc4 = CreateObject<LogicalLoraChannel> (867.7, 0, 5);
-  Ptr<LogicalLoraChannel> lc5 = CreateObject<LogicalLoraChannel> (867.9, 0, 5);
-  Ptr<LogicalLoraChannel> lc6 = CreateObject<LogicalLoraChannel> (868.1, 0, 5);
-  Ptr<LogicalLoraChannel> lc7 = CreateObject<LogicalLoraChannel> (868.3, 0, 5);
-  Ptr<LogicalLoraChannel> lc8 = CreateObject<LogicalLoraChannel> (868.5, 0, 5);
-  channelHelper.AddChannel (lc1);
-  channelHelper.AddChannel (lc2);
-  channelHelper.AddChannel (lc3);
-  channelHelper.AddChannel (lc4);
-  channelHelper.AddChannel (lc5);
-  channelHelper.AddChannel (lc6);
-  channelHelper.AddChannel (lc7);
-  channelHelper.AddChannel (lc8);
-
-  lorawanMac->SetLogicalLoraChannelHelper (channelHelper);
+  plan->AddChannel (867.1, 0, 5);
+  plan->AddChannel (867.3, 0, 5);
+  plan->AddChannel (867.5, 0, 5);
+  plan->AddChannel (867.7, 0, 5);
+  plan->AddChannel (867.9, 0, 5);
+  plan->AddChannel (868.1, 0, 5);
+  plan->AddChannel (868.3, 0, 5);
+  plan->AddChannel (868.5, 0, 5);
 
   ///////////////////////////////////////////////
   // DataRate -> SF, DataRate -> Bandwidth     //
   // and DataRate -> MaxAppPayload conversions //
   ///////////////////////////////////////////////
-  lorawanMac->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
-  lorawanMac->SetBandwidthForDataRate (
+  plan->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
+  plan->SetBandwidthForDataRate (
       std::vector<double>{125000, 125000, 125000, 125000, 125000, 125000, 250000});
-  lorawanMac->SetMaxAppPayloadForDataRate (
+  plan->SetMaxAppPayloadForDataRate (
       std::vector<uint32_t>{59, 59, 59, 123, 230, 230, 230, 230});
+
+  /////////////////////////////////////////////////////
+  // TxPower -> Transmission power in dBm conversion //
+  /////////////////////////////////////////////////////
+  plan->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
+
+  ////////////////////////////////////////////////////////////
+  // Matrix to know which DataRate the GW will respond with //
+  ////////////////////////////////////////////////////////////
+  LoraRegionalPlan::ReplyDataRateMatrix matrix = {{{{0, 0, 0, 0, 0, 0}},
+                                                   {{1, 0, 0, 0, 0, 0}},
+                                                   {{2, 1, 0, 0, 0, 0}},
+                                                   {{3, 2, 1, 0, 0, 0}},
+                                                   {{4, 3, 2, 1, 0, 0}},
+                                                   {{5, 4, 3, 2, 1, 0}},
+                                                   {{6, 5, 4, 3, 2, 1}},
+                                                   {{7, 6, 5, 4, 3, 2}}}};
+  plan->SetReplyDataRateMatrix (matrix);
+
+  return plan;
 }
 
 ///////////////////////////////
@@ -364,25 +426,7 @@ LorawanMacHelper::ConfigureForSingleChannelRegion (Ptr<ClassAEndDeviceLorawanMac
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  ApplyCommonSingleChannelConfigurations (edMac);
-
-  /////////////////////////////////////////////////////
-  // TxPower -> Transmission power in dBm conversion //
-  /////////////////////////////////////////////////////
-  edMac->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
-
-  ////////////////////////////////////////////////////////////
-  // Matrix to know which DataRate the GW will respond with //
-  ////////////////////////////////////////////////////////////
-  LorawanMac::ReplyDataRateMatrix matrix = {{{{0, 0, 0, 0, 0, 0}},
-                                             {{1, 0, 0, 0, 0, 0}},
-                                             {{2, 1, 0, 0, 0, 0}},
-                                             {{3, 2, 1, 0, 0, 0}},
-                                             {{4, 3, 2, 1, 0, 0}},
-                                             {{5, 4, 3, 2, 1, 0}},
-                                             {{6, 5, 4, 3, 2, 1}},
-                                             {{7, 6, 5, 4, 3, 2}}}};
-  edMac->SetReplyDataRateMatrix (matrix);
+  edMac->SetRegionalPlan (GetRegionalPlan (LorawanMacHelper::SingleChannel));
 
   /////////////////////
   // Preamble length //
@@ -407,7 +451,7 @@ LorawanMacHelper::ConfigureForSingleChannelRegion (Ptr<GatewayLorawanMac> gwMac)
   Ptr<GatewayLoraPhy> gwPhy =
       gwMac->GetDevice ()->GetObject<LoraNetDevice> ()->GetPhy ()->GetObject<GatewayLoraPhy> ();
 
-  ApplyCommonEuConfigurations (gwMac);
+  ApplyRegionalPlan (gwMac, GetRegionalPlan (LorawanMacHelper::EU));
 
   if (gwPhy) // If cast is successful, there's a GatewayLoraPhy
     {
@@ -432,156 +476,459 @@ LorawanMacHelper::ConfigureForSingleChannelRegion (Ptr<GatewayLorawanMac> gwMac)
     }
 }
 
-void
-LorawanMacHelper::ApplyCommonSingleChannelConfigurations (Ptr<LorawanMac> lorawanMac) const
+Ptr<LoraRegionalPlan>
+LorawanMacHelper::CreateSingleChannelRegionalPlan (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  Ptr<LoraRegionalPlan> plan = Create<LoraRegionalPlan> ();
+
   //////////////
   // SubBands //
   //////////////
 
-  LogicalLoraChannelHelper channelHelper;
-  channelHelper.AddSubBand (868, 868.6, 0.01, 14);
-  channelHelper.AddSubBand (868.7, 869.2, 0.01, 14);
-  channelHelper.AddSubBand (869.4, 869.65, 0.1, 27);
+  plan->AddSubBand (868, 868.6, 0.01, 14);
+  plan->AddSubBand (868.7, 869.2, 0.01, 14);
+  plan->AddSubBand (869.4, 869.65, 0.1, 27);
 
   //////////////////////
   // Default channels //
   //////////////////////
-  Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel> (868.1, 0, 5);
-  channelHelper.AddChannel (lc1);
-
-  lorawanMac->SetLogicalLoraChannelHelper (channelHelper);
+  plan->AddChannel (868.1, 0, 5);
 
   ///////////////////////////////////////////////
   // DataRate -> SF, DataRate -> Bandwidth     //
   // and DataRate -> MaxAppPayload conversions //
   ///////////////////////////////////////////////
-  lorawanMac->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
-  lorawanMac->SetBandwidthForDataRate (
+  plan->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
+  plan->SetBandwidthForDataRate (
       std::vector<double>{125000, 125000, 125000, 125000, 125000, 125000, 250000});
-  lorawanMac->SetMaxAppPayloadForDataRate (
+  plan->SetMaxAppPayloadForDataRate (
       std::vector<uint32_t>{59, 59, 59, 123, 230, 230, 230, 230});
+
+  /////////////////////////////////////////////////////
+  // TxPower -> Transmission power in dBm conversion //
+  /////////////////////////////////////////////////////
+  plan->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
+
+  ////////////////////////////////////////////////////////////
+  // Matrix to know which DataRate the GW will respond with //
+  ////////////////////////////////////////////////////////////
+  LoraRegionalPlan::ReplyDataRateMatrix matrix = {{{{0, 0, 0, 0, 0, 0}},
+                                                   {{1, 0, 0, 0, 0, 0}},
+                                                   {{2, 1, 0, 0, 0, 0}},
+                                                   {{3, 2, 1, 0, 0, 0}},
+                                                   {{4, 3, 2, 1, 0, 0}},
+                                                   {{5, 4, 3, 2, 1, 0}},
+                                                   {{6, 5, 4, 3, 2, 1}},
+                                                   {{7, 6, 5, 4, 3, 2}}}};
+  plan->SetReplyDataRateMatrix (matrix);
+
+  return plan;
 }
 
-std::vector<uint8_t>
+std::vector<uint32_t>
 LorawanMacHelper::SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer gateways,
                                          Ptr<LoraChannel> channel, bool enableRTX)
 {
-  NS_LOG_FUNCTION_NOARGS ();
+  return SetSpreadingFactorsUp (endDevices, gateways, channel, enableRTX, 0, 1);
+}
+
+std::vector<uint32_t>
+LorawanMacHelper::SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer gateways,
+                                         Ptr<LoraChannel> channel, bool enableRTX,
+                                         uint32_t candidateGateways, uint32_t nThreads)
+{
+  NS_LOG_FUNCTION (candidateGateways << nThreads);
+
+  // Look up the mobility model of each gateway only once
+  std::vector<Ptr<MobilityModel> > gatewayMobility;
+  std::vector<Vector> gatewayPositions;
+  for (NodeContainer::Iterator gw = gateways.Begin (); gw != gateways.End (); ++gw)
+    {
+      Ptr<MobilityModel> mobility = (*gw)->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != NULL);
+      gatewayMobility.push_back (mobility);
+      gatewayPositions.push_back (mobility->GetPosition ());
+    }
 
-  std::vector<uint8_t> sfQuantity (6, 0);
+  std::vector<Ptr<MobilityModel> > deviceMobility;
+  std::vector<Vector> devicePositions;
   for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
     {
-      Ptr<Node> object = *j;
-      Ptr<MobilityModel> position = object->GetObject<MobilityModel> ();
-      NS_ASSERT (position != NULL);
-      Ptr<NetDevice> netDevice = object->GetDevice (0);
+      Ptr<MobilityModel> mobility = (*j)->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != NULL);
+      deviceMobility.push_back (mobility);
+      devicePositions.push_back (mobility->GetPosition ());
+    }
+
+  // Find the candidate gateways of each device. This only touches plain
+  // positions, so it can be split among threads; the link budgets below go
+  // through the propagation models, which are not thread-safe (reference
+  // counts included) and, unless LoraDeviceSubstreams is set, draw from shared
+  // random variables, and are evaluated in device order on this thread, so
+  // that the outcome does not depend on the number of threads.
+  uint32_t nCandidates = gateways.GetN ();
+  std::vector<uint32_t> candidates;
+  if (candidateGateways > 0 && candidateGateways < gateways.GetN ())
+    {
+      nCandidates = candidateGateways;
+      candidates.resize (devicePositions.size () * nCandidates);
+      GatewaySpatialIndex index (gatewayPositions);
+
+      auto findCandidates = [&] (uint32_t begin, uint32_t end)
+        {
+          std::vector<uint32_t> nearest;
+          for (uint32_t i = begin; i < end; i++)
+            {
+              index.GetNearest (devicePositions[i], nCandidates, nearest);
+              // Evaluate candidates in container order, to break ties as
+              // when all gateways are evaluated
+              std::sort (nearest.begin (), nearest.end ());
+              std::copy (nearest.begin (), nearest.end (),
+                         candidates.begin () + i * nCandidates);
+            }
+        };
+
+      if (nThreads == 0)
+        {
+          nThreads = std::max (std::thread::hardware_concurrency (), 1u);
+        }
+      nThreads = std::min<uint32_t> (nThreads, devicePositions.size ());
+      if (nThreads <= 1)
+        {
+          findCandidates (0, devicePositions.size ());
+        }
+      else
+        {
+          std::vector<std::thread> threads;
+          uint32_t chunk = (devicePositions.size () + nThreads - 1) / nThreads;
+          for (uint32_t begin = 0; begin < devicePositions.size (); begin += chunk)
+            {
+              threads.push_back (std::thread (findCandidates, begin,
+                                              std::min<uint32_t> (begin + chunk,
+                                                                  devicePositions.size ())));
+            }
+          for (auto &thread : threads)
+            {
+              thread.join ();
+            }
+        }
+    }
+
+  // Without RTX, the uplink must reach the gateway, otherwise the downlink
+  // must reach the device
+  const double *sensitivity = enableRTX ? EndDeviceLoraPhy::sensitivity :
+    GatewayLoraPhy::sensitivity;
+
+  std::vector<uint32_t> sfQuantity (6, 0);
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      Ptr<NetDevice> netDevice = endDevices.Get (i)->GetDevice (0);
       Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice> ();
       NS_ASSERT (loraNetDevice != NULL);
       Ptr<ClassAEndDeviceLorawanMac> mac =
           loraNetDevice->GetMac ()->GetObject<ClassAEndDeviceLorawanMac> ();
       NS_ASSERT (mac != NULL);
 
-      // Try computing the distance from each gateway and find the best one
-      Ptr<Node> bestGateway = gateways.Get (0);
-      Ptr<MobilityModel> bestGatewayPosition = bestGateway->GetObject<MobilityModel> ();
-
-      // Assume devices transmit at 14 dBm
-      double highestRxPower = channel->GetRxPower (14, position, bestGatewayPosition);
-
-      for (NodeContainer::Iterator currentGw = gateways.Begin () + 1; currentGw != gateways.End ();
-           ++currentGw)
+      // Find the best gateway among the candidates, assuming devices
+      // transmit at 14 dBm
+      double highestRxPower = -std::numeric_limits<double>::infinity ();
+      for (uint32_t c = 0; c < nCandidates; c++)
         {
-          // Compute the power received from the current gateway
-          Ptr<Node> curr = *currentGw;
-          Ptr<MobilityModel> currPosition = curr->GetObject<MobilityModel> ();
-          double currentRxPower = channel->GetRxPower (14, position, currPosition); // dBm
-
+          uint32_t gw = candidates.empty () ? c : candidates[i * nCandidates + c];
+          double currentRxPower = channel->GetRxPower (14, deviceMobility[i],
+                                                       gatewayMobility[gw]); // dBm
           if (currentRxPower > highestRxPower)
             {
-              bestGateway = curr;
-              bestGatewayPosition = curr->GetObject<MobilityModel> ();
               highestRxPower = currentRxPower;
             }
         }
 
       // NS_LOG_DEBUG ("Rx Power: " << highestRxPower);
-      double rxPower = highestRxPower;
-	  if(enableRTX){
+      uint8_t sfIndex = 0;
+      while (sfIndex < 6 && highestRxPower <= sensitivity[sfIndex])
+        {
+          sfIndex++;
+        }
+      if (sfIndex == 6)
+        {
+          // Device is out of range. Assign SF12.
+          NS_LOG_DEBUG ("Device out of range");
+          sfIndex = 5;
+        }
 
-      	// Get the ED sensitivity
-      	Ptr<EndDeviceLoraPhy> edPhy = loraNetDevice->GetPhy ()->GetObject<EndDeviceLoraPhy> ();
-      	const double *edSensitivity = edPhy->sensitivity;
+      mac->SetDataRate (5 - sfIndex);
+      sfQuantity[sfIndex]++;
 
-      	if (rxPower > *edSensitivity){
-        	mac->SetDataRate (5);
-        	sfQuantity[0] = sfQuantity[0] + 1;
-        }else if (rxPower > *(edSensitivity + 1)){
-         	mac->SetDataRate (4);
-          	sfQuantity[1] = sfQuantity[1] + 1;
-        }else if (rxPower > *(edSensitivity + 2)){
-         	mac->SetDataRate (3);
-          	sfQuantity[2] = sfQuantity[2] + 1;
-        }else if (rxPower > *(edSensitivity + 3)){
-          	mac->SetDataRate (2);
-          	sfQuantity[3] = sfQuantity[3] + 1;
-        }else if (rxPower > *(edSensitivity + 4)){
-          	mac->SetDataRate (1);
-          	sfQuantity[4] = sfQuantity[4] + 1;
-        }else if (rxPower > *(edSensitivity + 5)){
-          	mac->SetDataRate (0);
-          	sfQuantity[5] = sfQuantity[5] + 1;
-        }else{ // Device is out of range. Assign SF12.
-          	NS_LOG_DEBUG ("Device out of range");
-          	mac->SetDataRate (0);
-          	sfQuantity[6] = sfQuantity[6] + 1;
-          	NS_LOG_DEBUG ("sfQuantity[6] = " << sfQuantity[6]);
+    } // end loop on nodes
+
+  return sfQuantity;
+
+} //  end function
+
+
+std::vector<uint32_t>
+LorawanMacHelper::SetSpreadingFactorsCapacityAware (NodeContainer endDevices, NodeContainer gateways,
+                                                    Ptr<LoraChannel> channel, Time defaultInterval,
+                                                    uint8_t defaultPacketSize,
+                                                    uint32_t candidateGateways)
+{
+  NS_LOG_FUNCTION (defaultInterval << unsigned (defaultPacketSize) << candidateGateways);
+
+  std::vector<Ptr<MobilityModel> > gatewayMobility;
+  std::vector<Vector> gatewayPositions;
+  for (NodeContainer::Iterator gw = gateways.Begin (); gw != gateways.End (); ++gw)
+    {
+      Ptr<MobilityModel> mobility = (*gw)->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != NULL);
+      gatewayMobility.push_back (mobility);
+      gatewayPositions.push_back (mobility->GetPosition ());
+    }
+  GatewaySpatialIndex index (gatewayPositions);
+  bool useIndex = candidateGateways > 0 && candidateGateways < gateways.GetN ();
+
+  // What each device asks of the network
+  struct Demand
+  {
+    Ptr<ClassAEndDeviceLorawanMac> mac;
+    double rate;   // Packets per second
+    const std::vector<double> *airtimes;   // Seconds per packet, per SF
+    std::vector<uint32_t> channels;   // Indexes in frequencies
+    std::vector<uint32_t> coverage[6];   // Gateways receiving each SF
+    uint8_t firstSf;   // Fastest feasible SF, as an index, 6 if none
+    uint8_t sf;   // Assigned SF, as an index
+  };
+  std::vector<Demand> demands (endDevices.GetN ());
+  std::vector<double> frequencies;
+  std::map<uint8_t, std::vector<double> > airtimes;
+
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      Ptr<Node> node = endDevices.Get (i);
+      Demand &demand = demands[i];
+
+      Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != NULL);
+      Ptr<LoraNetDevice> loraNetDevice = node->GetDevice (0)->GetObject<LoraNetDevice> ();
+      NS_ASSERT (loraNetDevice != NULL);
+      demand.mac = loraNetDevice->GetMac ()->GetObject<ClassAEndDeviceLorawanMac> ();
+      NS_ASSERT (demand.mac != NULL);
+
+      // Traffic, from the application if there is one
+      double interval = defaultInterval.GetSeconds ();
+      uint8_t packetSize = defaultPacketSize;
+      for (uint32_t a = 0; a < node->GetNApplications (); a++)
+        {
+          Ptr<PeriodicSender> periodic = DynamicCast<PeriodicSender> (node->GetApplication (a));
+          Ptr<RandomSender> random = DynamicCast<RandomSender> (node->GetApplication (a));
+          if (periodic != NULL && periodic->GetInterval ().IsStrictlyPositive ())
+            {
+              interval = periodic->GetInterval ().GetSeconds ();
+              packetSize = periodic->GetPacketSize ();
+            }
+          else if (random != NULL)
+            {
+              interval = random->GetMean ();
+              packetSize = random->GetPacketSize ();
+            }
         }
-	  }else{
+      NS_ASSERT (interval > 0);
+      demand.rate = 1 / interval;
 
-      	// Get the Gw sensitivity
-      	Ptr<NetDevice> gatewayNetDevice = bestGateway->GetDevice (0);
-      	Ptr<LoraNetDevice> gatewayLoraNetDevice = gatewayNetDevice->GetObject<LoraNetDevice> ();
-      	Ptr<GatewayLoraPhy> gatewayPhy = gatewayLoraNetDevice->GetPhy ()->GetObject<GatewayLoraPhy> ();
-      	const double *gwSensitivity = gatewayPhy->sensitivity;
+      // Time on air of an uplink with this payload, with the parameters used
+      // by ClassAEndDeviceLorawanMac::SendToPhy
+      auto airtime = airtimes.find (packetSize);
+      if (airtime == airtimes.end ())
+        {
+          Ptr<Packet> packet = Create<Packet> (packetSize);
+          LoraFrameHeader frameHdr;
+          frameHdr.SetAsUplink ();
+          packet->AddHeader (frameHdr);
+          LorawanMacHeader macHdr;
+          packet->AddHeader (macHdr);
+
+          std::vector<double> values;
+          for (uint8_t sf = 7; sf <= 12; sf++)
+            {
+              LoraTxParameters params;
+              params.sf = sf;
+              params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym (params) > MilliSeconds (16);
+              values.push_back (LoraPhy::GetOnAirTime (packet, params).GetSeconds ());
+            }
+          airtime = airtimes.insert (std::make_pair (packetSize, values)).first;
+        }
+      demand.airtimes = &airtime->second;
 
-      	if(rxPower > *gwSensitivity){
-          	mac->SetDataRate (5);
-          	sfQuantity[0] = sfQuantity[0] + 1;
-        }else if (rxPower > *(gwSensitivity+1)){
-          	mac->SetDataRate (4);
-          	sfQuantity[1] = sfQuantity[1] + 1;
-        }else if (rxPower > *(gwSensitivity+2)){
-          	mac->SetDataRate (3);
-          	sfQuantity[2] = sfQuantity[2] + 1;
-        }else if (rxPower > *(gwSensitivity+3)){
-          	mac->SetDataRate (2);
-          	sfQuantity[3] = sfQuantity[3] + 1;
-        }else if (rxPower > *(gwSensitivity+4)){
-          	mac->SetDataRate (1);
-          	sfQuantity[4] = sfQuantity[4] + 1;
-        }else if (rxPower > *(gwSensitivity+5)){
-          	mac->SetDataRate (0);
-          	sfQuantity[5] = sfQuantity[5] + 1;
-        }else{ // Device is out of range. Assign SF12.
-          	mac->SetDataRate (0);
-          	sfQuantity[6] = sfQuantity[6] + 1;
+      // Devices hop uniformly among their enabled channels
+      std::vector<Ptr<LogicalLoraChannel> > enabled =
+        demand.mac->GetLogicalLoraChannelHelper ().GetEnabledChannelList ();
+      NS_ASSERT (!enabled.empty ());
+      for (auto &logicalChannel : enabled)
+        {
+          double frequency = logicalChannel->GetFrequency ();
+          uint32_t f = std::find (frequencies.begin (), frequencies.end (), frequency) -
+            frequencies.begin ();
+          if (f == frequencies.size ())
+            {
+              frequencies.push_back (frequency);
+            }
+          demand.channels.push_back (f);
         }
-      }
 
-    } // end loop on nodes
+      // The gateways that would receive each SF, assuming devices transmit
+      // at 14 dBm
+      std::vector<uint32_t> nearest;
+      if (useIndex)
+        {
+          index.GetNearest (mobility->GetPosition (), candidateGateways, nearest);
+          std::sort (nearest.begin (), nearest.end ());
+        }
+      else
+        {
+          for (uint32_t gw = 0; gw < gateways.GetN (); gw++)
+            {
+              nearest.push_back (gw);
+            }
+        }
+      for (uint32_t gw : nearest)
+        {
+          double rxPower = channel->GetRxPower (14, mobility, gatewayMobility[gw]);
+          for (uint8_t sf = 0; sf < 6; sf++)
+            {
+              if (rxPower > GatewayLoraPhy::sensitivity[sf])
+                {
+                  demand.coverage[sf].push_back (gw);
+                }
+            }
+        }
+      demand.firstSf = 0;
+      while (demand.firstSf < 6 && demand.coverage[demand.firstSf].empty ())
+        {
+          demand.firstSf++;
+        }
+      demand.sf = std::min<uint8_t> (demand.firstSf, 5);
+    }
 
-  return(sfQuantity);
+  // Channel occupancy, in Erlang, of each (gateway, channel, SF)
+  uint32_t nFrequencies = frequencies.size ();
+  std::vector<double> load (gateways.GetN () * nFrequencies * 6, 0);
 
-} //  end function
+  // The peak occupancy among the cells a device would load with a given SF
+  auto getPeak = [&] (const Demand &demand, uint8_t sf)
+    {
+      double share = demand.rate * (*demand.airtimes)[sf] / demand.channels.size ();
+      double peak = 0;
+      for (uint32_t gw : demand.coverage[sf])
+        {
+          for (uint32_t f : demand.channels)
+            {
+              peak = std::max (peak, load[(gw * nFrequencies + f) * 6 + sf] + share);
+            }
+        }
+      return peak;
+    };
+  auto addLoad = [&] (const Demand &demand, double sign)
+    {
+      double share = demand.rate * (*demand.airtimes)[demand.sf] / demand.channels.size ();
+      for (uint32_t gw : demand.coverage[demand.sf])
+        {
+          for (uint32_t f : demand.channels)
+            {
+              load[(gw * nFrequencies + f) * 6 + demand.sf] += sign * share;
+            }
+        }
+    };
+  // The feasible SF that keeps the peak lowest, the fastest one on ties
+  auto choose = [&] (const Demand &demand)
+    {
+      uint8_t best = demand.firstSf;
+      double bestPeak = getPeak (demand, best);
+      for (uint8_t sf = demand.firstSf + 1; sf < 6; sf++)
+        {
+          double peak = getPeak (demand, sf);
+          if (peak < bestPeak)
+            {
+              best = sf;
+              bestPeak = peak;
+            }
+        }
+      return best;
+    };
+
+  // Place the most constrained, then the most demanding devices first
+  std::vector<uint32_t> order;
+  for (uint32_t i = 0; i < demands.size (); i++)
+    {
+      if (demands[i].firstSf < 6)
+        {
+          order.push_back (i);
+        }
+    }
+  std::stable_sort (order.begin (), order.end (), [&] (uint32_t a, uint32_t b)
+                    {
+                      const Demand &da = demands[a];
+                      const Demand &db = demands[b];
+                      if (da.firstSf != db.firstSf)
+                        {
+                          return da.firstSf > db.firstSf;
+                        }
+                      return da.rate * (*da.airtimes)[da.firstSf] >
+                             db.rate * (*db.airtimes)[db.firstSf];
+                    });
+
+  for (uint32_t i : order)
+    {
+      demands[i].sf = choose (demands[i]);
+      addLoad (demands[i], 1);
+    }
+
+  // Let each device move to a better SF, given where the others ended up,
+  // until no device moves
+  for (int pass = 0; pass < 10; pass++)
+    {
+      uint32_t moved = 0;
+      for (uint32_t i : order)
+        {
+          Demand &demand = demands[i];
+          addLoad (demand, -1);
+          uint8_t sf = choose (demand);
+          if (sf != demand.sf)
+            {
+              demand.sf = sf;
+              moved++;
+            }
+          addLoad (demand, 1);
+        }
+      NS_LOG_DEBUG ("Pass " << pass << ": " << moved << " devices moved");
+      if (moved == 0)
+        {
+          break;
+        }
+    }
+
+  NS_LOG_INFO ("Peak channel occupancy: " <<
+               (load.empty () ? 0 : *std::max_element (load.begin (), load.end ())));
 
+  std::vector<uint32_t> sfQuantity (6, 0);
+  for (auto &demand : demands)
+    {
+      if (demand.firstSf == 6)
+        {
+          // Device is out of range. Assign SF12.
+          NS_LOG_DEBUG ("Device out of range");
+        }
+      demand.mac->SetDataRate (5 - demand.sf);
+      sfQuantity[demand.sf]++;
+    }
 
-std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsEIB (NodeContainer endDevices, double rad){
+  return sfQuantity;
+}
+
+std::vector<uint32_t> LorawanMacHelper::SetSpreadingFactorsEIB (NodeContainer endDevices, double rad){
   	NS_LOG_FUNCTION_NOARGS ();
 
-  	std::vector<uint8_t> sfQuantity (6, 0);
+  	std::vector<uint32_t> sfQuantity (6, 0);
   	double pos=0, threshold=rad/3;
   	for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j){
       	Ptr<Node> object = *j;
@@ -616,8 +963,7 @@ std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsEIB (NodeContainer end
         }else{ // Device is out of range. Assign SF12.
           	// NS_LOG_DEBUG ("Device out of range");
           	mac->SetDataRate (0);
-          	sfQuantity[6] = sfQuantity[6] + 1;
-          	// NS_LOG_DEBUG ("sfQuantity[6] = " << sfQuantity[6]);
+          	sfQuantity[5] = sfQuantity[5] + 1;
         }
 
     } // end loop on nodes
@@ -625,10 +971,10 @@ std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsEIB (NodeContainer end
   	return(sfQuantity);
 }
 
-std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsEAB (NodeContainer endDevices, double rad){
+std::vector<uint32_t> LorawanMacHelper::SetSpreadingFactorsEAB (NodeContainer endDevices, double rad){
   	NS_LOG_FUNCTION_NOARGS ();
 
-  	std::vector<uint8_t> sfQuantity (6, 0);
+  	std::vector<uint32_t> sfQuantity (6, 0);
   	double pos=0;
   	for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j){
       	Ptr<Node> object = *j;
@@ -672,7 +1018,7 @@ std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsEAB (NodeContainer end
   return(sfQuantity);
 }
 
-std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsStrategies (NodeContainer endDevices, std::vector<uint8_t> sfQuantity, 
+std::vector<uint32_t> LorawanMacHelper::SetSpreadingFactorsStrategies (NodeContainer endDevices, std::vector<uint32_t> sfQuantity, 
 												 uint32_t edge, uint32_t edge2, uint32_t nDev, uint8_t mode){
   	NS_LOG_FUNCTION_NOARGS ();
 	uint8_t drAlm = 1;
@@ -849,10 +1195,10 @@ std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsStrategies (NodeContai
   	return(sfQuantity);
 }
 
-std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsProp (NodeContainer endDevices, double prop1, double prop2, double rad){
+std::vector<uint32_t> LorawanMacHelper::SetSpreadingFactorsProp (NodeContainer endDevices, double prop1, double prop2, double rad){
   	NS_LOG_FUNCTION_NOARGS ();
 
-  	std::vector<uint8_t> sfQuantity (6, 0);
+  	std::vector<uint32_t> sfQuantity (6, 0);
   	double pos=0;
   	for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j){
     	Ptr<Node> object = *j;
@@ -909,18 +1255,24 @@ std::vector<uint8_t> LorawanMacHelper::SetSpreadingFactorsProp (NodeContainer en
   return(sfQuantity);
 }
 
-std::vector<uint8_t>
+std::vector<uint32_t>
 LorawanMacHelper::SetSpreadingFactorsGivenDistribution (NodeContainer endDevices,
                                                         NodeContainer gateways,
                                                         std::vector<double> distribution)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  std::vector<uint8_t> sfQuantity (6, 0);
-  Ptr<UniformRandomVariable> uniformRV = CreateObject<UniformRandomVariable> ();
+  std::vector<uint32_t> sfQuantity (6, 0);
+  bool substreams = LoraSubstreamRng::IsEnabled ();
+  uint64_t key = LoraSubstreamRng::GetKey (LoraSubstreamRng::SPREADING_FACTOR);
+  Ptr<UniformRandomVariable> uniformRV;
+  if (!substreams)
+    {
+      uniformRV = CreateObject<UniformRandomVariable> ();
+    }
   std::vector<double> cumdistr (6);
   cumdistr[0] = distribution[0];
-  for (int i = 1; i < 7; ++i)
+  for (int i = 1; i < 6; ++i)
     {
       cumdistr[i] = distribution[i] + cumdistr[i - 1];
     }
@@ -944,7 +1296,8 @@ LorawanMacHelper::SetSpreadingFactorsGivenDistribution (NodeContainer endDevices
           loraNetDevice->GetMac ()->GetObject<ClassAEndDeviceLorawanMac> ();
       NS_ASSERT (mac != NULL);
 
-      double prob = uniformRV->GetValue (0, 1);
+      double prob = substreams ? LoraSubstreamRng (key, object->GetId ()).GetValue () :
+        uniformRV->GetValue (0, 1);
 
       // NS_LOG_DEBUG ("Probability: " << prob);
       if (prob < cumdistr[0])
@@ -30,6 +30,8 @@
 #include "ns3/gateway-lorawan-mac.h"
 #include "ns3/node-container.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/lora-regional-plan.h"
+#include <map>
 
 namespace ns3 {
 namespace lorawan {
@@ -99,6 +101,14 @@ public:
    */
   void SetRegion (enum Regions region);
 
+  /**
+   * Get the regional plan of the region set with SetRegion, which is shared
+   * by all the end device MACs this helper creates.
+   *
+   * \return The plan, or 0 if the region isn't supported.
+   */
+  Ptr<const LoraRegionalPlan> GetRegionalPlan (void) const;
+
   /**
    * Create the LorawanMac instance and connect it to a device
    *
@@ -117,28 +127,98 @@ public:
    * SF10 -> DR2
    * SF11 -> DR1
    * SF12 -> DR0
+   *
+   * Each device gets the fastest SF at which its best gateway, at 14 dBm,
+   * receives it above sensitivity (or, with enableRTX, at which it receives
+   * the gateway). Devices out of range of all gateways get SF12.
+   *
+   * \return The number of devices assigned to each SF, from SF7 to SF12.
    */
-  static std::vector<uint8_t> SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer gateways,
-                                                 Ptr<LoraChannel> channel, bool enableRTX);
+  static std::vector<uint32_t> SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer gateways,
+                                                      Ptr<LoraChannel> channel, bool enableRTX);
+
+  /**
+   * Set up the end device's data rates as above, only evaluating the link
+   * budget towards the closest gateways of each device.
+   *
+   * The closest gateways are found through a GatewaySpatialIndex, on
+   * nThreads threads. Link budgets are evaluated in device order on the
+   * calling thread, so that the result does not depend on the number of
+   * threads.
+   *
+   * \param candidateGateways The number of closest gateways to evaluate for
+   * each device, or 0 to evaluate all gateways.
+   * \param nThreads The number of threads looking for the closest gateways,
+   * or 0 to use one per hardware thread.
+   */
+  static std::vector<uint32_t> SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer gateways,
+                                                      Ptr<LoraChannel> channel, bool enableRTX,
+                                                      uint32_t candidateGateways, uint32_t nThreads);
  
-  static std::vector<uint8_t> SetSpreadingFactorsEIB (NodeContainer endDevices, double rad);
+  /**
+   * Set up the end device's data rates so that the airtime load is spread
+   * among SFs and gateways.
+   *
+   * Each device loads, with the airtime of its traffic, every (gateway,
+   * channel, SF) that would receive it, its traffic being split evenly among
+   * its enabled channels. Devices are placed one by one, the most constrained
+   * first, at the feasible SF that keeps the peak occupancy of the cells they
+   * load the lowest; then each device is moved to its best SF given the
+   * others, until no device moves.
+   *
+   * The traffic of a device is taken from its PeriodicSender or RandomSender,
+   * if one is installed, and from the default values otherwise.
+   *
+   * \param defaultInterval The interval between packets of devices without
+   * an application.
+   * \param defaultPacketSize The payload of devices without an application.
+   * \param candidateGateways The number of closest gateways that can
+   * receive each device, or 0 to consider all gateways.
+   * \return The number of devices assigned to each SF, from SF7 to SF12.
+   */
+  static std::vector<uint32_t> SetSpreadingFactorsCapacityAware (NodeContainer endDevices,
+                                                                 NodeContainer gateways,
+                                                                 Ptr<LoraChannel> channel,
+                                                                 Time defaultInterval,
+                                                                 uint8_t defaultPacketSize,
+                                                                 uint32_t candidateGateways = 0);
+
+  static std::vector<uint32_t> SetSpreadingFactorsEIB (NodeContainer endDevices, double rad);
  
-  static std::vector<uint8_t> SetSpreadingFactorsEAB (NodeContainer endDevices, double rad);
+  static std::vector<uint32_t> SetSpreadingFactorsEAB (NodeContainer endDevices, double rad);
 
-  static std::vector<uint8_t> SetSpreadingFactorsStrategies (NodeContainer endDevices, std::vector<uint8_t> sfQuantity, 
+  static std::vector<uint32_t> SetSpreadingFactorsStrategies (NodeContainer endDevices, std::vector<uint32_t> sfQuantity, 
 														 uint32_t edge, uint32_t edge2, uint32_t nDev, 
 														 uint8_t mode);
-  static std::vector<uint8_t> SetSpreadingFactorsProp (NodeContainer endDevices, double prop1, double prop2, double rad);
+  static std::vector<uint32_t> SetSpreadingFactorsProp (NodeContainer endDevices, double prop1, double prop2, double rad);
 
 
   /**
    * Set up the end device's data rates according to the given distribution.
+   *
+   * If the LoraDeviceSubstreams global value is true, the data rate of a
+   * device is drawn from the LoraSubstreamRng substream of its node id, and
+   * doesn't depend on the other devices of the container.
    */
-  static std::vector<uint8_t> SetSpreadingFactorsGivenDistribution (NodeContainer endDevices,
+  static std::vector<uint32_t> SetSpreadingFactorsGivenDistribution (NodeContainer endDevices,
                                                                 NodeContainer gateways,
                                                                 std::vector<double> distribution);
 
 private:
+  /**
+   * Get the plan of a region, creating it the first time.
+   *
+   * \return The plan, or 0 if the region isn't supported.
+   */
+  Ptr<const LoraRegionalPlan> GetRegionalPlan (enum Regions region) const;
+
+  /**
+   * Configure a gateway MAC with a regional plan. Unlike end devices, the
+   * gateway gets its own copies of the channels and SubBands of the plan.
+   */
+  void ApplyRegionalPlan (Ptr<GatewayLorawanMac> gwMac,
+                          Ptr<const LoraRegionalPlan> plan) const;
+
   /**
    * Perform region-specific configurations for the 868 MHz EU band.
    */
@@ -150,10 +230,9 @@ private:
   void ConfigureForEuRegion (Ptr<GatewayLorawanMac> gwMac) const;
 
   /**
-   * Apply configurations that are common both for the GatewayLorawanMac and the
-   * ClassAEndDeviceLorawanMac classes.
+   * Create the regional plan of the 868 MHz EU band.
    */
-  void ApplyCommonEuConfigurations (Ptr<LorawanMac> lorawanMac) const;
+  static Ptr<LoraRegionalPlan> CreateEuRegionalPlan (void);
 
   /**
    * Perform region-specific configurations for the SINGLECHANNEL band.
@@ -166,10 +245,9 @@ private:
   void ConfigureForSingleChannelRegion (Ptr<GatewayLorawanMac> gwMac) const;
 
   /**
-   * Apply configurations that are common both for the GatewayLorawanMac and the
-   * ClassAEndDeviceLorawanMac classes.
+   * Create the regional plan of the SINGLECHANNEL band.
    */
-  void ApplyCommonSingleChannelConfigurations (Ptr<LorawanMac> lorawanMac) const;
+  static Ptr<LoraRegionalPlan> CreateSingleChannelRegionalPlan (void);
 
   /**
    * Perform region-specific configurations for the ALOHA band.
@@ -182,15 +260,15 @@ private:
   void ConfigureForAlohaRegion (Ptr<GatewayLorawanMac> gwMac) const;
 
   /**
-   * Apply configurations that are common both for the GatewayLorawanMac and the
-   * ClassAEndDeviceLorawanMac classes.
+   * Create the regional plan of the ALOHA band.
    */
-  void ApplyCommonAlohaConfigurations (Ptr<LorawanMac> lorawanMac) const;
+  static Ptr<LoraRegionalPlan> CreateAlohaRegionalPlan (void);
 
   ObjectFactory m_mac;
   Ptr<LoraDeviceAddressGenerator> m_addrGen; //!< Pointer to the address generator to use
   enum DeviceType m_deviceType; //!< The kind of device to install
   enum Regions m_region; //!< The region in which the device will operate
+  mutable std::map<enum Regions, Ptr<const LoraRegionalPlan> > m_regionalPlans; //!< The plans created so far
 };
 
 } // namespace lorawan
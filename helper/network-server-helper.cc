@@ -62,6 +62,12 @@ NetworkServerHelper::SetEndDevices (NodeContainer endDevices)
   m_endDevices = endDevices;
 }
 
+void
+NetworkServerHelper::SetAddressGenerator (Ptr<LoraDeviceAddressGenerator> generator)
+{
+  m_addressGenerator = generator;
+}
+
 ApplicationContainer
 NetworkServerHelper::Install (Ptr<Node> node)
 {
@@ -112,7 +118,11 @@ NetworkServerHelper::InstallPriv (Ptr<Node> node)
                                               app));
     }
 
-  // Add the end devices
+  // Add the end devices, at their device index if the generator is known
+  if (m_addressGenerator)
+    {
+      app->GetNetworkStatus ()->SetAddressGenerator (m_addressGenerator);
+    }
   app->AddNodes (m_endDevices);
 
   // Add components to the NetworkServer
@@ -29,6 +29,7 @@
 #include "ns3/application-container.h"
 #include "ns3/point-to-point-helper.h"
 #include "ns3/network-server.h"
+#include "ns3/lora-device-address-generator.h"
 #include <stdint.h>
 #include <string>
 
@@ -61,6 +62,12 @@ public:
    */
   void SetEndDevices (NodeContainer endDevices);
 
+  /**
+   * Set the generator that allocated the addresses of the end devices, so
+   * that the NS indexes its tables by the device index of the generator.
+   */
+  void SetAddressGenerator (Ptr<LoraDeviceAddressGenerator> generator);
+
   /**
    * Enable (true) or disable (false) the ADR component in the Network
    * Server created by this helper.
@@ -83,6 +90,8 @@ private:
 
   NodeContainer m_endDevices;   //!< Set of endDevices to connect to this NS
 
+  Ptr<LoraDeviceAddressGenerator> m_addressGenerator;   //!< Generator of the ED addresses, if set
+
   PointToPointHelper p2pHelper; //!< Helper to create PointToPoint links
 
   bool m_adrEnabled;
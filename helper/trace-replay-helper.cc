@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/trace-replay-helper.h"
+#include "ns3/string.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("TraceReplayHelper");
+
+TraceReplayHelper::TraceReplayHelper ()
+{
+  m_factory.SetTypeId ("ns3::TraceReplaySender");
+}
+
+TraceReplayHelper::~TraceReplayHelper ()
+{
+}
+
+void
+TraceReplayHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+void
+TraceReplayHelper::SetTraceFile (std::string filename)
+{
+  m_factory.Set ("TraceFile", StringValue (filename));
+}
+
+ApplicationContainer
+TraceReplayHelper::Install (NodeContainer c) const
+{
+  NS_LOG_FUNCTION (this << c.GetN ());
+
+  NS_ASSERT_MSG (c.GetN () > 0, "No nodes to replay the traffic of");
+
+  Ptr<TraceReplaySender> app = m_factory.Create<TraceReplaySender> ();
+  app->SetDevices (c);
+
+  c.Get (0)->AddApplication (app);
+
+  return ApplicationContainer (app);
+}
+
+uint64_t
+TraceReplayHelper::ConvertCsv (std::string csvFile, std::string traceFile)
+{
+  NS_LOG_FUNCTION (csvFile << traceFile);
+
+  std::ifstream csv (csvFile.c_str ());
+  NS_ABORT_MSG_UNLESS (csv.is_open (), "Cannot open " << csvFile);
+  std::ofstream trace (traceFile.c_str (), std::ofstream::out |
+                       std::ofstream::trunc | std::ofstream::binary);
+  NS_ABORT_MSG_UNLESS (trace.is_open (), "Cannot open " << traceFile);
+
+  // The number of records is filled in at the end
+  UplinkTraceHeader header;
+  std::memcpy (header.magic, "LORAUPL1", 8);
+  header.version = 1;
+  header.reserved = 0;
+  header.nRecords = 0;
+  trace.write (reinterpret_cast<const char *> (&header), sizeof (header));
+
+  bool sorted = true;
+  int64_t lastTime = 0;
+  std::string line;
+  while (std::getline (csv, line))
+    {
+      if (line.empty () || !std::isdigit (static_cast<unsigned char> (line[0])))
+        {
+          continue;
+        }
+
+      std::istringstream fields (line);
+      uint32_t device;
+      double seconds;
+      uint32_t size;
+      char comma1, comma2;
+      fields >> device >> comma1 >> seconds >> comma2 >> size;
+      NS_ABORT_MSG_IF (fields.fail () || comma1 != ',' || comma2 != ','
+                       || seconds < 0 || size > 0xffff,
+                       "Invalid line in " << csvFile << ": " << line);
+
+      UplinkTraceRecord record;
+      record.time = std::llround (seconds * 1e9);
+      record.device = device;
+      record.size = size;
+      record.reserved = 0;
+      trace.write (reinterpret_cast<const char *> (&record), sizeof (record));
+
+      sorted = sorted && (header.nRecords == 0 || record.time >= lastTime);
+      lastTime = record.time;
+      header.nRecords++;
+    }
+
+  trace.seekp (0);
+  trace.write (reinterpret_cast<const char *> (&header), sizeof (header));
+  trace.close ();
+  NS_ABORT_MSG_IF (trace.fail (), "Cannot write " << traceFile);
+
+  if (!sorted && header.nRecords > 0)
+    {
+      NS_LOG_DEBUG ("Sorting the records of " << traceFile);
+
+      uint64_t size = sizeof (header) + header.nRecords * sizeof (UplinkTraceRecord);
+      int fd = open (traceFile.c_str (), O_RDWR);
+      NS_ABORT_MSG_IF (fd < 0, "Cannot open " << traceFile);
+      void *map = mmap (0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close (fd);
+      NS_ABORT_MSG_IF (map == MAP_FAILED, "Cannot map " << traceFile);
+
+      // Packets of the same time keep the order of the CSV file
+      UplinkTraceRecord *records = reinterpret_cast<UplinkTraceRecord *>
+        (static_cast<char *> (map) + sizeof (header));
+      std::stable_sort (records, records + header.nRecords,
+                        [] (const UplinkTraceRecord &a, const UplinkTraceRecord &b)
+                        {
+                          return a.time < b.time;
+                        });
+      munmap (map, size);
+    }
+
+  return header.nRecords;
+}
+
+}
+} // namespace ns3
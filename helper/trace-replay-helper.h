@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRACE_REPLAY_HELPER_H
+#define TRACE_REPLAY_HELPER_H
+
+#include "ns3/object-factory.h"
+#include "ns3/attribute.h"
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+#include "ns3/trace-replay-sender.h"
+#include <stdint.h>
+#include <string>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * This class can be used to replay the uplink traffic of a set of nodes from
+ * a trace, with a single TraceReplaySender application, and to create such
+ * traces from CSV files.
+ */
+class TraceReplayHelper
+{
+public:
+  TraceReplayHelper ();
+
+  ~TraceReplayHelper ();
+
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Set the trace to replay.
+   */
+  void SetTraceFile (std::string filename);
+
+  /**
+   * Create a TraceReplaySender for the devices of a set of nodes, and install
+   * it on the first node.
+   *
+   * \param c The nodes of the devices, the i-th one being device i of the
+   * trace.
+   * \returns A container holding the TraceReplaySender.
+   */
+  ApplicationContainer Install (NodeContainer c) const;
+
+  /**
+   * Convert a CSV file into an uplink trace.
+   *
+   * Each line of the CSV file holds the index of a device, the time of a
+   * packet in seconds and its size in bytes, separated by commas. Lines that
+   * don't start with a number, like a header, are skipped. The records are
+   * written as they are read, and sorted by time afterwards, in the mapped
+   * output file, only if they were not already sorted, so that files larger
+   * than memory can be converted.
+   *
+   * \param csvFile The CSV file to read.
+   * \param traceFile The trace file to write.
+   * \return The number of records written.
+   */
+  static uint64_t ConvertCsv (std::string csvFile, std::string traceFile);
+
+private:
+  ObjectFactory m_factory;
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* TRACE_REPLAY_HELPER_H */
@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/traffic-generator-helper.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("TrafficGeneratorHelper");
+
+TrafficGeneratorHelper::TrafficGeneratorHelper ()
+{
+  m_factory.SetTypeId ("ns3::TrafficGenerator");
+
+  m_initialDelay = CreateObject<UniformRandomVariable> ();
+  m_initialDelay->SetAttribute ("Min", DoubleValue (0));
+
+  m_intervalProb = CreateObject<UniformRandomVariable> ();
+  m_intervalProb->SetAttribute ("Min", DoubleValue (0));
+  m_intervalProb->SetAttribute ("Max", DoubleValue (1));
+
+  m_period = Seconds (0);
+  m_pktSize = 10;
+}
+
+TrafficGeneratorHelper::~TrafficGeneratorHelper ()
+{
+}
+
+void
+TrafficGeneratorHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+ApplicationContainer
+TrafficGeneratorHelper::Install (NodeContainer c) const
+{
+  NS_LOG_FUNCTION (this << c.GetN ());
+
+  NS_ASSERT_MSG (c.GetN () > 0, "No nodes to generate traffic for");
+
+  Ptr<TrafficGenerator> app = m_factory.Create<TrafficGenerator> ();
+  app->SetPacketSize (m_pktSize);
+  if (m_pktSizeRV)
+    {
+      app->SetPacketSizeRandomVariable (m_pktSizeRV);
+    }
+  if (m_interArrival)
+    {
+      app->SetInterArrivalRandomVariable (m_interArrival);
+    }
+
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      if (m_interArrival)
+        {
+          app->AddDevice (*i, Seconds (m_interArrival->GetValue ()));
+          continue;
+        }
+
+      Time interval;
+      if (m_period == Seconds (0))
+        {
+          double intervalProb = m_intervalProb->GetValue ();
+
+          // Based on TR 45.820
+          if (intervalProb < 0.4)
+            {
+              interval = Days (1);
+            }
+          else if (0.4 <= intervalProb  && intervalProb < 0.8)
+            {
+              interval = Hours (2);
+            }
+          else if (0.8 <= intervalProb  && intervalProb < 0.95)
+            {
+              interval = Hours (1);
+            }
+          else
+            {
+              interval = Minutes (30);
+            }
+        }
+      else
+        {
+          interval = m_period;
+        }
+
+      app->AddDevice (*i, Seconds (m_initialDelay->GetValue (0, interval.GetSeconds ())),
+                      interval);
+    }
+
+  c.Get (0)->AddApplication (app);
+
+  return ApplicationContainer (app);
+}
+
+void
+TrafficGeneratorHelper::SetPeriod (Time period)
+{
+  m_period = period;
+}
+
+void
+TrafficGeneratorHelper::SetInterArrivalRandomVariable (Ptr<RandomVariableStream> rv)
+{
+  m_interArrival = rv;
+}
+
+void
+TrafficGeneratorHelper::SetPacketSizeRandomVariable (Ptr <RandomVariableStream> rv)
+{
+  m_pktSizeRV = rv;
+}
+
+void
+TrafficGeneratorHelper::SetPacketSize (uint8_t size)
+{
+  m_pktSize = size;
+}
+
+}
+} // namespace ns3
@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRAFFIC_GENERATOR_HELPER_H
+#define TRAFFIC_GENERATOR_HELPER_H
+
+#include "ns3/object-factory.h"
+#include "ns3/attribute.h"
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traffic-generator.h"
+#include <stdint.h>
+#include <string>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * This class can be used to generate the traffic of a set of nodes with a
+ * single TrafficGenerator application, which takes the place of one
+ * PeriodicSender or RandomSender per node.
+ */
+class TrafficGeneratorHelper
+{
+public:
+  TrafficGeneratorHelper ();
+
+  ~TrafficGeneratorHelper ();
+
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Create a TrafficGenerator for the devices of a set of nodes, and install
+   * it on the first node.
+   *
+   * Each device gets an initial delay drawn uniformly in its interval, with
+   * periodic traffic, or from the inter-arrival random variable otherwise.
+   *
+   * \param c The nodes of the devices.
+   * \returns A container holding the TrafficGenerator.
+   */
+  ApplicationContainer Install (NodeContainer c) const;
+
+  /**
+   * Set the period of the devices, with periodic traffic.
+   *
+   * A value of Seconds (0) results in randomly generated periods according to
+   * the model contained in the TR 45.820 document, as in
+   * PeriodicSenderHelper.
+   *
+   * \param period The period to set
+   */
+  void SetPeriod (Time period);
+
+  /**
+   * Draw the time between two packets of a device, in seconds, from a random
+   * variable: for instance an ExponentialRandomVariable, for the traffic of
+   * RandomSender, or a ParetoRandomVariable.
+   */
+  void SetInterArrivalRandomVariable (Ptr<RandomVariableStream> rv);
+
+  void SetPacketSizeRandomVariable (Ptr <RandomVariableStream> rv);
+
+  void SetPacketSize (uint8_t size);
+
+private:
+  ObjectFactory m_factory;
+
+  Ptr<UniformRandomVariable> m_initialDelay;
+
+  Ptr<UniformRandomVariable> m_intervalProb;
+
+  Time m_period; //!< The period of the devices, or 0 for the TR 45.820 model
+
+  Ptr<RandomVariableStream> m_interArrival; //!< The random time between packets, if any
+
+  Ptr<RandomVariableStream> m_pktSizeRV; //!< The random bytes added to the packet size, if any
+
+  uint8_t m_pktSize; //!< The packet size
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* TRAFFIC_GENERATOR_HELPER_H */
@@ -0,0 +1,460 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/virtual-end-device-population.h"
+#include "ns3/class-a-end-device-lorawan-mac.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-event-profiler.h"
+#include "ns3/lora-phy.h"
+#include "ns3/lora-tag.h"
+#include "ns3/periodic-sender.h"
+#include "ns3/building-penetration-loss.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <algorithm>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("VirtualEndDevicePopulation");
+
+NS_OBJECT_ENSURE_REGISTERED (VirtualEndDevicePopulation);
+
+TypeId
+VirtualEndDevicePopulation::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::VirtualEndDevicePopulation")
+    .SetParent<Object> ()
+    .AddConstructor<VirtualEndDevicePopulation> ()
+    .SetGroupName ("lorawan")
+    .AddAttribute ("Interval", "The interval between two packets of a device",
+                   TimeValue (Seconds (600)),
+                   MakeTimeAccessor (&VirtualEndDevicePopulation::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("PacketSize", "The application payload of the packets",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&VirtualEndDevicePopulation::m_packetSize),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("NumberOfTransmissions",
+                   "The number of transmissions of each packet (NbTrans)",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&VirtualEndDevicePopulation::m_nbTrans),
+                   MakeUintegerChecker<uint8_t> (1, 15))
+    .AddTraceSource ("SentNewPacket",
+                     "Trace source indicating a device generated a new packet",
+                     MakeTraceSourceAccessor
+                       (&VirtualEndDevicePopulation::m_sentNewPacket),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("StartSending",
+                     "Trace source indicating a device started a "
+                     "transmission, with the index of the device",
+                     MakeTraceSourceAccessor
+                       (&VirtualEndDevicePopulation::m_startSending),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("Promoted",
+                     "Trace source indicating a device was promoted, with "
+                     "its index and its new node",
+                     MakeTraceSourceAccessor
+                       (&VirtualEndDevicePopulation::m_promotedTrace),
+                     "ns3::VirtualEndDevicePopulation::PromotedTracedCallback");
+  return tid;
+}
+
+VirtualEndDevicePopulation::VirtualEndDevicePopulation () :
+  m_interval (Seconds (600)),
+  m_packetSize (10),
+  m_nbTrans (1),
+  m_running (false)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_mobility = CreateObject<ConstantPositionMobilityModel> ();
+  m_uniformRV = CreateObject<UniformRandomVariable> ();
+}
+
+VirtualEndDevicePopulation::~VirtualEndDevicePopulation ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+VirtualEndDevicePopulation::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Simulator::Cancel (m_event);
+  m_channel = 0;
+  m_regionalPlan = 0;
+  m_mobility = 0;
+  m_buildingInfo = 0;
+  m_uniformRV = 0;
+
+  Object::DoDispose ();
+}
+
+void
+VirtualEndDevicePopulation::SetChannel (Ptr<LoraChannel> channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  m_channel = channel;
+
+  // Building losses need building info on the transmitter, kept up to date
+  // with the position of each device
+  for (Ptr<PropagationLossModel> loss = channel->GetPropagationLossModel ();
+       loss; loss = loss->GetNext ())
+    {
+      Ptr<BuildingPenetrationLoss> buildingLoss =
+        DynamicCast<BuildingPenetrationLoss> (loss);
+      if (!buildingLoss)
+        {
+          continue;
+        }
+      NS_ABORT_MSG_UNLESS (buildingLoss->UsesSubstreams (),
+                           "Virtual end devices need a BuildingPenetrationLoss "
+                           "drawing from substreams (LoraDeviceSubstreams)");
+      if (!m_buildingInfo)
+        {
+          m_buildingInfo = CreateObject<MobilityBuildingInfo> ();
+          m_mobility->AggregateObject (m_buildingInfo);
+        }
+    }
+}
+
+void
+VirtualEndDevicePopulation::SetRegionalPlan (Ptr<const LoraRegionalPlan> plan)
+{
+  m_regionalPlan = plan;
+}
+
+uint32_t
+VirtualEndDevicePopulation::Add (Vector position, uint8_t dataRate,
+                                 uint8_t txPowerDbm,
+                                 LoraDeviceAddress address)
+{
+  NS_LOG_FUNCTION (this << position << unsigned (dataRate) <<
+                   unsigned (txPowerDbm) << address);
+
+  NS_ABORT_MSG_IF (m_running, "Devices must be added before Start");
+
+  m_x.push_back (position.x);
+  m_y.push_back (position.y);
+  m_z.push_back (position.z);
+  m_dataRate.push_back (dataRate);
+  m_txPowerDbm.push_back (txPowerDbm);
+  m_address.push_back (address.Get ());
+  m_fCnt.push_back (0);
+  m_transmissionsLeft.push_back (0);
+  m_nextPacket.push_back (Time::Max ());
+  m_nextAllowedTx.push_back (Seconds (0));
+  m_promoted.push_back (false);
+
+  return m_x.size () - 1;
+}
+
+uint32_t
+VirtualEndDevicePopulation::GetN (void) const
+{
+  return m_x.size ();
+}
+
+void
+VirtualEndDevicePopulation::Start (Time start)
+{
+  NS_LOG_FUNCTION (this << start);
+
+  NS_ASSERT_MSG (m_channel != 0 && m_regionalPlan != 0,
+                 "The channel and the regional plan must be set");
+
+  m_running = true;
+  for (uint32_t i = 0; i < GetN (); i++)
+    {
+      if (!m_promoted[i])
+        {
+          m_nextPacket[i] = start + Seconds (m_uniformRV->GetValue
+                                               (0, m_interval.GetSeconds ()));
+          m_queue.push (Entry (m_nextPacket[i], i));
+        }
+    }
+  ScheduleNext ();
+}
+
+void
+VirtualEndDevicePopulation::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_running = false;
+  Simulator::Cancel (m_event);
+  m_queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > ();
+}
+
+void
+VirtualEndDevicePopulation::ScheduleNext (void)
+{
+  if (m_queue.empty ())
+    {
+      return;
+    }
+
+  Time next = m_queue.top ().first;
+  if (m_event.IsRunning () && Time (m_event.GetTs ()) <= next)
+    {
+      return;
+    }
+
+  Simulator::Cancel (m_event);
+  m_event = LoraEventProfiler::Schedule (LoraEventProfiler::POPULATION_SEND,
+                                         std::max (next - Simulator::Now (),
+                                                   Seconds (0)),
+                                         &VirtualEndDevicePopulation::Process,
+                                         this);
+}
+
+void
+VirtualEndDevicePopulation::Process (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time now = Simulator::Now ();
+  while (!m_queue.empty () && m_queue.top ().first <= now)
+    {
+      uint32_t index = m_queue.top ().second;
+      m_queue.pop ();
+      if (!m_promoted[index])
+        {
+          ProcessDevice (index);
+        }
+    }
+  ScheduleNext ();
+}
+
+void
+VirtualEndDevicePopulation::ProcessDevice (uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+
+  Time now = Simulator::Now ();
+
+  // As in the MAC, a new packet replaces the repetitions of the previous one
+  if (m_nextPacket[index] <= now)
+    {
+      if (m_transmissionsLeft[index] > 0)
+        {
+          NS_LOG_DEBUG ("Device " << index << " drops " <<
+                        unsigned (m_transmissionsLeft[index]) <<
+                        " transmissions of FCnt " << m_fCnt[index]);
+        }
+      m_fCnt[index]++;
+      m_transmissionsLeft[index] = m_nbTrans;
+      m_nextPacket[index] += m_interval;
+    }
+
+  if (m_transmissionsLeft[index] > 0 && m_nextAllowedTx[index] <= now)
+    {
+      Transmit (index);
+    }
+
+  Time next = m_nextPacket[index];
+  if (m_transmissionsLeft[index] > 0)
+    {
+      next = std::min (next, m_nextAllowedTx[index]);
+    }
+  m_queue.push (Entry (next, index));
+}
+
+void
+VirtualEndDevicePopulation::Transmit (uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+
+  uint8_t dataRate = m_dataRate[index];
+
+  // Build the packet as EndDeviceLorawanMac does
+  Ptr<Packet> packet = Create<Packet> (m_packetSize);
+
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  frameHdr.SetFPort (1);
+  frameHdr.SetAddress (LoraDeviceAddress (m_address[index]));
+  frameHdr.SetAdr (false);
+  frameHdr.SetAdrAckReq (0);
+  frameHdr.SetFCnt (m_fCnt[index]);
+  packet->AddHeader (frameHdr);
+
+  if (packet->GetSize () > m_regionalPlan->GetMaxAppPayloadForDataRate (dataRate))
+    {
+      NS_LOG_WARN ("Packet too large for DR" << unsigned (dataRate) <<
+                   ", device " << index << " will not transmit");
+      m_transmissionsLeft[index] = 0;
+      return;
+    }
+
+  LorawanMacHeader macHdr;
+  macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+  macHdr.SetMajor (1);
+  packet->AddHeader (macHdr);
+
+  LoraTxParameters params;
+  params.sf = m_regionalPlan->GetSfForDataRate (dataRate);
+  params.bandwidthHz = m_regionalPlan->GetBandwidthForDataRate (dataRate);
+  params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym (params) > MilliSeconds (16) ? true : false;
+
+  LoraTag tag;
+  tag.SetSpreadingFactor (params.sf);
+  packet->AddPacketTag (tag);
+
+  // Pick a random channel among the ones that allow the data rate
+  const std::vector<Ptr<LogicalLoraChannel> > &channels = m_regionalPlan->GetChannels ();
+  std::vector<uint32_t> candidates;
+  for (uint32_t c = 0; c < channels.size (); c++)
+    {
+      if (channels[c]->GetMinimumDataRate () <= dataRate
+          && channels[c]->GetMaximumDataRate () >= dataRate)
+        {
+          candidates.push_back (c);
+        }
+    }
+  NS_ASSERT_MSG (!candidates.empty (), "No channel allows DR" << unsigned (dataRate));
+  double frequency = channels[candidates[m_uniformRV->GetInteger
+                                           (0, candidates.size () - 1)]]->GetFrequency ();
+
+  Time duration = LoraPhy::GetOnAirTime (packet, params);
+
+  if (m_transmissionsLeft[index] == m_nbTrans)
+    {
+      m_sentNewPacket (packet, params.sf);
+    }
+  m_startSending (packet, index);
+
+  m_mobility->SetPosition (Vector (m_x[index], m_y[index], m_z[index]));
+  if (m_buildingInfo)
+    {
+      m_buildingInfo->MakeConsistent (m_mobility);
+    }
+  m_channel->Send (m_mobility, packet, m_txPowerDbm[index], params, duration,
+                   frequency);
+
+  m_transmissionsLeft[index]--;
+
+  // Wait for the duty cycle of the SubBand and, as the MAC does, for the end
+  // of the receive windows, with the random ACK timeout before a repetition
+  double dutyCycle = m_regionalPlan->GetSubBands ()
+    [m_regionalPlan->GetSubBandIndex (frequency)]->GetDutyCycle ();
+  double timeOnAir = duration.GetSeconds ();
+  Time now = Simulator::Now ();
+  m_nextAllowedTx[index] = std::max (now + Seconds (timeOnAir / dutyCycle - timeOnAir),
+                                     now + duration + Seconds (2));
+  if (m_transmissionsLeft[index] > 0)
+    {
+      m_nextAllowedTx[index] = std::max (m_nextAllowedTx[index],
+                                         now + duration + Seconds (2) +
+                                         Seconds (m_uniformRV->GetValue (1, 3)));
+    }
+
+  NS_LOG_DEBUG ("Device " << index << " sent FCnt " << m_fCnt[index] <<
+                " on " << frequency << " MHz at SF" << unsigned (params.sf));
+}
+
+Ptr<Node>
+VirtualEndDevicePopulation::Promote (uint32_t index, const LoraHelper &helper,
+                                     const LoraPhyHelper &phyHelper,
+                                     LorawanMacHelper macHelper,
+                                     Ptr<NetworkServer> networkServer)
+{
+  NS_LOG_FUNCTION (this << index);
+
+  NS_ASSERT (index < GetN ());
+  NS_ABORT_MSG_IF (m_promoted[index], "Device " << index << " was already promoted");
+
+  m_promoted[index] = true;
+
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (GetPosition (index));
+  node->AggregateObject (mobility);
+
+  // The address is the one of the virtual device
+  macHelper.SetAddressGenerator (0);
+  helper.Install (phyHelper, macHelper, node);
+
+  Ptr<ClassAEndDeviceLorawanMac> mac = node->GetDevice (0)->GetObject<LoraNetDevice> ()
+    ->GetMac ()->GetObject<ClassAEndDeviceLorawanMac> ();
+  NS_ASSERT_MSG (mac != 0, "Promoted devices need a class A end device MAC");
+  mac->SetDeviceAddress (GetDeviceAddress (index));
+  mac->SetDataRate (m_dataRate[index]);
+  mac->SetTransmissionPower (m_txPowerDbm[index]);
+  mac->SetFCnt (m_fCnt[index]);
+
+  // Continue the traffic of the virtual device
+  if (m_running)
+    {
+      Ptr<PeriodicSender> app = CreateObject<PeriodicSender> ();
+      app->SetInterval (m_interval);
+      app->SetInitialDelay (m_nextPacket[index] - Simulator::Now ());
+      app->SetPacketSize (m_packetSize);
+      node->AddApplication (app);
+    }
+
+  if (networkServer != 0)
+    {
+      networkServer->AddNode (node);
+    }
+
+  m_promotedTrace (index, node);
+
+  return node;
+}
+
+bool
+VirtualEndDevicePopulation::IsPromoted (uint32_t index) const
+{
+  return m_promoted.at (index);
+}
+
+Vector
+VirtualEndDevicePopulation::GetPosition (uint32_t index) const
+{
+  return Vector (m_x.at (index), m_y.at (index), m_z.at (index));
+}
+
+LoraDeviceAddress
+VirtualEndDevicePopulation::GetDeviceAddress (uint32_t index) const
+{
+  return LoraDeviceAddress (m_address.at (index));
+}
+
+uint16_t
+VirtualEndDevicePopulation::GetFCnt (uint32_t index) const
+{
+  return m_fCnt.at (index);
+}
+
+int64_t
+VirtualEndDevicePopulation::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+
+  m_uniformRV->SetStream (stream);
+  return 1;
+}
+
+}
+}
@@ -0,0 +1,268 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef VIRTUAL_END_DEVICE_POPULATION_H
+#define VIRTUAL_END_DEVICE_POPULATION_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/event-id.h"
+#include "ns3/node.h"
+#include "ns3/traced-callback.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/mobility-building-info.h"
+#include "ns3/lora-channel.h"
+#include "ns3/lora-device-address.h"
+#include "ns3/lora-regional-plan.h"
+#include "ns3/lora-helper.h"
+#include "ns3/lora-phy-helper.h"
+#include "ns3/lorawan-mac-helper.h"
+#include "ns3/network-server.h"
+
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * A group of homogeneous class A end devices that send unconfirmed packets
+ * periodically, simulated without creating any ns-3 object per device.
+ *
+ * Each device is a record of a few bytes, kept in one vector per field:
+ * position, data rate, transmission power, address, frame counter, number of
+ * transmissions left for the current packet and the times of its next packet
+ * and of its next allowed transmission. The transmissions of all devices are
+ * kept in a single heap, with one Simulator event pending at any time, and
+ * are sent directly on a LoraChannel, so that gateways receive them as if
+ * they came from full devices.
+ *
+ * Virtual devices can't receive: the NetworkServer drops their packets
+ * until they are promoted with Promote, which replaces the record with a
+ * Node carrying a full device stack, a PeriodicSender continuing the traffic
+ * of the record, and registers it with the NetworkServer.
+ *
+ * Each device keeps a single duty cycle clock, which is exact as long as the
+ * channels of the regional plan are in the same SubBand, as the default
+ * channels of the EU region are.
+ */
+class VirtualEndDevicePopulation : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  /**
+   * TracedCallback signature for the promotion of a device.
+   *
+   * \param index The index of the device.
+   * \param node The node of the full device stack.
+   */
+  typedef void (* PromotedTracedCallback)(uint32_t index, Ptr<Node> node);
+
+  VirtualEndDevicePopulation ();
+  virtual ~VirtualEndDevicePopulation ();
+
+  /**
+   * Set the channel the devices transmit on.
+   *
+   * If the propagation loss chain of the channel contains a
+   * BuildingPenetrationLoss, the model must draw from substreams, since all
+   * devices share a single mobility model: the model would otherwise keep
+   * the same p value and wall loss for all of them. The simulation is
+   * aborted if it doesn't.
+   */
+  void SetChannel (Ptr<LoraChannel> channel);
+
+  /**
+   * Set the regional plan the devices follow, as given by
+   * LorawanMacHelper::GetRegionalPlan.
+   */
+  void SetRegionalPlan (Ptr<const LoraRegionalPlan> plan);
+
+  /**
+   * Add a device to the population.
+   *
+   * \param position The position of the device.
+   * \param dataRate The data rate the device transmits with.
+   * \param txPowerDbm The transmission power of the device, in dBm.
+   * \param address The address of the device.
+   * \return The index of the device in the population.
+   */
+  uint32_t Add (Vector position, uint8_t dataRate, uint8_t txPowerDbm,
+                LoraDeviceAddress address);
+
+  /**
+   * Get the number of devices in the population, promoted ones included.
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * Start the traffic of the devices, each sending its first packet at a
+   * random time in [start, start + Interval).
+   */
+  void Start (Time start);
+
+  /**
+   * Stop the traffic of the devices that are not promoted.
+   */
+  void Stop (void);
+
+  /**
+   * Replace a virtual device with a full device stack.
+   *
+   * The device gets a new Node with a ConstantPositionMobilityModel at its
+   * position, a LoraNetDevice created by helper, with its address, data
+   * rate, transmission power and frame counter, and a PeriodicSender whose
+   * next packet is sent when the virtual device would have sent it. The
+   * pending repetitions of its current packet, if any, are dropped.
+   *
+   * \param index The index of the device.
+   * \param helper The helper that creates the LoraNetDevice, and connects its
+   * packet tracker if enabled.
+   * \param phyHelper A helper creating end device PHYs on the same channel.
+   * \param macHelper A helper creating class A end device MACs. Its address
+   * generator, if any, is not used.
+   * \param networkServer If not 0, the server the device is added to.
+   * \return The node of the device.
+   */
+  Ptr<Node> Promote (uint32_t index, const LoraHelper &helper,
+                     const LoraPhyHelper &phyHelper,
+                     LorawanMacHelper macHelper,
+                     Ptr<NetworkServer> networkServer = 0);
+
+  /**
+   * Return whether a device was promoted.
+   */
+  bool IsPromoted (uint32_t index) const;
+
+  /**
+   * Get the position of a device.
+   */
+  Vector GetPosition (uint32_t index) const;
+
+  /**
+   * Get the address of a device.
+   */
+  LoraDeviceAddress GetDeviceAddress (uint32_t index) const;
+
+  /**
+   * Get the frame counter of the last packet of a device.
+   */
+  uint16_t GetFCnt (uint32_t index) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this population.
+   *
+   * \param stream The first stream index to use.
+   * \return The number of stream indices assigned.
+   */
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * Handle the earliest entries of the heap and schedule the next event.
+   */
+  void Process (void);
+
+  /**
+   * Start a new packet, or a repetition of the current one, of a device, and
+   * put the device back in the heap.
+   */
+  void ProcessDevice (uint32_t index);
+
+  /**
+   * Send the current packet of a device on the channel.
+   */
+  void Transmit (uint32_t index);
+
+  /**
+   * Make sure the event of the population is scheduled at the time of the
+   * earliest entry of the heap.
+   */
+  void ScheduleNext (void);
+
+  typedef std::pair<Time, uint32_t> Entry;   //!< A device and its next event
+
+  Ptr<LoraChannel> m_channel;   //!< The channel the devices transmit on
+  Ptr<const LoraRegionalPlan> m_regionalPlan;   //!< The regional plan
+
+  Time m_interval;   //!< The interval between two packets of a device
+  uint8_t m_packetSize;   //!< The application payload of the packets
+  uint8_t m_nbTrans;   //!< The transmissions of each packet
+
+  std::vector<float> m_x;   //!< The x coordinate of each device
+  std::vector<float> m_y;   //!< The y coordinate of each device
+  std::vector<float> m_z;   //!< The z coordinate of each device
+  std::vector<uint8_t> m_dataRate;   //!< The data rate of each device
+  std::vector<uint8_t> m_txPowerDbm;   //!< The transmission power of each device
+  std::vector<uint32_t> m_address;   //!< The address of each device
+  std::vector<uint16_t> m_fCnt;   //!< The FCnt of the last packet of each device
+  std::vector<uint8_t> m_transmissionsLeft;   //!< The transmissions left for the current packet
+  std::vector<Time> m_nextPacket;   //!< When each device generates its next packet
+  std::vector<Time> m_nextAllowedTx;   //!< The duty cycle and receive window clock of each device
+  std::vector<bool> m_promoted;   //!< Whether each device was promoted
+
+  /**
+   * The next event of each device, earliest first. Entries of promoted
+   * devices are discarded when they are reached.
+   */
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > m_queue;
+
+  EventId m_event;   //!< The pending event of the population
+  bool m_running;   //!< Whether the traffic was started and not stopped
+
+  /**
+   * The transmitter handed to the channel, moved to each sending device.
+   */
+  Ptr<ConstantPositionMobilityModel> m_mobility;
+
+  /**
+   * The building info aggregated to m_mobility if the channel accounts for
+   * buildings, or 0.
+   */
+  Ptr<MobilityBuildingInfo> m_buildingInfo;
+
+  Ptr<UniformRandomVariable> m_uniformRV;   //!< Phases, channels and retransmission delays
+
+  /**
+   * Trace source fired when a device sends a new packet, as the
+   * SentNewPacket trace source of LorawanMac.
+   */
+  TracedCallback<Ptr<Packet const>, uint8_t> m_sentNewPacket;
+
+  /**
+   * Trace source fired on each transmission, as the StartSending trace source
+   * of LoraPhy, with the index of the device.
+   */
+  TracedCallback<Ptr<const Packet>, uint32_t> m_startSending;
+
+  /**
+   * Trace source fired when a device is promoted, with its index and node.
+   */
+  TracedCallback<uint32_t, Ptr<Node> > m_promotedTrace;
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* VIRTUAL_END_DEVICE_POPULATION_H */
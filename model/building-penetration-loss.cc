@@ -29,6 +29,12 @@ NS_LOG_COMPONENT_DEFINE ("BuildingPenetrationLoss");
 
 NS_OBJECT_ENSURE_REGISTERED (BuildingPenetrationLoss);
 
+// The substreams of a device position and of a link, the n-th transmission
+// on a link drawing from substream LINK_SUBSTREAM + n
+static const uint32_t P_VALUE_SUBSTREAM = 0;
+static const uint32_t WALL_LOSS_SUBSTREAM = 1;
+static const uint32_t LINK_SUBSTREAM = 2;
+
 TypeId
 BuildingPenetrationLoss::GetTypeId (void)
 {
@@ -41,11 +47,16 @@ BuildingPenetrationLoss::GetTypeId (void)
 }
 
 BuildingPenetrationLoss::BuildingPenetrationLoss ()
+  : m_substreams (LoraSubstreamRng::IsEnabled ()),
+  m_key (LoraSubstreamRng::GetKey (LoraSubstreamRng::BUILDING))
 {
   NS_LOG_FUNCTION_NOARGS ();
 
   // Initialize the random variable
-  m_uniformRV = CreateObject<UniformRandomVariable> ();
+  if (!m_substreams)
+    {
+      m_uniformRV = CreateObject<UniformRandomVariable> ();
+    }
 }
 
 BuildingPenetrationLoss::~BuildingPenetrationLoss ()
@@ -53,6 +64,12 @@ BuildingPenetrationLoss::~BuildingPenetrationLoss ()
   NS_LOG_FUNCTION_NOARGS ();
 }
 
+bool
+BuildingPenetrationLoss::UsesSubstreams (void) const
+{
+  return m_substreams;
+}
+
 double
 BuildingPenetrationLoss::DoCalcRxPower (double txPowerDbm,
                                         Ptr<MobilityModel> a,
@@ -69,14 +86,26 @@ BuildingPenetrationLoss::DoCalcRxPower (double txPowerDbm,
   double tor3 = 0;
   double gfh = 0;
 
+  // The substream of this transmission on the link, if any
+  uint64_t linkIndex = 0;
+  uint32_t transmission = 0;
+  if (m_substreams)
+    {
+      linkIndex = LoraSubstreamRng::Mix (LoraSubstreamRng::GetPositionIndex (a->GetPosition ()))
+        ^ LoraSubstreamRng::GetPositionIndex (b->GetPosition ());
+      transmission = m_linkTransmissions[linkIndex]++;
+    }
+  LoraSubstreamRng linkRng (m_key, linkIndex, LINK_SUBSTREAM + transmission);
+  LoraSubstreamRng *rng = m_substreams ? &linkRng : 0;
+
   // Go through various cases in which a and b are indoors or outdoors
   if ((b1->IsIndoor () && !a1->IsIndoor ()))
     {
       NS_LOG_INFO ("Tx is outdoors and Rx is indoors");
 
-      externalWallLoss = GetWallLoss (b);     // External wall loss due to b
-      tor1 = GetTor1 (b);     // Internal wall loss due to b
-      tor3 = 0.6 * m_uniformRV->GetValue (0, 15);
+      externalWallLoss = GetWallLoss (b, rng);     // External wall loss due to b
+      tor1 = GetTor1 (b, rng);     // Internal wall loss due to b
+      tor3 = 0.6 * GetUniform (0, 15, rng);
       gfh = 0;
 
     }
@@ -85,9 +114,9 @@ BuildingPenetrationLoss::DoCalcRxPower (double txPowerDbm,
       NS_LOG_INFO ("Rx is outdoors and Tx is indoors");
 
       // These are the components of the loss due to building penetration
-      externalWallLoss = GetWallLoss (a);
-      tor1 = GetTor1 (a);
-      tor3 = 0.6 * m_uniformRV->GetValue (0, 15);
+      externalWallLoss = GetWallLoss (a, rng);
+      tor1 = GetTor1 (a, rng);
+      tor3 = 0.6 * GetUniform (0, 15, rng);
       gfh = 0;
 
     }
@@ -102,16 +131,16 @@ BuildingPenetrationLoss::DoCalcRxPower (double txPowerDbm,
         {
           NS_LOG_INFO ("Devices are in the same building");
           // Only internal wall loss
-          tor1 = GetTor1 (b);
-          tor3 = 0.6 * m_uniformRV->GetValue (0, 15);
+          tor1 = GetTor1 (b, rng);
+          tor3 = 0.6 * GetUniform (0, 15, rng);
         }
       // They are in different buildings
       else
         {
           // These are the components of the loss due to building penetration
-          externalWallLoss = GetWallLoss (b) + GetWallLoss (a);
-          tor1 = GetTor1 (b) + GetTor1 (a);
-          tor3 = 0.6 * m_uniformRV->GetValue (0, 15);
+          externalWallLoss = GetWallLoss (b, rng) + GetWallLoss (a, rng);
+          tor1 = GetTor1 (b, rng) + GetTor1 (a, rng);
+          tor3 = 0.6 * GetUniform (0, 15, rng);
           gfh = 0;
         }
     }
@@ -133,17 +162,25 @@ BuildingPenetrationLoss::DoCalcRxPower (double txPowerDbm,
 int64_t
 BuildingPenetrationLoss::DoAssignStreams (int64_t stream)
 {
+  if (m_substreams)
+    {
+      return 0;
+    }
   m_uniformRV->SetStream (stream);
   return 1;
 }
 
-int
-BuildingPenetrationLoss::GetPValue (void) const
+double
+BuildingPenetrationLoss::GetUniform (double min, double max,
+                                     LoraSubstreamRng *linkRng) const
 {
-  NS_LOG_FUNCTION_NOARGS ();
+  return linkRng ? linkRng->GetValue (min, max) : m_uniformRV->GetValue (min, max);
+}
 
-  // We need to decide on the p value to return
-  double random = m_uniformRV->GetValue (0.0, 1.0);
+int
+BuildingPenetrationLoss::GetPValue (double random) const
+{
+  NS_LOG_FUNCTION (random);
 
   // Distribution is specified in TR 45.820, page 482, first scenario
   if (random < 0.2833)
@@ -165,12 +202,9 @@ BuildingPenetrationLoss::GetPValue (void) const
 }
 
 int
-BuildingPenetrationLoss::GetWallLossValue (void) const
+BuildingPenetrationLoss::GetWallLossValue (double random) const
 {
-  NS_LOG_FUNCTION_NOARGS ();
-
-  // We need to decide on the random value to return
-  double random = m_uniformRV->GetValue (0.0, 1.0);
+  NS_LOG_FUNCTION (random);
 
   // Distribution is specified in TR 45.820, page 482, first scenario
   if (random < 0.25)
@@ -188,30 +222,43 @@ BuildingPenetrationLoss::GetWallLossValue (void) const
 }
 
 double
-BuildingPenetrationLoss::GetWallLoss (Ptr<MobilityModel> b) const
+BuildingPenetrationLoss::GetWallLoss (Ptr<MobilityModel> b, LoraSubstreamRng *linkRng) const
 {
   NS_LOG_FUNCTION (this << b);
 
-  std::map<Ptr<MobilityModel>, int>::const_iterator it;
-
-  // Check whether the b device already has a wall loss value
-  it = m_wallLossMap.find (b);
-  if (it == m_wallLossMap.end ())
+  int wallLossValue;
+  if (linkRng)
     {
-      // Create a random value and insert it on the map
-      m_wallLossMap[b] = GetWallLossValue ();
-      NS_LOG_DEBUG ("Inserted a new wall loss value: " <<
-                    m_wallLossMap.find (b)->second);
+      // The value of the device comes from the substream of its position
+      LoraSubstreamRng deviceRng (m_key,
+                                  LoraSubstreamRng::GetPositionIndex (b->GetPosition ()),
+                                  WALL_LOSS_SUBSTREAM);
+      wallLossValue = GetWallLossValue (deviceRng.GetValue ());
     }
+  else
+    {
+      std::map<Ptr<MobilityModel>, int>::const_iterator it;
 
-  switch (m_wallLossMap.find (b)->second)
+      // Check whether the b device already has a wall loss value
+      it = m_wallLossMap.find (b);
+      if (it == m_wallLossMap.end ())
+        {
+          // Create a random value and insert it on the map
+          m_wallLossMap[b] = GetWallLossValue (m_uniformRV->GetValue (0.0, 1.0));
+          NS_LOG_DEBUG ("Inserted a new wall loss value: " <<
+                        m_wallLossMap.find (b)->second);
+        }
+      wallLossValue = m_wallLossMap.find (b)->second;
+    }
+
+  switch (wallLossValue)
     {
     case 0:
-      return m_uniformRV->GetValue (4, 11);
+      return GetUniform (4, 11, linkRng);
     case 1:
-      return m_uniformRV->GetValue (11, 19);
+      return GetUniform (11, 19, linkRng);
     case 2:
-      return m_uniformRV->GetValue (19, 23);
+      return GetUniform (19, 23, linkRng);
     }
 
   // Case in which something goes wrong
@@ -219,10 +266,19 @@ BuildingPenetrationLoss::GetWallLoss (Ptr<MobilityModel> b) const
 }
 
 double
-BuildingPenetrationLoss::GetTor1 (Ptr<MobilityModel> b) const
+BuildingPenetrationLoss::GetTor1 (Ptr<MobilityModel> b, LoraSubstreamRng *linkRng) const
 {
   NS_LOG_FUNCTION (this << b);
 
+  if (linkRng)
+    {
+      // The p value of the device comes from the substream of its position
+      LoraSubstreamRng deviceRng (m_key,
+                                  LoraSubstreamRng::GetPositionIndex (b->GetPosition ()),
+                                  P_VALUE_SUBSTREAM);
+      return linkRng->GetValue (4, 10) * GetPValue (deviceRng.GetValue ());
+    }
+
   std::map<Ptr<MobilityModel>, int>::const_iterator it;
 
   // Check whether the b device already has a p value
@@ -230,7 +286,7 @@ BuildingPenetrationLoss::GetTor1 (Ptr<MobilityModel> b) const
   if (it == m_pMap.end ())
     {
       // Create a random p value and insert it on the map
-      m_pMap[b] = GetPValue ();
+      m_pMap[b] = GetPValue (m_uniformRV->GetValue (0.0, 1.0));
       NS_LOG_DEBUG ("Inserted a new p value: " << m_pMap.find (b)->second);
     }
   return m_uniformRV->GetValue (4, 10) * m_pMap.find (b)->second;
@@ -23,6 +23,7 @@
 #include "ns3/mobility-model.h"
 #include "ns3/vector.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/lora-substream-rng.h"
 
 namespace ns3 {
 class MobilityModel;
@@ -31,6 +32,15 @@ namespace lorawan {
 
 /**
  * A class implementing the TR 45.820 model for building losses
+ *
+ * If the LoraDeviceSubstreams global value is true when the model is
+ * created, its random values come from LoraSubstreamRng substreams instead of
+ * a UniformRandomVariable: the values that are fixed for a device, its p
+ * value and wall loss class, from the substream of its position, and the
+ * values drawn anew for each transmission from a substream of the link,
+ * selected by the number of transmissions evaluated on the link before. The
+ * loss of a link then doesn't depend on the links evaluated before it, while
+ * successive transmissions on the same link still see different losses.
  */
 class BuildingPenetrationLoss : public PropagationLossModel
 {
@@ -41,6 +51,13 @@ public:
 
   ~BuildingPenetrationLoss ();
 
+  /**
+   * Return whether the model draws from substreams, and thus keeps no state
+   * for the mobility models it is given, only a count of transmissions per
+   * pair of positions.
+   */
+  bool UsesSubstreams (void) const;
+
 private:
   /**
    * Perform the computation of the received power according to the current
@@ -55,34 +72,53 @@ private:
   /**
    * Generate a random p value.
    * The distribution of the returned value is as specified in TR 45.820.
+   * \param random A value uniform in [0, 1).
    * \returns A value in the 0-3 range.
    */
-  int GetPValue (void) const;
+  int GetPValue (double random) const;
 
   /**
    * Get a value to compute the wall loss.
    * The distribution of the returned value is as specified in TR 45.820.
+   * \param random A value uniform in [0, 1).
    * \returns A value in the 0-2 range.
    */
-  int GetWallLossValue (void) const;
+  int GetWallLossValue (double random) const;
 
   /**
    * Compute the wall loss associated to this mobility model
    * \param b The mobility model associated to the node whose wall loss we need
    * to compute.
+   * \param linkRng The substream of the link, or 0.
    * \returns The power loss due to external walls.
    */
-  double GetWallLoss (Ptr<MobilityModel> b) const;
+  double GetWallLoss (Ptr<MobilityModel> b, LoraSubstreamRng *linkRng) const;
 
   /**
    * Get the Tor1 value used in the TR 45.820 standard to account for internal
    * wall loss.
    * \param b The mobility model of the node we want to compute the value for.
+   * \param linkRng The substream of the link, or 0.
    * \returns The tor1 value.
    */
-  double GetTor1 (Ptr<MobilityModel> b) const;
+  double GetTor1 (Ptr<MobilityModel> b, LoraSubstreamRng *linkRng) const;
 
-  Ptr<UniformRandomVariable> m_uniformRV;     //!< An uniform RV
+  /**
+   * Draw a uniform value from the substream of the link, if any, or from the
+   * random variable of the model.
+   */
+  double GetUniform (double min, double max, LoraSubstreamRng *linkRng) const;
+
+  Ptr<UniformRandomVariable> m_uniformRV;     //!< An uniform RV, without substreams
+
+  bool m_substreams;   //!< Whether to draw from substreams
+  uint64_t m_key;   //!< The key of the substreams
+
+  /**
+   * The number of transmissions evaluated on each link, by link index, with
+   * substreams.
+   */
+  mutable std::map<uint64_t, uint32_t> m_linkTransmissions;
 
   /**
    * A map linking each mobility model to a p value
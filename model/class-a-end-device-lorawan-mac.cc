@@ -25,7 +25,9 @@
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/end-device-lorawan-mac.h"
 #include "ns3/end-device-lora-phy.h"
+#include "ns3/lora-event-profiler.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include <algorithm>
 
 namespace ns3 {
@@ -269,13 +271,17 @@ ClassAEndDeviceLorawanMac::TxFinished (Ptr<const Packet> packet)
   NS_LOG_FUNCTION_NOARGS ();
 
   // Schedule the opening of the first receive window
-  Simulator::Schedule (m_receiveDelay1,
-                       &ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow, this);
+  LoraEventProfiler::Schedule (LoraEventProfiler::MAC_OPEN_RECEIVE_WINDOW,
+                               m_receiveDelay1,
+                               &ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow,
+                               this);
 
   // Schedule the opening of the second receive window
-  m_secondReceiveWindow = Simulator::Schedule (m_receiveDelay2,
-                                               &ClassAEndDeviceLorawanMac::OpenSecondReceiveWindow,
-                                               this);
+  m_secondReceiveWindow =
+    LoraEventProfiler::Schedule (LoraEventProfiler::MAC_OPEN_RECEIVE_WINDOW,
+                                 m_receiveDelay2,
+                                 &ClassAEndDeviceLorawanMac::OpenSecondReceiveWindow,
+                                 this);
   // // Schedule the opening of the first receive window
   // Simulator::Schedule (m_receiveDelay1,
   //                      &ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow, this);
@@ -303,8 +309,10 @@ ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow (void)
   // Schedule return to sleep after "at least the time required by the end
   // device's radio transceiver to effectively detect a downlink preamble"
   // (LoraWAN specification)
-  m_closeFirstWindow = Simulator::Schedule (Seconds (m_receiveWindowDurationInSymbols*tSym),
-                                            &ClassAEndDeviceLorawanMac::CloseFirstReceiveWindow, this); //m_receiveWindowDuration
+  m_closeFirstWindow =
+    LoraEventProfiler::Schedule (LoraEventProfiler::MAC_CLOSE_RECEIVE_WINDOW,
+                                 Seconds (m_receiveWindowDurationInSymbols*tSym),
+                                 &ClassAEndDeviceLorawanMac::CloseFirstReceiveWindow, this); //m_receiveWindowDuration
 
 }
 
@@ -371,8 +379,10 @@ ClassAEndDeviceLorawanMac::OpenSecondReceiveWindow (void)
   // Schedule return to sleep after "at least the time required by the end
   // device's radio transceiver to effectively detect a downlink preamble"
   // (LoraWAN specification)
-  m_closeSecondWindow = Simulator::Schedule (Seconds (m_receiveWindowDurationInSymbols*tSym),
-                                             &ClassAEndDeviceLorawanMac::CloseSecondReceiveWindow, this);
+  m_closeSecondWindow =
+    LoraEventProfiler::Schedule (LoraEventProfiler::MAC_CLOSE_RECEIVE_WINDOW,
+                                 Seconds (m_receiveWindowDurationInSymbols*tSym),
+                                 &ClassAEndDeviceLorawanMac::CloseSecondReceiveWindow, this);
 
 }
 
@@ -488,7 +498,10 @@ ClassAEndDeviceLorawanMac::GetNextClassTransmissionDelay (Time waitingTime)
 uint8_t
 ClassAEndDeviceLorawanMac::GetFirstReceiveWindowDataRate (void)
 {
-  return m_replyDataRateMatrix.at (m_dataRate).at (m_rx1DrOffset);
+  NS_ABORT_MSG_IF (!m_regionalPlan, "No regional plan to get the RX1 data "
+                   "rate from: call SetRegionalPlan first");
+
+  return m_regionalPlan->GetReplyDataRate (m_dataRate, m_rx1DrOffset);
 }
 
 void
@@ -46,6 +46,8 @@ CorrelatedShadowingPropagationLossModel::GetTypeId (void)
 }
 
 CorrelatedShadowingPropagationLossModel::CorrelatedShadowingPropagationLossModel ()
+  : m_substreams (LoraSubstreamRng::IsEnabled ()),
+  m_key (LoraSubstreamRng::GetKey (LoraSubstreamRng::SHADOWING))
 {
 }
 
@@ -89,8 +91,16 @@ CorrelatedShadowingPropagationLossModel::DoCalcRxPower (double txPowerDbm,
       NS_LOG_DEBUG ("Creating a new shadowing map to be used at coordinates "
                     << coordinates.first << " " << coordinates.second);
 
-      Ptr<ShadowingMap> shadowingMap =
-        Create<CorrelatedShadowingPropagationLossModel::ShadowingMap> ();
+      Ptr<ShadowingMap> shadowingMap;
+      if (m_substreams)
+        {
+          shadowingMap = Create<CorrelatedShadowingPropagationLossModel::ShadowingMap>
+              (m_key, coordinates);
+        }
+      else
+        {
+          shadowingMap = Create<CorrelatedShadowingPropagationLossModel::ShadowingMap> ();
+        }
 
       m_shadowingGrid[coordinates] = shadowingMap;
     }
@@ -135,7 +145,10 @@ const double CorrelatedShadowingPropagationLossModel::ShadowingMap::m_kInv[4][4]
 };
 
 CorrelatedShadowingPropagationLossModel::ShadowingMap::ShadowingMap () :
-  m_correlationDistance (110)
+  m_correlationDistance (110),
+  m_substreams (false),
+  m_key (0),
+  m_squareIndex (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
@@ -146,11 +159,35 @@ CorrelatedShadowingPropagationLossModel::ShadowingMap::ShadowingMap () :
   m_shadowingValue->SetAttribute ("Variance", DoubleValue (16.0));
 }
 
+CorrelatedShadowingPropagationLossModel::ShadowingMap::ShadowingMap
+  (uint64_t key, std::pair<int, int> square) :
+  m_correlationDistance (110),
+  m_substreams (true),
+  m_key (key),
+  m_squareIndex (((uint64_t) (uint32_t) square.first << 32) | (uint32_t) square.second)
+{
+  NS_LOG_FUNCTION (key << square.first << square.second);
+}
+
 CorrelatedShadowingPropagationLossModel::ShadowingMap::~ShadowingMap ()
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
 
+double
+CorrelatedShadowingPropagationLossModel::ShadowingMap::GetVertexValue (int xVertex,
+                                                                      int yVertex)
+{
+  if (!m_substreams)
+    {
+      return m_shadowingValue->GetValue ();
+    }
+
+  // Vertices wrap around every 65536 grid units, about 7200 km
+  uint32_t vertexIndex = ((uint32_t) (xVertex & 0xffff) << 16) | (yVertex & 0xffff);
+  return LoraSubstreamRng (m_key, m_squareIndex, vertexIndex).GetNormal (0.0, 16.0);
+}
+
 double
 CorrelatedShadowingPropagationLossModel::ShadowingMap::GetLoss
   (CorrelatedShadowingPropagationLossModel::Position position)
@@ -198,16 +235,16 @@ CorrelatedShadowingPropagationLossModel::ShadowingMap::GetLoss
       // TODO: Avoid useless generation of ShadowingMap values. This can be
       // done by performing some checks (and not leveraging the map
       // implementation)
-      double q11 = m_shadowingValue->GetValue ();
+      double q11 = GetVertexValue (xcoord, ycoord);
       NS_LOG_DEBUG ("Lower left corner: " << q11);
       m_shadowingMap[lowerLeft] = q11;
-      double q12 = m_shadowingValue->GetValue ();
+      double q12 = GetVertexValue (xcoord, ycoord + 1);
       NS_LOG_DEBUG ("Upper left corner: " << q12);
       m_shadowingMap[upperLeft] = q12;
-      double q21 = m_shadowingValue->GetValue ();
+      double q21 = GetVertexValue (xcoord + 1, ycoord);
       NS_LOG_DEBUG ("Lower right corner: " << q21);
       m_shadowingMap[lowerRight] = q21;
-      double q22 = m_shadowingValue->GetValue ();
+      double q22 = GetVertexValue (xcoord + 1, ycoord + 1);
       NS_LOG_DEBUG ("Upper right corner: " << q22);
       m_shadowingMap[upperRight] = q22;
 
@@ -23,11 +23,21 @@
 #include "ns3/mobility-model.h"
 #include "ns3/vector.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/lora-substream-rng.h"
 
 namespace ns3 {
 class MobilityModel;
 namespace lorawan {
 
+/**
+ * A shadowing model with spatial correlation.
+ *
+ * If the LoraDeviceSubstreams global value is true when the model is
+ * created, the independent values of the grid of each ShadowingMap are drawn
+ * from LoraSubstreamRng substreams of the square of the map and the vertex,
+ * and the shadowing of a link no longer depends on the order in which links
+ * are evaluated.
+ */
 class CorrelatedShadowingPropagationLossModel : public PropagationLossModel
 {
 
@@ -70,6 +80,16 @@ public:
      */
     ShadowingMap ();
 
+    /**
+     * Constructor of a map whose grid values are drawn from the
+     * LoraSubstreamRng substreams of the grid square of the map, so that
+     * they only depend on their place in the grid.
+     *
+     * \param key The key of the substreams.
+     * \param square The coordinates of the grid square of the map.
+     */
+    ShadowingMap (uint64_t key, std::pair<int, int> square);
+
     ~ShadowingMap ();
 
     /**
@@ -80,6 +100,14 @@ public:
     double GetLoss (CorrelatedShadowingPropagationLossModel::Position position);
 
 private:
+    /**
+     * Get the shadowing value of a vertex of the grid.
+     *
+     * \param xVertex The x coordinate of the vertex, in grid units.
+     * \param yVertex The y coordinate of the vertex, in grid units.
+     */
+    double GetVertexValue (int xVertex, int yVertex);
+
     /**
      * For each Position, this map gives a corresponding loss.
      * The map contains a basic grid that is initialized at construction
@@ -99,6 +127,10 @@ private:
      */
     Ptr<NormalRandomVariable> m_shadowingValue;
 
+    bool m_substreams;   //!< Whether grid values are drawn from substreams
+    uint64_t m_key;   //!< The key of the substreams
+    uint64_t m_squareIndex;   //!< The index of the substreams of this map
+
     /**
      * The inverted K matrix.
      * This matrix is used to compute the coefficients to be used when
@@ -133,6 +165,9 @@ private:
 
   double m_correlationDistance;     //!< The correlation distance for the ShadowingMap
 
+  bool m_substreams;   //!< Whether to draw from substreams
+  uint64_t m_key;   //!< The key of the substreams
+
   /**
    * Map linking a square to a ShadowingMap.
    * Each square of the shadowing grid has a corresponding ShadowingMap, and a
@@ -0,0 +1,429 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/downlink-planner.h"
+#include "ns3/network-status.h"
+#include "ns3/end-device-status.h"
+#include "ns3/gateway-status.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("DownlinkPlanner");
+
+NS_OBJECT_ENSURE_REGISTERED (DownlinkPlanner);
+
+TypeId
+DownlinkPlanner::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DownlinkPlanner")
+    .SetParent<Object> ()
+    .AddConstructor<DownlinkPlanner> ()
+    .AddAttribute ("PlanningHorizon",
+                   "Replies whose first receive window opens within this "
+                   "time are planned together",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&DownlinkPlanner::m_horizon),
+                   MakeTimeChecker ())
+    .AddAttribute ("GuardInterval",
+                   "Minimum spacing between two transmissions of a gateway",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&DownlinkPlanner::m_guardInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("ReplySize",
+                   "Size in bytes used to estimate the duration of a reply",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&DownlinkPlanner::m_replySize),
+                   MakeUintegerChecker<uint32_t> ())
+    .SetGroupName ("lorawan");
+  return tid;
+}
+
+DownlinkPlanner::DownlinkPlanner ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+DownlinkPlanner::DownlinkPlanner (Ptr<NetworkStatus> status) :
+  m_status (status)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+DownlinkPlanner::~DownlinkPlanner ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DownlinkPlanner::SetNetworkStatus (Ptr<NetworkStatus> status)
+{
+  m_status = status;
+}
+
+void
+DownlinkPlanner::AddPendingReply (LoraDeviceAddress deviceAddress,
+                                  Time firstWindowTime)
+{
+  NS_LOG_FUNCTION (this << deviceAddress << firstWindowTime);
+
+  // A new uplink supersedes whatever was planned for the previous one
+  Release (deviceAddress);
+
+  PendingReply pending;
+  pending.firstWindowTime = firstWindowTime;
+  m_pending[deviceAddress] = pending;
+}
+
+DownlinkPlanner::Assignment
+DownlinkPlanner::Plan (LoraDeviceAddress deviceAddress)
+{
+  NS_LOG_FUNCTION (this << deviceAddress);
+
+  Prune ();
+
+  auto it = m_pending.find (deviceAddress);
+  if (it == m_pending.end ())
+    {
+      AddPendingReply (deviceAddress, Simulator::Now ());
+      it = m_pending.find (deviceAddress);
+    }
+
+  if (it->second.resolved)
+    {
+      NS_LOG_DEBUG ("Device " << deviceAddress << " was already planned");
+      return it->second.assignment;
+    }
+
+  // Collect this device's reply and all the ones that will need to be sent
+  // within the planning horizon
+  struct Request
+  {
+    LoraDeviceAddress deviceAddress;
+    Time firstWindowTime;
+    std::vector<Candidate> candidates;
+  };
+  std::vector<Request> batch;
+
+  Time now = Simulator::Now ();
+  for (auto pit = m_pending.begin (); pit != m_pending.end (); ++pit)
+    {
+      if (pit->second.resolved)
+        {
+          continue;
+        }
+
+      if (pit->first != deviceAddress)
+        {
+          if (pit->second.firstWindowTime < now
+              || pit->second.firstWindowTime > now + m_horizon
+              || !m_status->NeedsReply (pit->first))
+            {
+              continue;
+            }
+        }
+
+      Request request;
+      request.deviceAddress = pit->first;
+      request.firstWindowTime = pit->second.firstWindowTime;
+      std::vector<Candidate> candidates = GetCandidates (pit->first,
+                                                         pit->second.firstWindowTime);
+      for (auto cit = candidates.begin (); cit != candidates.end (); ++cit)
+        {
+          if (IsFeasible (*cit))
+            {
+              request.candidates.push_back (*cit);
+            }
+        }
+      batch.push_back (request);
+    }
+
+  NS_LOG_DEBUG ("Planning " << batch.size () << " replies together");
+
+  // Serve the most constrained devices first
+  std::stable_sort (batch.begin (), batch.end (),
+                    [] (const Request &a, const Request &b)
+    {
+      if (a.candidates.size () != b.candidates.size ())
+        {
+          return a.candidates.size () < b.candidates.size ();
+        }
+      return a.firstWindowTime < b.firstWindowTime;
+    });
+
+  for (auto bit = batch.begin (); bit != batch.end (); ++bit)
+    {
+      PendingReply &pending = m_pending.at (bit->deviceAddress);
+
+      for (auto cit = bit->candidates.begin (); cit != bit->candidates.end (); ++cit)
+        {
+          // Previous assignments in this round may have taken this slot
+          if (IsFeasible (*cit))
+            {
+              Reserve (bit->deviceAddress, *cit);
+              pending.assignment.gwAddress = cit->gwAddress;
+              pending.assignment.window = cit->window;
+              pending.resolved = true;
+              break;
+            }
+        }
+
+      // Devices other than the current one will get another chance when
+      // their own receive window comes
+      if (bit->deviceAddress == deviceAddress)
+        {
+          pending.resolved = true;
+        }
+
+      NS_LOG_DEBUG ("Device " << bit->deviceAddress << " assigned to window "
+                              << pending.assignment.window);
+    }
+
+  return m_pending.at (deviceAddress).assignment;
+}
+
+DownlinkPlanner::Assignment
+DownlinkPlanner::GetAssignment (LoraDeviceAddress deviceAddress)
+{
+  auto it = m_pending.find (deviceAddress);
+  if (it != m_pending.end ())
+    {
+      return it->second.assignment;
+    }
+  return Assignment ();
+}
+
+void
+DownlinkPlanner::Complete (LoraDeviceAddress deviceAddress, bool sent)
+{
+  NS_LOG_FUNCTION (this << deviceAddress << sent);
+
+  // If the reply was sent, its slot stays reserved until it is over
+  if (!sent)
+    {
+      Release (deviceAddress);
+    }
+  m_pending.erase (deviceAddress);
+}
+
+std::vector<DownlinkPlanner::Candidate>
+DownlinkPlanner::GetCandidates (LoraDeviceAddress deviceAddress,
+                                Time firstWindowTime)
+{
+  std::vector<Candidate> candidates;
+
+  Ptr<EndDeviceStatus> edStatus = m_status->GetEndDeviceStatus (deviceAddress);
+  if (edStatus == 0 || edStatus->GetLastPacketReceivedFromDevice () == 0)
+    {
+      return candidates;
+    }
+
+  // By iterating on the map in reverse, we go from the gateway with the
+  // highest received power to the worst one. First receive window options
+  // are always preferred.
+  std::map<double, Address> gwAddresses = edStatus->GetPowerGatewayMap ();
+  for (int window = 1; window <= 2; window++)
+    {
+      Candidate candidate;
+      candidate.window = window;
+      candidate.start = firstWindowTime + Seconds (window - 1);
+      if (candidate.start < Simulator::Now ())
+        {
+          continue;
+        }
+
+      uint8_t dataRate;
+      if (window == 1)
+        {
+          candidate.frequency = edStatus->GetFirstReceiveWindowFrequency ();
+          dataRate = edStatus->GetMac ()->GetFirstReceiveWindowDataRate ();
+        }
+      else
+        {
+          candidate.frequency = edStatus->GetSecondReceiveWindowFrequency ();
+          dataRate = edStatus->GetMac ()->GetSecondReceiveWindowDataRate ();
+        }
+
+      for (auto it = gwAddresses.rbegin (); it != gwAddresses.rend (); it++)
+        {
+          candidate.gwAddress = it->second;
+          candidate.duration = GetReplyDuration (it->second, dataRate);
+          candidates.push_back (candidate);
+        }
+    }
+
+  return candidates;
+}
+
+bool
+DownlinkPlanner::IsFeasible (const Candidate &candidate)
+{
+  Ptr<GatewayStatus> gwStatus = m_status->GetGatewayStatus (candidate.gwAddress);
+  if (gwStatus == 0)
+    {
+      return false;
+    }
+
+  // Immediate transmissions also depend on the gateway's current state
+  if (candidate.start == Simulator::Now ()
+      && !gwStatus->IsAvailableForTransmission (candidate.frequency))
+    {
+      return false;
+    }
+
+  GatewayTimeline &timeline = GetTimeline (candidate.gwAddress);
+  Ptr<SubBand> subBand = gwStatus->GetSubBand (candidate.frequency);
+
+  // Duty cycle caused by transmissions that already took place
+  if (gwStatus->GetEarliestTransmissionTime (candidate.frequency) > candidate.start)
+    {
+      return false;
+    }
+
+  double dutyCycle = subBand->GetDutyCycle ();
+  for (auto it = timeline.reservations.begin ();
+       it != timeline.reservations.end (); ++it)
+    {
+      // We can't send multiple packets at once, see SX1301 V2.01 page 29
+      if (candidate.start < it->start + it->duration + m_guardInterval
+          && it->start < candidate.start + candidate.duration + m_guardInterval)
+        {
+          return false;
+        }
+
+      if (it->subBand != subBand)
+        {
+          continue;
+        }
+
+      // Duty cycle caused by transmissions that are planned, computed as in
+      // LogicalLoraChannelHelper::AddEvent
+      if (it->start <= candidate.start)
+        {
+          double offTime = it->duration.GetSeconds () / dutyCycle
+            - it->duration.GetSeconds ();
+          if (candidate.start < it->start + Seconds (offTime) + m_guardInterval)
+            {
+              return false;
+            }
+        }
+      else
+        {
+          double offTime = candidate.duration.GetSeconds () / dutyCycle
+            - candidate.duration.GetSeconds ();
+          if (it->start < candidate.start + Seconds (offTime) + m_guardInterval)
+            {
+              return false;
+            }
+        }
+    }
+
+  return true;
+}
+
+void
+DownlinkPlanner::Reserve (LoraDeviceAddress deviceAddress,
+                          const Candidate &candidate)
+{
+  NS_LOG_FUNCTION (this << deviceAddress << candidate.gwAddress
+                        << candidate.window);
+
+  GatewayTimeline &timeline = GetTimeline (candidate.gwAddress);
+
+  Reservation reservation;
+  reservation.deviceAddress = deviceAddress;
+  reservation.start = candidate.start;
+  reservation.duration = candidate.duration;
+  reservation.subBand = m_status->GetGatewayStatus (candidate.gwAddress)->
+    GetSubBand (candidate.frequency);
+  timeline.reservations.push_back (reservation);
+}
+
+void
+DownlinkPlanner::Release (LoraDeviceAddress deviceAddress)
+{
+  auto pit = m_pending.find (deviceAddress);
+  if (pit == m_pending.end () || pit->second.assignment.window == 0)
+    {
+      return;
+    }
+
+  auto tit = m_timelines.find (pit->second.assignment.gwAddress);
+  if (tit == m_timelines.end ())
+    {
+      return;
+    }
+
+  std::list<Reservation> &reservations = tit->second.reservations;
+  for (auto it = reservations.begin (); it != reservations.end (); )
+    {
+      if (it->deviceAddress == deviceAddress && it->start >= Simulator::Now ())
+        {
+          NS_LOG_DEBUG ("Releasing slot of device " << deviceAddress);
+          it = reservations.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+}
+
+void
+DownlinkPlanner::Prune (void)
+{
+  Time now = Simulator::Now ();
+  for (auto tit = m_timelines.begin (); tit != m_timelines.end (); ++tit)
+    {
+      // Once a transmission is over, its duty cycle is tracked by the
+      // gateway's own SubBand
+      tit->second.reservations.remove_if ([now] (const Reservation &r)
+        {
+          return r.start + r.duration < now;
+        });
+    }
+}
+
+DownlinkPlanner::GatewayTimeline &
+DownlinkPlanner::GetTimeline (Address gwAddress)
+{
+  return m_timelines[gwAddress];
+}
+
+Time
+DownlinkPlanner::GetReplyDuration (Address gwAddress, uint8_t dataRate)
+{
+  auto it = m_replyDurations.find (dataRate);
+  if (it != m_replyDurations.end ())
+    {
+      return it->second;
+    }
+
+  Ptr<GatewayLorawanMac> gwMac = m_status->GetGatewayStatus (gwAddress)->
+    GetGatewayMac ();
+  Time duration = gwMac->GetOnAirTime (Create<Packet> (m_replySize), dataRate);
+  m_replyDurations[dataRate] = duration;
+
+  return duration;
+}
+
+}
+}
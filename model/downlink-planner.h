@@ -0,0 +1,208 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef DOWNLINK_PLANNER_H
+#define DOWNLINK_PLANNER_H
+
+#include "ns3/object.h"
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include "ns3/lora-device-address.h"
+#include "ns3/sub-band.h"
+#include <list>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+class NetworkStatus;     // Forward declaration
+class EndDeviceStatus;     // Forward declaration
+
+/**
+ * This class plans the downlink transmissions of the Network Server across
+ * all of its gateways.
+ *
+ * For each gateway, the planner keeps a timeline of the transmission slots it
+ * already reserved, split by SubBand so that the duty cycle each reservation
+ * will cause can be projected in the future, while the duty cycle caused by
+ * past transmissions is read from the GatewayStatus ledger. When a receive
+ * window opportunity comes up, the planner resolves together all replies whose
+ * first receive window falls within the planning horizon: devices with the
+ * fewest feasible (gateway, window) options are served first, so that a device
+ * which can only be reached in RX1 through a single gateway is not starved by
+ * a device that could also be served in RX2 or by another gateway.
+ */
+class DownlinkPlanner : public Object
+{
+public:
+  /**
+   * The outcome of the planning procedure for a device.
+   */
+  struct Assignment
+  {
+    Address gwAddress;   //!< The gateway that will send the reply
+    int window = 0;      //!< The receive window to use (0 if none is available)
+  };
+
+  static TypeId GetTypeId (void);
+
+  DownlinkPlanner ();
+  DownlinkPlanner (Ptr<NetworkStatus> status);
+  virtual ~DownlinkPlanner ();
+
+  /**
+   * Set the NetworkStatus this planner reads device and gateway state from.
+   */
+  void SetNetworkStatus (Ptr<NetworkStatus> status);
+
+  /**
+   * Inform the planner that a reply may be sent to a device, whose first
+   * receive window will open at the specified time.
+   *
+   * \param deviceAddress The address of the device.
+   * \param firstWindowTime The time at which the first receive window opens.
+   */
+  void AddPendingReply (LoraDeviceAddress deviceAddress, Time firstWindowTime);
+
+  /**
+   * Resolve the assignment for a device.
+   *
+   * If the device was not already planned together with another one, this
+   * triggers a joint resolution of all the pending replies whose first
+   * receive window falls within the planning horizon.
+   *
+   * \param deviceAddress The address of the device that needs a reply.
+   * \return The assignment for the device.
+   */
+  Assignment Plan (LoraDeviceAddress deviceAddress);
+
+  /**
+   * Get the assignment that was previously resolved for a device.
+   *
+   * \param deviceAddress The address of the device.
+   * \return The assignment, or an empty one if the device was not planned.
+   */
+  Assignment GetAssignment (LoraDeviceAddress deviceAddress);
+
+  /**
+   * Inform the planner that the reply to a device was handled.
+   *
+   * \param deviceAddress The address of the device.
+   * \param sent Whether the reply was actually sent. If it wasn't, the
+   * reserved slot is released.
+   */
+  void Complete (LoraDeviceAddress deviceAddress, bool sent);
+
+private:
+  /**
+   * A transmission slot reserved on a gateway.
+   */
+  struct Reservation
+  {
+    LoraDeviceAddress deviceAddress;
+    Time start;
+    Time duration;
+    Ptr<SubBand> subBand;
+  };
+
+  /**
+   * The reservations of a single gateway.
+   */
+  struct GatewayTimeline
+  {
+    std::list<Reservation> reservations;
+  };
+
+  /**
+   * A reply that still has to be sent.
+   */
+  struct PendingReply
+  {
+    Time firstWindowTime;
+    bool resolved = false;
+    Assignment assignment;
+  };
+
+  /**
+   * A (gateway, window) option for a device.
+   */
+  struct Candidate
+  {
+    Address gwAddress;
+    int window;
+    Time start;
+    Time duration;
+    double frequency;
+  };
+
+  /**
+   * Compute the (gateway, window) options of a device, from the best to the
+   * worst.
+   */
+  std::vector<Candidate> GetCandidates (LoraDeviceAddress deviceAddress,
+                                        Time firstWindowTime);
+
+  /**
+   * Whether a candidate slot is compatible with the current reservations and
+   * the gateway's state.
+   */
+  bool IsFeasible (const Candidate &candidate);
+
+  /**
+   * Reserve the slot of a candidate for a device.
+   */
+  void Reserve (LoraDeviceAddress deviceAddress, const Candidate &candidate);
+
+  /**
+   * Release any slot reserved for a device.
+   */
+  void Release (LoraDeviceAddress deviceAddress);
+
+  /**
+   * Remove the reservations that are over.
+   */
+  void Prune (void);
+
+  /**
+   * Get the timeline of a gateway, creating it if necessary.
+   */
+  GatewayTimeline &GetTimeline (Address gwAddress);
+
+  /**
+   * Estimate the time on air of a reply at a certain data rate.
+   */
+  Time GetReplyDuration (Address gwAddress, uint8_t dataRate);
+
+  Ptr<NetworkStatus> m_status;
+
+  std::map<Address, GatewayTimeline> m_timelines;
+
+  std::map<LoraDeviceAddress, PendingReply> m_pending;
+
+  std::map<uint8_t, Time> m_replyDurations;   //!< Cache of reply durations per DR
+
+  Time m_horizon;   //!< Pending replies planned together
+
+  Time m_guardInterval;   //!< Minimum spacing between two transmissions
+
+  uint32_t m_replySize;   //!< Reply size used to estimate durations
+};
+
+} /* namespace lorawan */
+
+} /* namespace ns3 */
+#endif /* DOWNLINK_PLANNER_H */
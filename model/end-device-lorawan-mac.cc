@@ -26,6 +26,7 @@
 #include "ns3/end-device-lora-phy.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
+#include "ns3/lora-event-profiler.h"
 #include <algorithm>
 
 namespace ns3 {
@@ -197,7 +198,10 @@ EndDeviceLorawanMac::postponeTransmission (Time netxTxDelay, Ptr<Packet> packet)
   NS_LOG_FUNCTION (this);
   // Delete previously scheduled transmissions if any.
   Simulator::Cancel (m_nextTx);
-  m_nextTx = Simulator::Schedule (netxTxDelay, &EndDeviceLorawanMac::DoSend, this, packet);
+  m_nextTx = LoraEventProfiler::Schedule (LoraEventProfiler::MAC_SEND,
+                                          netxTxDelay,
+                                          &EndDeviceLorawanMac::DoSend, this,
+                                          packet);
   NS_LOG_WARN ("Attempting to send, but the aggregate duty cycle won't allow it. Scheduling a tx at a delay "
                << netxTxDelay.GetSeconds () << ".");
 }
@@ -223,7 +227,7 @@ EndDeviceLorawanMac::DoSend (Ptr<Packet> packet)
                    " bytes.");
 
       // Check that MACPayload length is below the allowed maximum
-      if (packet->GetSize () > m_maxAppPayloadForDataRate.at (m_dataRate))
+      if (packet->GetSize () > GetMaxAppPayloadForDataRate (m_dataRate))
         {
           NS_LOG_WARN ("Attempting to send a packet larger than the maximum allowed"
                        << " size at this DataRate (DR" << unsigned(m_dataRate) <<
@@ -359,8 +363,8 @@ EndDeviceLorawanMac::ParseCommands (LoraFrameHeader frameHeader)
         }
     }
 
-  std::list<Ptr<MacCommand> > commands = frameHeader.GetCommands ();
-  std::list<Ptr<MacCommand> >::iterator it;
+  const std::vector<Ptr<MacCommand> > &commands = frameHeader.GetCommands ();
+  std::vector<Ptr<MacCommand> >::const_iterator it;
   for (it = commands.begin (); it != commands.end (); it++)
     {
       NS_LOG_DEBUG ("Iterating over the MAC commands...");
@@ -786,16 +790,16 @@ EndDeviceLorawanMac::OnLinkAdrReq (uint8_t dataRate, uint8_t txPower,
   if (channelMaskOk && dataRateOk && txPowerOk)
     {
       // Cycle over all channels in the list
-      for (uint32_t i = 0; i < m_channelHelper.GetChannelList ().size (); i++)
+      for (uint32_t i = 0; i < channelList.size (); i++)
         {
           if (std::find (enabledChannels.begin (), enabledChannels.end (), i) != enabledChannels.end ())
             {
-              m_channelHelper.GetChannelList ().at (i)->SetEnabledForUplink ();
+              m_channelHelper.EnableChannel (i);
               NS_LOG_DEBUG ("Channel " << i << " enabled");
             }
           else
             {
-              m_channelHelper.GetChannelList ().at (i)->DisableForUplink ();
+              m_channelHelper.DisableChannel (i);
               NS_LOG_DEBUG ("Channel " << i << " disabled");
             }
         }
@@ -930,5 +934,27 @@ EndDeviceLorawanMac::GetTransmissionPower (void)
 {
   return m_txPower;
 }
+
+void
+EndDeviceLorawanMac::SetTransmissionPower (uint8_t txPowerDbm)
+{
+  NS_LOG_FUNCTION (this << unsigned (txPowerDbm));
+
+  m_txPower = txPowerDbm;
+}
+
+void
+EndDeviceLorawanMac::SetFCnt (uint16_t fCnt)
+{
+  NS_LOG_FUNCTION (this << fCnt);
+
+  m_currentFCnt = fCnt;
+}
+
+uint16_t
+EndDeviceLorawanMac::GetFCnt (void) const
+{
+  return m_currentFCnt;
+}
 }
 }
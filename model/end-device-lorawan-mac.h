@@ -159,6 +159,27 @@ public:
    */
   virtual uint8_t GetTransmissionPower (void);
 
+  /**
+   * Set the transmission power this end device will use. Like the data rate,
+   * this value can later be modified via MAC commands issued by the GW.
+   *
+   * \param txPowerDbm The transmission power to use, in dBm.
+   */
+  void SetTransmissionPower (uint8_t txPowerDbm);
+
+  /**
+   * Set the frame counter of the last packet sent by this device, so that
+   * the next new packet is sent with fCnt + 1.
+   *
+   * \param fCnt The frame counter of the last packet.
+   */
+  void SetFCnt (uint16_t fCnt);
+
+  /**
+   * Get the frame counter of the last packet sent by this device.
+   */
+  uint16_t GetFCnt (void) const;
+
   /**
    * Set the network address of this device.
    *
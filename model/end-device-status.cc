@@ -124,15 +124,13 @@ EndDeviceStatus::GetCompleteReplyPacket (void)
       replyPacket = Create<Packet> (0);
     }
 
-  // Add headers
+  // Add headers, using the frame counter that was saved when the last packet
+  // was received instead of deserializing a copy of the packet
   m_reply.frameHeader.SetAddress (m_endDeviceAddress);
-  Ptr<Packet> lastPacket = GetLastPacketReceivedFromDevice ()->Copy ();
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  lastPacket->RemoveHeader (mHdr);
-  lastPacket->RemoveHeader (fHdr);
-  m_reply.frameHeader.SetFCnt (fHdr.GetFCnt ());
+  if (!m_receivedPacketList.empty ())
+    {
+      m_reply.frameHeader.SetFCnt (m_receivedPacketList.back ().second.fCnt);
+    }
   m_reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
   replyPacket->AddHeader (m_reply.frameHeader);
   replyPacket->AddHeader (m_reply.macHeader);
@@ -243,6 +241,26 @@ EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket, const A
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  LoraTag tag;
+  receivedPacket->PeekPacketTag (tag);
+
+  PacketInfoPerGw gwInfo;
+  gwInfo.receivedTime = Simulator::Now ();
+  gwInfo.rxPower = tag.GetReceivePower ();
+  gwInfo.gwAddress = gwAddress;
+
+  GatewayList gwList;
+  gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
+
+  InsertReceivedPacket (receivedPacket, gwList);
+}
+
+void
+EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket,
+                                       const GatewayList &gwList)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
   // Create a copy of the packet
   Ptr<Packet> myPacket = receivedPacket->Copy ();
 
@@ -265,8 +283,7 @@ EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket, const A
   info.sf = tag.GetSpreadingFactor ();
   info.frequency = tag.GetFrequency ();
   info.packet = receivedPacket;
-
-  double rcvPower = tag.GetReceivePower ();
+  info.fCnt = frameHdr.GetFCnt ();
 
   // Perform insertion in list, also checking that the packet isn't already in
   // the list (it could have been received by another GW already)
@@ -275,34 +292,22 @@ EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket, const A
   auto it = m_receivedPacketList.rbegin ();
   for (; it != m_receivedPacketList.rend (); it++)
     {
-      // Get the frame counter of the current packet to compare it with the
-      // newly received one
-      Ptr<Packet> packetCopy = ((*it).first)->Copy ();
-      LorawanMacHeader currentMacHdr;
-      packetCopy->RemoveHeader (currentMacHdr);
-      LoraFrameHeader currentFrameHdr;
-      frameHdr.SetAsUplink ();
-      packetCopy->RemoveHeader (currentFrameHdr);
-
+      // Compare the frame counter of the current packet, saved when it was
+      // inserted, with the newly received one
       NS_LOG_DEBUG ("Received packet's frame counter: " << unsigned(frameHdr.GetFCnt ())
                                                         << "\nCurrent packet's frame counter: "
-                                                        << unsigned(currentFrameHdr.GetFCnt ()));
+                                                        << unsigned(it->second.fCnt));
 
-      if (frameHdr.GetFCnt () == currentFrameHdr.GetFCnt ())
+      if (frameHdr.GetFCnt () == it->second.fCnt)
         {
           NS_LOG_INFO ("Packet was already received by another gateway");
 
           // This packet had already been received from another gateway:
-          // add this gateway's reception information.
-          GatewayList &gwList = it->second.gwList;
-
-          PacketInfoPerGw gwInfo;
-          gwInfo.receivedTime = Simulator::Now ();
-          gwInfo.rxPower = rcvPower;
-          gwInfo.gwAddress = gwAddress;
-          gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
+          // add these gateways' reception information.
+          GatewayList &currentGwList = it->second.gwList;
+          currentGwList.insert (gwList.begin (), gwList.end ());
 
-          NS_LOG_DEBUG ("Size of gateway list: " << gwList.size ());
+          NS_LOG_DEBUG ("Size of gateway list: " << currentGwList.size ());
 
           break; // Exit from the cycle
         }
@@ -310,11 +315,7 @@ EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket, const A
   if (it == m_receivedPacketList.rend ())
     {
       NS_LOG_INFO ("Packet was received for the first time");
-      PacketInfoPerGw gwInfo;
-      gwInfo.receivedTime = Simulator::Now ();
-      gwInfo.rxPower = rcvPower;
-      gwInfo.gwAddress = gwAddress;
-      info.gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
+      info.gwList = gwList;
       m_receivedPacketList.push_back (
           std::pair<Ptr<Packet const>, ReceivedPacketInfo> (receivedPacket, info));
     }
@@ -355,7 +356,11 @@ void
 EndDeviceStatus::InitializeReply ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_reply = Reply ();
+  // Reset the reply in place, so that the storage of its MAC commands is
+  // reused by the next reply to this device
+  m_reply.macHeader = LorawanMacHeader ();
+  m_reply.frameHeader.Reset ();
+  m_reply.payload = 0;
   m_reply.needsReply = false;
 }
 
@@ -171,6 +171,7 @@ public:
     GatewayList gwList;      //!< List of gateways that received this packet.
     uint8_t sf;
     double frequency;
+    uint16_t fCnt = 0;   //!< The frame counter of the received packet
   };
 
   typedef std::list<std::pair<Ptr<Packet const>, ReceivedPacketInfo> >
@@ -268,6 +269,13 @@ public:
   void InsertReceivedPacket (Ptr<Packet const> receivedPacket,
                              const Address& gwAddress);
 
+  /**
+   * Insert a received packet in the packet list, together with the list of
+   * all the gateways that received it.
+   */
+  void InsertReceivedPacket (Ptr<Packet const> receivedPacket,
+                             const GatewayList& gwList);
+
   /**
    * Return the last packet that was received from this device.
    */
@@ -75,14 +75,7 @@ GatewayLorawanMac::Send (Ptr<Packet> packet)
       return;
     }
 
-  LoraTxParameters params;
-  params.sf = GetSfFromDataRate (dataRate);
-  params.headerDisabled = false;
-  params.codingRate = 1;
-  params.bandwidthHz = GetBandwidthFromDataRate (dataRate);
-  params.nPreamble = 8;
-  params.crcEnabled = 1;
-  params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym (params) > MilliSeconds (16) ? true : false;
+  LoraTxParameters params = GetTxParameters (dataRate);
 
   // Get the duration
   Time duration = m_phy->GetOnAirTime (packet, params);
@@ -155,5 +148,28 @@ GatewayLorawanMac::GetWaitingTime (double frequency)
   return m_channelHelper.GetWaitingTime (CreateObject<LogicalLoraChannel>
                                            (frequency));
 }
+
+Time
+GatewayLorawanMac::GetOnAirTime (Ptr<Packet> packet, uint8_t dataRate)
+{
+  NS_LOG_FUNCTION (this << packet << unsigned (dataRate));
+
+  return LoraPhy::GetOnAirTime (packet, GetTxParameters (dataRate));
+}
+
+LoraTxParameters
+GatewayLorawanMac::GetTxParameters (uint8_t dataRate)
+{
+  LoraTxParameters params;
+  params.sf = GetSfFromDataRate (dataRate);
+  params.headerDisabled = false;
+  params.codingRate = 1;
+  params.bandwidthHz = GetBandwidthFromDataRate (dataRate);
+  params.nPreamble = 8;
+  params.crcEnabled = 1;
+  params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym (params) > MilliSeconds (16) ? true : false;
+
+  return params;
+}
 }
 }
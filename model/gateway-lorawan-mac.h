@@ -56,7 +56,20 @@ public:
    * \return The next transmission time.
    */
   Time GetWaitingTime (double frequency);
+
+  /**
+   * Compute the time it takes this gateway to transmit a packet.
+   *
+   * \param packet The packet to transmit.
+   * \param dataRate The data rate the packet will be transmitted with.
+   * \return The time on air of the packet.
+   */
+  Time GetOnAirTime (Ptr<Packet> packet, uint8_t dataRate);
 private:
+  /**
+   * Get the parameters this gateway uses to transmit at a data rate.
+   */
+  LoraTxParameters GetTxParameters (uint8_t dataRate);
 protected:
 };
 
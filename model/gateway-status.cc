@@ -19,7 +19,11 @@
  */
 
 #include "ns3/gateway-status.h"
+#include "ns3/simulator.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
+
+#include <algorithm>
 
 namespace ns3 {
 namespace lorawan {
@@ -110,7 +114,7 @@ GatewayStatus::IsAvailableForTransmission (double frequency)
     }
 
   // Check that the gateway is not constrained by the duty cycle
-  Time waitingTime = m_gatewayMac->GetWaitingTime (frequency);
+  Time waitingTime = GetEarliestTransmissionTime (frequency) - Simulator::Now ();
   if (waitingTime > Seconds (0))
     {
       NS_LOG_INFO ("Gateway cannot be used because of duty cycle");
@@ -128,5 +132,80 @@ GatewayStatus::SetNextTransmissionTime (Time nextTransmissionTime)
 {
   m_nextTransmissionTime = nextTransmissionTime;
 }
+
+Time
+GatewayStatus::GetEarliestTransmissionTime (double frequency)
+{
+  NS_LOG_FUNCTION (this << frequency);
+
+  LedgerEntry &entry = GetLedgerEntry (frequency);
+
+  return std::max (entry.subBand->GetNextTransmissionTime (),
+                   entry.nextTransmissionTime);
+}
+
+void
+GatewayStatus::RecordTransmission (double frequency, Time duration)
+{
+  NS_LOG_FUNCTION (this << frequency << duration);
+
+  LedgerEntry &entry = GetLedgerEntry (frequency);
+
+  // Same computation as LogicalLoraChannelHelper::AddEvent
+  double dutyCycle = entry.subBand->GetDutyCycle ();
+  double timeOnAir = duration.GetSeconds ();
+  entry.nextTransmissionTime = Simulator::Now () + Seconds
+      (timeOnAir / dutyCycle - timeOnAir);
+
+  // The gateway is booked while the packet travels to it and is transmitted
+  SetNextTransmissionTime (Simulator::Now () + duration);
+
+  NS_LOG_DEBUG ("Next transmission on this sub-band allowed at time: " <<
+                entry.nextTransmissionTime.GetSeconds ());
+}
+
+Ptr<SubBand>
+GatewayStatus::GetSubBand (double frequency)
+{
+  return GetLedgerEntry (frequency).subBand;
+}
+
+GatewayStatus::LedgerEntry &
+GatewayStatus::GetLedgerEntry (double frequency)
+{
+  auto it = m_ledgerIndex.find (frequency);
+  if (it != m_ledgerIndex.end ())
+    {
+      return m_ledger[it->second];
+    }
+
+  // First time this frequency is used: look up its SubBand, which is shared
+  // with the gateway's MAC, and reuse its entry if another frequency of the
+  // same SubBand was already seen.
+  Ptr<SubBand> subBand = m_gatewayMac->GetLogicalLoraChannelHelper ().
+    GetSubBandFromFrequency (frequency);
+  NS_ABORT_MSG_IF (!subBand, "Frequency " << frequency <<
+                   " MHz is in no SubBand of the gateway");
+
+  uint32_t index = 0;
+  for (; index < m_ledger.size (); index++)
+    {
+      if (m_ledger[index].subBand == subBand)
+        {
+          break;
+        }
+    }
+  if (index == m_ledger.size ())
+    {
+      LedgerEntry entry;
+      entry.subBand = subBand;
+      entry.nextTransmissionTime = Seconds (0);
+      m_ledger.push_back (entry);
+    }
+
+  m_ledgerIndex[frequency] = index;
+
+  return m_ledger[index];
+}
 }
 }
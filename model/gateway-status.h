@@ -25,6 +25,9 @@
 #include "ns3/address.h"
 #include "ns3/net-device.h"
 #include "ns3/gateway-lorawan-mac.h"
+#include "ns3/sub-band.h"
+#include <unordered_map>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -81,7 +84,53 @@ public:
   void SetNextTransmissionTime (Time nextTransmissionTime);
   // Time GetNextTransmissionTime (void);
 
+  /**
+   * Get the earliest time at which this gateway will be allowed to transmit
+   * on a frequency.
+   *
+   * This takes into account both the duty cycle of the SubBand the frequency
+   * belongs to, as tracked by the gateway's MAC, and the transmissions that
+   * were recorded by the Network Server but may not have reached the gateway
+   * yet.
+   *
+   * \param frequency The frequency of the transmission.
+   * \return The earliest transmission time, which may be in the past.
+   */
+  Time GetEarliestTransmissionTime (double frequency);
+
+  /**
+   * Record a transmission that the Network Server asked this gateway to
+   * perform, and update the duty cycle ledger accordingly.
+   *
+   * \param frequency The frequency of the transmission.
+   * \param duration The time on air of the transmission.
+   */
+  void RecordTransmission (double frequency, Time duration);
+
+  /**
+   * Get the SubBand of this gateway's MAC that a frequency belongs to.
+   *
+   * \param frequency The frequency we want to check.
+   * \return The SubBand the frequency belongs to.
+   */
+  Ptr<SubBand> GetSubBand (double frequency);
+
 private:
+  /**
+   * An entry of the duty cycle ledger, one for each SubBand.
+   */
+  struct LedgerEntry
+  {
+    Ptr<SubBand> subBand;   //!< The SubBand of the gateway's MAC
+    Time nextTransmissionTime;   //!< Next transmission time according to the NS
+  };
+
+  /**
+   * Get the ledger entry corresponding to a frequency, creating it the first
+   * time the frequency is used.
+   */
+  LedgerEntry &GetLedgerEntry (double frequency);
+
   Address m_address;   //!< The Address of the P2PNetDevice of this gateway
 
   Ptr<NetDevice> m_netDevice;     //!< The NetDevice through which to reach this gateway from the server
@@ -89,6 +138,10 @@ private:
   Ptr<GatewayLorawanMac> m_gatewayMac;     //!< The Mac layer of the gateway
 
   Time m_nextTransmissionTime;   //!< This gateway's next transmission time
+
+  std::vector<LedgerEntry> m_ledger;   //!< The duty cycle ledger
+
+  std::unordered_map<double, uint32_t> m_ledgerIndex;   //!< Frequency to ledger entry
 };
 }
 
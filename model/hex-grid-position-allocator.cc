@@ -104,6 +104,12 @@ namespace ns3 {
     return position;
   }
 
+  uint32_t
+  HexGridPositionAllocator::GetN (void) const
+  {
+    return m_positions.size ();
+  }
+
   int64_t
   HexGridPositionAllocator::AssignStreams (int64_t stream)
   {
@@ -34,6 +34,11 @@ namespace ns3 {
 
     virtual Vector GetNext (void) const;
 
+    /**
+     * Get the number of positions of the grid
+     */
+    uint32_t GetN (void) const;
+
     virtual int64_t AssignStreams (int64_t stream);
 
     static TypeId GetTypeId (void);
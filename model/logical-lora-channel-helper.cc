@@ -21,6 +21,7 @@
 #include "ns3/logical-lora-channel-helper.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -39,6 +40,7 @@ LogicalLoraChannelHelper::GetTypeId (void)
 }
 
 LogicalLoraChannelHelper::LogicalLoraChannelHelper () :
+  m_channelMask (0),
   m_nextAggregatedTransmissionTime (Seconds (0)),
   m_aggregatedDutyCycle (1)
 {
@@ -55,6 +57,27 @@ LogicalLoraChannelHelper::GetChannelList (void)
 {
   NS_LOG_FUNCTION (this);
 
+  if (m_regionalPlan)
+    {
+      // The channels of the plan are shared with other helpers, so hand out
+      // copies that can't change them
+      std::vector<Ptr<LogicalLoraChannel> > copies;
+      const std::vector<Ptr<LogicalLoraChannel> > &planChannels =
+        m_regionalPlan->GetChannels ();
+      for (uint32_t i = 0; i < planChannels.size (); i++)
+        {
+          Ptr<LogicalLoraChannel> copy = CreateObject<LogicalLoraChannel>
+              (planChannels[i]->GetFrequency (), planChannels[i]->GetMinimumDataRate (),
+              planChannels[i]->GetMaximumDataRate ());
+          if (!(m_channelMask & (1 << i)))
+            {
+              copy->DisableForUplink ();
+            }
+          copies.push_back (copy);
+        }
+      return copies;
+    }
+
   // Make a copy of the channel vector
   std::vector<Ptr<LogicalLoraChannel> > vector;
   vector.reserve (m_channelList.size ());
@@ -70,6 +93,22 @@ LogicalLoraChannelHelper::GetEnabledChannelList (void)
 {
   NS_LOG_FUNCTION (this);
 
+  if (m_regionalPlan)
+    {
+      const std::vector<Ptr<LogicalLoraChannel> > &planChannels =
+        m_regionalPlan->GetChannels ();
+
+      std::vector<Ptr <LogicalLoraChannel> > channels;
+      for (uint32_t i = 0; i < planChannels.size (); i++)
+        {
+          if (m_channelMask & (1 << i))
+            {
+              channels.push_back (planChannels[i]);
+            }
+        }
+      return channels;
+    }
+
   // Make a copy of the channel vector
   std::vector<Ptr<LogicalLoraChannel> > vector;
   vector.reserve (m_channelList.size ());
@@ -99,6 +138,9 @@ LogicalLoraChannelHelper::GetSubBandFromChannel (Ptr<LogicalLoraChannel>
 Ptr<SubBand>
 LogicalLoraChannelHelper::GetSubBandFromFrequency (double frequency)
 {
+  // The caller may change the SubBand
+  DetachRegionalPlan ();
+
   // Get the SubBand this frequency belongs to
   std::list< Ptr< SubBand > >::iterator it;
   for (it = m_subBandList.begin (); it != m_subBandList.end (); it++)
@@ -120,6 +162,8 @@ LogicalLoraChannelHelper::AddChannel (double frequency)
 {
   NS_LOG_FUNCTION (this << frequency);
 
+  DetachRegionalPlan ();
+
   // Create the new channel and increment the counter
   Ptr<LogicalLoraChannel> channel = Create<LogicalLoraChannel> (frequency);
 
@@ -135,6 +179,8 @@ LogicalLoraChannelHelper::AddChannel (Ptr<LogicalLoraChannel> logicalChannel)
 {
   NS_LOG_FUNCTION (this << logicalChannel);
 
+  DetachRegionalPlan ();
+
   // Add it to the list
   m_channelList.push_back (logicalChannel);
 }
@@ -146,6 +192,8 @@ LogicalLoraChannelHelper::SetChannel (uint8_t chIndex,
 {
   NS_LOG_FUNCTION (this << chIndex << logicalChannel);
 
+  DetachRegionalPlan ();
+
   m_channelList.at (chIndex) = logicalChannel;
 }
 
@@ -156,6 +204,8 @@ LogicalLoraChannelHelper::AddSubBand (double firstFrequency,
 {
   NS_LOG_FUNCTION (this << firstFrequency << lastFrequency);
 
+  DetachRegionalPlan ();
+
   Ptr<SubBand> subBand = Create<SubBand> (firstFrequency, lastFrequency,
                                           dutyCycle, maxTxPowerDbm);
 
@@ -167,12 +217,16 @@ LogicalLoraChannelHelper::AddSubBand (Ptr<SubBand> subBand)
 {
   NS_LOG_FUNCTION (this << subBand);
 
+  DetachRegionalPlan ();
+
   m_subBandList.push_back (subBand);
 }
 
 void
 LogicalLoraChannelHelper::RemoveChannel (Ptr<LogicalLoraChannel> logicalChannel)
 {
+  DetachRegionalPlan ();
+
   // Search and remove the channel from the list
   std::vector<Ptr<LogicalLoraChannel> >::iterator it;
   for (it = m_channelList.begin (); it != m_channelList.end (); it++)
@@ -207,9 +261,18 @@ LogicalLoraChannelHelper::GetWaitingTime (Ptr<LogicalLoraChannel> channel)
   NS_LOG_FUNCTION (this << channel);
 
   // SubBand waiting time
-  Time subBandWaitingTime = GetSubBandFromChannel (channel)->
-    GetNextTransmissionTime () -
-    Simulator::Now ();
+  Time nextTransmissionTime;
+  if (m_regionalPlan)
+    {
+      nextTransmissionTime = m_nextTransmissionTimes
+        [m_regionalPlan->GetSubBandIndex (channel->GetFrequency ())];
+    }
+  else
+    {
+      nextTransmissionTime = GetSubBandFromChannel (channel)->
+        GetNextTransmissionTime ();
+    }
+  Time subBandWaitingTime = nextTransmissionTime - Simulator::Now ();
 
   // Handle case in which waiting time is negative
   subBandWaitingTime = Seconds (std::max (subBandWaitingTime.GetSeconds (),
@@ -226,14 +289,33 @@ LogicalLoraChannelHelper::AddEvent (Time duration,
 {
   NS_LOG_FUNCTION (this << duration << channel);
 
-  Ptr<SubBand> subBand = GetSubBandFromChannel (channel);
+  // With a regional plan, the clock of the SubBand is kept here
+  Ptr<SubBand> subBand;
+  uint32_t subBandIndex = 0;
+  if (m_regionalPlan)
+    {
+      subBandIndex = m_regionalPlan->GetSubBandIndex (channel->GetFrequency ());
+      subBand = m_regionalPlan->GetSubBands ()[subBandIndex];
+    }
+  else
+    {
+      subBand = GetSubBandFromChannel (channel);
+    }
 
   double dutyCycle = subBand->GetDutyCycle ();
   double timeOnAir = duration.GetSeconds ();
 
   // Computation of necessary waiting time on this sub-band
-  subBand->SetNextTransmissionTime (Simulator::Now () + Seconds
-                                      (timeOnAir / dutyCycle - timeOnAir));
+  Time nextTransmissionTime = Simulator::Now () + Seconds
+      (timeOnAir / dutyCycle - timeOnAir);
+  if (m_regionalPlan)
+    {
+      m_nextTransmissionTimes[subBandIndex] = nextTransmissionTime;
+    }
+  else
+    {
+      subBand->SetNextTransmissionTime (nextTransmissionTime);
+    }
 
   // Computation of necessary aggregate waiting time
   m_nextAggregatedTransmissionTime = Simulator::Now () + Seconds
@@ -243,7 +325,7 @@ LogicalLoraChannelHelper::AddEvent (Time duration,
   NS_LOG_DEBUG ("m_aggregatedDutyCycle: " << m_aggregatedDutyCycle);
   NS_LOG_DEBUG ("Current time: " << Simulator::Now ().GetSeconds ());
   NS_LOG_DEBUG ("Next transmission on this sub-band allowed at time: " <<
-                (subBand->GetNextTransmissionTime ()).GetSeconds ());
+                nextTransmissionTime.GetSeconds ());
   NS_LOG_DEBUG ("Next aggregated transmission allowed at time " <<
                 m_nextAggregatedTransmissionTime.GetSeconds ());
 }
@@ -254,6 +336,13 @@ LogicalLoraChannelHelper::GetTxPowerForChannel (Ptr<LogicalLoraChannel>
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  if (m_regionalPlan)
+    {
+      uint32_t subBandIndex =
+        m_regionalPlan->GetSubBandIndex (logicalChannel->GetFrequency ());
+      return m_regionalPlan->GetSubBands ()[subBandIndex]->GetMaxTxPowerDbm ();
+    }
+
   // Get the maxTxPowerDbm from the SubBand this channel is in
   std::list< Ptr< SubBand > >::iterator it;
   for (it = m_subBandList.begin (); it != m_subBandList.end (); it++)
@@ -274,7 +363,126 @@ LogicalLoraChannelHelper::DisableChannel (int index)
 {
   NS_LOG_FUNCTION (this << index);
 
+  if (m_regionalPlan)
+    {
+      // The mask has a bit for each of at most 16 channels
+      NS_ABORT_MSG_IF (index < 0 || index >= 16
+                       || index >= int (m_regionalPlan->GetChannels ().size ()),
+                       "Channel " << index << " is not in the regional plan");
+      m_channelMask &= ~(1 << index);
+      return;
+    }
+
   m_channelList.at (index)->DisableForUplink ();
 }
+
+void
+LogicalLoraChannelHelper::EnableChannel (int index)
+{
+  NS_LOG_FUNCTION (this << index);
+
+  if (m_regionalPlan)
+    {
+      // The mask has a bit for each of at most 16 channels
+      NS_ABORT_MSG_IF (index < 0 || index >= 16
+                       || index >= int (m_regionalPlan->GetChannels ().size ()),
+                       "Channel " << index << " is not in the regional plan");
+      m_channelMask |= (1 << index);
+      return;
+    }
+
+  m_channelList.at (index)->SetEnabledForUplink ();
+}
+
+void
+LogicalLoraChannelHelper::SetRegionalPlan (Ptr<const LoraRegionalPlan> plan)
+{
+  NS_LOG_FUNCTION (this << plan);
+
+  m_subBandList.clear ();
+  m_channelList.clear ();
+
+  m_regionalPlan = plan;
+  m_nextTransmissionTimes.assign (plan->GetSubBands ().size (), Seconds (0));
+
+  // Start from the channels the plan has enabled
+  const std::vector<Ptr<LogicalLoraChannel> > &planChannels = plan->GetChannels ();
+  NS_ABORT_MSG_IF (planChannels.size () > 16, "The channel mask can't hold the " <<
+                   planChannels.size () << " channels of the regional plan");
+  m_channelMask = 0;
+  for (uint32_t i = 0; i < planChannels.size (); i++)
+    {
+      if (planChannels[i]->IsEnabledForUplink ())
+        {
+          m_channelMask |= (1 << i);
+        }
+    }
+}
+
+Ptr<const LoraRegionalPlan>
+LogicalLoraChannelHelper::GetRegionalPlan (void) const
+{
+  return m_regionalPlan;
+}
+
+void
+LogicalLoraChannelHelper::CopyRegionalPlan (Ptr<const LoraRegionalPlan> plan)
+{
+  NS_LOG_FUNCTION (this << plan);
+
+  for (auto &subBand : plan->GetSubBands ())
+    {
+      AddSubBand (subBand->GetFirstFrequency (), subBand->GetLastFrequency (),
+                  subBand->GetDutyCycle (), subBand->GetMaxTxPowerDbm ());
+    }
+
+  for (auto &channel : plan->GetChannels ())
+    {
+      Ptr<LogicalLoraChannel> copy = CreateObject<LogicalLoraChannel>
+          (channel->GetFrequency (), channel->GetMinimumDataRate (),
+          channel->GetMaximumDataRate ());
+      if (!channel->IsEnabledForUplink ())
+        {
+          copy->DisableForUplink ();
+        }
+      AddChannel (copy);
+    }
+}
+
+void
+LogicalLoraChannelHelper::DetachRegionalPlan (void)
+{
+  if (!m_regionalPlan)
+    {
+      return;
+    }
+
+  NS_LOG_FUNCTION (this);
+
+  Ptr<const LoraRegionalPlan> plan = m_regionalPlan;
+  m_regionalPlan = 0;
+  CopyRegionalPlan (plan);
+
+  // Carry over the clocks and the channel mask
+  uint32_t i = 0;
+  for (auto &subBand : m_subBandList)
+    {
+      subBand->SetNextTransmissionTime (m_nextTransmissionTimes[i++]);
+    }
+  for (i = 0; i < m_channelList.size (); i++)
+    {
+      if (m_channelMask & (1 << i))
+        {
+          m_channelList[i]->SetEnabledForUplink ();
+        }
+      else
+        {
+          m_channelList[i]->DisableForUplink ();
+        }
+    }
+
+  m_nextTransmissionTimes.clear ();
+  m_channelMask = 0;
+}
 }
 }
@@ -26,6 +26,7 @@
 #include "ns3/nstime.h"
 #include "ns3/packet.h"
 #include "ns3/sub-band.h"
+#include "ns3/lora-regional-plan.h"
 #include <list>
 #include <iterator>
 #include <vector>
@@ -41,6 +42,12 @@ namespace lorawan {
  * This class also takes into account duty cycle limitations, by updating a list
  * of SubBand objects and providing methods to query whether transmission on a
  * set channel is admissible or not.
+ *
+ * The channels and SubBands can also be those of a LoraRegionalPlan shared
+ * with other devices, in which case this helper only keeps the duty cycle
+ * clock of each SubBand and the channel mask. Methods that change the list
+ * of channels or SubBands, or that return a SubBand, first replace the plan
+ * with copies of its channels and SubBands that belong to this helper.
  */
 class LogicalLoraChannelHelper : public Object
 {
@@ -83,6 +90,10 @@ public:
   /**
    * Get the list of LogicalLoraChannels currently registered on this helper.
    *
+   * While the helper shares a regional plan, these are copies of the plan's
+   * channels, enabled according to this helper's channel mask: changing them
+   * affects neither the plan nor this helper.
+   *
    * \return A list of the managed channels.
    */
   std::vector<Ptr<LogicalLoraChannel> > GetChannelList (void);
@@ -91,6 +102,9 @@ public:
    * Get the list of LogicalLoraChannels currently registered on this helper
    * that have been enabled for Uplink transmission with the channel mask.
    *
+   * While the helper shares a regional plan, these are the plan's own
+   * channels, which must not be changed.
+   *
    * \return A list of the managed channels enabled for Uplink transmission.
    */
   std::vector<Ptr<LogicalLoraChannel> > GetEnabledChannelList (void);
@@ -171,11 +185,67 @@ public:
   /**
    * Disable the channel at a specified index.
    *
-   * \param index The index of the channel to disable.
+   * \param index The index of the channel to disable, which must be a channel of
+   * the regional plan, if any.
    */
   void DisableChannel (int index);
 
+  /**
+   * Enable the channel at a specified index.
+   *
+   * \param index The index of the channel to enable, which must be a channel of
+   * the regional plan, if any.
+   */
+  void EnableChannel (int index);
+
+  /**
+   * Use the channels and SubBands of a regional plan, shared with the other
+   * helpers that use it. Channels and SubBands added before are removed.
+   *
+   * \param plan The plan to use.
+   */
+  void SetRegionalPlan (Ptr<const LoraRegionalPlan> plan);
+
+  /**
+   * Get the regional plan this helper is sharing.
+   *
+   * \return The plan, or 0 if the channels and SubBands belong to this helper.
+   */
+  Ptr<const LoraRegionalPlan> GetRegionalPlan (void) const;
+
+  /**
+   * Add copies of the channels and SubBands of a regional plan, that belong
+   * to this helper.
+   *
+   * \param plan The plan to copy.
+   */
+  void CopyRegionalPlan (Ptr<const LoraRegionalPlan> plan);
+
 private:
+  /**
+   * Stop sharing the regional plan, if any, replacing it with copies of its
+   * channels and SubBands that carry the state of this helper.
+   */
+  void DetachRegionalPlan (void);
+
+  /**
+   * The regional plan whose channels and SubBands this helper uses, if any.
+   * If set, the lists below are empty.
+   */
+  Ptr<const LoraRegionalPlan> m_regionalPlan;
+
+  /**
+   * The next time a transmission is allowed in each SubBand of the regional
+   * plan.
+   */
+  std::vector<Time> m_nextTransmissionTimes;
+
+  /**
+   * The channels of the regional plan that are enabled for uplink, one bit
+   * per channel.
+   */
+  uint16_t m_channelMask;
+
   /**
    * A list of the SubBands that are currently registered within this helper.
    */
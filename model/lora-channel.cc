@@ -26,6 +26,7 @@
 #include "ns3/simulator.h"
 #include "ns3/end-device-lora-phy.h"
 #include "ns3/gateway-lora-phy.h"
+#include "ns3/lora-event-profiler.h"
 #include <algorithm>
 
 namespace ns3 {
@@ -118,6 +119,30 @@ LoraChannel::Send (Ptr< LoraPhy > sender, Ptr< Packet > packet,
 
   NS_ASSERT (senderMobility != 0);     // Make sure it's available
 
+  DoSend (sender, senderMobility, packet, txPowerDbm, txParams, duration,
+          frequencyMHz);
+}
+
+void
+LoraChannel::Send (Ptr<MobilityModel> senderMobility, Ptr<Packet> packet,
+                   double txPowerDbm, LoraTxParameters txParams,
+                   Time duration, double frequencyMHz) const
+{
+  NS_LOG_FUNCTION (this << senderMobility << packet << txPowerDbm <<
+                   txParams << duration << frequencyMHz);
+
+  NS_ASSERT (senderMobility != 0);
+
+  DoSend (0, senderMobility, packet, txPowerDbm, txParams, duration,
+          frequencyMHz);
+}
+
+void
+LoraChannel::DoSend (Ptr<LoraPhy> sender, Ptr<MobilityModel> senderMobility,
+                     Ptr<Packet> packet, double txPowerDbm,
+                     LoraTxParameters txParams, Time duration,
+                     double frequencyMHz) const
+{
   NS_LOG_INFO ("Starting cycle over all " << m_phyList.size () << " PHYs");
   NS_LOG_INFO ("Sender mobility: " << senderMobility->GetPosition ());
 
@@ -171,8 +196,9 @@ LoraChannel::Send (Ptr< LoraPhy > sender, Ptr< Packet > packet,
 
           // Schedule the receive event
           NS_LOG_INFO ("Scheduling reception of the packet");
-          Simulator::ScheduleWithContext (dstNode, delay, &LoraChannel::Receive,
-                                          this, j, packet, parameters);
+          LoraEventProfiler::ScheduleWithContext
+            (LoraEventProfiler::CHANNEL_RECEIVE, dstNode, delay,
+            &LoraChannel::Receive, this, j, packet, parameters);
 
           // Fire the trace source for sent packet
           m_packetSent (packet);
@@ -198,6 +224,12 @@ LoraChannel::GetRxPower (double txPowerDbm, Ptr<MobilityModel> senderMobility,
   return m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
 }
 
+Ptr<PropagationLossModel>
+LoraChannel::GetPropagationLossModel (void) const
+{
+  return m_loss;
+}
+
 std::ostream &operator << (std::ostream &os, const LoraChannelParameters &params)
 {
   os << "(rxPowerDbm: " << params.rxPowerDbm << ", SF: " << unsigned(params.sf) <<
@@ -138,6 +138,23 @@ public:
              LoraTxParameters txParams, Time duration, double frequencyMHz)
   const;
 
+  /**
+    * Send a packet in the channel on behalf of a transmitter that has no PHY.
+    *
+    * This is used by VirtualEndDevicePopulation, whose devices are not
+    * connected to the channel: every connected PHY is notified of the packet.
+    *
+    * \param senderMobility The position of the transmitter.
+    * \param packet The PHY layer packet that is being sent over the channel.
+    * \param txPowerDbm The power of the transmission.
+    * \param txParams The set of parameters that are used by the transmitter.
+    * \param duration The on-air duration of this packet.
+    * \param frequencyMHz The frequency this transmission will happen at.
+    */
+  void Send (Ptr<MobilityModel> senderMobility, Ptr<Packet> packet,
+             double txPowerDbm, LoraTxParameters txParams, Time duration,
+             double frequencyMHz) const;
+
   /**
     * Compute the received power when transmitting from a point to another one.
     *
@@ -153,7 +170,25 @@ public:
   double GetRxPower (double txPowerDbm, Ptr<MobilityModel> senderMobility,
                      Ptr<MobilityModel> receiverMobility) const;
 
+  /**
+    * Get the PropagationLossModel this channel computes receive powers with.
+    *
+    * \return The head of the propagation loss chain.
+    */
+  Ptr<PropagationLossModel> GetPropagationLossModel (void) const;
+
 private:
+  /**
+    * Deliver a transmission to every connected PHY but the sender.
+    *
+    * \param sender The sending PHY, or 0 if the transmitter has none.
+    * \param senderMobility The mobility model of the transmitter.
+    */
+  void DoSend (Ptr<LoraPhy> sender, Ptr<MobilityModel> senderMobility,
+               Ptr<Packet> packet, double txPowerDbm,
+               LoraTxParameters txParams, Time duration,
+               double frequencyMHz) const;
+
   /**
     * Private method that is scheduled by LoraChannel's Send method to happen
     * after the channel delay, for each of the connected PHY layers.
@@ -20,6 +20,7 @@
 
 #include "ns3/lora-device-address-generator.h"
 #include "ns3/log.h"
+#include <limits>
 
 namespace ns3 {
 namespace lorawan {
@@ -38,6 +39,7 @@ LoraDeviceAddressGenerator::GetTypeId (void)
 
 LoraDeviceAddressGenerator::LoraDeviceAddressGenerator (const uint8_t nwkId,
                                                         const uint32_t nwkAddr)
+  : m_nDevices (0)
 {
   NS_LOG_FUNCTION (this << unsigned(nwkId) << nwkAddr);
 
@@ -64,7 +66,18 @@ LoraDeviceAddressGenerator::NextAddress (void)
   NwkAddr oldNwkAddr = m_currentNwkAddr;
   m_currentNwkAddr.Set (m_currentNwkAddr.Get () + 1);
 
-  return LoraDeviceAddress (m_currentNwkId, oldNwkAddr);
+  // Extend the last run of addresses, or start a new one after a change of
+  // network
+  LoraDeviceAddress address (m_currentNwkId, oldNwkAddr);
+  if (m_segments.empty ()
+      || m_segments.back ().firstAddress + m_segments.back ().nAddresses != address.Get ())
+    {
+      m_segments.push_back ({address.Get (), m_nDevices, 0});
+    }
+  m_segments.back ().nAddresses++;
+  m_nDevices++;
+
+  return address;
 }
 
 LoraDeviceAddress
@@ -74,5 +87,26 @@ LoraDeviceAddressGenerator::GetNextAddress (void)
 
   return LoraDeviceAddress (m_currentNwkId.Get (), m_currentNwkAddr.Get () + 1);
 }
+
+uint32_t
+LoraDeviceAddressGenerator::GetDeviceIndex (LoraDeviceAddress address) const
+{
+  // There is one segment per network, unless addresses wrapped around
+  for (const auto &segment : m_segments)
+    {
+      uint32_t offset = address.Get () - segment.firstAddress;
+      if (offset < segment.nAddresses)
+        {
+          return segment.firstIndex + offset;
+        }
+    }
+  return std::numeric_limits<uint32_t>::max ();
+}
+
+uint32_t
+LoraDeviceAddressGenerator::GetNDevices (void) const
+{
+  return m_nDevices;
+}
 }
 }
@@ -23,12 +23,17 @@
 
 #include "ns3/lora-device-address.h"
 #include "ns3/object.h"
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
 
 /**
  * This class generates sequential LoraDeviceAddress instances.
+ *
+ * Each allocated address also gets a dense device index, counting the
+ * addresses allocated before it, that tables about the devices can use as an
+ * array index instead of looking the address up.
  */
 class LoraDeviceAddressGenerator : public Object
 {
@@ -80,9 +85,37 @@ public:
    */
   LoraDeviceAddress GetNextAddress (void);
 
+  /**
+   * Get the device index of an address allocated by NextAddress.
+   *
+   * \param address The address.
+   * \return The number of addresses allocated before this one, or
+   * std::numeric_limits<uint32_t>::max () if it wasn't allocated here.
+   */
+  uint32_t GetDeviceIndex (LoraDeviceAddress address) const;
+
+  /**
+   * Get the number of addresses allocated so far.
+   *
+   * \return The number of addresses, which bounds the device indexes.
+   */
+  uint32_t GetNDevices (void) const;
+
 private:
+  /**
+   * A run of consecutive addresses, allocated with consecutive indexes.
+   */
+  struct Segment
+  {
+    uint32_t firstAddress;   //!< The first address, in 32-bit form
+    uint32_t firstIndex;   //!< The device index of the first address
+    uint32_t nAddresses;   //!< The number of addresses
+  };
+
   NwkID m_currentNwkId; //!< The current Network Id value
   NwkAddr m_currentNwkAddr; //!< The current Network Address value
+  std::vector<Segment> m_segments; //!< The addresses allocated so far
+  uint32_t m_nDevices; //!< The number of addresses allocated so far
 };
 } //namespace ns3
 }
@@ -79,31 +79,28 @@ NwkAddr::Get (void) const
 ////////////////////
 
 LoraDeviceAddress::LoraDeviceAddress ()
+  : m_address (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
 
 LoraDeviceAddress::LoraDeviceAddress (uint32_t address)
+  : m_address (address)
 {
   NS_LOG_FUNCTION (this << address);
-
-  Set (address);
 }
 
 LoraDeviceAddress::LoraDeviceAddress (uint8_t nwkId, uint32_t nwkAddr)
 {
   NS_LOG_FUNCTION (this << unsigned(nwkId) << nwkAddr);
 
-  m_nwkId.Set (nwkId);
-  m_nwkAddr.Set (nwkAddr);
+  Set (nwkId, nwkAddr);
 }
 
 LoraDeviceAddress::LoraDeviceAddress (NwkID nwkId, NwkAddr nwkAddr)
+  : m_address (((uint32_t) (nwkId.Get () & 0x7F) << 25) | (nwkAddr.Get () & 0x1FFFFFF))
 {
   NS_LOG_FUNCTION (this << unsigned(nwkId.Get ()) << nwkAddr.Get ());
-
-  m_nwkId = nwkId;
-  m_nwkAddr = nwkAddr;
 }
 
 void
@@ -111,12 +108,10 @@ LoraDeviceAddress::Serialize (uint8_t buf[4]) const
 {
   NS_LOG_FUNCTION (this << &buf);
 
-  uint32_t address = Get ();
-
-  buf[0] = (address >> 24) & 0xff;
-  buf[1] = (address >> 16) & 0xff;
-  buf[2] = (address >> 8) & 0xff;
-  buf[3] = (address >> 0) & 0xff;
+  buf[0] = (m_address >> 24) & 0xff;
+  buf[1] = (m_address >> 16) & 0xff;
+  buf[2] = (m_address >> 8) & 0xff;
+  buf[3] = (m_address >> 0) & 0xff;
 }
 
 LoraDeviceAddress
@@ -125,16 +120,8 @@ LoraDeviceAddress::Deserialize (const uint8_t buf[4])
   NS_LOG_FUNCTION (&buf);
 
   // Craft the address from the buffer
-  uint32_t address = 0;
-  address |= buf[0];
-  address <<= 8;
-  address |= buf[1];
-  address <<= 8;
-  address |= buf[2];
-  address <<= 8;
-  address |= buf[3];
-
-  return LoraDeviceAddress (address);
+  return LoraDeviceAddress ((uint32_t (buf[0]) << 24) | (uint32_t (buf[1]) << 16) |
+                            (uint32_t (buf[2]) << 8) | buf[3]);
 }
 
 Address
@@ -171,42 +158,41 @@ LoraDeviceAddress::GetType (void)
   return type;
 }
 
-uint32_t
-LoraDeviceAddress::Get (void) const
+void
+LoraDeviceAddress::Set (uint32_t address)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  uint32_t address = 0;
-  uint32_t nwkId = uint32_t (m_nwkId.Get () << 25);
-  address |= (m_nwkAddr.Get () | nwkId);
-  NS_LOG_DEBUG ("m_nwkId + m_nwkAddr = " << std::bitset<32> (address));
-
-  return address;
+  m_address = address;
 }
 
 void
-LoraDeviceAddress::Set (uint32_t address)
+LoraDeviceAddress::Set (uint8_t nwkId, uint32_t nwkAddr)
 {
-  NS_LOG_FUNCTION_NOARGS ();
+  NS_LOG_FUNCTION (this << unsigned(nwkId) << nwkAddr);
 
-  m_nwkId.Set (address >> 25);     // Only leave the 7 most significant bits
-  m_nwkAddr.Set (address & 0x1FFFFFF);     // Only consider the 25 least significant bits
+  // NwkID and NwkAddr warn about the bits that don't fit
+  NwkID id;
+  id.Set (nwkId);
+  NwkAddr addr;
+  addr.Set (nwkAddr);
+  m_address = ((uint32_t) id.Get () << 25) | addr.Get ();
 }
 
 uint8_t
-LoraDeviceAddress::GetNwkID (void)
+LoraDeviceAddress::GetNwkID (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  return m_nwkId.Get ();
+  return m_address >> 25;
 }
 
 uint32_t
-LoraDeviceAddress::GetNwkAddr (void)
+LoraDeviceAddress::GetNwkAddr (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  return m_nwkAddr.Get ();
+  return m_address & 0x1FFFFFF;
 }
 
 void
@@ -214,7 +200,7 @@ LoraDeviceAddress::SetNwkID (uint8_t nwkId)
 {
   NS_LOG_FUNCTION (this << unsigned(nwkId));
 
-  m_nwkId.Set (nwkId);
+  Set (nwkId, m_address & 0x1FFFFFF);
 }
 
 void
@@ -222,7 +208,7 @@ LoraDeviceAddress::SetNwkAddr (uint32_t nwkAddr)
 {
   NS_LOG_FUNCTION (this << nwkAddr);
 
-  m_nwkAddr.Set (nwkAddr);
+  Set (m_address >> 25, nwkAddr);
 }
 
 std::string
@@ -231,36 +217,12 @@ LoraDeviceAddress::Print (void) const
   NS_LOG_FUNCTION_NOARGS ();
 
   std::string result;
-  result += std::bitset<7> (m_nwkId.Get ()).to_string ();
+  result += std::bitset<7> (m_address >> 25).to_string ();
   result += "|";
-  result += std::bitset<25> (m_nwkAddr.Get ()).to_string ();
+  result += std::bitset<25> (m_address & 0x1FFFFFF).to_string ();
   return result;
 }
 
-bool LoraDeviceAddress::operator==
-  (const LoraDeviceAddress &other) const
-{
-  return this->Get () == other.Get ();
-}
-
-bool LoraDeviceAddress::operator!=
-  (const LoraDeviceAddress &other) const
-{
-  return this->Get () != other.Get ();
-}
-
-bool LoraDeviceAddress::operator<
-  (const LoraDeviceAddress &other) const
-{
-  return this->Get () < other.Get ();
-}
-
-bool LoraDeviceAddress::operator>
-  (const LoraDeviceAddress &other) const
-{
-  return !(this->Get () < other.Get ());
-}
-
 std::ostream& operator<< (std::ostream& os, const LoraDeviceAddress &address)
 {
   os << address.Print ();
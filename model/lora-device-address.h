@@ -22,6 +22,7 @@
 #define LORA_DEVICE_ADDRESS_H
 
 #include "ns3/address.h"
+#include <functional>
 #include <string>
 
 namespace ns3 {
@@ -90,6 +91,10 @@ private:
 
 /**
  * This class represents the device address of a LoraWAN End Device.
+ *
+ * The address is stored in its 32-bit form, the NwkID in the 7 most
+ * significant bits and the NwkAddr in the others, so that it can be copied,
+ * compared and hashed (see std::hash<LoraDeviceAddress>) as an integer.
  */
 class LoraDeviceAddress
 {
@@ -154,7 +159,7 @@ public:
    *
    * \return An 8-bit representation of the Network Id of this Device Address.
    */
-  uint8_t GetNwkID (void);
+  uint8_t GetNwkID (void) const;
 
   /**
    * Set the NwkID of this device.
@@ -174,7 +179,7 @@ public:
    *
    * \return A 32-bit representation of the Network Address of this Device Address.
    */
-  uint32_t GetNwkAddr (void);
+  uint32_t GetNwkAddr (void) const;
 
   /**
    * Set the NwkAddr of this device.
@@ -204,10 +209,40 @@ private:
    */
   Address ConvertTo (void) const;
   static uint8_t GetType (void);
-  NwkID m_nwkId;   //!< The network Id of this address
-  NwkAddr m_nwkAddr;   //!< The network address of this address
+  uint32_t m_address;   //!< The NwkID and NwkAddr of this address, packed
 };
 
+// Defined here, since addresses are compared and hashed on every lookup
+inline uint32_t
+LoraDeviceAddress::Get (void) const
+{
+  return m_address;
+}
+
+inline bool
+LoraDeviceAddress::operator== (const LoraDeviceAddress &other) const
+{
+  return m_address == other.m_address;
+}
+
+inline bool
+LoraDeviceAddress::operator!= (const LoraDeviceAddress &other) const
+{
+  return m_address != other.m_address;
+}
+
+inline bool
+LoraDeviceAddress::operator< (const LoraDeviceAddress &other) const
+{
+  return m_address < other.m_address;
+}
+
+inline bool
+LoraDeviceAddress::operator> (const LoraDeviceAddress &other) const
+{
+  return m_address > other.m_address;
+}
+
 /**
  * Operator overload to correctly handle logging when an address is passed as
  * an argument.
@@ -215,5 +250,22 @@ private:
 std::ostream& operator<< (std::ostream& os, const LoraDeviceAddress &address);
 
 }
+}
+
+namespace std {
+
+/**
+ * Hash a LoraDeviceAddress through its 32-bit form, to use it as key of
+ * unordered containers.
+ */
+template <>
+struct hash<ns3::lorawan::LoraDeviceAddress>
+{
+  size_t operator() (const ns3::lorawan::LoraDeviceAddress &address) const
+  {
+    return hash<uint32_t> () (address.Get ());
+  }
+};
+
 }
 #endif
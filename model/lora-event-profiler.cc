@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lora-event-profiler.h"
+#include "ns3/log.h"
+#include <chrono>
+#include <iostream>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LoraEventProfiler");
+
+bool LoraEventProfiler::m_enabled = false;
+bool LoraEventProfiler::m_reportScheduled = false;
+std::array<LoraEventProfiler::Stats, LoraEventProfiler::N_CATEGORIES>
+LoraEventProfiler::m_stats;
+
+static const char *g_categoryNames[LoraEventProfiler::N_CATEGORIES] = {
+  "LoraChannel::Receive",
+  "LoraPhy::EndReceive",
+  "LoraPhy::TxFinished",
+  "EndDeviceLorawanMac::DoSend",
+  "ClassAEndDeviceLorawanMac::OpenReceiveWindow",
+  "ClassAEndDeviceLorawanMac::CloseReceiveWindow",
+  "Application::SendPacket",
+  "NetworkServer::EndDeduplicationWindow",
+  "NetworkScheduler::OnReceiveWindowOpportunity",
+  "VirtualEndDevicePopulation::Process",
+  "TrafficGenerator::ProcessBatch"
+};
+
+/**
+ * An event that measures the execution of another one.
+ */
+class ProfiledEvent : public EventImpl
+{
+public:
+  ProfiledEvent (LoraEventProfiler::Stats &stats, EventImpl *event) :
+    m_stats (stats),
+    m_event (event, false)
+  {
+  }
+
+protected:
+  virtual void Notify (void)
+  {
+    auto start = std::chrono::steady_clock::now ();
+    m_event->Invoke ();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+
+    m_stats.executed++;
+    m_stats.wallTime += elapsed.count ();
+  }
+
+private:
+  LoraEventProfiler::Stats &m_stats;   //!< The counters of the category
+  Ptr<EventImpl> m_event;   //!< The measured event
+};
+
+void
+LoraEventProfiler::Enable (bool enable)
+{
+  NS_LOG_FUNCTION (enable);
+
+  m_enabled = enable;
+
+  if (m_enabled && !m_reportScheduled)
+    {
+      Simulator::ScheduleDestroy (&LoraEventProfiler::DoPrintReport);
+      m_reportScheduled = true;
+    }
+}
+
+bool
+LoraEventProfiler::IsEnabled (void)
+{
+  return m_enabled;
+}
+
+void
+LoraEventProfiler::Reset (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  m_stats.fill (Stats ());
+}
+
+const LoraEventProfiler::Stats &
+LoraEventProfiler::GetStats (Category category)
+{
+  NS_ASSERT (category < N_CATEGORIES);
+
+  return m_stats[category];
+}
+
+const char *
+LoraEventProfiler::GetName (Category category)
+{
+  NS_ASSERT (category < N_CATEGORIES);
+
+  return g_categoryNames[category];
+}
+
+void
+LoraEventProfiler::PrintReport (std::ostream &os)
+{
+  double totalTime = 0;
+  for (auto &stats : m_stats)
+    {
+      totalTime += stats.wallTime;
+    }
+
+  os << "Lorawan event profile:" << std::endl;
+  for (uint32_t i = 0; i < N_CATEGORIES; i++)
+    {
+      const Stats &stats = m_stats[i];
+      os << "  " << g_categoryNames[i] << ": "
+         << stats.scheduled << " scheduled, "
+         << stats.executed << " executed, "
+         << stats.wallTime << " s";
+      if (stats.executed)
+        {
+          os << " (" << stats.wallTime / stats.executed * 1e6 << " us/event";
+          if (totalTime > 0)
+            {
+              os << ", " << 100 * stats.wallTime / totalTime << "%";
+            }
+          os << ")";
+        }
+      os << std::endl;
+    }
+}
+
+EventImpl *
+LoraEventProfiler::Wrap (Category category, EventImpl *event)
+{
+  if (!m_enabled)
+    {
+      return event;
+    }
+
+  NS_ASSERT (category < N_CATEGORIES);
+
+  m_stats[category].scheduled++;
+  return new ProfiledEvent (m_stats[category], event);
+}
+
+void
+LoraEventProfiler::DoPrintReport (void)
+{
+  m_reportScheduled = false;
+
+  if (m_enabled)
+    {
+      PrintReport (std::cout);
+    }
+}
+
+}
+}
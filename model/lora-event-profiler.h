@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORA_EVENT_PROFILER_H
+#define LORA_EVENT_PROFILER_H
+
+#include "ns3/simulator.h"
+#include "ns3/make-event.h"
+#include "ns3/event-impl.h"
+#include "ns3/nstime.h"
+
+#include <array>
+#include <ostream>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Measures where the wall clock time of a simulation goes, by category of
+ * event.
+ *
+ * The classes of this module schedule their events through the Schedule
+ * methods of this class, which tag each event with a category. While
+ * profiling is disabled the events are scheduled as usual; once enabled, the
+ * scheduled and executed events of each category are counted, and the time
+ * spent in their handlers is measured. A report is printed at
+ * Simulator::Destroy.
+ */
+class LoraEventProfiler
+{
+public:
+  /**
+   * The categories of events of this module.
+   */
+  enum Category
+  {
+    CHANNEL_RECEIVE,   //!< LoraChannel::Receive, one per receiver
+    PHY_END_RECEIVE,   //!< LoraPhy::EndReceive
+    PHY_TX_FINISHED,   //!< End of a transmission at the PHY
+    MAC_SEND,   //!< Postponed transmissions at the end device MAC
+    MAC_OPEN_RECEIVE_WINDOW,   //!< Opening of a receive window
+    MAC_CLOSE_RECEIVE_WINDOW,   //!< Closing of a receive window
+    APP_SEND,   //!< Packet generation by the applications
+    SERVER_DEDUPLICATION,   //!< End of a deduplication window
+    SERVER_SCHEDULING,   //!< Receive window opportunities of the scheduler
+    POPULATION_SEND,   //!< Transmissions of a VirtualEndDevicePopulation
+    APP_BATCH,   //!< Batches of packets of a TrafficGenerator
+    N_CATEGORIES
+  };
+
+  /**
+   * The counters of a category.
+   */
+  struct Stats
+  {
+    uint64_t scheduled = 0;   //!< Events scheduled
+    uint64_t executed = 0;   //!< Events executed
+    double wallTime = 0;   //!< Wall clock seconds spent in the handlers
+  };
+
+  /**
+   * Enable (true) or disable (false) profiling. Only events scheduled while
+   * profiling is enabled are measured.
+   */
+  static void Enable (bool enable);
+
+  /**
+   * Whether profiling is enabled.
+   */
+  static bool IsEnabled (void);
+
+  /**
+   * Reset the counters of all categories.
+   */
+  static void Reset (void);
+
+  /**
+   * Get the counters of a category.
+   */
+  static const Stats &GetStats (Category category);
+
+  /**
+   * Get the name of a category.
+   */
+  static const char *GetName (Category category);
+
+  /**
+   * Print a report of all categories.
+   */
+  static void PrintReport (std::ostream &os);
+
+  /**
+   * Schedule an event, like Simulator::Schedule.
+   *
+   * \param category The category of the event.
+   */
+  template <typename MEM, typename OBJ, typename... Ts>
+  static EventId Schedule (Category category, const Time &delay,
+                           MEM mem_ptr, OBJ obj, Ts... args)
+  {
+    return Simulator::Schedule (delay, Ptr<EventImpl>
+                                  (Wrap (category,
+                                         MakeEvent (mem_ptr, obj, args...)),
+                                  false));
+  }
+
+  /**
+   * Schedule an event in a given context, like
+   * Simulator::ScheduleWithContext.
+   *
+   * \param category The category of the event.
+   */
+  template <typename MEM, typename OBJ, typename... Ts>
+  static void ScheduleWithContext (Category category, uint32_t context,
+                                   const Time &delay, MEM mem_ptr, OBJ obj,
+                                   Ts... args)
+  {
+    Simulator::ScheduleWithContext (context, delay,
+                                    Wrap (category,
+                                          MakeEvent (mem_ptr, obj, args...)));
+  }
+
+private:
+  /**
+   * Wrap an event so that its execution is measured, if profiling is
+   * enabled.
+   *
+   * \return The event to schedule, with a reference the caller owns.
+   */
+  static EventImpl *Wrap (Category category, EventImpl *event);
+
+  /**
+   * Print the report on the standard output, at Simulator::Destroy.
+   */
+  static void DoPrintReport (void);
+
+  static bool m_enabled;   //!< Whether profiling is enabled
+  static bool m_reportScheduled;   //!< Whether the report was scheduled
+  static std::array<Stats, N_CATEGORIES> m_stats;   //!< Counters per category
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* LORA_EVENT_PROFILER_H */
@@ -436,7 +436,7 @@ LoraFrameHeader::GetFOptsLen (void) const
 {
   // Sum the serialized lenght of all commands in the list
   uint8_t fOptsLen = 0;
-  std::list< Ptr< MacCommand> >::const_iterator it;
+  std::vector< Ptr< MacCommand> >::const_iterator it;
   for (it = m_macCommands.begin (); it != m_macCommands.end (); it++)
     {
       fOptsLen = fOptsLen + (*it)->GetSerializedSize ();
@@ -593,8 +593,8 @@ LoraFrameHeader::AddNewChannelReq (uint8_t chIndex, double frequency,
   m_fOptsLen += command->GetSerializedSize ();
 }
 
-std::list<Ptr<MacCommand> >
-LoraFrameHeader::GetCommands (void)
+const std::vector<Ptr<MacCommand> > &
+LoraFrameHeader::GetCommands (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
 
@@ -610,5 +610,21 @@ LoraFrameHeader::AddCommand (Ptr<MacCommand> macCommand)
   m_fOptsLen += macCommand->GetSerializedSize ();
 }
 
+void
+LoraFrameHeader::Reset (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  m_fPort = 0;
+  m_address = LoraDeviceAddress (0,0);
+  m_adr = 0;
+  m_adrAckReq = 0;
+  m_ack = 0;
+  m_fPending = 0;
+  m_fOptsLen = 0;
+  m_fCnt = 0;
+  m_macCommands.clear ();
+}
+
 }
 }
@@ -24,6 +24,8 @@
 #include "ns3/header.h"
 #include "ns3/lora-device-address.h"
 #include "ns3/mac-command.h"
+#include <list>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -286,15 +288,24 @@ public:
                          uint8_t maxDataRate);
 
   /**
-   * Return a list of pointers to all the MAC commands saved in this header.
+   * Return the pointers to all the MAC commands saved in this header.
+   *
+   * The reference is valid as long as the header is, and until commands are
+   * added or the header is reset.
    */
-  std::list<Ptr<MacCommand> > GetCommands (void);
+  const std::vector<Ptr<MacCommand> > &GetCommands (void) const;
 
   /**
    * Add a predefined command to the list.
    */
   void AddCommand (Ptr<MacCommand> macCommand);
 
+  /**
+   * Bring all fields back to their default values and remove all MAC
+   * commands, keeping the storage of the command list for reuse.
+   */
+  void Reset (void);
+
 private:
   uint8_t m_fPort;
 
@@ -314,7 +325,7 @@ private:
    * List containing all the MacCommand instances that are contained in this
    * LoraFrameHeader.
    */
-  std::list< Ptr< MacCommand> > m_macCommands;
+  std::vector< Ptr< MacCommand> > m_macCommands;
 
   bool m_isUplink;
 };
@@ -325,7 +336,7 @@ Ptr<T>
 LoraFrameHeader::GetMacCommand ()
 {
   // Iterate on MAC commands and try casting
-  std::list< Ptr< MacCommand> >::const_iterator it;
+  std::vector< Ptr< MacCommand> >::const_iterator it;
   for (it = m_macCommands.begin (); it != m_macCommands.end (); ++it)
     {
       if ((*it)->GetObject<T> () != 0)
@@ -180,10 +180,15 @@ LoraInterferenceHelper::GetTypeId (void)
 LoraInterferenceHelper::~LoraInterferenceHelper ()
 {
   NS_LOG_FUNCTION (this);
+
+  m_activeEvents -= m_events.size ();
 }
 
 Time LoraInterferenceHelper::oldEventThreshold = Seconds (2);
 
+uint64_t LoraInterferenceHelper::m_activeEvents = 0;
+uint64_t LoraInterferenceHelper::m_totalEvents = 0;
+
 Ptr<LoraInterferenceHelper::Event>
 LoraInterferenceHelper::Add (Time duration, double rxPower, uint8_t spreadingFactor,
                              Ptr<Packet> packet, double frequencyMHz)
@@ -198,6 +203,8 @@ LoraInterferenceHelper::Add (Time duration, double rxPower, uint8_t spreadingFac
 
   // Add the event to the list
   m_events.push_back (event);
+  m_activeEvents++;
+  m_totalEvents++;
 
   // Clean the event list
   if (m_events.size () > 100)
@@ -219,6 +226,7 @@ LoraInterferenceHelper::CleanOldEvents (void)
       if ((*it)->GetEndTime () + oldEventThreshold < Simulator::Now ())
         {
           it = m_events.erase (it);
+          m_activeEvents--;
         }
       else
         {
@@ -227,6 +235,18 @@ LoraInterferenceHelper::CleanOldEvents (void)
     }
 }
 
+uint64_t
+LoraInterferenceHelper::GetActiveEventCount (void)
+{
+  return m_activeEvents;
+}
+
+uint64_t
+LoraInterferenceHelper::GetTotalEventCount (void)
+{
+  return m_totalEvents;
+}
+
 std::list<Ptr<LoraInterferenceHelper::Event>>
 LoraInterferenceHelper::GetInterferers ()
 {
@@ -365,6 +385,7 @@ LoraInterferenceHelper::ClearAllEvents (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  m_activeEvents -= m_events.size ();
   m_events.clear ();
 }
 
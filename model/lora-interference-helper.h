@@ -196,6 +196,18 @@ public:
    */
   void CleanOldEvents (void);
 
+  /**
+   * Get the number of events currently kept by all LoraInterferenceHelper
+   * instances.
+   */
+  static uint64_t GetActiveEventCount (void);
+
+  /**
+   * Get the number of events added to all LoraInterferenceHelper instances
+   * since the start of the program.
+   */
+  static uint64_t GetTotalEventCount (void);
+
   static CollisionMatrix collisionMatrix;
 
   static std::vector<std::vector<double>> collisionSnirAloha;
@@ -219,6 +231,9 @@ private:
    * list.
    */
   static Time oldEventThreshold;
+
+  static uint64_t m_activeEvents;   //!< Events kept, across all instances
+  static uint64_t m_totalEvents;   //!< Events added, across all instances
 };
 
 /**
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lora-regional-plan.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LoraRegionalPlan");
+
+LoraRegionalPlan::LoraRegionalPlan ()
+{
+  NS_LOG_FUNCTION (this);
+
+  for (auto &row : m_replyDataRateMatrix)
+    {
+      row.fill (0);
+    }
+}
+
+void
+LoraRegionalPlan::AddSubBand (double firstFrequency, double lastFrequency,
+                              double dutyCycle, double maxTxPowerDbm)
+{
+  NS_LOG_FUNCTION (this << firstFrequency << lastFrequency << dutyCycle <<
+                   maxTxPowerDbm);
+
+  m_subBands.push_back (CreateObject<SubBand> (firstFrequency, lastFrequency,
+                                               dutyCycle, maxTxPowerDbm));
+}
+
+void
+LoraRegionalPlan::AddChannel (double frequency, uint8_t minDataRate,
+                              uint8_t maxDataRate)
+{
+  NS_LOG_FUNCTION (this << frequency << unsigned (minDataRate) <<
+                   unsigned (maxDataRate));
+
+  // The channel mask of a device has 16 bits
+  NS_ABORT_MSG_IF (m_channels.size () >= 16,
+                   "A regional plan can't have more than 16 channels");
+
+  m_channels.push_back (CreateObject<LogicalLoraChannel> (frequency,
+                                                          minDataRate,
+                                                          maxDataRate));
+}
+
+const std::vector<Ptr<SubBand> > &
+LoraRegionalPlan::GetSubBands (void) const
+{
+  return m_subBands;
+}
+
+const std::vector<Ptr<LogicalLoraChannel> > &
+LoraRegionalPlan::GetChannels (void) const
+{
+  return m_channels;
+}
+
+uint32_t
+LoraRegionalPlan::GetSubBandIndex (double frequency) const
+{
+  for (uint32_t i = 0; i < m_subBands.size (); i++)
+    {
+      if (m_subBands[i]->BelongsToSubBand (frequency))
+        {
+          return i;
+        }
+    }
+
+  NS_LOG_ERROR ("Requested frequency: " << frequency);
+  NS_ABORT_MSG ("Warning: frequency is outside any known SubBand.");
+
+  return 0;
+}
+
+void
+LoraRegionalPlan::SetSfForDataRate (std::vector<uint8_t> sfForDataRate)
+{
+  m_sfForDataRate = sfForDataRate;
+}
+
+void
+LoraRegionalPlan::SetBandwidthForDataRate (std::vector<double> bandwidthForDataRate)
+{
+  m_bandwidthForDataRate = bandwidthForDataRate;
+}
+
+void
+LoraRegionalPlan::SetMaxAppPayloadForDataRate (std::vector<uint32_t> maxAppPayloadForDataRate)
+{
+  m_maxAppPayloadForDataRate = maxAppPayloadForDataRate;
+}
+
+void
+LoraRegionalPlan::SetTxDbmForTxPower (std::vector<double> txDbmForTxPower)
+{
+  m_txDbmForTxPower = txDbmForTxPower;
+}
+
+void
+LoraRegionalPlan::SetReplyDataRateMatrix (ReplyDataRateMatrix replyDataRateMatrix)
+{
+  m_replyDataRateMatrix = replyDataRateMatrix;
+}
+
+uint8_t
+LoraRegionalPlan::GetSfForDataRate (uint8_t dataRate) const
+{
+  if (dataRate >= m_sfForDataRate.size ())
+    {
+      return 0;
+    }
+
+  return m_sfForDataRate[dataRate];
+}
+
+double
+LoraRegionalPlan::GetBandwidthForDataRate (uint8_t dataRate) const
+{
+  if (dataRate >= m_bandwidthForDataRate.size ())
+    {
+      return 0;
+    }
+
+  return m_bandwidthForDataRate[dataRate];
+}
+
+uint32_t
+LoraRegionalPlan::GetMaxAppPayloadForDataRate (uint8_t dataRate) const
+{
+  if (dataRate >= m_maxAppPayloadForDataRate.size ())
+    {
+      return 0;
+    }
+
+  return m_maxAppPayloadForDataRate[dataRate];
+}
+
+double
+LoraRegionalPlan::GetTxDbmForTxPower (uint8_t txPower) const
+{
+  if (txPower >= m_txDbmForTxPower.size ())
+    {
+      return 0;
+    }
+
+  return m_txDbmForTxPower[txPower];
+}
+
+uint8_t
+LoraRegionalPlan::GetReplyDataRate (uint8_t dataRate, uint8_t rx1DrOffset) const
+{
+  return m_replyDataRateMatrix.at (dataRate).at (rx1DrOffset);
+}
+
+}
+}
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORA_REGIONAL_PLAN_H
+#define LORA_REGIONAL_PLAN_H
+
+#include "ns3/simple-ref-count.h"
+#include "ns3/logical-lora-channel.h"
+#include "ns3/sub-band.h"
+#include <array>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * The parameters of a region, as configured by LorawanMacHelper: its
+ * SubBands, its default channels and the tables that convert data rates and
+ * transmission power values.
+ *
+ * A plan is meant to be shared, unmodified, by all the MACs of the devices
+ * of a region, which only keep their own duty cycle clocks and channel mask
+ * (see LogicalLoraChannelHelper::SetRegionalPlan). To change the parameters
+ * of a single device, modify a copy of its plan.
+ *
+ * The SubBands and channels of a plan only describe the region: the next
+ * transmission time of the SubBands and the uplink flag of the channels are
+ * not used.
+ */
+class LoraRegionalPlan : public SimpleRefCount<LoraRegionalPlan>
+{
+public:
+  typedef std::array<std::array<uint8_t, 6>, 8> ReplyDataRateMatrix;
+
+  LoraRegionalPlan ();
+
+  /**
+   * Add a SubBand to the plan.
+   *
+   * \param firstFrequency The first frequency of the SubBand, in MHz.
+   * \param lastFrequency The last frequency of the SubBand, in MHz.
+   * \param dutyCycle The duty cycle that needs to be enforced on the SubBand.
+   * \param maxTxPowerDbm The maximum transmission power [dBm] that can be
+   * used on the SubBand.
+   */
+  void AddSubBand (double firstFrequency, double lastFrequency,
+                   double dutyCycle, double maxTxPowerDbm);
+
+  /**
+   * Add a default channel to the plan.
+   *
+   * \param frequency The center frequency of the channel, in MHz.
+   * \param minDataRate The minimum data rate allowed on the channel.
+   * \param maxDataRate The maximum data rate allowed on the channel.
+   */
+  void AddChannel (double frequency, uint8_t minDataRate,
+                   uint8_t maxDataRate);
+
+  /**
+   * Get the SubBands of the plan.
+   */
+  const std::vector<Ptr<SubBand> > &GetSubBands (void) const;
+
+  /**
+   * Get the default channels of the plan.
+   */
+  const std::vector<Ptr<LogicalLoraChannel> > &GetChannels (void) const;
+
+  /**
+   * Get the index, in GetSubBands (), of the SubBand a frequency belongs to.
+   *
+   * \param frequency The frequency we want to check.
+   * \return The index of the SubBand the frequency belongs to.
+   */
+  uint32_t GetSubBandIndex (double frequency) const;
+
+  /**
+   * Set the vector to use to check up correspondence between SF and DataRate.
+   */
+  void SetSfForDataRate (std::vector<uint8_t> sfForDataRate);
+
+  /**
+   * Set the vector to use to check up correspondence between bandwidth and
+   * DataRate.
+   */
+  void SetBandwidthForDataRate (std::vector<double> bandwidthForDataRate);
+
+  /**
+   * Set the maximum App layer payload for each DataRate.
+   */
+  void SetMaxAppPayloadForDataRate (std::vector<uint32_t>
+                                    maxAppPayloadForDataRate);
+
+  /**
+   * Set the vector to use to check up which transmission power in dBm
+   * corresponds to a certain TxPower value.
+   */
+  void SetTxDbmForTxPower (std::vector<double> txDbmForTxPower);
+
+  /**
+   * Set the matrix to use when deciding with which DataRate to respond.
+   */
+  void SetReplyDataRateMatrix (ReplyDataRateMatrix replyDataRateMatrix);
+
+  /**
+   * Get the SF corresponding to a data rate.
+   *
+   * \return The SF, or 0 if the dataRate is not valid.
+   */
+  uint8_t GetSfForDataRate (uint8_t dataRate) const;
+
+  /**
+   * Get the bandwidth corresponding to a data rate.
+   *
+   * \return The bandwidth, or 0 if the dataRate is not valid.
+   */
+  double GetBandwidthForDataRate (uint8_t dataRate) const;
+
+  /**
+   * Get the maximum App layer payload for a data rate.
+   *
+   * \return The payload, or 0 if the dataRate is not valid.
+   */
+  uint32_t GetMaxAppPayloadForDataRate (uint8_t dataRate) const;
+
+  /**
+   * Get the transmission power in dBm that corresponds to an encoded
+   * txPower.
+   *
+   * \return The power, or 0 if txPower is not valid.
+   */
+  double GetTxDbmForTxPower (uint8_t txPower) const;
+
+  /**
+   * Get the DataRate a gateway replies with, given the sending DataRate and
+   * the RX1DROffset.
+   */
+  uint8_t GetReplyDataRate (uint8_t dataRate, uint8_t rx1DrOffset) const;
+
+private:
+  std::vector<Ptr<SubBand> > m_subBands;   //!< The SubBands of the region
+  std::vector<Ptr<LogicalLoraChannel> > m_channels;   //!< The default channels
+  std::vector<uint8_t> m_sfForDataRate;   //!< The SF of each DataRate
+  std::vector<double> m_bandwidthForDataRate;   //!< The bandwidth of each DataRate
+  std::vector<uint32_t> m_maxAppPayloadForDataRate;   //!< The maximum App payload of each DataRate
+  std::vector<double> m_txDbmForTxPower;   //!< The power of each TxPower value
+  ReplyDataRateMatrix m_replyDataRateMatrix;   //!< The reply DataRates
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* LORA_REGIONAL_PLAN_H */
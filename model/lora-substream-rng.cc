@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lora-substream-rng.h"
+#include "ns3/global-value.h"
+#include "ns3/boolean.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/log.h"
+#include <cmath>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LoraSubstreamRng");
+
+static GlobalValue g_loraDeviceSubstreams =
+  GlobalValue ("LoraDeviceSubstreams",
+               "Draw the random values of the setup of LoRaWAN devices from "
+               "per-device substreams, which don't depend on the setup order",
+               BooleanValue (false),
+               MakeBooleanChecker ());
+
+LoraSubstreamRng::LoraSubstreamRng (uint64_t key, uint64_t index,
+                                    uint32_t subIndex)
+  : m_key (key),
+  m_index (index),
+  m_subIndex (subIndex),
+  m_counter (0)
+{
+}
+
+void
+LoraSubstreamRng::NextBlock (uint32_t block[4])
+{
+  // Philox4x32-10, from Salmon et al., "Parallel Random Numbers: As Easy as
+  // 1, 2, 3", SC 2011
+  uint32_t c[4] = {(uint32_t) m_index, (uint32_t) (m_index >> 32),
+                   m_subIndex, m_counter++};
+  uint32_t k0 = (uint32_t) m_key;
+  uint32_t k1 = (uint32_t) (m_key >> 32);
+
+  for (int round = 0; round < 10; round++)
+    {
+      uint64_t p0 = (uint64_t) 0xD2511F53 * c[0];
+      uint64_t p1 = (uint64_t) 0xCD9E8D57 * c[2];
+      uint32_t next[4] = {(uint32_t) (p1 >> 32) ^ c[1] ^ k0, (uint32_t) p1,
+                          (uint32_t) (p0 >> 32) ^ c[3] ^ k1, (uint32_t) p0};
+      c[0] = next[0];
+      c[1] = next[1];
+      c[2] = next[2];
+      c[3] = next[3];
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+
+  block[0] = c[0];
+  block[1] = c[1];
+  block[2] = c[2];
+  block[3] = c[3];
+}
+
+double
+LoraSubstreamRng::GetValue (void)
+{
+  uint32_t block[4];
+  NextBlock (block);
+
+  // 53 random bits, the precision of a double
+  uint64_t bits = ((uint64_t) block[0] << 21) ^ (block[1] >> 11);
+  return bits * (1.0 / 9007199254740992.0);
+}
+
+double
+LoraSubstreamRng::GetValue (double min, double max)
+{
+  return min + (max - min) * GetValue ();
+}
+
+uint32_t
+LoraSubstreamRng::GetInteger (uint32_t min, uint32_t max)
+{
+  NS_ASSERT (min <= max);
+  return min + (uint32_t) std::floor (GetValue () * ((double) max - min + 1));
+}
+
+double
+LoraSubstreamRng::GetNormal (double mean, double variance)
+{
+  uint32_t block[4];
+  NextBlock (block);
+
+  // Box-Muller transform, using both halves of the block
+  double u1 = (((uint64_t) block[0] << 21) ^ (block[1] >> 11)) * (1.0 / 9007199254740992.0);
+  double u2 = (((uint64_t) block[2] << 21) ^ (block[3] >> 11)) * (1.0 / 9007199254740992.0);
+  double z = std::sqrt (-2 * std::log (1 - u1)) * std::cos (2 * M_PI * u2);
+  return mean + z * std::sqrt (variance);
+}
+
+bool
+LoraSubstreamRng::IsEnabled (void)
+{
+  BooleanValue enabled;
+  g_loraDeviceSubstreams.GetValue (enabled);
+  return enabled.Get ();
+}
+
+uint64_t
+LoraSubstreamRng::GetKey (enum Purpose purpose)
+{
+  return Mix (Mix (Mix (RngSeedManager::GetSeed ()) + RngSeedManager::GetRun ()) + purpose);
+}
+
+uint64_t
+LoraSubstreamRng::GetPositionIndex (const Vector &position)
+{
+  uint64_t x = (uint64_t) std::llround (position.x * 100);
+  uint64_t y = (uint64_t) std::llround (position.y * 100);
+  uint64_t z = (uint64_t) std::llround (position.z * 100);
+  return Mix (Mix (Mix (x) + y) + z);
+}
+
+uint64_t
+LoraSubstreamRng::Mix (uint64_t value)
+{
+  // The finalizer of SplitMix64
+  value += 0x9E3779B97F4A7C15ull;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+  return value ^ (value >> 31);
+}
+
+}
+}
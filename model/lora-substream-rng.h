@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORA_SUBSTREAM_RNG_H
+#define LORA_SUBSTREAM_RNG_H
+
+#include "ns3/vector.h"
+#include <stdint.h>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * A counter-based random number generator, giving each device (or other
+ * entity of the setup) its own substream.
+ *
+ * The i-th value of a substream is the Philox4x32-10 block cipher applied to
+ * the counter (index, subIndex, i), under a key derived from the seed and run
+ * number of the simulation and the purpose of the substream. A value thus
+ * only depends on where it is drawn, and not on which values were drawn
+ * before it: the values of a device don't depend on the devices set up before
+ * it, and substreams can be drawn by several threads. Components that cache
+ * what they draw, like the loss models, are still not thread-safe.
+ *
+ * Components draw from substreams instead of their RandomVariableStream
+ * objects when the LoraDeviceSubstreams global value is true. They read it,
+ * and the seed and run number, when they are created, as RandomVariableStream
+ * objects do. In this mode they don't create RandomVariableStream objects, so
+ * that they don't shift the stream numbers of the rest of the simulation.
+ *
+ * Objects of this class are not shared: each thread creates its own from the
+ * key, which GetKey computes on the main thread.
+ */
+class LoraSubstreamRng
+{
+public:
+  /**
+   * The purpose of a substream, which selects an independent key.
+   */
+  enum Purpose
+  {
+    POSITION,           //!< Device positions, indexed by allocation order
+    SPREADING_FACTOR,   //!< Spreading factor assignment, indexed by node id
+    SHADOWING,          //!< Shadowing, indexed by grid square
+    BUILDING            //!< Building penetration, indexed by position
+  };
+
+  /**
+   * Create the substream of an entity.
+   *
+   * \param key The key of the purpose of the substream, as given by GetKey.
+   * \param index The index of the entity.
+   * \param subIndex The index of the substream among those of the entity.
+   */
+  LoraSubstreamRng (uint64_t key, uint64_t index, uint32_t subIndex = 0);
+
+  /**
+   * Get the next value, uniform in [0, 1).
+   */
+  double GetValue (void);
+
+  /**
+   * Get the next value, uniform in [min, max).
+   */
+  double GetValue (double min, double max);
+
+  /**
+   * Get the next value, uniform among the integers of [min, max].
+   */
+  uint32_t GetInteger (uint32_t min, uint32_t max);
+
+  /**
+   * Get the next value from a normal distribution.
+   */
+  double GetNormal (double mean, double variance);
+
+  /**
+   * Return whether components should draw from substreams, according to the
+   * LoraDeviceSubstreams global value.
+   */
+  static bool IsEnabled (void);
+
+  /**
+   * Get the key of the substreams of a purpose, for the current seed and run
+   * number.
+   */
+  static uint64_t GetKey (enum Purpose purpose);
+
+  /**
+   * Get an index identifying a position, to the centimeter.
+   */
+  static uint64_t GetPositionIndex (const Vector &position);
+
+  /**
+   * Mix the bits of a value, so that close values give unrelated results.
+   */
+  static uint64_t Mix (uint64_t value);
+
+private:
+  /**
+   * Compute the next block of 128 random bits.
+   */
+  void NextBlock (uint32_t block[4]);
+
+  uint64_t m_key;   //!< The key of the cipher
+  uint64_t m_index;   //!< The index of the entity
+  uint32_t m_subIndex;   //!< The index of the substream of the entity
+  uint32_t m_counter;   //!< The number of blocks drawn so far
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* LORA_SUBSTREAM_RNG_H */
@@ -20,6 +20,7 @@
 
 #include "ns3/lorawan-mac.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -104,18 +105,49 @@ LorawanMac::SetLogicalLoraChannelHelper (LogicalLoraChannelHelper helper)
   m_channelHelper = helper;
 }
 
+void
+LorawanMac::SetRegionalPlan (Ptr<const LoraRegionalPlan> plan)
+{
+  NS_LOG_FUNCTION (this << plan);
+
+  m_regionalPlan = plan;
+  m_channelHelper.SetRegionalPlan (plan);
+}
+
+Ptr<const LoraRegionalPlan>
+LorawanMac::GetRegionalPlan (void) const
+{
+  return m_regionalPlan;
+}
+
+Ptr<LoraRegionalPlan>
+LorawanMac::GetModifiableRegionalPlan (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<LoraRegionalPlan> plan;
+  if (m_regionalPlan)
+    {
+      plan = Create<LoraRegionalPlan> (*m_regionalPlan);
+    }
+  else
+    {
+      plan = Create<LoraRegionalPlan> ();
+    }
+  m_regionalPlan = plan;
+
+  return plan;
+}
+
 uint8_t
 LorawanMac::GetSfFromDataRate (uint8_t dataRate)
 {
   NS_LOG_FUNCTION (this << unsigned(dataRate));
 
-  // Check we are in range
-  if (dataRate >= m_sfForDataRate.size ())
-    {
-      return 0;
-    }
+  NS_ABORT_MSG_IF (!m_regionalPlan, "No regional plan to get the SF from: "
+                   "call SetRegionalPlan first");
 
-  return m_sfForDataRate.at (dataRate);
+  return m_regionalPlan->GetSfForDataRate (dataRate);
 }
 
 double
@@ -123,13 +155,10 @@ LorawanMac::GetBandwidthFromDataRate (uint8_t dataRate)
 {
   NS_LOG_FUNCTION (this << unsigned(dataRate));
 
-  // Check we are in range
-  if (dataRate > m_bandwidthForDataRate.size ())
-    {
-      return 0;
-    }
+  NS_ABORT_MSG_IF (!m_regionalPlan, "No regional plan to get the bandwidth "
+                   "from: call SetRegionalPlan first");
 
-  return m_bandwidthForDataRate.at (dataRate);
+  return m_regionalPlan->GetBandwidthForDataRate (dataRate);
 }
 
 double
@@ -137,36 +166,46 @@ LorawanMac::GetDbmForTxPower (uint8_t txPower)
 {
   NS_LOG_FUNCTION (this << unsigned (txPower));
 
-  if (txPower > m_txDbmForTxPower.size ())
-    {
-      return 0;
-    }
+  NS_ABORT_MSG_IF (!m_regionalPlan, "No regional plan to get the transmission "
+                   "power from: call SetRegionalPlan first");
+
+  return m_regionalPlan->GetTxDbmForTxPower (txPower);
+}
+
+uint32_t
+LorawanMac::GetMaxAppPayloadForDataRate (uint8_t dataRate)
+{
+  NS_LOG_FUNCTION (this << unsigned (dataRate));
+
+  // Returning 0 would silently drop every packet as oversized
+  NS_ABORT_MSG_IF (!m_regionalPlan, "No regional plan to get the maximum "
+                   "payload size from: call SetRegionalPlan first");
 
-  return m_txDbmForTxPower.at (txPower);
+  return m_regionalPlan->GetMaxAppPayloadForDataRate (dataRate);
 }
 
 void
 LorawanMac::SetSfForDataRate (std::vector<uint8_t> sfForDataRate)
 {
-  m_sfForDataRate = sfForDataRate;
+  GetModifiableRegionalPlan ()->SetSfForDataRate (sfForDataRate);
 }
 
 void
 LorawanMac::SetBandwidthForDataRate (std::vector<double> bandwidthForDataRate)
 {
-  m_bandwidthForDataRate = bandwidthForDataRate;
+  GetModifiableRegionalPlan ()->SetBandwidthForDataRate (bandwidthForDataRate);
 }
 
 void
 LorawanMac::SetMaxAppPayloadForDataRate (std::vector<uint32_t> maxAppPayloadForDataRate)
 {
-  m_maxAppPayloadForDataRate = maxAppPayloadForDataRate;
+  GetModifiableRegionalPlan ()->SetMaxAppPayloadForDataRate (maxAppPayloadForDataRate);
 }
 
 void
 LorawanMac::SetTxDbmForTxPower (std::vector<double> txDbmForTxPower)
 {
-  m_txDbmForTxPower = txDbmForTxPower;
+  GetModifiableRegionalPlan ()->SetTxDbmForTxPower (txDbmForTxPower);
 }
 
 void
@@ -184,7 +223,7 @@ LorawanMac::GetNPreambleSymbols (void)
 void
 LorawanMac::SetReplyDataRateMatrix (ReplyDataRateMatrix replyDataRateMatrix)
 {
-  m_replyDataRateMatrix = replyDataRateMatrix;
+  GetModifiableRegionalPlan ()->SetReplyDataRateMatrix (replyDataRateMatrix);
 }
 }
 }
@@ -23,6 +23,7 @@
 
 #include "ns3/object.h"
 #include "ns3/logical-lora-channel-helper.h"
+#include "ns3/lora-regional-plan.h"
 #include "ns3/packet.h"
 #include "ns3/lora-phy.h"
 #include <array>
@@ -47,7 +48,7 @@ public:
   LorawanMac ();
   virtual ~LorawanMac ();
 
-  typedef std::array<std::array<uint8_t, 6>, 8> ReplyDataRateMatrix;
+  typedef LoraRegionalPlan::ReplyDataRateMatrix ReplyDataRateMatrix;
 
   /**
    * Set the underlying PHY layer
@@ -120,6 +121,22 @@ public:
    */
   void SetLogicalLoraChannelHelper (LogicalLoraChannelHelper helper);
 
+  /**
+   * Use a regional plan, that may be shared with other MACs, both for the
+   * data rate and power conversions and for the channels and SubBands of the
+   * LogicalLoraChannelHelper.
+   *
+   * \param plan The plan to use.
+   */
+  void SetRegionalPlan (Ptr<const LoraRegionalPlan> plan);
+
+  /**
+   * Get the regional plan this MAC takes its conversions from.
+   *
+   * \return The plan, or 0 if none was set.
+   */
+  Ptr<const LoraRegionalPlan> GetRegionalPlan (void) const;
+
   /**
    * Get the SF corresponding to a data rate, based on this MAC's region.
    *
@@ -150,9 +167,21 @@ public:
    */
   double GetDbmForTxPower (uint8_t txPower);
 
+  /**
+   * Get the maximum App layer payload for a data rate, based on this MAC's
+   * region.
+   *
+   * \param dataRate The Data Rate.
+   * \return The maximum payload, or 0 if the dataRate is not valid.
+   */
+  uint32_t GetMaxAppPayloadForDataRate (uint8_t dataRate);
+
   /**
    * Set the vector to use to check up correspondence between SF and DataRate.
    *
+   * The setters of the conversions below change a copy of the regional plan
+   * of this MAC, which is no longer shared with other MACs.
+   *
    * \param sfForDataRate A vector that contains at position i the SF that
    * should correspond to DR i.
    */
@@ -211,6 +240,13 @@ public:
   int GetNPreambleSymbols (void);
 
 protected:
+  /**
+   * Replace the regional plan with a copy of its own, that can be changed.
+   *
+   * \return The copy.
+   */
+  Ptr<LoraRegionalPlan> GetModifiableRegionalPlan (void);
+
   /**
   * The trace source that is fired when a packet cannot be sent because of duty
   * cycle limitations.
@@ -246,36 +282,16 @@ protected:
   LogicalLoraChannelHelper m_channelHelper;
 
   /**
-   * A vector holding the SF each Data Rate corresponds to.
-   */
-  std::vector<uint8_t> m_sfForDataRate;
-
-  /**
-   * A vector holding the bandwidth each Data Rate corresponds to.
-   */
-  std::vector<double> m_bandwidthForDataRate;
-
-  /**
-   * A vector holding the maximum app payload size that corresponds to a
-   * certain DataRate.
+   * The regional plan holding the SF, bandwidth and maximum app payload each
+   * Data Rate corresponds to, the power each TxPower value corresponds to,
+   * and the matrix that decides the DR the GW will use in a reply.
    */
-  std::vector<uint32_t> m_maxAppPayloadForDataRate;
+  Ptr<const LoraRegionalPlan> m_regionalPlan;
 
   /**
    * The number of symbols to use in the PHY preamble.
    */
   int m_nPreambleSymbols;
-
-  /**
-   * A vector holding the power that corresponds to a certain TxPower value.
-   */
-  std::vector<double> m_txDbmForTxPower;
-
-  /**
-   * The matrix that decides the DR the GW will use in a reply based on the ED's
-   * sending DR and on the value of the RX1DROffset parameter.
-   */
-  ReplyDataRateMatrix m_replyDataRateMatrix;
 };
 
 } /* namespace ns3 */
@@ -19,6 +19,10 @@
  */
 
 #include "network-controller.h"
+#include "ns3/simulator.h"
+
+#include <chrono>
+#include <iostream>
 
 namespace ns3 {
 namespace lorawan {
@@ -32,17 +36,26 @@ NetworkController::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::NetworkController")
     .AddConstructor<NetworkController> ()
+    .AddTraceSource ("ComponentCall",
+                     "Trace source fired, while profiling is enabled, after "
+                     "each call to a NetworkControllerComponent",
+                     MakeTraceSourceAccessor (&NetworkController::m_componentCall),
+                     "ns3::NetworkController::ComponentCallTracedCallback")
     .SetGroupName ("lorawan");
   return tid;
 }
 
-NetworkController::NetworkController ()
+NetworkController::NetworkController () :
+  m_profiling (false),
+  m_reportScheduled (false)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
 
 NetworkController::NetworkController (Ptr<NetworkStatus> networkStatus) :
-  m_status (networkStatus)
+  m_status (networkStatus),
+  m_profiling (false),
+  m_reportScheduled (false)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -57,6 +70,10 @@ NetworkController::Install (Ptr<NetworkControllerComponent> component)
 {
   NS_LOG_FUNCTION (this);
   m_components.push_back (component);
+
+  ComponentCost cost;
+  cost.name = component->GetInstanceTypeId ().GetName ();
+  m_costs.push_back (cost);
 }
 
 void
@@ -68,12 +85,28 @@ NetworkController::OnNewPacket (Ptr<Packet const> packet)
   // callbacks and only be called in case a certain MAC command is contained.
   // For now, we call all components.
 
-  // Inform each component about the new packet
-  for (auto it = m_components.begin (); it != m_components.end (); ++it)
+  Ptr<EndDeviceStatus> endDeviceStatus = m_status->GetEndDeviceStatus (packet);
+
+  if (!m_profiling)
+    {
+      // Inform each component about the new packet
+      for (auto it = m_components.begin (); it != m_components.end (); ++it)
+        {
+          (*it)->OnReceivedPacket (packet, endDeviceStatus, m_status);
+        }
+      return;
+    }
+
+  auto cost = m_costs.begin ();
+  for (auto it = m_components.begin (); it != m_components.end (); ++it, ++cost)
     {
-      (*it)->OnReceivedPacket (packet,
-                               m_status->GetEndDeviceStatus (packet),
-                               m_status);
+      auto start = std::chrono::steady_clock::now ();
+      (*it)->OnReceivedPacket (packet, endDeviceStatus, m_status);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+
+      cost->receivedPacketCalls++;
+      cost->receivedPacketTime += elapsed.count ();
+      m_componentCall (cost->name, "OnReceivedPacket", elapsed.count ());
     }
 }
 
@@ -82,10 +115,76 @@ NetworkController::BeforeSendingReply (Ptr<EndDeviceStatus> endDeviceStatus)
 {
   NS_LOG_FUNCTION (this);
 
-  // Inform each component about the imminent reply
-  for (auto it = m_components.begin (); it != m_components.end (); ++it)
+  if (!m_profiling)
+    {
+      // Inform each component about the imminent reply
+      for (auto it = m_components.begin (); it != m_components.end (); ++it)
+        {
+          (*it)->BeforeSendingReply (endDeviceStatus, m_status);
+        }
+      return;
+    }
+
+  auto cost = m_costs.begin ();
+  for (auto it = m_components.begin (); it != m_components.end (); ++it, ++cost)
     {
+      auto start = std::chrono::steady_clock::now ();
       (*it)->BeforeSendingReply (endDeviceStatus, m_status);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+
+      cost->beforeSendingReplyCalls++;
+      cost->beforeSendingReplyTime += elapsed.count ();
+      m_componentCall (cost->name, "BeforeSendingReply", elapsed.count ());
+    }
+}
+
+void
+NetworkController::SetProfiling (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+
+  m_profiling = enable;
+
+  if (m_profiling && !m_reportScheduled)
+    {
+      Simulator::ScheduleDestroy (&NetworkController::DoPrintComponentCosts,
+                                  Ptr<NetworkController> (this));
+      m_reportScheduled = true;
+    }
+}
+
+bool
+NetworkController::GetProfiling (void) const
+{
+  return m_profiling;
+}
+
+std::vector<NetworkController::ComponentCost>
+NetworkController::GetComponentCosts (void) const
+{
+  return m_costs;
+}
+
+void
+NetworkController::PrintComponentCosts (std::ostream &os) const
+{
+  os << "NetworkController component costs:" << std::endl;
+  for (auto it = m_costs.begin (); it != m_costs.end (); ++it)
+    {
+      os << "  " << it->name
+         << " OnReceivedPacket: " << it->receivedPacketCalls << " calls, "
+         << it->receivedPacketTime << " s"
+         << "; BeforeSendingReply: " << it->beforeSendingReplyCalls << " calls, "
+         << it->beforeSendingReplyTime << " s" << std::endl;
+    }
+}
+
+void
+NetworkController::DoPrintComponentCosts (void)
+{
+  if (m_profiling)
+    {
+      PrintComponentCosts (std::cout);
     }
 }
 
@@ -25,6 +25,9 @@
 #include "ns3/packet.h"
 #include "ns3/network-status.h"
 #include "ns3/network-controller-components.h"
+#include "ns3/traced-callback.h"
+#include <string>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -64,9 +67,64 @@ public:
    */
   void BeforeSendingReply (Ptr<EndDeviceStatus> endDeviceStatus);
 
+  /**
+   * The cost of a NetworkControllerComponent, as measured while profiling is
+   * enabled.
+   */
+  struct ComponentCost
+  {
+    std::string name;   //!< The TypeId name of the component
+    uint64_t receivedPacketCalls = 0;   //!< Calls to OnReceivedPacket
+    double receivedPacketTime = 0;   //!< Wall clock seconds in OnReceivedPacket
+    uint64_t beforeSendingReplyCalls = 0;   //!< Calls to BeforeSendingReply
+    double beforeSendingReplyTime = 0;   //!< Wall clock seconds in BeforeSendingReply
+  };
+
+  /**
+   * TracedCallback signature for component calls.
+   *
+   * \param [in] component The TypeId name of the component.
+   * \param [in] method The name of the method that was called.
+   * \param [in] wallTime The wall clock seconds spent in the call.
+   */
+  typedef void (* ComponentCallTracedCallback)
+    (std::string component, std::string method, double wallTime);
+
+  /**
+   * Enable (true) or disable (false) the measurement of the cost of each
+   * component. When enabled, a report is printed at Simulator::Destroy.
+   */
+  void SetProfiling (bool enable);
+
+  /**
+   * Whether the cost of each component is being measured.
+   */
+  bool GetProfiling (void) const;
+
+  /**
+   * Get the cost of each installed component, in installation order.
+   */
+  std::vector<ComponentCost> GetComponentCosts (void) const;
+
+  /**
+   * Print a report of the cost of each installed component.
+   */
+  void PrintComponentCosts (std::ostream &os) const;
+
 private:
+  /**
+   * Print the component cost report on the standard output.
+   */
+  void DoPrintComponentCosts (void);
+
   Ptr<NetworkStatus> m_status;
   std::list<Ptr<NetworkControllerComponent> > m_components;
+
+  std::vector<ComponentCost> m_costs;   //!< Same order as m_components
+  bool m_profiling;   //!< Whether component costs are measured
+  bool m_reportScheduled;   //!< Whether the report was scheduled at Destroy
+
+  TracedCallback<std::string, std::string, double> m_componentCall;
 };
 
 } /* namespace ns3 */
@@ -1,4 +1,5 @@
 #include "network-scheduler.h"
+#include "ns3/lora-event-profiler.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -39,7 +40,13 @@ NetworkScheduler::~NetworkScheduler ()
 void
 NetworkScheduler::OnReceivedPacket (Ptr<const Packet> packet)
 {
-  NS_LOG_FUNCTION (packet);
+  OnReceivedPacket (packet, Simulator::Now ());
+}
+
+void
+NetworkScheduler::OnReceivedPacket (Ptr<const Packet> packet, Time receptionTime)
+{
+  NS_LOG_FUNCTION (packet << receptionTime);
 
   // Get the current packet's frame counter
   Ptr<Packet> packetCopy = packet->Copy ();
@@ -49,19 +56,27 @@ NetworkScheduler::OnReceivedPacket (Ptr<const Packet> packet)
   receivedFrameHdr.SetAsUplink ();
   packetCopy->RemoveHeader (receivedFrameHdr);
 
+  // Extract the address, and look the device up once, since the headers are
+  // already deserialized
+  LoraDeviceAddress deviceAddress = receivedFrameHdr.GetAddress ();
+  Ptr<EndDeviceStatus> edStatus = m_status->GetEndDeviceStatus (deviceAddress);
+
   // Need to decide whether to schedule a receive window
-  if (!m_status->GetEndDeviceStatus (packet)->HasReceiveWindowOpportunityScheduled ())
+  if (!edStatus->HasReceiveWindowOpportunityScheduled ())
   {
-    // Extract the address
-    LoraDeviceAddress deviceAddress = receivedFrameHdr.GetAddress ();
-
     // Schedule OnReceiveWindowOpportunity event
-    m_status->GetEndDeviceStatus (packet)->SetReceiveWindowOpportunity (
-      Simulator::Schedule (Seconds (1),
-                           &NetworkScheduler::OnReceiveWindowOpportunity,
-                           this,
-                           deviceAddress,
-                           1)); // This will be the first receive window
+    edStatus->SetReceiveWindowOpportunity (
+      LoraEventProfiler::Schedule (LoraEventProfiler::SERVER_SCHEDULING,
+                                   receptionTime + Seconds (1) - Simulator::Now (),
+                                   &NetworkScheduler::OnReceiveWindowOpportunity,
+                                   this,
+                                   deviceAddress,
+                                   1)); // This will be the first receive window
+
+    if (m_planner)
+      {
+        m_planner->AddPendingReply (deviceAddress, receptionTime + Seconds (1));
+      }
   }
 }
 
@@ -73,23 +88,52 @@ NetworkScheduler::OnReceiveWindowOpportunity (LoraDeviceAddress deviceAddress, i
   NS_LOG_DEBUG ("Opening receive window number " << window << " for device "
                                                  << deviceAddress);
 
+  if (m_planner)
+    {
+      OnPlannedReceiveWindowOpportunity (deviceAddress, window);
+      return;
+    }
+
+  Ptr<EndDeviceStatus> edStatus = m_status->GetEndDeviceStatus (deviceAddress);
+
   // Check whether we can send a reply to the device, again by using
   // NetworkStatus
   Address gwAddress = m_status->GetBestGatewayForDevice (deviceAddress, window);
 
+  // Time::Max () means that no gateway's ledger could be checked, in which
+  // case the second window is still worth trying
+  Time earliestSecondReply = Time::Max ();
   if (gwAddress == Address () && window == 1)
+    {
+      earliestSecondReply = m_status->GetEarliestReplyTime (deviceAddress, 2);
+    }
+
+  if (gwAddress == Address () && window == 1
+      && earliestSecondReply != Time::Max ()
+      && earliestSecondReply > Simulator::Now () + Seconds (1))
+    {
+      // The duty cycle ledger tells us that no gateway will be able to reply
+      // in the second window either: give up without waiting for it.
+      NS_LOG_DEBUG ("Giving up on reply: no gateway will be available " <<
+                    "on the second receive window");
+
+      edStatus->RemoveReceiveWindowOpportunity();
+      edStatus->InitializeReply ();
+    }
+  else if (gwAddress == Address () && window == 1)
     {
       NS_LOG_DEBUG ("No suitable gateway found for first window.");
 
       // No suitable GW was found, but there's still hope to find one for the
       // second window.
       // Schedule another OnReceiveWindowOpportunity event
-      m_status->GetEndDeviceStatus (deviceAddress)->SetReceiveWindowOpportunity (
-        Simulator::Schedule (Seconds (1),
-                             &NetworkScheduler::OnReceiveWindowOpportunity,
-                             this,
-                             deviceAddress,
-                             2));     // This will be the second receive window
+      edStatus->SetReceiveWindowOpportunity (
+        LoraEventProfiler::Schedule (LoraEventProfiler::SERVER_SCHEDULING,
+                                     Seconds (1),
+                                     &NetworkScheduler::OnReceiveWindowOpportunity,
+                                     this,
+                                     deviceAddress,
+                                     2));     // This will be the second receive window
     }
   else if (gwAddress == Address () && window == 2)
     {
@@ -100,8 +144,8 @@ NetworkScheduler::OnReceiveWindowOpportunity (LoraDeviceAddress deviceAddress, i
 
       // Reset the reply
       // XXX Should we reset it here or keep it for the next opportunity?
-      m_status->GetEndDeviceStatus (deviceAddress)->RemoveReceiveWindowOpportunity();
-      m_status->GetEndDeviceStatus (deviceAddress)->InitializeReply ();
+      edStatus->RemoveReceiveWindowOpportunity();
+      edStatus->InitializeReply ();
     }
   else
     {
@@ -109,8 +153,7 @@ NetworkScheduler::OnReceiveWindowOpportunity (LoraDeviceAddress deviceAddress, i
 
       NS_LOG_DEBUG ("Found available gateway with address: " << gwAddress);
 
-      m_controller->BeforeSendingReply (m_status->GetEndDeviceStatus
-                                          (deviceAddress));
+      m_controller->BeforeSendingReply (edStatus);
 
       // Check whether this device needs a response by querying m_status
       bool needsReply = m_status->NeedsReply (deviceAddress);
@@ -125,10 +168,87 @@ NetworkScheduler::OnReceiveWindowOpportunity (LoraDeviceAddress deviceAddress, i
                                         gwAddress);
 
           // Reset the reply
-          m_status->GetEndDeviceStatus (deviceAddress)->RemoveReceiveWindowOpportunity();
-          m_status->GetEndDeviceStatus (deviceAddress)->InitializeReply ();
+          edStatus->RemoveReceiveWindowOpportunity();
+          edStatus->InitializeReply ();
         }
     }
 }
+
+void
+NetworkScheduler::OnPlannedReceiveWindowOpportunity (LoraDeviceAddress deviceAddress,
+                                                     int window)
+{
+  NS_LOG_FUNCTION (deviceAddress << window);
+
+  Ptr<EndDeviceStatus> edStatus = m_status->GetEndDeviceStatus (deviceAddress);
+
+  DownlinkPlanner::Assignment assignment;
+  if (window == 1)
+    {
+      assignment = m_planner->Plan (deviceAddress);
+    }
+  else
+    {
+      assignment = m_planner->GetAssignment (deviceAddress);
+    }
+
+  if (assignment.window == 0)
+    {
+      NS_LOG_DEBUG ("Giving up on reply: the planner found no suitable gateway");
+
+      m_planner->Complete (deviceAddress, false);
+      edStatus->RemoveReceiveWindowOpportunity ();
+      edStatus->InitializeReply ();
+    }
+  else if (assignment.window > window)
+    {
+      NS_LOG_DEBUG ("Reply planned for the second receive window");
+
+      // Only one event is needed, since the slot is already reserved
+      edStatus->SetReceiveWindowOpportunity (
+        LoraEventProfiler::Schedule (LoraEventProfiler::SERVER_SCHEDULING,
+                                     Seconds (1),
+                                     &NetworkScheduler::OnReceiveWindowOpportunity,
+                                     this,
+                                     deviceAddress,
+                                     2));
+    }
+  else
+    {
+      NS_LOG_DEBUG ("Reply planned through gateway " << assignment.gwAddress);
+
+      m_controller->BeforeSendingReply (edStatus);
+
+      bool needsReply = m_status->NeedsReply (deviceAddress);
+      m_planner->Complete (deviceAddress, needsReply);
+
+      if (needsReply)
+        {
+          NS_LOG_INFO ("A reply is needed");
+
+          m_status->SendThroughGateway (m_status->GetReplyForDevice
+                                          (deviceAddress, window),
+                                        assignment.gwAddress);
+
+          // Reset the reply
+          edStatus->RemoveReceiveWindowOpportunity ();
+          edStatus->InitializeReply ();
+        }
+    }
+}
+
+void
+NetworkScheduler::SetDownlinkPlanner (Ptr<DownlinkPlanner> planner)
+{
+  NS_LOG_FUNCTION (this << planner);
+
+  m_planner = planner;
+}
+
+Ptr<DownlinkPlanner>
+NetworkScheduler::GetDownlinkPlanner (void)
+{
+  return m_planner;
+}
 }
 }
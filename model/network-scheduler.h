@@ -29,6 +29,7 @@
 #include "ns3/lora-frame-header.h"
 #include "ns3/network-controller.h"
 #include "ns3/network-status.h"
+#include "ns3/downlink-planner.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -53,16 +54,44 @@ public:
    */
   void OnReceivedPacket (Ptr<const Packet> packet);
 
+  /**
+   * Same as above, for a packet whose first copy reached the NetworkServer
+   * at an earlier time. The receive windows are timed from that reception.
+   */
+  void OnReceivedPacket (Ptr<const Packet> packet, Time receptionTime);
+
   /**
    * Method that is scheduled after packet arrivals in order to act on
    * receive windows 1 and 2 seconds later receptions.
    */
   void OnReceiveWindowOpportunity (LoraDeviceAddress deviceAddress, int window);
 
+  /**
+   * Set the DownlinkPlanner to use to choose gateways and receive windows.
+   *
+   * If no planner is set (the default), the best available gateway is picked
+   * greedily at each receive window opportunity.
+   *
+   * \param planner The planner to use, or 0 to disable planning.
+   */
+  void SetDownlinkPlanner (Ptr<DownlinkPlanner> planner);
+
+  /**
+   * Get the DownlinkPlanner used by this scheduler, if any.
+   */
+  Ptr<DownlinkPlanner> GetDownlinkPlanner (void);
+
 private:
+  /**
+   * Act on a receive window opportunity according to the DownlinkPlanner.
+   */
+  void OnPlannedReceiveWindowOpportunity (LoraDeviceAddress deviceAddress,
+                                          int window);
+
   TracedCallback<Ptr<const Packet> > m_receiveWindowOpened;
   Ptr<NetworkStatus> m_status;
   Ptr<NetworkController> m_controller;
+  Ptr<DownlinkPlanner> m_planner;
 };
 
 } /* namespace ns3 */
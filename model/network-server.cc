@@ -31,6 +31,9 @@
 #include "ns3/node-container.h"
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/mac-command.h"
+#include "ns3/boolean.h"
+#include "ns3/lora-tag.h"
+#include "ns3/lora-event-profiler.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -49,6 +52,28 @@ NetworkServer::GetTypeId (void)
                      "Trace source that is fired when a packet arrives at the Network Server",
                      MakeTraceSourceAccessor (&NetworkServer::m_receivedPacket),
                      "ns3::Packet::TracedCallback")
+    .AddAttribute ("DeduplicationWindow",
+                   "Time to wait for the copies of an uplink packet coming "
+                   "from different gateways before processing it once. A "
+                   "zero value processes every copy as soon as it arrives",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NetworkServer::m_deduplicationWindow),
+                   MakeTimeChecker (Seconds (0), MilliSeconds (900)))
+    .AddAttribute ("DownlinkPlanning",
+                   "Whether to plan the gateway and receive window of replies "
+                   "jointly across all gateways",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NetworkServer::SetDownlinkPlanning,
+                                        &NetworkServer::GetDownlinkPlanning),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ComponentProfiling",
+                   "Whether to measure the number of calls and the wall clock "
+                   "time of each NetworkControllerComponent, and print a "
+                   "report at Simulator::Destroy",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NetworkServer::SetComponentProfiling,
+                                        &NetworkServer::GetComponentProfiling),
+                   MakeBooleanChecker ())
     .SetGroupName ("lorawan");
   return tid;
 }
@@ -158,6 +183,59 @@ NetworkServer::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
   // Create a copy of the packet
   Ptr<Packet> myPacket = packet->Copy ();
 
+  // Extract the headers
+  LorawanMacHeader macHdr;
+  myPacket->RemoveHeader (macHdr);
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  myPacket->RemoveHeader (frameHdr);
+
+  // Devices of a VirtualEndDevicePopulation are only known to the server once
+  // promoted
+  if (!m_status->HasEndDevice (frameHdr.GetAddress ()))
+    {
+      NS_LOG_DEBUG ("Dropping a packet from untracked device " <<
+                    frameHdr.GetAddress ());
+      return true;
+    }
+
+  if (!m_deduplicationWindow.IsZero ())
+    {
+      // Extract the key of this uplink
+      std::pair<LoraDeviceAddress, uint16_t> key (frameHdr.GetAddress (),
+                                                  frameHdr.GetFCnt ());
+
+      LoraTag tag;
+      packet->PeekPacketTag (tag);
+      EndDeviceStatus::PacketInfoPerGw gwInfo;
+      gwInfo.gwAddress = address;
+      gwInfo.receivedTime = Simulator::Now ();
+      gwInfo.rxPower = tag.GetReceivePower ();
+
+      auto it = m_pendingUplinks.find (key);
+      if (it == m_pendingUplinks.end ())
+        {
+          NS_LOG_DEBUG ("Opening deduplication window for device " << key.first
+                                                                 << ", FCnt " << key.second);
+          PendingUplink pending;
+          pending.packet = packet;
+          pending.receptionTime = Simulator::Now ();
+          it = m_pendingUplinks.insert (std::make_pair (key, pending)).first;
+
+          LoraEventProfiler::Schedule (LoraEventProfiler::SERVER_DEDUPLICATION,
+                                       m_deduplicationWindow,
+                                       &NetworkServer::EndDeduplicationWindow,
+                                       this, key.first, key.second);
+        }
+      else
+        {
+          NS_LOG_DEBUG ("Collected a duplicate from gateway " << address);
+        }
+      it->second.gwList.insert (std::make_pair (address, gwInfo));
+
+      return true;
+    }
+
   // Fire the trace source
   m_receivedPacket (packet);
 
@@ -173,6 +251,46 @@ NetworkServer::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
   return true;
 }
 
+void
+NetworkServer::EndDeduplicationWindow (LoraDeviceAddress deviceAddress, uint16_t fCnt)
+{
+  NS_LOG_FUNCTION (this << deviceAddress << fCnt);
+
+  auto it = m_pendingUplinks.find (std::make_pair (deviceAddress, fCnt));
+  if (it == m_pendingUplinks.end ())
+    {
+      return;
+    }
+
+  PendingUplink pending = it->second;
+  m_pendingUplinks.erase (it);
+
+  NS_LOG_DEBUG ("Dispatching packet received by " << pending.gwList.size ()
+                                                   << " gateways");
+
+  DispatchPacket (pending.packet, pending.gwList, pending.receptionTime);
+}
+
+void
+NetworkServer::DispatchPacket (Ptr<const Packet> packet,
+                               const EndDeviceStatus::GatewayList &gwList,
+                               Time receptionTime)
+{
+  NS_LOG_FUNCTION (this << packet << gwList.size () << receptionTime);
+
+  // Fire the trace source
+  m_receivedPacket (packet);
+
+  // Inform the scheduler of the newly arrived packet
+  m_scheduler->OnReceivedPacket (packet, receptionTime);
+
+  // Inform the status of the newly arrived packet
+  m_status->OnReceivedPacket (packet, gwList);
+
+  // Inform the controller of the newly arrived packet
+  m_controller->OnNewPacket (packet);
+}
+
 void
 NetworkServer::AddComponent (Ptr<NetworkControllerComponent> component)
 {
@@ -187,5 +305,46 @@ NetworkServer::GetNetworkStatus (void)
   return m_status;
 }
 
+void
+NetworkServer::SetDownlinkPlanning (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+
+  if (enable && !m_scheduler->GetDownlinkPlanner ())
+    {
+      m_scheduler->SetDownlinkPlanner (CreateObject<DownlinkPlanner> (m_status));
+    }
+  else if (!enable)
+    {
+      m_scheduler->SetDownlinkPlanner (0);
+    }
+}
+
+bool
+NetworkServer::GetDownlinkPlanning (void) const
+{
+  return m_scheduler->GetDownlinkPlanner () != 0;
+}
+
+Ptr<NetworkController>
+NetworkServer::GetNetworkController (void)
+{
+  return m_controller;
+}
+
+void
+NetworkServer::SetComponentProfiling (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+
+  m_controller->SetProfiling (enable);
+}
+
+bool
+NetworkServer::GetComponentProfiling (void) const
+{
+  return m_controller->GetProfiling ();
+}
+
 }
 }
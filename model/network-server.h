@@ -97,14 +97,72 @@ public:
   bool Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
                 const Address &address);
 
+  /**
+   * Pass an uplink packet through the trace, scheduler, status and controller
+   * once, together with all the gateways that received it.
+   *
+   * \param packet The received packet.
+   * \param gwList The gateways that received the packet.
+   * \param receptionTime The time the first copy of the packet was received.
+   */
+  void DispatchPacket (Ptr<const Packet> packet,
+                       const EndDeviceStatus::GatewayList &gwList,
+                       Time receptionTime);
+
   Ptr<NetworkStatus> GetNetworkStatus (void);
 
+  /**
+   * Enable (true) or disable (false) the DownlinkPlanner, which decides the
+   * gateway and receive window of replies jointly for all pending devices.
+   */
+  void SetDownlinkPlanning (bool enable);
+
+  /**
+   * Whether replies are scheduled through a DownlinkPlanner.
+   */
+  bool GetDownlinkPlanning (void) const;
+
+  /**
+   * Return the NetworkController of this NetworkServer.
+   */
+  Ptr<NetworkController> GetNetworkController (void);
+
+  /**
+   * Enable or disable the measurement of the cost of each
+   * NetworkControllerComponent.
+   */
+  void SetComponentProfiling (bool enable);
+
+  /**
+   * Whether the cost of each NetworkControllerComponent is being measured.
+   */
+  bool GetComponentProfiling (void) const;
+
 protected:
+  /**
+   * The copies of an uplink packet collected during the deduplication window.
+   */
+  struct PendingUplink
+  {
+    Ptr<const Packet> packet;   //!< The first copy of the packet
+    EndDeviceStatus::GatewayList gwList;   //!< The gateways that received it
+    Time receptionTime;   //!< The reception time of the first copy
+  };
+
+  /**
+   * Dispatch the copies collected for an uplink packet.
+   */
+  void EndDeduplicationWindow (LoraDeviceAddress deviceAddress, uint16_t fCnt);
+
   Ptr<NetworkStatus> m_status;
   Ptr<NetworkController> m_controller;
   Ptr<NetworkScheduler> m_scheduler;
 
   TracedCallback<Ptr<const Packet>> m_receivedPacket;
+
+  Time m_deduplicationWindow;   //!< Time to wait for copies of an uplink
+
+  std::map<std::pair<LoraDeviceAddress, uint16_t>, PendingUplink> m_pendingUplinks;
 };
 
 } // namespace lorawan
@@ -28,7 +28,12 @@
 #include "ns3/lora-device-address.h"
 #include "ns3/node-container.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include "ns3/pointer.h"
+#include "ns3/lora-tag.h"
+
+#include <algorithm>
+#include <limits>
 
 namespace ns3 {
 namespace lorawan {
@@ -47,6 +52,7 @@ NetworkStatus::GetTypeId (void)
 }
 
 NetworkStatus::NetworkStatus ()
+  : m_nEndDevices (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -56,6 +62,17 @@ NetworkStatus::~NetworkStatus ()
   NS_LOG_FUNCTION_NOARGS ();
 }
 
+void
+NetworkStatus::SetAddressGenerator (Ptr<LoraDeviceAddressGenerator> generator)
+{
+  NS_LOG_FUNCTION (this << generator);
+
+  NS_ABORT_MSG_IF (m_nEndDevices > 0,
+                   "Set the address generator before adding devices");
+
+  m_addressGenerator = generator;
+}
+
 void
 NetworkStatus::AddNode (Ptr<ClassAEndDeviceLorawanMac> edMac)
 {
@@ -63,18 +80,37 @@ NetworkStatus::AddNode (Ptr<ClassAEndDeviceLorawanMac> edMac)
 
   // Check whether this device already exists in our list
   LoraDeviceAddress edAddress = edMac->GetDeviceAddress ();
-  if (m_endDeviceStatuses.find (edAddress) == m_endDeviceStatuses.end ())
+  if (GetEndDeviceIndex (edAddress) != std::numeric_limits<uint32_t>::max ())
     {
-      // The device doesn't exist. Create new EndDeviceStatus
-      Ptr<EndDeviceStatus> edStatus = CreateObject<EndDeviceStatus>
-        (edAddress, edMac->GetObject<ClassAEndDeviceLorawanMac>());
+      return;
+    }
 
-      // Add it to the map
-      m_endDeviceStatuses.insert (std::pair<LoraDeviceAddress, Ptr<EndDeviceStatus> >
-                                  (edAddress, edStatus));
-      NS_LOG_DEBUG ("Added to the list a device with address " <<
-                    edAddress.Print ());
+  // The device doesn't exist. Create new EndDeviceStatus
+  Ptr<EndDeviceStatus> edStatus = CreateObject<EndDeviceStatus>
+    (edAddress, edMac->GetObject<ClassAEndDeviceLorawanMac>());
+
+  // Add it to the array, at its device index or after the last device
+  if (m_addressGenerator)
+    {
+      uint32_t index = m_addressGenerator->GetDeviceIndex (edAddress);
+      NS_ABORT_MSG_IF (index == std::numeric_limits<uint32_t>::max (),
+                       "Address " << edAddress <<
+                       " wasn't allocated by the address generator");
+      if (index >= m_endDeviceStatuses.size ())
+        {
+          m_endDeviceStatuses.resize (index + 1);
+        }
+      m_endDeviceStatuses[index] = edStatus;
+    }
+  else
+    {
+      m_endDeviceIndexes.insert (std::make_pair (edAddress,
+                                                 (uint32_t) m_endDeviceStatuses.size ()));
+      m_endDeviceStatuses.push_back (edStatus);
     }
+  m_nEndDevices++;
+  NS_LOG_DEBUG ("Added to the list a device with address " <<
+                edAddress.Print ());
 }
 
 void
@@ -113,21 +149,43 @@ NetworkStatus::OnReceivedPacket (Ptr<const Packet> packet,
   // Update the correct EndDeviceStatus object
   LoraDeviceAddress edAddr = frameHdr.GetAddress ();
   NS_LOG_DEBUG ("Node address: " << edAddr);
-  m_endDeviceStatuses.at (edAddr)->InsertReceivedPacket (packet, gwAddress);
+  GetTrackedEndDeviceStatus (edAddr)->InsertReceivedPacket (packet, gwAddress);
+}
+
+void
+NetworkStatus::OnReceivedPacket (Ptr<const Packet> packet,
+                                 const EndDeviceStatus::GatewayList &gwList)
+{
+  NS_LOG_FUNCTION (this << packet << gwList.size ());
+
+  // Create a copy of the packet
+  Ptr<Packet> myPacket = packet->Copy ();
+
+  // Extract the headers
+  LorawanMacHeader macHdr;
+  myPacket->RemoveHeader (macHdr);
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  myPacket->RemoveHeader (frameHdr);
+
+  // Update the correct EndDeviceStatus object
+  LoraDeviceAddress edAddr = frameHdr.GetAddress ();
+  NS_LOG_DEBUG ("Node address: " << edAddr);
+  GetTrackedEndDeviceStatus (edAddr)->InsertReceivedPacket (packet, gwList);
 }
 
 bool
 NetworkStatus::NeedsReply (LoraDeviceAddress deviceAddress)
 {
   // Throws out of range if no device is found
-  return m_endDeviceStatuses.at (deviceAddress)->NeedsReply ();
+  return GetTrackedEndDeviceStatus (deviceAddress)->NeedsReply ();
 }
 
 Address
 NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window)
 {
   // Get the endDeviceStatus we are interested in
-  Ptr<EndDeviceStatus> edStatus = m_endDeviceStatuses.at (deviceAddress);
+  Ptr<EndDeviceStatus> edStatus = GetTrackedEndDeviceStatus (deviceAddress);
   double replyFrequency;
   if (window == 1)
     {
@@ -165,21 +223,65 @@ NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int win
   return bestGwAddress;
 }
 
+Time
+NetworkStatus::GetEarliestTransmissionTime (Address gwAddress, double frequency)
+{
+  return m_gatewayStatuses.at (gwAddress)->GetEarliestTransmissionTime (frequency);
+}
+
+Time
+NetworkStatus::GetEarliestReplyTime (LoraDeviceAddress deviceAddress, int window)
+{
+  Ptr<EndDeviceStatus> edStatus = GetTrackedEndDeviceStatus (deviceAddress);
+  double replyFrequency;
+  if (window == 1)
+    {
+      replyFrequency = edStatus->GetFirstReceiveWindowFrequency ();
+    }
+  else if (window == 2)
+    {
+      replyFrequency = edStatus->GetSecondReceiveWindowFrequency ();
+    }
+  else
+    {
+      NS_ABORT_MSG ("Invalid window value");
+    }
+
+  Time earliestTime = Time::Max ();
+  EndDeviceStatus::GatewayList gwList = edStatus->GetLastReceivedPacketInfo ().gwList;
+  for (auto it = gwList.begin (); it != gwList.end (); it++)
+    {
+      earliestTime = std::min (earliestTime,
+                               GetEarliestTransmissionTime (it->first,
+                                                            replyFrequency));
+    }
+
+  return earliestTime;
+}
+
 void
 NetworkStatus::SendThroughGateway (Ptr<Packet> packet, Address gwAddress)
 {
   NS_LOG_FUNCTION (packet << gwAddress);
 
-  m_gatewayStatuses.find (gwAddress)->second->GetNetDevice ()->Send (packet,
-                                                                      gwAddress,
-                                                                      0x0800);
+  Ptr<GatewayStatus> gwStatus = m_gatewayStatuses.find (gwAddress)->second;
+
+  // Keep the duty cycle ledger up to date while the packet travels to the
+  // gateway
+  LoraTag tag;
+  packet->PeekPacketTag (tag);
+  gwStatus->RecordTransmission (tag.GetFrequency (),
+                                gwStatus->GetGatewayMac ()->GetOnAirTime
+                                  (packet, tag.GetDataRate ()));
+
+  gwStatus->GetNetDevice ()->Send (packet, gwAddress, 0x0800);
 }
 
 Ptr<Packet>
 NetworkStatus::GetReplyForDevice (LoraDeviceAddress edAddress, int windowNumber)
 {
   // Get the reply packet
-  Ptr<EndDeviceStatus> edStatus = m_endDeviceStatuses.find (edAddress)->second;
+  Ptr<EndDeviceStatus> edStatus = GetTrackedEndDeviceStatus (edAddress);
   Ptr<Packet> packet = edStatus->GetCompleteReplyPacket ();
 
   // Apply the appropriate tag
@@ -211,10 +313,18 @@ NetworkStatus::GetEndDeviceStatus (Ptr<Packet const> packet)
   Ptr<Packet> myPacket = packet->Copy ();
   myPacket->RemoveHeader (mHdr);
   myPacket->RemoveHeader (fHdr);
-  auto it = m_endDeviceStatuses.find (fHdr.GetAddress ());
-  if (it != m_endDeviceStatuses.end ())
+  return GetEndDeviceStatus (fHdr.GetAddress ());
+}
+
+Ptr<EndDeviceStatus>
+NetworkStatus::GetEndDeviceStatus (LoraDeviceAddress address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  uint32_t index = GetEndDeviceIndex (address);
+  if (index != std::numeric_limits<uint32_t>::max ())
     {
-      return (*it).second;
+      return m_endDeviceStatuses[index];
     }
   else
     {
@@ -223,21 +333,59 @@ NetworkStatus::GetEndDeviceStatus (Ptr<Packet const> packet)
     }
 }
 
-Ptr<EndDeviceStatus>
-NetworkStatus::GetEndDeviceStatus (LoraDeviceAddress address)
+uint32_t
+NetworkStatus::GetEndDeviceIndex (LoraDeviceAddress address) const
 {
-  NS_LOG_FUNCTION (this << address);
+  if (m_addressGenerator)
+    {
+      // The index comes from the address, but the device may belong to
+      // another server
+      uint32_t index = m_addressGenerator->GetDeviceIndex (address);
+      if (index < m_endDeviceStatuses.size () && m_endDeviceStatuses[index])
+        {
+          return index;
+        }
+      return std::numeric_limits<uint32_t>::max ();
+    }
 
-  auto it = m_endDeviceStatuses.find (address);
-  if (it != m_endDeviceStatuses.end ())
+  auto it = m_endDeviceIndexes.find (address);
+  if (it != m_endDeviceIndexes.end ())
     {
-      return (*it).second;
+      return it->second;
     }
-  else
+  return std::numeric_limits<uint32_t>::max ();
+}
+
+Ptr<EndDeviceStatus>
+NetworkStatus::GetEndDeviceStatusAt (uint32_t index) const
+{
+  NS_ASSERT (index < m_endDeviceStatuses.size () && m_endDeviceStatuses[index]);
+
+  return m_endDeviceStatuses[index];
+}
+
+Ptr<EndDeviceStatus>
+NetworkStatus::GetTrackedEndDeviceStatus (LoraDeviceAddress address) const
+{
+  // Throws out of range if no device is found
+  return m_endDeviceStatuses.at (GetEndDeviceIndex (address));
+}
+
+Ptr<GatewayStatus>
+NetworkStatus::GetGatewayStatus (const Address &gwAddress) const
+{
+  auto it = m_gatewayStatuses.find (gwAddress);
+  if (it != m_gatewayStatuses.end ())
     {
-      NS_LOG_ERROR ("EndDeviceStatus not found");
-      return 0;
+      return it->second;
     }
+  return 0;
+}
+
+bool
+NetworkStatus::HasEndDevice (LoraDeviceAddress address) const
+{
+  return GetEndDeviceIndex (address) != std::numeric_limits<uint32_t>::max ();
 }
 
 int
@@ -245,7 +393,7 @@ NetworkStatus::CountEndDevices (void)
 {
   NS_LOG_FUNCTION (this);
 
-  return m_endDeviceStatuses.size ();
+  return m_nEndDevices;
 }
 }
 }
@@ -26,18 +26,26 @@
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/gateway-status.h"
 #include "ns3/lora-device-address.h"
+#include "ns3/lora-device-address-generator.h"
 #include "ns3/network-scheduler.h"
 
 #include <iterator>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
 
 /**
  * This class represents the knowledge about the state of the network that is
- * available at the Network Server. It is essentially a collection of two maps:
- * one containing DeviceStatus objects, and the other containing GatewayStatus
- * objects.
+ * available at the Network Server. It is essentially a collection of
+ * DeviceStatus objects and of GatewayStatus objects.
+ *
+ * DeviceStatus objects are kept in an array, indexed by device. If the
+ * LoraDeviceAddressGenerator that allocated the addresses is set, the index of
+ * a device is its dense device index, computed from the address. Otherwise
+ * devices are indexed in the order they are added, and a hash table gives the
+ * index of each address. The array is iterated in index order.
  *
  * This class is meant to be queried by NetworkController components, which
  * can decide to take action based on the current status of the network.
@@ -50,8 +58,21 @@ public:
   NetworkStatus ();
   virtual ~NetworkStatus ();
 
+  /**
+   * Index the devices by the dense device index of the generator that
+   * allocated their addresses, instead of by the order they are added.
+   *
+   * This must be called before any device is added.
+   *
+   * \param generator The generator of the device addresses.
+   */
+  void SetAddressGenerator (Ptr<LoraDeviceAddressGenerator> generator);
+
   /**
    * Add a device to the ones that are tracked by this NetworkStatus object.
+   *
+   * If an address generator is set, the address of the device must have
+   * been allocated by it.
    */
   void AddNode (Ptr<ClassAEndDeviceLorawanMac> edMac);
 
@@ -70,6 +91,16 @@ public:
    */
   void OnReceivedPacket (Ptr<const Packet> packet, const Address &gwaddress);
 
+  /**
+   * Update network status on a received packet, once all the gateways that
+   * received it are known.
+   *
+   * \param packet the received packet.
+   * \param gwList the gateways this packet was received from.
+   */
+  void OnReceivedPacket (Ptr<const Packet> packet,
+                         const EndDeviceStatus::GatewayList &gwList);
+
   /**
    * Return whether the specified device needs a reply.
    *
@@ -85,12 +116,31 @@ public:
    */
   Address GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window);
 
+  /**
+   * Get the earliest time at which a gateway will be allowed to transmit on a
+   * frequency, according to its duty cycle ledger.
+   *
+   * \param gwAddress The address of the gateway.
+   * \param frequency The frequency of the transmission.
+   */
+  Time GetEarliestTransmissionTime (Address gwAddress, double frequency);
+
+  /**
+   * Get the earliest time at which any of the gateways that received the last
+   * packet of a device will be allowed to send a reply in a receive window.
+   *
+   * \param deviceAddress the address of the device we are interested in.
+   * \param window the receive window the reply would be sent in.
+   */
+  Time GetEarliestReplyTime (LoraDeviceAddress deviceAddress, int window);
+
   /**
    * Send a packet through a Gateway.
    *
    * This function assumes that the packet is already tagged with a LoraTag
    * that will inform the gateway of the parameters to use for the
-   * transmission.
+   * transmission. The transmission is recorded in the gateway's duty cycle
+   * ledger.
    */
   void SendThroughGateway (Ptr<Packet> packet, Address gwAddress);
 
@@ -109,14 +159,56 @@ public:
    */
   Ptr<EndDeviceStatus> GetEndDeviceStatus (LoraDeviceAddress address);
 
+  /**
+   * Get the index of a device among the ones tracked by this NetworkStatus
+   * object.
+   *
+   * \param address The address of the device.
+   * \return The index, or std::numeric_limits<uint32_t>::max () if the device
+   * isn't tracked.
+   */
+  uint32_t GetEndDeviceIndex (LoraDeviceAddress address) const;
+
+  /**
+   * Get the EndDeviceStatus of the device at an index, as given by
+   * GetEndDeviceIndex.
+   *
+   * \param index The index of a tracked device.
+   * \return The EndDeviceStatus of the device.
+   */
+  Ptr<EndDeviceStatus> GetEndDeviceStatusAt (uint32_t index) const;
+
+  /**
+   * Get the GatewayStatus of a gateway, or 0 if the gateway isn't connected
+   * to the network.
+   */
+  Ptr<GatewayStatus> GetGatewayStatus (const Address &gwAddress) const;
+
+  /**
+   * Return whether a device is tracked by this NetworkStatus object.
+   */
+  bool HasEndDevice (LoraDeviceAddress address) const;
+
   /**
    * Return the number of end devices currently managed by the server.
    */
   int CountEndDevices (void);
 
 public:
-  std::map<LoraDeviceAddress, Ptr<EndDeviceStatus>> m_endDeviceStatuses;
   std::map<Address, Ptr<GatewayStatus>> m_gatewayStatuses;
+
+private:
+  /**
+   * Get the EndDeviceStatus of a tracked device.
+   *
+   * Throws std::out_of_range if the device isn't tracked.
+   */
+  Ptr<EndDeviceStatus> GetTrackedEndDeviceStatus (LoraDeviceAddress address) const;
+
+  std::vector<Ptr<EndDeviceStatus>> m_endDeviceStatuses; //!< Indexed by device, 0 for untracked indexes
+  std::unordered_map<LoraDeviceAddress, uint32_t> m_endDeviceIndexes; //!< Without a generator
+  Ptr<LoraDeviceAddressGenerator> m_addressGenerator; //!< Gives the device indexes, if set
+  int m_nEndDevices; //!< The number of tracked devices
 };
 
 } // namespace lorawan
@@ -25,6 +25,7 @@
 #include "ns3/double.h"
 #include "ns3/string.h"
 #include "ns3/lora-net-device.h"
+#include "ns3/lora-event-profiler.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -94,8 +95,9 @@ OneShotSender::StartApplication (void)
 
   // Schedule the next SendPacket event
   Simulator::Cancel (m_sendEvent);
-  m_sendEvent = Simulator::Schedule (m_sendTime, &OneShotSender::SendPacket,
-                                     this);
+  m_sendEvent = LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND,
+                                             m_sendTime,
+                                             &OneShotSender::SendPacket, this);
 }
 
 void
@@ -24,6 +24,7 @@
 #include "ns3/double.h"
 #include "ns3/string.h"
 #include "ns3/lora-net-device.h"
+#include "ns3/lora-event-profiler.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -101,6 +102,12 @@ PeriodicSender::SetPacketSize (uint8_t size)
   m_basePktSize = size;
 }
 
+uint8_t
+PeriodicSender::GetPacketSize (void) const
+{
+  return m_basePktSize;
+}
+
 
 void
 PeriodicSender::SendPacket (void)
@@ -121,8 +128,9 @@ PeriodicSender::SendPacket (void)
   m_mac->Send (packet);
 
   // Schedule the next SendPacket event
-  m_sendEvent = Simulator::Schedule (m_interval, &PeriodicSender::SendPacket,
-                                     this);
+  m_sendEvent = LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND,
+                                             m_interval,
+                                             &PeriodicSender::SendPacket, this);
 
   NS_LOG_DEBUG ("Sent a packet of size " << packet->GetSize ());
 }
@@ -146,8 +154,9 @@ PeriodicSender::StartApplication (void)
   Simulator::Cancel (m_sendEvent);
   NS_LOG_DEBUG ("Starting up application with a first event with a " <<
                 m_initialDelay.GetSeconds () << " seconds delay");
-  m_sendEvent = Simulator::Schedule (m_initialDelay,
-                                     &PeriodicSender::SendPacket, this);
+  m_sendEvent = LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND,
+                                             m_initialDelay,
+                                             &PeriodicSender::SendPacket, this);
   NS_LOG_DEBUG ("Event Id: " << m_sendEvent.GetUid ());
 }
 
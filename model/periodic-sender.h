@@ -59,6 +59,11 @@ public:
    */
   void SetPacketSize (uint8_t size);
 
+  /**
+   * Get the base packet size
+   */
+  uint8_t GetPacketSize (void) const;
+
   /**
    * Set if using randomness in the packet size
    */
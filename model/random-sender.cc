@@ -24,6 +24,7 @@
 #include "ns3/double.h"
 #include "ns3/string.h"
 #include "ns3/lora-net-device.h"
+#include "ns3/lora-event-profiler.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -70,6 +71,10 @@ void RandomSender::SetMean (double mean){
   m_nextDelay->SetAttribute ("Mean", DoubleValue(mean));
 }
 
+double RandomSender::GetMean (void) const{
+  return m_nextDelay->GetMean ();
+}
+
 void RandomSender::SetBound (double bound){
   NS_LOG_FUNCTION (this << bound);
   m_nextDelay->SetAttribute ("Bound", DoubleValue(bound));
@@ -79,6 +84,10 @@ void RandomSender::SetPacketSize (uint8_t size){
   m_basePktSize = size;
 }
 
+uint8_t RandomSender::GetPacketSize (void) const{
+  return m_basePktSize;
+}
+
 void RandomSender::SendPacket (void){
   	NS_LOG_FUNCTION (this);
 
@@ -100,7 +109,9 @@ void RandomSender::SendPacket (void){
                 nxtDelay.GetSeconds() << " Seconds delay");
 	
 	// Schedule the next SendPacket event
-  	m_sendEvent = Simulator::Schedule (nxtDelay, &RandomSender::SendPacket, this);
+  	m_sendEvent = LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND,
+  	                                           nxtDelay, &RandomSender::SendPacket,
+  	                                           this);
 
   	NS_LOG_DEBUG ("Sent a packet of size " << packet->GetSize ());
 }
@@ -121,8 +132,9 @@ void RandomSender::StartApplication (void){
   	Simulator::Cancel (m_sendEvent);
   	NS_LOG_DEBUG ("Starting up application with a first event with a " <<
      	           m_initialDelay.GetSeconds () << " seconds delay");
-  	m_sendEvent = Simulator::Schedule (m_initialDelay,
-                                     	&RandomSender::SendPacket, this);
+  	m_sendEvent = LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND,
+  	                                           m_initialDelay,
+  	                                           &RandomSender::SendPacket, this);
   	NS_LOG_DEBUG ("Event Id: " << m_sendEvent.GetUid ());
 }
 
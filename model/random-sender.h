@@ -44,6 +44,11 @@ public:
    	*/
   	void SetMean (double);
 
+   	/**
+   	* Get the mean interval between packets, in seconds
+   	*/
+  	double GetMean (void) const;
+
    	/**
    	* Set the initial delay of this application
    	*/
@@ -55,6 +60,11 @@ public:
    	*/
   	void SetPacketSize (uint8_t size);
 
+  	/**
+   	* Get the base packet size
+   	*/
+  	uint8_t GetPacketSize (void) const;
+
   	/**
    	* Send a packet using the LoraNetDevice's Send method
    	*/
@@ -23,6 +23,7 @@
 #include "ns3/simulator.h"
 #include "ns3/lora-tag.h"
 #include "ns3/log.h"
+#include "ns3/lora-event-profiler.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -85,7 +86,8 @@ SimpleEndDeviceLoraPhy::Send (Ptr<Packet> packet, LoraTxParameters txParams,
 
   // Schedule the switch back to STANDBY mode.
   // For reference see SX1272 datasheet, section 4.1.6
-  Simulator::Schedule (duration, &EndDeviceLoraPhy::SwitchToStandby, this);
+  LoraEventProfiler::Schedule (LoraEventProfiler::PHY_TX_FINISHED, duration,
+                               &EndDeviceLoraPhy::SwitchToStandby, this);
 
   // Schedule the txFinished callback, if it was set
   // The call is scheduled just after the switch to standby in case the upper
@@ -93,9 +95,10 @@ SimpleEndDeviceLoraPhy::Send (Ptr<Packet> packet, LoraTxParameters txParams,
   // STANDBY mode.
   if (!m_txFinishedCallback.IsNull ())
     {
-      Simulator::Schedule (duration + NanoSeconds (10),
-                           &SimpleEndDeviceLoraPhy::m_txFinishedCallback, this,
-                           packet);
+      LoraEventProfiler::Schedule (LoraEventProfiler::PHY_TX_FINISHED,
+                                   duration + NanoSeconds (10),
+                                   &SimpleEndDeviceLoraPhy::m_txFinishedCallback,
+                                   this, packet);
     }
 
 
@@ -240,8 +243,9 @@ SimpleEndDeviceLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm,
             NS_LOG_INFO ("Scheduling reception of a packet. End in " <<
                          duration.GetSeconds () << " seconds");
 
-            Simulator::Schedule (duration, &LoraPhy::EndReceive, this, packet,
-                                 event);
+            LoraEventProfiler::Schedule (LoraEventProfiler::PHY_END_RECEIVE,
+                                         duration, &LoraPhy::EndReceive, this,
+                                         packet, event);
 
             // Fire the beginning of reception trace source
             m_phyRxBeginTrace (packet);
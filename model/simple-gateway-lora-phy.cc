@@ -22,6 +22,8 @@
 #include "ns3/lora-tag.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/lora-event-profiler.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -40,12 +42,21 @@ SimpleGatewayLoraPhy::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::SimpleGatewayLoraPhy")
                           .SetParent<GatewayLoraPhy> ()
                           .SetGroupName ("lorawan")
-                          .AddConstructor<SimpleGatewayLoraPhy> ();
+                          .AddConstructor<SimpleGatewayLoraPhy> ()
+                          .AddAttribute ("PerformanceCounters",
+                                         "Whether to count the outcome of "
+                                         "the packets reaching this gateway, "
+                                         "per SF and per frequency",
+                                         BooleanValue (true),
+                                         MakeBooleanAccessor
+                                           (&SimpleGatewayLoraPhy::m_performanceCounters),
+                                         MakeBooleanChecker ());
 
   return tid;
 }
 
-SimpleGatewayLoraPhy::SimpleGatewayLoraPhy ()
+SimpleGatewayLoraPhy::SimpleGatewayLoraPhy () :
+  m_performanceCounters (true)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -75,6 +86,11 @@ SimpleGatewayLoraPhy::Send (Ptr<Packet> packet, LoraTxParameters txParams, doubl
 
       if (!currentPath->IsAvailable ()) // Reception path is occupied
         {
+          Ptr<LoraInterferenceHelper::Event> event = currentPath->GetEvent ();
+          Count (event->GetSpreadingFactor (), event->GetFrequency (),
+                 &PerformanceCounters::lostBecauseTx);
+          CountOccupancy (event, Simulator::Now () - event->GetStartTime ());
+
           // Call the callback for reception interrupted by transmission
           // Fire the trace source
           if (m_device)
@@ -99,7 +115,8 @@ SimpleGatewayLoraPhy::Send (Ptr<Packet> packet, LoraTxParameters txParams, doubl
   // Send the packet in the channel
   m_channel->Send (this, packet, txPowerDbm, txParams, duration, frequencyMHz);
 
-  Simulator::Schedule (duration, &SimpleGatewayLoraPhy::TxFinished, this, packet);
+  LoraEventProfiler::Schedule (LoraEventProfiler::PHY_TX_FINISHED, duration,
+                               &SimpleGatewayLoraPhy::TxFinished, this, packet);
 
   m_isTransmitting = true;
 
@@ -131,6 +148,8 @@ SimpleGatewayLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm, uint8
 
       m_phyRxEndTrace (packet);
 
+      Count (sf, frequencyMHz, &PerformanceCounters::lostBecauseTx);
+
       // Fire the trace source
       if (m_device)
         {
@@ -169,6 +188,8 @@ SimpleGatewayLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm, uint8
                            << unsigned (sf) << " because under the sensitivity of " << sensitivity
                            << " dBm");
 
+              Count (sf, frequencyMHz, &PerformanceCounters::underSensitivity);
+
               if (m_device)
                 {
                   m_underSensitivity (packet, m_device->GetNode ()->GetId ());
@@ -193,7 +214,9 @@ SimpleGatewayLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm, uint8
 
               // Schedule the end of the reception of the packet
               EventId endReceiveEventId =
-                  Simulator::Schedule (duration, &LoraPhy::EndReceive, this, packet, event);
+                  LoraEventProfiler::Schedule (LoraEventProfiler::PHY_END_RECEIVE,
+                                               duration, &LoraPhy::EndReceive,
+                                               this, packet, event);
 
               currentPath->SetEndReceive (endReceiveEventId);
 
@@ -207,6 +230,8 @@ SimpleGatewayLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm, uint8
                << unsigned (sf) << " and frequency " << frequencyMHz
                << "MHz because no suitable demodulator was found");
 
+  Count (sf, frequencyMHz, &PerformanceCounters::noMoreDemodulators);
+
   // Fire the trace source
   if (m_device)
     {
@@ -237,6 +262,22 @@ SimpleGatewayLoraPhy::EndReceive (Ptr<Packet> packet, Ptr<LoraInterferenceHelper
     {
       NS_LOG_DEBUG ("packetDestroyed by " << unsigned (packetDestroyed));
 
+      if (m_performanceCounters)
+        {
+          PerformanceCounters *perSf;
+          PerformanceCounters *perFrequency;
+          GetCounters (event->GetSpreadingFactor (), event->GetFrequency (),
+                       &perSf, &perFrequency);
+          for (PerformanceCounters *counters : {perSf, perFrequency})
+            {
+              counters->interfered++;
+              if (packetDestroyed >= 7 && packetDestroyed <= 12)
+                {
+                  counters->interferedBySf[packetDestroyed - 7]++;
+                }
+            }
+        }
+
       // Update the packet's LoraTag
       LoraTag tag;
       packet->RemovePacketTag (tag);
@@ -258,6 +299,9 @@ SimpleGatewayLoraPhy::EndReceive (Ptr<Packet> packet, Ptr<LoraInterferenceHelper
       NS_LOG_INFO ("Packet with SF " << unsigned (event->GetSpreadingFactor ())
                                      << " received correctly");
 
+      Count (event->GetSpreadingFactor (), event->GetFrequency (),
+             &PerformanceCounters::received);
+
       // Fire the trace source
       if (m_device)
         {
@@ -297,6 +341,7 @@ SimpleGatewayLoraPhy::EndReceive (Ptr<Packet> packet, Ptr<LoraInterferenceHelper
 
       if (currentPath->GetEvent () == event)
         {
+          CountOccupancy (event, event->GetDuration ());
           currentPath->Free ();
           m_occupiedReceptionPaths--;
           return;
@@ -304,5 +349,115 @@ SimpleGatewayLoraPhy::EndReceive (Ptr<Packet> packet, Ptr<LoraInterferenceHelper
     }
 }
 
+const SimpleGatewayLoraPhy::PerformanceCounters &
+SimpleGatewayLoraPhy::GetPerformanceCounters (uint8_t sf) const
+{
+  NS_ASSERT (sf >= 7 && sf <= 12);
+
+  return m_countersPerSf[sf - 7];
+}
+
+const std::vector<double> &
+SimpleGatewayLoraPhy::GetPerformanceFrequencies (void) const
+{
+  return m_counterFrequencies;
+}
+
+SimpleGatewayLoraPhy::PerformanceCounters
+SimpleGatewayLoraPhy::GetPerformanceCountersPerFrequency (double frequencyMHz) const
+{
+  for (uint32_t i = 0; i < m_counterFrequencies.size (); i++)
+    {
+      if (m_counterFrequencies[i] == frequencyMHz)
+        {
+          return m_countersPerFrequency[i];
+        }
+    }
+  return PerformanceCounters ();
+}
+
+SimpleGatewayLoraPhy::PerformanceCounters
+SimpleGatewayLoraPhy::GetTotalPerformanceCounters (void) const
+{
+  PerformanceCounters total;
+  for (auto &counters : m_countersPerSf)
+    {
+      total.Add (counters);
+    }
+  return total;
+}
+
+void
+SimpleGatewayLoraPhy::GetCounters (uint8_t sf, double frequencyMHz,
+                                   PerformanceCounters **perSf,
+                                   PerformanceCounters **perFrequency)
+{
+  NS_ASSERT (sf >= 7 && sf <= 12);
+
+  *perSf = &m_countersPerSf[sf - 7];
+
+  // Gateways only listen on a handful of frequencies, so a linear search is
+  // the fastest lookup
+  for (uint32_t i = 0; i < m_counterFrequencies.size (); i++)
+    {
+      if (m_counterFrequencies[i] == frequencyMHz)
+        {
+          *perFrequency = &m_countersPerFrequency[i];
+          return;
+        }
+    }
+  m_counterFrequencies.push_back (frequencyMHz);
+  m_countersPerFrequency.push_back (PerformanceCounters ());
+  *perFrequency = &m_countersPerFrequency.back ();
+}
+
+void
+SimpleGatewayLoraPhy::Count (uint8_t sf, double frequencyMHz,
+                             uint64_t PerformanceCounters::*counter)
+{
+  if (!m_performanceCounters)
+    {
+      return;
+    }
+
+  PerformanceCounters *perSf;
+  PerformanceCounters *perFrequency;
+  GetCounters (sf, frequencyMHz, &perSf, &perFrequency);
+  (perSf->*counter)++;
+  (perFrequency->*counter)++;
+}
+
+void
+SimpleGatewayLoraPhy::CountOccupancy (Ptr<LoraInterferenceHelper::Event> event,
+                                      Time duration)
+{
+  if (!m_performanceCounters)
+    {
+      return;
+    }
+
+  PerformanceCounters *perSf;
+  PerformanceCounters *perFrequency;
+  GetCounters (event->GetSpreadingFactor (), event->GetFrequency (),
+               &perSf, &perFrequency);
+  perSf->occupancy += duration;
+  perFrequency->occupancy += duration;
+}
+
+void
+SimpleGatewayLoraPhy::PerformanceCounters::Add (const PerformanceCounters &other)
+{
+  received += other.received;
+  interfered += other.interfered;
+  for (uint32_t i = 0; i < interferedBySf.size (); i++)
+    {
+      interferedBySf[i] += other.interferedBySf[i];
+    }
+  noMoreDemodulators += other.noMoreDemodulators;
+  underSensitivity += other.underSensitivity;
+  lostBecauseTx += other.lostBecauseTx;
+  occupancy += other.occupancy;
+}
+
 } // namespace lorawan
 } // namespace ns3
@@ -28,7 +28,9 @@
 #include "ns3/node.h"
 #include "ns3/gateway-lora-phy.h"
 #include "ns3/traced-value.h"
+#include <array>
 #include <list>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -41,6 +43,25 @@ class LoraChannel;
 class SimpleGatewayLoraPhy : public GatewayLoraPhy
 {
 public:
+  /**
+   * Counters of the packets that reached this gateway, by outcome.
+   */
+  struct PerformanceCounters
+  {
+    uint64_t received = 0;   //!< Correctly received
+    uint64_t interfered = 0;   //!< Destroyed by interference
+    std::array<uint64_t, 6> interferedBySf = {};   //!< Same, by SF of the interferer, from SF7 to SF12
+    uint64_t noMoreDemodulators = 0;   //!< No reception path was available
+    uint64_t underSensitivity = 0;   //!< Below the sensitivity of the gateway
+    uint64_t lostBecauseTx = 0;   //!< Lost because the gateway was transmitting
+    Time occupancy = Seconds (0);   //!< Time spent by reception paths locked on packets
+
+    /**
+     * Add the counters of another object to these.
+     */
+    void Add (const PerformanceCounters &other);
+  };
+
   static TypeId GetTypeId (void);
 
   SimpleGatewayLoraPhy ();
@@ -55,7 +76,50 @@ public:
   virtual void Send (Ptr<Packet> packet, LoraTxParameters txParams,
                      double frequencyMHz, double txPowerDbm);
 
+  /**
+   * Get the counters of the packets with a certain spreading factor.
+   */
+  const PerformanceCounters &GetPerformanceCounters (uint8_t sf) const;
+
+  /**
+   * Get the frequencies, in MHz, of the packets that reached this gateway.
+   */
+  const std::vector<double> &GetPerformanceFrequencies (void) const;
+
+  /**
+   * Get the counters of the packets on a certain frequency.
+   */
+  PerformanceCounters GetPerformanceCountersPerFrequency (double frequencyMHz) const;
+
+  /**
+   * Get the counters of all packets.
+   */
+  PerformanceCounters GetTotalPerformanceCounters (void) const;
+
 private:
+  /**
+   * Get the counters to update for a packet, one per SF and one per
+   * frequency.
+   */
+  void GetCounters (uint8_t sf, double frequencyMHz,
+                    PerformanceCounters **perSf,
+                    PerformanceCounters **perFrequency);
+
+  /**
+   * Increment a counter of the packets with a certain SF and frequency.
+   */
+  void Count (uint8_t sf, double frequencyMHz,
+              uint64_t PerformanceCounters::*counter);
+
+  /**
+   * Account for the time a reception path spent locked on an event.
+   */
+  void CountOccupancy (Ptr<LoraInterferenceHelper::Event> event, Time duration);
+
+  bool m_performanceCounters;   //!< Whether counters are updated
+  std::array<PerformanceCounters, 6> m_countersPerSf;   //!< From SF7 to SF12
+  std::vector<double> m_counterFrequencies;   //!< Frequency of each entry of m_countersPerFrequency
+  std::vector<PerformanceCounters> m_countersPerFrequency;   //!< Counters per frequency
 };
 
 } /* namespace ns3 */
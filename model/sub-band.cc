@@ -65,6 +65,12 @@ SubBand::SubBand ()
     return m_firstFrequency;
   }
 
+  double
+  SubBand::GetLastFrequency (void)
+  {
+    return m_lastFrequency;
+  }
+
   double
   SubBand::GetDutyCycle (void)
   {
@@ -63,9 +63,9 @@ public:
   /**
    * Get the last frequency of the subband.
    *
-   * \return The lowest frequency of the SubBand.
+   * \return The highest frequency of the SubBand.
    */
-  // double GetLastFrequency (void);
+  double GetLastFrequency (void);
 
   /**
    * Get the duty cycle of the subband.
@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/substream-disc-position-allocator.h"
+#include "ns3/lora-substream-rng.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include <cmath>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("SubstreamDiscPositionAllocator");
+
+NS_OBJECT_ENSURE_REGISTERED (SubstreamDiscPositionAllocator);
+
+TypeId
+SubstreamDiscPositionAllocator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SubstreamDiscPositionAllocator")
+    .SetParent<PositionAllocator> ()
+    .SetGroupName ("lorawan")
+    .AddConstructor<SubstreamDiscPositionAllocator> ()
+    .AddAttribute ("rho", "The radius of the disc",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&SubstreamDiscPositionAllocator::m_rho),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("X", "The x coordinate of the center of the disc",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&SubstreamDiscPositionAllocator::m_x),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Y", "The y coordinate of the center of the disc",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&SubstreamDiscPositionAllocator::m_y),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Z", "The z coordinate of all the positions in the disc",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&SubstreamDiscPositionAllocator::m_z),
+                   MakeDoubleChecker<double> ());
+  return tid;
+}
+
+SubstreamDiscPositionAllocator::SubstreamDiscPositionAllocator ()
+  : m_rho (0),
+  m_x (0),
+  m_y (0),
+  m_z (0),
+  m_key (LoraSubstreamRng::GetKey (LoraSubstreamRng::POSITION)),
+  m_next (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+SubstreamDiscPositionAllocator::~SubstreamDiscPositionAllocator ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+Vector
+SubstreamDiscPositionAllocator::GetPosition (uint64_t index) const
+{
+  LoraSubstreamRng rng (m_key, index);
+
+  // The square root makes the density uniform over the area of the disc
+  double r = m_rho * std::sqrt (rng.GetValue ());
+  double theta = rng.GetValue (0, 2 * M_PI);
+  return Vector (m_x + r * std::cos (theta), m_y + r * std::sin (theta), m_z);
+}
+
+Vector
+SubstreamDiscPositionAllocator::GetNext (void) const
+{
+  Vector position = GetPosition (m_next++);
+  NS_LOG_DEBUG ("Disc position x=" << position.x << ", y=" << position.y);
+  return position;
+}
+
+int64_t
+SubstreamDiscPositionAllocator::AssignStreams (int64_t stream)
+{
+  return 0;
+}
+
+}
+}
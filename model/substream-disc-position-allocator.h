@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SUBSTREAM_DISC_POSITION_ALLOCATOR_H
+#define SUBSTREAM_DISC_POSITION_ALLOCATOR_H
+
+#include "ns3/position-allocator.h"
+#include <stdint.h>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Allocate positions uniformly in a disc, as UniformDiscPositionAllocator,
+ * drawing the i-th position from the LoraSubstreamRng substream of index i.
+ *
+ * GetPosition computes any position without changing the allocator, so that
+ * the positions of large sets of devices can be computed by several threads,
+ * and GetNext returns them in order. Positions are computed at the time of
+ * the call, and the key of the substreams when the allocator is created.
+ */
+class SubstreamDiscPositionAllocator : public PositionAllocator
+{
+public:
+  static TypeId GetTypeId (void);
+
+  SubstreamDiscPositionAllocator ();
+  virtual ~SubstreamDiscPositionAllocator ();
+
+  /**
+   * Get the position of a given index. This method can be called by several
+   * threads at a time.
+   */
+  Vector GetPosition (uint64_t index) const;
+
+  virtual Vector GetNext (void) const;
+
+  /**
+   * Substreams don't use stream numbers: nothing is assigned.
+   */
+  virtual int64_t AssignStreams (int64_t stream);
+
+private:
+  double m_rho;   //!< The radius of the disc
+  double m_x;   //!< The x coordinate of the center of the disc
+  double m_y;   //!< The y coordinate of the center of the disc
+  double m_z;   //!< The z coordinate of the positions
+  uint64_t m_key;   //!< The key of the substreams
+  mutable uint64_t m_next;   //!< The index of the next position
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* SUBSTREAM_DISC_POSITION_ALLOCATOR_H */
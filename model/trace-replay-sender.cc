@@ -0,0 +1,249 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/trace-replay-sender.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-event-profiler.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("TraceReplaySender");
+
+NS_OBJECT_ENSURE_REGISTERED (TraceReplaySender);
+
+TypeId
+TraceReplaySender::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TraceReplaySender")
+    .SetParent<Application> ()
+    .AddConstructor<TraceReplaySender> ()
+    .SetGroupName ("lorawan")
+    .AddAttribute ("TraceFile", "The uplink trace to replay",
+                   StringValue (""),
+                   MakeStringAccessor (&TraceReplaySender::m_filename),
+                   MakeStringChecker ())
+    .AddAttribute ("Lookahead",
+                   "The maximum number of packets scheduled ahead of time",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&TraceReplaySender::m_lookahead),
+                   MakeUintegerChecker<uint32_t> (1));
+  return tid;
+}
+
+TraceReplaySender::TraceReplaySender ()
+  : m_lookahead (1024),
+  m_map (0),
+  m_mapSize (0),
+  m_records (0),
+  m_nRecords (0),
+  m_cursor (0),
+  m_releasedBytes (0),
+  m_pending (0),
+  m_sent (0),
+  m_running (false)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+TraceReplaySender::~TraceReplaySender ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+TraceReplaySender::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_running = false;
+  Unmap ();
+  m_nodes = NodeContainer ();
+  m_macs.clear ();
+
+  Application::DoDispose ();
+}
+
+void
+TraceReplaySender::SetTraceFile (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  m_filename = filename;
+}
+
+void
+TraceReplaySender::SetDevices (NodeContainer nodes)
+{
+  NS_LOG_FUNCTION (this);
+  m_nodes = nodes;
+}
+
+uint64_t
+TraceReplaySender::GetNRecords (void) const
+{
+  return m_nRecords;
+}
+
+uint64_t
+TraceReplaySender::GetNSent (void) const
+{
+  return m_sent;
+}
+
+void
+TraceReplaySender::Unmap (void)
+{
+  if (m_map)
+    {
+      munmap (m_map, m_mapSize);
+    }
+  m_map = 0;
+  m_mapSize = 0;
+  m_records = 0;
+}
+
+void
+TraceReplaySender::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Assumes there's only one device per node
+  m_macs.clear ();
+  for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+    {
+      Ptr<LoraNetDevice> loraNetDevice = m_nodes.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ();
+      m_macs.push_back (loraNetDevice->GetMac ());
+      NS_ASSERT (m_macs.back () != 0);
+    }
+
+  Unmap ();
+  int fd = open (m_filename.c_str (), O_RDONLY);
+  NS_ABORT_MSG_IF (fd < 0, "Cannot open " << m_filename);
+  struct stat st;
+  NS_ABORT_MSG_IF (fstat (fd, &st) != 0 || st.st_size < (off_t) sizeof (UplinkTraceHeader),
+                   "Not an uplink trace: " << m_filename);
+  m_mapSize = st.st_size;
+  m_map = mmap (0, m_mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  NS_ABORT_MSG_IF (m_map == MAP_FAILED, "Cannot map " << m_filename);
+  madvise (m_map, m_mapSize, MADV_SEQUENTIAL);
+
+  const UplinkTraceHeader *header = static_cast<const UplinkTraceHeader *> (m_map);
+  NS_ABORT_MSG_IF (std::memcmp (header->magic, "LORAUPL1", 8) != 0
+                   || header->version != 1,
+                   "Not an uplink trace: " << m_filename);
+  NS_ABORT_MSG_IF (sizeof (UplinkTraceHeader) + header->nRecords * sizeof (UplinkTraceRecord)
+                   > m_mapSize,
+                   "Truncated uplink trace: " << m_filename);
+  m_nRecords = header->nRecords;
+  m_records = reinterpret_cast<const UplinkTraceRecord *> (header + 1);
+
+  m_cursor = 0;
+  m_releasedBytes = 0;
+  m_pending = 0;
+  m_sent = 0;
+  m_running = true;
+  if (m_nRecords > 0)
+    {
+      m_start = Simulator::Now () - NanoSeconds (m_records[0].time);
+    }
+  Refill ();
+
+  NS_LOG_DEBUG ("Replaying " << m_nRecords << " packets of " <<
+                m_nodes.GetN () << " devices");
+}
+
+void
+TraceReplaySender::StopApplication (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  // The events already scheduled find the application stopped
+  m_running = false;
+}
+
+void
+TraceReplaySender::Refill (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  while (m_pending < m_lookahead && m_cursor < m_nRecords)
+    {
+      const UplinkTraceRecord &record = m_records[m_cursor++];
+
+      if (record.device >= m_nodes.GetN ())
+        {
+          NS_LOG_WARN ("Skipping a packet of unknown device " << record.device);
+          continue;
+        }
+      Time delay = m_start + NanoSeconds (record.time) - Simulator::Now ();
+      NS_ASSERT_MSG (!delay.IsNegative (), "The uplink trace is not sorted by time");
+
+      // Send in the context of the device, as its own application would
+      LoraEventProfiler::ScheduleWithContext (LoraEventProfiler::APP_SEND,
+                                              m_nodes.Get (record.device)->GetId (),
+                                              delay,
+                                              &TraceReplaySender::SendPacket,
+                                              this, record.device, record.size);
+      m_pending++;
+    }
+
+  // Release the pages of the records already scheduled
+  uint64_t pageSize = sysconf (_SC_PAGESIZE);
+  uint64_t consumed = sizeof (UplinkTraceHeader) + m_cursor * sizeof (UplinkTraceRecord);
+  uint64_t releasable = consumed / pageSize * pageSize;
+  if (releasable > m_releasedBytes)
+    {
+      madvise (static_cast<char *> (m_map) + m_releasedBytes,
+               releasable - m_releasedBytes, MADV_DONTNEED);
+      m_releasedBytes = releasable;
+    }
+}
+
+void
+TraceReplaySender::SendPacket (uint32_t device, uint16_t size)
+{
+  NS_LOG_FUNCTION (this << device << size);
+
+  if (!m_running)
+    {
+      return;
+    }
+
+  m_pending--;
+  m_macs[device]->Send (Create<Packet> (size));
+  m_sent++;
+
+  NS_LOG_DEBUG ("Device " << device << " sent a packet of size " << size);
+
+  if (m_pending <= m_lookahead / 2)
+    {
+      Refill ();
+    }
+}
+
+}
+}
@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRACE_REPLAY_SENDER_H
+#define TRACE_REPLAY_SENDER_H
+
+#include "ns3/application.h"
+#include "ns3/nstime.h"
+#include "ns3/node-container.h"
+#include "ns3/lorawan-mac.h"
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * The header of an uplink trace file.
+ */
+struct UplinkTraceHeader
+{
+  char magic[8];   //!< "LORAUPL1"
+  uint32_t version;   //!< The version of the format, 1
+  uint32_t reserved;   //!< Padding, 0
+  uint64_t nRecords;   //!< The number of records
+};
+
+/**
+ * A record of an uplink trace, as stored in the file.
+ */
+struct UplinkTraceRecord
+{
+  int64_t time;   //!< The send time, in ns
+  uint32_t device;   //!< The index of the device
+  uint16_t size;   //!< The application payload, in bytes
+  uint16_t reserved;   //!< Padding, 0
+};
+
+/**
+ * An application that replays the uplink traffic of a set of end devices
+ * from a binary trace.
+ *
+ * The file starts with the 8-byte magic "LORAUPL1", followed by a 32-bit
+ * version number, 4 reserved bytes and the number of records as a 64-bit
+ * unsigned integer. UplinkTraceRecord entries of 16 bytes follow, sorted by
+ * time, with values in the byte order of the host. The device index of a
+ * record is the position of the device in the NodeContainer of the
+ * application, and its time is relative to the first record: the first
+ * packet is sent when the application starts. TraceReplayHelper::ConvertCsv
+ * writes such files.
+ *
+ * The file is memory-mapped, and never read into memory as a whole: at most
+ * Lookahead packets are scheduled ahead of time, in the context of the node
+ * of their device, and the pages of the records already scheduled are
+ * released, so that traces of any length can be replayed.
+ */
+class TraceReplaySender : public Application
+{
+public:
+  TraceReplaySender ();
+  ~TraceReplaySender ();
+
+  static TypeId GetTypeId (void);
+
+  /**
+   * Set the trace to replay.
+   */
+  void SetTraceFile (std::string filename);
+
+  /**
+   * Set the devices of the trace, by index.
+   *
+   * \param nodes The nodes of the devices, each with a LoraNetDevice as
+   * first device.
+   */
+  void SetDevices (NodeContainer nodes);
+
+  /**
+   * Get the number of records of the trace, once the application started.
+   */
+  uint64_t GetNRecords (void) const;
+
+  /**
+   * Get the number of packets sent so far.
+   */
+  uint64_t GetNSent (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * Map the trace and schedule its first packets
+   */
+  virtual void StartApplication (void);
+
+  /**
+   * Stop the application, ignoring the packets already scheduled
+   */
+  virtual void StopApplication (void);
+
+  /**
+   * Schedule the next records, until Lookahead packets are pending.
+   */
+  void Refill (void);
+
+  /**
+   * Send a packet using the MAC of a device.
+   */
+  void SendPacket (uint32_t device, uint16_t size);
+
+  /**
+   * Unmap the trace, if it is mapped.
+   */
+  void Unmap (void);
+
+  std::string m_filename;   //!< The trace file
+  NodeContainer m_nodes;   //!< The node of each device
+  std::vector<Ptr<LorawanMac> > m_macs;   //!< The MAC of each device
+  uint32_t m_lookahead;   //!< The maximum number of pending packets
+
+  void *m_map;   //!< The mapping of the file, or 0
+  uint64_t m_mapSize;   //!< The size of the mapping
+  const UplinkTraceRecord *m_records;   //!< The records, in the mapping
+  uint64_t m_nRecords;   //!< The number of records
+  uint64_t m_cursor;   //!< The first record not yet scheduled
+  uint64_t m_releasedBytes;   //!< The bytes of the mapping already released
+  uint32_t m_pending;   //!< The packets scheduled and not yet sent
+  uint64_t m_sent;   //!< The packets sent so far
+  Time m_start;   //!< The simulation time of the first record
+  bool m_running;   //!< Whether the application is started
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* TRACE_REPLAY_SENDER_H */
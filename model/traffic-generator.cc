@@ -0,0 +1,341 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/traffic-generator.h"
+#include "ns3/pointer.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-event-profiler.h"
+#include <algorithm>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("TrafficGenerator");
+
+NS_OBJECT_ENSURE_REGISTERED (TrafficGenerator);
+
+TypeId
+TrafficGenerator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TrafficGenerator")
+    .SetParent<Application> ()
+    .AddConstructor<TrafficGenerator> ()
+    .SetGroupName ("lorawan")
+    .AddAttribute ("Interval", "The default interval between packet sends of a device",
+                   TimeValue (Seconds (600)),
+                   MakeTimeAccessor (&TrafficGenerator::GetInterval,
+                                     &TrafficGenerator::SetInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("InterArrival",
+                   "If set, the random time between packet sends of a "
+                   "device, in seconds, in place of the interval",
+                   PointerValue (),
+                   MakePointerAccessor (&TrafficGenerator::m_interArrival),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("PacketSize", "The size of the packets, in bytes",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&TrafficGenerator::m_basePktSize),
+                   MakeUintegerChecker<uint8_t> ());
+  return tid;
+}
+
+TrafficGenerator::TrafficGenerator ()
+  : m_lastTimeStep (0),
+  m_heapSize (0),
+  m_interval (Seconds (600)),
+  m_basePktSize (10)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+TrafficGenerator::~TrafficGenerator ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+TrafficGenerator::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Simulator::Cancel (m_batchEvent);
+  m_nodes = NodeContainer ();
+  m_macs.clear ();
+  m_interArrival = 0;
+  m_pktSizeRV = 0;
+
+  Application::DoDispose ();
+}
+
+uint32_t
+TrafficGenerator::AddDevice (Ptr<Node> node, Time initialDelay)
+{
+  return AddDevice (node, initialDelay, Seconds (0));
+}
+
+uint32_t
+TrafficGenerator::AddDevice (Ptr<Node> node, Time initialDelay, Time interval)
+{
+  NS_LOG_FUNCTION (this << node << initialDelay << interval);
+
+  m_nodes.Add (node);
+  m_initialDelays.push_back (initialDelay);
+  m_intervals.push_back (interval);
+
+  return m_nodes.GetN () - 1;
+}
+
+uint32_t
+TrafficGenerator::GetNDevices (void) const
+{
+  return m_nodes.GetN ();
+}
+
+NodeContainer
+TrafficGenerator::GetDevices (void) const
+{
+  return m_nodes;
+}
+
+Time
+TrafficGenerator::GetDeviceInterval (uint32_t index) const
+{
+  Time interval = m_intervals.at (index);
+  return interval.IsZero () ? m_interval : interval;
+}
+
+void
+TrafficGenerator::SetInterval (Time interval)
+{
+  NS_LOG_FUNCTION (this << interval);
+  m_interval = interval;
+}
+
+Time
+TrafficGenerator::GetInterval (void) const
+{
+  return m_interval;
+}
+
+void
+TrafficGenerator::SetInterArrivalRandomVariable (Ptr<RandomVariableStream> rv)
+{
+  m_interArrival = rv;
+}
+
+Ptr<RandomVariableStream>
+TrafficGenerator::GetInterArrivalRandomVariable (void) const
+{
+  return m_interArrival;
+}
+
+void
+TrafficGenerator::SetPacketSize (uint8_t size)
+{
+  m_basePktSize = size;
+}
+
+uint8_t
+TrafficGenerator::GetPacketSize (void) const
+{
+  return m_basePktSize;
+}
+
+void
+TrafficGenerator::SetPacketSizeRandomVariable (Ptr<RandomVariableStream> rv)
+{
+  m_pktSizeRV = rv;
+}
+
+//////////////////
+//  Radix heap  //
+//////////////////
+
+uint32_t
+TrafficGenerator::GetBucket (uint64_t timeStep) const
+{
+  uint64_t diff = timeStep ^ m_lastTimeStep;
+  return diff == 0 ? 0 : 64 - __builtin_clzll (diff);
+}
+
+void
+TrafficGenerator::Push (uint64_t timeStep, uint32_t index)
+{
+  NS_ASSERT (timeStep >= m_lastTimeStep);
+
+  m_buckets[GetBucket (timeStep)].push_back (Entry (timeStep, index));
+  m_heapSize++;
+}
+
+void
+TrafficGenerator::Normalize (void)
+{
+  NS_ASSERT (m_heapSize > 0);
+
+  if (!m_buckets[0].empty ())
+    {
+      return;
+    }
+
+  // Move the first non-empty bucket into lower ones, relative to its minimum.
+  // Its entries all differ from the minimum in lower bits, so they land in
+  // lower buckets, and the minimum itself lands in bucket 0.
+  uint32_t b = 1;
+  while (m_buckets[b].empty ())
+    {
+      b++;
+    }
+  std::vector<Entry> entries;
+  entries.swap (m_buckets[b]);
+  m_lastTimeStep = std::min_element (entries.begin (), entries.end ())->first;
+  for (const auto &entry : entries)
+    {
+      m_buckets[GetBucket (entry.first)].push_back (entry);
+    }
+}
+
+////////////////////////
+//  Sending methods   //
+////////////////////////
+
+void
+TrafficGenerator::ProcessBatch (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint64_t now = Simulator::Now ().GetTimeStep ();
+  uint32_t batchSize = 0;
+  while (m_heapSize > 0)
+    {
+      Normalize ();
+      if (m_lastTimeStep > now)
+        {
+          break;
+        }
+
+      std::vector<Entry> due;
+      due.swap (m_buckets[0]);
+      m_heapSize -= due.size ();
+      for (const auto &entry : due)
+        {
+          uint32_t index = entry.second;
+
+          // Send in the context of the device, as its own application would
+          LoraEventProfiler::ScheduleWithContext (LoraEventProfiler::APP_SEND,
+                                                  m_nodes.Get (index)->GetId (),
+                                                  Seconds (0),
+                                                  &TrafficGenerator::SendPacket,
+                                                  this, index);
+
+          Push (now + GetNextDelay (index).GetTimeStep (), index);
+          batchSize++;
+        }
+    }
+
+  NS_LOG_DEBUG ("Sent a batch of " << batchSize << " packets");
+
+  if (m_heapSize > 0)
+    {
+      m_batchEvent = LoraEventProfiler::Schedule (LoraEventProfiler::APP_BATCH,
+                                                  TimeStep (m_lastTimeStep - now),
+                                                  &TrafficGenerator::ProcessBatch,
+                                                  this);
+    }
+}
+
+void
+TrafficGenerator::SendPacket (uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+
+  Ptr<Packet> packet;
+  if (m_pktSizeRV)
+    {
+      packet = Create<Packet> (m_basePktSize + m_pktSizeRV->GetInteger ());
+    }
+  else
+    {
+      packet = Create<Packet> (m_basePktSize);
+    }
+  m_macs[index]->Send (packet);
+
+  NS_LOG_DEBUG ("Device " << index << " sent a packet of size " <<
+                packet->GetSize ());
+}
+
+Time
+TrafficGenerator::GetNextDelay (uint32_t index)
+{
+  if (m_interArrival)
+    {
+      // Two packets of a device are never sent at the same time
+      return std::max (Seconds (m_interArrival->GetValue ()), TimeStep (1));
+    }
+  return GetDeviceInterval (index);
+}
+
+void
+TrafficGenerator::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ASSERT_MSG (m_interArrival || !m_interval.IsZero (),
+                 "Periodic traffic needs a positive interval");
+
+  // Assumes there's only one device per node
+  m_macs.clear ();
+  for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+    {
+      Ptr<LoraNetDevice> loraNetDevice = m_nodes.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ();
+      m_macs.push_back (loraNetDevice->GetMac ());
+      NS_ASSERT (m_macs.back () != 0);
+    }
+
+  Simulator::Cancel (m_batchEvent);
+  for (auto &bucket : m_buckets)
+    {
+      bucket.clear ();
+    }
+  m_heapSize = 0;
+  m_lastTimeStep = Simulator::Now ().GetTimeStep ();
+  for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+    {
+      Push (m_lastTimeStep + m_initialDelays[i].GetTimeStep (), i);
+    }
+
+  if (m_heapSize > 0)
+    {
+      Normalize ();
+      m_batchEvent = LoraEventProfiler::Schedule (LoraEventProfiler::APP_BATCH,
+                                                  TimeStep (m_lastTimeStep) - Simulator::Now (),
+                                                  &TrafficGenerator::ProcessBatch,
+                                                  this);
+    }
+  NS_LOG_DEBUG ("Started the traffic of " << m_nodes.GetN () << " devices");
+}
+
+void
+TrafficGenerator::StopApplication (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Simulator::Cancel (m_batchEvent);
+}
+
+}
+}
@@ -0,0 +1,197 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRAFFIC_GENERATOR_H
+#define TRAFFIC_GENERATOR_H
+
+#include "ns3/application.h"
+#include "ns3/nstime.h"
+#include "ns3/node-container.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/lorawan-mac.h"
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * An application that generates the uplink traffic of a whole set of end
+ * devices, in place of one PeriodicSender or RandomSender per device.
+ *
+ * The next send time of every device is kept in a radix heap owned by the
+ * application, and only the earliest one is scheduled in the Simulator: when
+ * it expires, all the devices due at that time are handed a packet, through
+ * one event per device in the context of its node, and the next batch is
+ * scheduled. Simulation time never goes back, which is what makes a radix
+ * heap applicable: pushing and popping cost a few bucket moves per entry.
+ *
+ * Devices send periodically, every Interval (or their own interval, see
+ * AddDevice), unless InterArrival is set, in which case the time between two
+ * packets of a device is drawn from it, in seconds: an
+ * ExponentialRandomVariable gives the traffic of RandomSender, and a
+ * ParetoRandomVariable a bursty one.
+ */
+class TrafficGenerator : public Application
+{
+public:
+  TrafficGenerator ();
+  ~TrafficGenerator ();
+
+  static TypeId GetTypeId (void);
+
+  /**
+   * Add a device, sending with the interval of the application.
+   *
+   * \param node The node of the device, with a LoraNetDevice as first device.
+   * \param initialDelay The time between the start of the application and
+   * the first packet of the device.
+   * \return The index of the device.
+   */
+  uint32_t AddDevice (Ptr<Node> node, Time initialDelay);
+
+  /**
+   * Add a device sending periodically with its own interval.
+   *
+   * \param interval The interval between two packets of the device, used
+   * unless InterArrival is set.
+   */
+  uint32_t AddDevice (Ptr<Node> node, Time initialDelay, Time interval);
+
+  /**
+   * Get the number of devices of this application.
+   */
+  uint32_t GetNDevices (void) const;
+
+  /**
+   * Get the nodes of the devices of this application.
+   */
+  NodeContainer GetDevices (void) const;
+
+  /**
+   * Get the interval between two packets of a device, if traffic is
+   * periodic.
+   */
+  Time GetDeviceInterval (uint32_t index) const;
+
+  /**
+   * Set the default interval between two packets.
+   */
+  void SetInterval (Time interval);
+
+  /**
+   * Get the default interval between two packets.
+   */
+  Time GetInterval (void) const;
+
+  /**
+   * Draw the time between two packets of a device, in seconds, from a random
+   * variable instead of using a fixed interval.
+   *
+   * \param rv The random variable, or 0 for periodic traffic.
+   */
+  void SetInterArrivalRandomVariable (Ptr<RandomVariableStream> rv);
+
+  /**
+   * Get the random variable of the time between packets, if any.
+   */
+  Ptr<RandomVariableStream> GetInterArrivalRandomVariable (void) const;
+
+  /**
+   * Set packet size
+   */
+  void SetPacketSize (uint8_t size);
+
+  /**
+   * Get the base packet size
+   */
+  uint8_t GetPacketSize (void) const;
+
+  /**
+   * Add a random number of bytes, drawn from rv, to the size of each packet.
+   */
+  void SetPacketSizeRandomVariable (Ptr<RandomVariableStream> rv);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * Start the application by scheduling the first batch
+   */
+  virtual void StartApplication (void);
+
+  /**
+   * Stop the application
+   */
+  virtual void StopApplication (void);
+
+  /**
+   * Hand a packet to every device due now, and schedule the next batch.
+   */
+  void ProcessBatch (void);
+
+  /**
+   * Send a packet using the MAC of a device.
+   */
+  void SendPacket (uint32_t index);
+
+  /**
+   * Get the time between two packets of a device.
+   */
+  Time GetNextDelay (uint32_t index);
+
+  typedef std::pair<uint64_t, uint32_t> Entry;   //!< A time step and a device
+
+  /**
+   * Insert a device in the radix heap. The time step must not be before the
+   * last one popped.
+   */
+  void Push (uint64_t timeStep, uint32_t index);
+
+  /**
+   * Make sure the first bucket holds the entries with the smallest time
+   * step, which becomes the last popped one. The heap must not be empty.
+   */
+  void Normalize (void);
+
+  /**
+   * Get the bucket of a time step: the number of bits of its difference with
+   * the last popped time step.
+   */
+  uint32_t GetBucket (uint64_t timeStep) const;
+
+  NodeContainer m_nodes;   //!< The node of each device
+  std::vector<Ptr<LorawanMac> > m_macs;   //!< The MAC of each device
+  std::vector<Time> m_initialDelays;   //!< The initial delay of each device
+  std::vector<Time> m_intervals;   //!< The interval of each device
+
+  std::array<std::vector<Entry>, 65> m_buckets;   //!< The buckets of the radix heap
+  uint64_t m_lastTimeStep;   //!< The last time step popped from the heap
+  uint32_t m_heapSize;   //!< The number of entries in the heap
+
+  Time m_interval;   //!< The default interval between two packets
+  Ptr<RandomVariableStream> m_interArrival;   //!< The random time between packets, if any
+  uint8_t m_basePktSize;   //!< The packet size
+  Ptr<RandomVariableStream> m_pktSizeRV;   //!< The random bytes added to the packet size
+
+  EventId m_batchEvent;   //!< The event of the next batch
+};
+
+} // namespace lorawan
+} // namespace ns3
+#endif /* TRAFFIC_GENERATOR_H */
@@ -3,15 +3,47 @@
 // Include headers of classes to test
 #include "ns3/log.h"
 #include "ns3/lora-helper.h"
+#include "ns3/lora-packet-tracker.h"
+#include "ns3/latency-histogram.h"
+#include "ns3/lora-event-profiler.h"
+#include "ns3/gateway-spatial-index.h"
+#include "ns3/gateway-placement-helper.h"
+#include "ns3/virtual-end-device-population.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lora-tag.h"
 #include "ns3/simple-end-device-lora-phy.h"
 #include "ns3/simple-gateway-lora-phy.h"
 #include "ns3/mobility-helper.h"
 #include "ns3/one-shot-sender-helper.h"
+#include "ns3/traffic-generator-helper.h"
+#include "ns3/trace-replay-helper.h"
+#include "ns3/lora-substream-rng.h"
+#include "ns3/substream-disc-position-allocator.h"
+#include "ns3/correlated-shadowing-propagation-loss-model.h"
+#include "ns3/building-penetration-loss.h"
+#include "ns3/buildings-helper.h"
+#include "ns3/building.h"
+#include "ns3/mobility-building-info.h"
+#include "ns3/box.h"
 #include "ns3/constant-position-mobility-model.h"
+#include "ns3/config.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "utilities.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
 using namespace ns3;
 using namespace lorawan;
 
@@ -241,6 +273,33 @@ AddressTest::DoRun (void)
   // After 200 iterations, the address should be 0xC9
   NS_TEST_EXPECT_MSG_EQ ((addressGenerator.GetNextAddress () == LoraDeviceAddress (0xC9)), true,
                          "LoraDeviceAddressGenerator doesn't increment as expected");
+
+  // Strict ordering and hashing of the packed form
+  NS_TEST_EXPECT_MSG_EQ ((firstAddress > secondAddress), false,
+                         "> function for addresses isn't strict");
+  LoraDeviceAddress packed (0x45, 0x123456);
+  NS_TEST_EXPECT_MSG_EQ (packed.Get (), (0x45u << 25) | 0x123456,
+                         "NwkID and NwkAddr aren't packed as expected");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (packed.GetNwkID ()), 0x45u, "Wrong NwkID");
+  NS_TEST_EXPECT_MSG_EQ (packed.GetNwkAddr (), 0x123456u, "Wrong NwkAddr");
+  NS_TEST_EXPECT_MSG_EQ (std::hash<LoraDeviceAddress> () (packed),
+                         std::hash<LoraDeviceAddress> () (LoraDeviceAddress (packed.Get ())),
+                         "Equal addresses have different hashes");
+
+  // Dense device indexes, across networks
+  LoraDeviceAddressGenerator indexGenerator (3, 10);
+  LoraDeviceAddress first = indexGenerator.NextAddress ();
+  indexGenerator.NextAddress ();
+  indexGenerator.NextNetwork ();
+  LoraDeviceAddress third = indexGenerator.NextAddress ();
+  LoraDeviceAddress fourth = indexGenerator.NextAddress ();
+  NS_TEST_EXPECT_MSG_EQ (indexGenerator.GetNDevices (), 4u, "Wrong number of devices");
+  NS_TEST_EXPECT_MSG_EQ (indexGenerator.GetDeviceIndex (first), 0u, "Wrong device index");
+  NS_TEST_EXPECT_MSG_EQ (indexGenerator.GetDeviceIndex (third), 2u, "Wrong device index");
+  NS_TEST_EXPECT_MSG_EQ (indexGenerator.GetDeviceIndex (fourth), 3u, "Wrong device index");
+  NS_TEST_EXPECT_MSG_EQ (indexGenerator.GetDeviceIndex (LoraDeviceAddress (3, 12)),
+                         std::numeric_limits<uint32_t>::max (),
+                         "An address that wasn't allocated has an index");
 }
 
 /***************
@@ -734,6 +793,348 @@ ReceivePathTest::DoRun (void)
   // NS_TEST_EXPECT_MSG_EQ (m_maxOccupiedReceptionPaths, 1, "Unexpected value");
 }
 
+/***************************
+ * GatewayPhyCountersTest *
+ ***************************/
+
+class GatewayPhyCountersTest : public TestCase
+{
+public:
+  GatewayPhyCountersTest ();
+  virtual ~GatewayPhyCountersTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+GatewayPhyCountersTest::GatewayPhyCountersTest ()
+    : TestCase ("Verify that SimpleGatewayLoraPhy counts the outcome of packets")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GatewayPhyCountersTest::~GatewayPhyCountersTest ()
+{
+}
+
+void
+GatewayPhyCountersTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GatewayPhyCountersTest");
+
+  Ptr<SimpleGatewayLoraPhy> gatewayPhy = CreateObject<SimpleGatewayLoraPhy> ();
+  gatewayPhy->AddReceptionPath ();
+  gatewayPhy->AddReceptionPath ();
+
+  // Below the sensitivity of SF7
+  Simulator::Schedule (Seconds (1), &SimpleGatewayLoraPhy::StartReceive,
+                       gatewayPhy, Create<Packet> (), -140, 7, Seconds (0.5),
+                       868.1);
+  // Two packets on different frequencies occupy both reception paths
+  Simulator::Schedule (Seconds (2), &SimpleGatewayLoraPhy::StartReceive,
+                       gatewayPhy, Create<Packet> (), -100, 7, Seconds (1),
+                       868.1);
+  Simulator::Schedule (Seconds (2), &SimpleGatewayLoraPhy::StartReceive,
+                       gatewayPhy, Create<Packet> (), -100, 8, Seconds (1),
+                       868.3);
+  // No reception path is left for this one
+  Simulator::Schedule (Seconds (2.5), &SimpleGatewayLoraPhy::StartReceive,
+                       gatewayPhy, Create<Packet> (), -100, 9, Seconds (1),
+                       868.5);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  const SimpleGatewayLoraPhy::PerformanceCounters &sf7 =
+    gatewayPhy->GetPerformanceCounters (7);
+  NS_TEST_EXPECT_MSG_EQ (sf7.received, 1, "Unexpected SF7 receptions");
+  NS_TEST_EXPECT_MSG_EQ (sf7.underSensitivity, 1,
+                         "Unexpected SF7 packets under sensitivity");
+  NS_TEST_EXPECT_MSG_EQ (sf7.occupancy, Seconds (1),
+                         "Unexpected SF7 occupancy");
+  NS_TEST_EXPECT_MSG_EQ (gatewayPhy->GetPerformanceCounters (9).noMoreDemodulators,
+                         1, "Unexpected SF9 packets without demodulators");
+
+  SimpleGatewayLoraPhy::PerformanceCounters frequency =
+    gatewayPhy->GetPerformanceCountersPerFrequency (868.1);
+  NS_TEST_EXPECT_MSG_EQ (frequency.received, 1,
+                         "Unexpected receptions on 868.1 MHz");
+  NS_TEST_EXPECT_MSG_EQ (frequency.underSensitivity, 1,
+                         "Unexpected packets under sensitivity on 868.1 MHz");
+  NS_TEST_EXPECT_MSG_EQ (gatewayPhy->GetPerformanceFrequencies ().size (), 3,
+                         "Unexpected number of frequencies");
+
+  SimpleGatewayLoraPhy::PerformanceCounters total =
+    gatewayPhy->GetTotalPerformanceCounters ();
+  NS_TEST_EXPECT_MSG_EQ (total.received, 2, "Unexpected receptions");
+  NS_TEST_EXPECT_MSG_EQ (total.interfered, 0, "Unexpected interference");
+  NS_TEST_EXPECT_MSG_EQ (total.occupancy, Seconds (2),
+                         "Unexpected occupancy");
+}
+
+/*********************
+ * EventProfilerTest *
+ *********************/
+
+class EventProfilerTest : public TestCase
+{
+public:
+  EventProfilerTest ();
+  virtual ~EventProfilerTest ();
+
+  void Handle (void);
+
+private:
+  virtual void DoRun (void);
+
+  int m_handled;
+};
+
+// Add some help text to this case to describe what it is intended to test
+EventProfilerTest::EventProfilerTest ()
+    : TestCase ("Verify that the event profiler counts events per category"),
+      m_handled (0)
+{
+}
+
+// Reminder that the test case should clean up after itself
+EventProfilerTest::~EventProfilerTest ()
+{
+}
+
+void
+EventProfilerTest::Handle (void)
+{
+  m_handled++;
+}
+
+void
+EventProfilerTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("EventProfilerTest");
+
+  LoraEventProfiler::Reset ();
+
+  // Not measured, since profiling is disabled
+  LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND, Seconds (1),
+                               &EventProfilerTest::Handle, this);
+
+  LoraEventProfiler::Enable (true);
+  LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND, Seconds (2),
+                               &EventProfilerTest::Handle, this);
+  LoraEventProfiler::ScheduleWithContext (LoraEventProfiler::CHANNEL_RECEIVE, 0,
+                                          Seconds (3),
+                                          &EventProfilerTest::Handle, this);
+  EventId cancelled =
+    LoraEventProfiler::Schedule (LoraEventProfiler::APP_SEND, Seconds (4),
+                                 &EventProfilerTest::Handle, this);
+  Simulator::Schedule (Seconds (3.5), &EventId::Cancel, &cancelled);
+
+  Simulator::Run ();
+
+  // Disable the report at Destroy
+  LoraEventProfiler::Enable (false);
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_handled, 3, "Unexpected number of handled events");
+
+  const LoraEventProfiler::Stats &send =
+    LoraEventProfiler::GetStats (LoraEventProfiler::APP_SEND);
+  NS_TEST_EXPECT_MSG_EQ (send.scheduled, 2, "Unexpected scheduled events");
+  NS_TEST_EXPECT_MSG_EQ (send.executed, 1, "Unexpected executed events");
+  NS_TEST_EXPECT_MSG_EQ ((send.wallTime >= 0), true, "Negative wall time");
+
+  const LoraEventProfiler::Stats &receive =
+    LoraEventProfiler::GetStats (LoraEventProfiler::CHANNEL_RECEIVE);
+  NS_TEST_EXPECT_MSG_EQ (receive.scheduled, 1, "Unexpected scheduled events");
+  NS_TEST_EXPECT_MSG_EQ (receive.executed, 1, "Unexpected executed events");
+
+  LoraEventProfiler::Reset ();
+}
+
+/******************************
+ * SpreadingFactorsSetupTest *
+ ******************************/
+
+class SpreadingFactorsSetupTest : public TestCase
+{
+public:
+  SpreadingFactorsSetupTest ();
+  virtual ~SpreadingFactorsSetupTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+SpreadingFactorsSetupTest::SpreadingFactorsSetupTest ()
+    : TestCase ("Verify the gateway index used to set up spreading factors")
+{
+}
+
+// Reminder that the test case should clean up after itself
+SpreadingFactorsSetupTest::~SpreadingFactorsSetupTest ()
+{
+}
+
+void
+SpreadingFactorsSetupTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("SpreadingFactorsSetupTest");
+
+  // A 4x4 grid of gateways, 1 km apart
+  std::vector<Vector> positions;
+  for (int i = 0; i < 4; i++)
+    {
+      for (int j = 0; j < 4; j++)
+        {
+          positions.push_back (Vector (1000 * i, 1000 * j, 0));
+        }
+    }
+  GatewaySpatialIndex index (positions);
+  std::vector<uint32_t> nearest;
+
+  index.GetNearest (Vector (1100, 2100, 0), 3, nearest);
+  NS_TEST_EXPECT_MSG_EQ (nearest.size (), 3, "Unexpected number of gateways");
+  NS_TEST_EXPECT_MSG_EQ (nearest[0], 6, "Unexpected closest gateway");
+  // Two gateways at the same distance, sorted by index
+  NS_TEST_EXPECT_MSG_EQ (nearest[1], 7, "Unexpected second gateway");
+  NS_TEST_EXPECT_MSG_EQ (nearest[2], 10, "Unexpected third gateway");
+
+  index.GetNearest (Vector (-5000, 0, 0), 1, nearest);
+  NS_TEST_EXPECT_MSG_EQ (nearest[0], 0, "Unexpected closest gateway");
+
+  index.GetNearest (Vector (0, 0, 0), 20, nearest);
+  NS_TEST_EXPECT_MSG_EQ (nearest.size (), 16, "Unexpected number of gateways");
+
+  // Without shadowing, the best gateway is the closest one, so evaluating
+  // only a few candidates must give the same spreading factors
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "DeltaX", DoubleValue (3000),
+                                 "DeltaY", DoubleValue (3000),
+                                 "GridWidth", UintegerValue (4));
+  NodeContainer gateways = CreateGateways (16, mobility, channel);
+
+  // More devices than a uint8_t can count
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                 "rho", DoubleValue (8000),
+                                 "X", DoubleValue (4500),
+                                 "Y", DoubleValue (4500));
+  NodeContainer endDevices = CreateEndDevices (300, mobility, channel);
+
+  std::vector<uint32_t> exact =
+    LorawanMacHelper::SetSpreadingFactorsUp (endDevices, gateways, channel, false);
+  std::vector<uint8_t> dataRates;
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      dataRates.push_back (GetMacLayerFromNode<ClassAEndDeviceLorawanMac>
+                             (endDevices.Get (i))->GetDataRate ());
+    }
+  NS_TEST_EXPECT_MSG_EQ (exact.size (), 6, "Unexpected number of SFs");
+  NS_TEST_EXPECT_MSG_EQ (std::accumulate (exact.begin (), exact.end (), 0u),
+                         300, "Devices were not all counted");
+
+  std::vector<uint32_t> indexed =
+    LorawanMacHelper::SetSpreadingFactorsUp (endDevices, gateways, channel,
+                                             false, 2, 4);
+  for (uint32_t sf = 0; sf < 6; sf++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (indexed[sf], exact[sf], "Unexpected SF count");
+    }
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (unsigned (GetMacLayerFromNode<ClassAEndDeviceLorawanMac>
+                                         (endDevices.Get (i))->GetDataRate ()),
+                             unsigned (dataRates[i]), "Unexpected data rate");
+    }
+
+  Simulator::Destroy ();
+}
+
+/************************
+ * CapacityAwareSfTest *
+ ************************/
+
+class CapacityAwareSfTest : public TestCase
+{
+public:
+  CapacityAwareSfTest ();
+  virtual ~CapacityAwareSfTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+CapacityAwareSfTest::CapacityAwareSfTest ()
+    : TestCase ("Verify that the capacity-aware planner spreads devices among SFs")
+{
+}
+
+// Reminder that the test case should clean up after itself
+CapacityAwareSfTest::~CapacityAwareSfTest ()
+{
+}
+
+void
+CapacityAwareSfTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("CapacityAwareSfTest");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 15));
+  mobility.SetPositionAllocator (allocator);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+
+  // All devices can reach the gateway with any SF
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                 "rho", DoubleValue (500),
+                                 "X", DoubleValue (0),
+                                 "Y", DoubleValue (0));
+  NodeContainer endDevices = CreateEndDevices (200, mobility, channel);
+
+  std::vector<uint32_t> up =
+    LorawanMacHelper::SetSpreadingFactorsUp (endDevices, gateways, channel, false);
+  NS_TEST_EXPECT_MSG_EQ (up[0], 200, "All devices should get SF7");
+
+  std::vector<uint32_t> planned =
+    LorawanMacHelper::SetSpreadingFactorsCapacityAware (endDevices, gateways,
+                                                        channel, Seconds (10), 10);
+  NS_TEST_EXPECT_MSG_EQ (std::accumulate (planned.begin (), planned.end (), 0u),
+                         200, "Devices were not all counted");
+  // Faster SFs carry more devices, since their packets are shorter, but all
+  // SFs are used
+  for (uint32_t sf = 0; sf < 5; sf++)
+    {
+      NS_TEST_EXPECT_MSG_GT_OR_EQ (planned[sf], planned[sf + 1],
+                                   "Slower SF with more devices");
+    }
+  NS_TEST_EXPECT_MSG_GT (planned[5], 0, "SF12 is not used");
+
+  uint32_t sf7 = 0;
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      if (GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (i))
+          ->GetDataRate () == 5)
+        {
+          sf7++;
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (sf7, planned[0], "Data rates do not match the counts");
+
+  Simulator::Destroy ();
+}
+
 /**************************
  * LogicalLoraChannelTest *
  **************************/
@@ -849,6 +1250,755 @@ LogicalLoraChannelTest::DoRun (void)
                          "Waiting time affects other subbands");
 }
 
+/********************
+ * RegionalPlanTest *
+ ********************/
+
+class RegionalPlanTest : public TestCase
+{
+public:
+  RegionalPlanTest ();
+  virtual ~RegionalPlanTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+RegionalPlanTest::RegionalPlanTest ()
+    : TestCase ("Verify that end devices share their regional plan but not their duty cycle")
+{
+}
+
+// Reminder that the test case should clean up after itself
+RegionalPlanTest::~RegionalPlanTest ()
+{
+}
+
+void
+RegionalPlanTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("RegionalPlanTest");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  NodeContainer endDevices = CreateEndDevices (2, mobility, channel);
+
+  Ptr<ClassAEndDeviceLorawanMac> mac0 =
+    GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (0));
+  Ptr<ClassAEndDeviceLorawanMac> mac1 =
+    GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (1));
+
+  // Both devices use the same plan
+  Ptr<const LoraRegionalPlan> plan = mac0->GetRegionalPlan ();
+  NS_TEST_ASSERT_MSG_EQ ((plan != 0), true, "No regional plan was set");
+  NS_TEST_EXPECT_MSG_EQ (mac1->GetRegionalPlan (), plan, "Plan is not shared");
+
+  LogicalLoraChannelHelper helper0 = mac0->GetLogicalLoraChannelHelper ();
+  LogicalLoraChannelHelper helper1 = mac1->GetLogicalLoraChannelHelper ();
+  NS_TEST_EXPECT_MSG_EQ (helper0.GetRegionalPlan (), plan, "Channels are not shared");
+  NS_TEST_EXPECT_MSG_EQ (helper0.GetEnabledChannelList ().size (), 8,
+                         "Wrong number of EU channels");
+
+  // Duty cycle and channel mask are kept for each device
+  Ptr<LogicalLoraChannel> channel0 = helper0.GetChannelList ().at (0);
+  helper0.AddEvent (Seconds (1), channel0);
+  helper0.DisableChannel (1);
+  Time expectedTimeOff = Seconds (1 / 0.01 - 1);
+  NS_TEST_EXPECT_MSG_EQ (helper0.GetWaitingTime (channel0), expectedTimeOff,
+                         "Waiting time doesn't behave as expected");
+  NS_TEST_EXPECT_MSG_EQ (helper0.GetEnabledChannelList ().size (), 7,
+                         "Channel was not disabled");
+  NS_TEST_EXPECT_MSG_EQ (helper1.GetWaitingTime (channel0), Time (0),
+                         "Duty cycle is shared between devices");
+  NS_TEST_EXPECT_MSG_EQ (helper1.GetEnabledChannelList ().size (), 8,
+                         "Channel mask is shared between devices");
+
+  // Channels handed out by GetChannelList are copies, which can't change the
+  // shared plan
+  helper1.GetChannelList ().at (2)->DisableForUplink ();
+  NS_TEST_EXPECT_MSG_EQ (helper1.GetEnabledChannelList ().size (), 8,
+                         "A channel of the plan was changed through a helper");
+  NS_TEST_EXPECT_MSG_EQ (helper0.GetEnabledChannelList ().size (), 7,
+                         "A channel of the plan was changed through a helper");
+
+  // Changing the channels of a device gives it copies of its own, which
+  // keep its state
+  helper0.AddChannel (869.1);
+  NS_TEST_EXPECT_MSG_EQ ((helper0.GetRegionalPlan () == 0), true, "Plan is still shared");
+  NS_TEST_EXPECT_MSG_EQ (helper0.GetEnabledChannelList ().size (), 8,
+                         "Channel mask was not kept");
+  NS_TEST_EXPECT_MSG_EQ (helper0.GetWaitingTime (channel0), expectedTimeOff,
+                         "Duty cycle was not kept");
+  NS_TEST_EXPECT_MSG_EQ (helper1.GetChannelList ().size (), 8,
+                         "Channel was added to the plan");
+
+  // Changing the conversions of a device does not affect the others
+  mac0->SetTxDbmForTxPower (std::vector<double>{14, 12});
+  NS_TEST_EXPECT_MSG_NE (mac0->GetRegionalPlan (), plan, "Plan was modified");
+  NS_TEST_EXPECT_MSG_EQ (mac0->GetDbmForTxPower (2), 0, "Conversion was not changed");
+  NS_TEST_EXPECT_MSG_EQ (mac1->GetDbmForTxPower (2), 12, "Conversion of the plan changed");
+  NS_TEST_EXPECT_MSG_EQ (mac0->GetSfFromDataRate (5), 7, "Other conversions were lost");
+
+  Simulator::Destroy ();
+}
+
+/*************************
+ * VirtualPopulationTest *
+ *************************/
+
+class VirtualPopulationTest : public TestCase
+{
+public:
+  VirtualPopulationTest ();
+  virtual ~VirtualPopulationTest ();
+  void StartSending (Ptr<const Packet> packet, uint32_t index);
+  void ReceivedPacket (Ptr<const Packet> packet, uint32_t node);
+
+private:
+  virtual void DoRun (void);
+
+  int m_sentPackets = 0;
+  int m_receivedPackets = 0;
+};
+
+// Add some help text to this case to describe what it is intended to test
+VirtualPopulationTest::VirtualPopulationTest ()
+    : TestCase ("Verify that virtual end devices transmit and can be promoted")
+{
+}
+
+// Reminder that the test case should clean up after itself
+VirtualPopulationTest::~VirtualPopulationTest ()
+{
+}
+
+void
+VirtualPopulationTest::StartSending (Ptr<const Packet> packet, uint32_t index)
+{
+  m_sentPackets++;
+}
+
+void
+VirtualPopulationTest::ReceivedPacket (Ptr<const Packet> packet, uint32_t node)
+{
+  m_receivedPackets++;
+}
+
+void
+VirtualPopulationTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("VirtualPopulationTest");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 15));
+  mobility.SetPositionAllocator (allocator);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+  Ptr<Node> nsNode = CreateNetworkServer (NodeContainer (), gateways);
+  Ptr<NetworkServer> ns = nsNode->GetApplication (0)->GetObject<NetworkServer> ();
+
+  gateways.Get (0)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetPhy ()
+    ->TraceConnectWithoutContext ("ReceivedPacket",
+                                  MakeCallback (&VirtualPopulationTest::ReceivedPacket, this));
+
+  // Devices close to the gateway, at SF7
+  LorawanMacHelper macHelper;
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  Ptr<VirtualEndDevicePopulation> population = CreateObject<VirtualEndDevicePopulation> ();
+  population->SetAttribute ("Interval", TimeValue (Seconds (100)));
+  population->SetChannel (channel);
+  population->SetRegionalPlan (macHelper.GetRegionalPlan ());
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      population->Add (Vector (10.0 * i, 0, 1), 5, 14, LoraDeviceAddress (54, i + 1));
+    }
+  population->TraceConnectWithoutContext ("StartSending",
+                                          MakeCallback (&VirtualPopulationTest::StartSending, this));
+  population->Start (Seconds (0));
+
+  // Packets of virtual devices reach the gateway, and are dropped by the
+  // server, which doesn't know the devices
+  Simulator::Stop (Seconds (150));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (m_sentPackets, 50, "Each device should have sent a packet");
+  NS_TEST_EXPECT_MSG_GT (m_receivedPackets, m_sentPackets / 2,
+                         "Few packets were received by the gateway");
+  uint16_t fCnt = population->GetFCnt (0);
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (fCnt, 1, "Device 0 should have sent a packet");
+  NS_TEST_EXPECT_MSG_EQ (ns->GetNetworkStatus ()->CountEndDevices (), 0,
+                         "Virtual devices should not be known to the server");
+
+  // Once promoted, the device continues its traffic with a full stack
+  LoraPhyHelper phyHelper;
+  phyHelper.SetChannel (channel);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  Ptr<Node> node = population->Promote (0, LoraHelper (), phyHelper, macHelper, ns);
+  NS_TEST_EXPECT_MSG_EQ (population->IsPromoted (0), true, "Device was not promoted");
+  NS_TEST_EXPECT_MSG_EQ (ns->GetNetworkStatus ()->HasEndDevice (LoraDeviceAddress (54, 1)),
+                         true, "Promoted device should be known to the server");
+  Ptr<ClassAEndDeviceLorawanMac> mac = GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (node);
+  NS_TEST_EXPECT_MSG_EQ (mac->GetDeviceAddress (), LoraDeviceAddress (54, 1),
+                         "Promoted device has a different address");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (mac->GetDataRate ()), 5,
+                         "Promoted device has a different data rate");
+  NS_TEST_EXPECT_MSG_EQ (mac->GetFCnt (), fCnt, "Promoted device has a different FCnt");
+
+  Simulator::Stop (Seconds (250));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (population->GetFCnt (0), fCnt,
+                         "Promoted device should not be simulated by the population");
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (mac->GetFCnt (), fCnt + 2,
+                               "Promoted device should continue sending");
+
+  Simulator::Destroy ();
+}
+
+/*********************************
+ * VirtualPopulationBuildingTest *
+ *********************************/
+
+class VirtualPopulationBuildingTest : public TestCase
+{
+public:
+  VirtualPopulationBuildingTest ();
+  virtual ~VirtualPopulationBuildingTest ();
+  void ReceivedPacket (Ptr<const Packet> packet, uint32_t node);
+
+private:
+  virtual void DoRun (void);
+
+  std::map<LoraDeviceAddress, int> m_receivedPackets;
+};
+
+// Add some help text to this case to describe what it is intended to test
+VirtualPopulationBuildingTest::VirtualPopulationBuildingTest ()
+    : TestCase ("Verify that virtual end devices account for the building they are in")
+{
+}
+
+// Reminder that the test case should clean up after itself
+VirtualPopulationBuildingTest::~VirtualPopulationBuildingTest ()
+{
+}
+
+void
+VirtualPopulationBuildingTest::ReceivedPacket (Ptr<const Packet> packet, uint32_t node)
+{
+  Ptr<Packet> copy = packet->Copy ();
+  LorawanMacHeader macHdr;
+  copy->RemoveHeader (macHdr);
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  copy->RemoveHeader (frameHdr);
+  m_receivedPackets[frameHdr.GetAddress ()]++;
+}
+
+void
+VirtualPopulationBuildingTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("VirtualPopulationBuildingTest");
+
+  // Virtual devices only support building losses drawing from substreams
+  Config::SetGlobal ("LoraDeviceSubstreams", BooleanValue (true));
+
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+  loss->SetNext (CreateObject<BuildingPenetrationLoss> ());
+  Ptr<LoraChannel> channel =
+    CreateObject<LoraChannel> (loss, CreateObject<ConstantSpeedPropagationDelayModel> ());
+
+  // A building on one side of the gateway
+  Ptr<Building> building = CreateObject<Building> ();
+  building->SetBoundaries (Box (7950, 8050, -50, 50, 0, 10));
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 15));
+  mobility.SetPositionAllocator (allocator);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+  BuildingsHelper::Install (gateways);
+  CreateNetworkServer (NodeContainer (), gateways);
+
+  gateways.Get (0)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetPhy ()
+    ->TraceConnectWithoutContext ("ReceivedPacket",
+                                  MakeCallback (&VirtualPopulationBuildingTest::ReceivedPacket,
+                                                this));
+
+  // Two devices at SF12 and 8 km from the gateway, about 2 dB above the
+  // sensitivity outdoors: the one in the building loses at least 4 dB more
+  LorawanMacHelper macHelper;
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  Ptr<VirtualEndDevicePopulation> population = CreateObject<VirtualEndDevicePopulation> ();
+  population->SetAttribute ("Interval", TimeValue (Seconds (600)));
+  population->SetChannel (channel);
+  population->SetRegionalPlan (macHelper.GetRegionalPlan ());
+  population->Add (Vector (-8000, 0, 1), 0, 14, LoraDeviceAddress (54, 1));
+  population->Add (Vector (8000, 0, 1), 0, 14, LoraDeviceAddress (54, 2));
+  population->Start (Seconds (0));
+  Simulator::Schedule (Seconds (2900), &VirtualEndDevicePopulation::Stop, population);
+
+  // Leave time to the last packets to be received
+  Simulator::Stop (Seconds (3000));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (population->GetFCnt (1), 4,
+                               "The device in the building should keep sending");
+  NS_TEST_EXPECT_MSG_GT (m_receivedPackets[LoraDeviceAddress (54, 1)], 0,
+                         "Packets of the outdoor device should be received");
+  NS_TEST_EXPECT_MSG_EQ (m_receivedPackets[LoraDeviceAddress (54, 2)], 0,
+                         "Packets of the device in the building should be lost");
+
+  Simulator::Destroy ();
+
+  Config::SetGlobal ("LoraDeviceSubstreams", BooleanValue (false));
+}
+
+/************************
+ * TrafficGeneratorTest *
+ ************************/
+
+class TrafficGeneratorTest : public TestCase
+{
+public:
+  TrafficGeneratorTest ();
+  virtual ~TrafficGeneratorTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+TrafficGeneratorTest::TrafficGeneratorTest ()
+    : TestCase ("Verify that TrafficGenerator sends the packets of many devices in batches")
+{
+}
+
+// Reminder that the test case should clean up after itself
+TrafficGeneratorTest::~TrafficGeneratorTest ()
+{
+}
+
+void
+TrafficGeneratorTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("TrafficGeneratorTest");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  NodeContainer endDevices = CreateEndDevices (10, mobility, channel);
+
+  // Two groups of devices, 10 seconds apart
+  Ptr<TrafficGenerator> app = CreateObject<TrafficGenerator> ();
+  app->SetInterval (Seconds (1000));
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      app->AddDevice (endDevices.Get (i), Seconds (10 * (i % 2)));
+    }
+  endDevices.Get (0)->AddApplication (app);
+  NS_TEST_EXPECT_MSG_EQ (app->GetNDevices (), 10, "Devices were not added");
+  NS_TEST_EXPECT_MSG_EQ (app->GetDeviceInterval (3), Seconds (1000),
+                         "Devices should use the default interval");
+
+  LoraEventProfiler::Reset ();
+  LoraEventProfiler::Enable (true);
+  Simulator::Stop (Seconds (3500));
+  Simulator::Run ();
+  LoraEventProfiler::Enable (false);
+
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (i))
+                             ->GetFCnt (), 4, "Device " << i << " did not send 4 packets");
+    }
+  NS_TEST_EXPECT_MSG_EQ (LoraEventProfiler::GetStats (LoraEventProfiler::APP_BATCH).executed,
+                         8, "Devices due at the same time should share a batch");
+  NS_TEST_EXPECT_MSG_EQ (LoraEventProfiler::GetStats (LoraEventProfiler::APP_SEND).executed,
+                         40, "Unexpected number of packets");
+  LoraEventProfiler::Reset ();
+
+  // The helper creates a single application for all the devices
+  TrafficGeneratorHelper helper;
+  Ptr<ExponentialRandomVariable> interArrival = CreateObject<ExponentialRandomVariable> ();
+  interArrival->SetAttribute ("Mean", DoubleValue (100));
+  helper.SetInterArrivalRandomVariable (interArrival);
+  ApplicationContainer apps = helper.Install (endDevices);
+  NS_TEST_EXPECT_MSG_EQ (apps.GetN (), 1, "Expected a single application");
+  NS_TEST_EXPECT_MSG_EQ (DynamicCast<TrafficGenerator> (apps.Get (0))->GetNDevices (), 10,
+                         "The application should hold all devices");
+
+  Simulator::Destroy ();
+}
+
+/*******************
+ * TraceReplayTest *
+ *******************/
+
+class TraceReplayTest : public TestCase
+{
+public:
+  TraceReplayTest ();
+  virtual ~TraceReplayTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+TraceReplayTest::TraceReplayTest ()
+    : TestCase ("Verify that TraceReplaySender replays a trace converted from CSV")
+{
+}
+
+// Reminder that the test case should clean up after itself
+TraceReplayTest::~TraceReplayTest ()
+{
+}
+
+void
+TraceReplayTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("TraceReplayTest");
+
+  // An unsorted trace, with a header line and a packet of an unknown device
+  std::string csvFile = CreateTempDirFilename ("uplink.csv");
+  std::string traceFile = CreateTempDirFilename ("uplink.bin");
+  std::ofstream csv (csvFile.c_str ());
+  csv << "device,time,size" << std::endl
+      << "0,100,10" << std::endl
+      << "1,0,20" << std::endl
+      << "2,50.5,10" << std::endl
+      << "0,300,10" << std::endl
+      << "5,10,10" << std::endl
+      << "1,200,30" << std::endl;
+  csv.close ();
+  NS_TEST_ASSERT_MSG_EQ (TraceReplayHelper::ConvertCsv (csvFile, traceFile), 6,
+                         "Unexpected number of records");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  NodeContainer endDevices = CreateEndDevices (3, mobility, channel);
+
+  // A small lookahead, so that the trace is scheduled in several steps
+  TraceReplayHelper helper;
+  helper.SetTraceFile (traceFile);
+  helper.SetAttribute ("Lookahead", UintegerValue (2));
+  ApplicationContainer apps = helper.Install (endDevices);
+  NS_TEST_EXPECT_MSG_EQ (apps.GetN (), 1, "Expected a single application");
+  apps.Start (Seconds (10));
+
+  LoraEventProfiler::Reset ();
+  LoraEventProfiler::Enable (true);
+  Simulator::Stop (Seconds (400));
+  Simulator::Run ();
+  LoraEventProfiler::Enable (false);
+
+  Ptr<TraceReplaySender> app = DynamicCast<TraceReplaySender> (apps.Get (0));
+  NS_TEST_EXPECT_MSG_EQ (app->GetNRecords (), 6, "Unexpected number of records");
+  NS_TEST_EXPECT_MSG_EQ (app->GetNSent (), 5, "The unknown device should be skipped");
+  NS_TEST_EXPECT_MSG_EQ (LoraEventProfiler::GetStats (LoraEventProfiler::APP_SEND).executed,
+                         5, "Unexpected number of packets");
+  LoraEventProfiler::Reset ();
+
+  uint16_t expected[] = {2, 2, 1};
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (i))
+                             ->GetFCnt (), expected[i], "Device " << i << " missed packets");
+    }
+
+  Simulator::Destroy ();
+}
+
+/********************
+ * SubstreamRngTest *
+ ********************/
+
+class SubstreamRngTest : public TestCase
+{
+public:
+  SubstreamRngTest ();
+  virtual ~SubstreamRngTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+SubstreamRngTest::SubstreamRngTest ()
+    : TestCase ("Verify that per-device substreams make the setup independent of its order")
+{
+}
+
+// Reminder that the test case should clean up after itself
+SubstreamRngTest::~SubstreamRngTest ()
+{
+}
+
+void
+SubstreamRngTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("SubstreamRngTest");
+
+  // A substream only depends on its key and indices
+  uint64_t key = LoraSubstreamRng::GetKey (LoraSubstreamRng::POSITION);
+  LoraSubstreamRng first (key, 42);
+  LoraSubstreamRng second (key, 42);
+  first.GetValue ();
+  second.GetValue ();
+  NS_TEST_EXPECT_MSG_EQ (first.GetValue (), second.GetValue (),
+                         "Equal substreams gave different values");
+  NS_TEST_EXPECT_MSG_NE (LoraSubstreamRng (key, 42).GetValue (),
+                         LoraSubstreamRng (key, 43).GetValue (),
+                         "Different devices share a substream");
+  NS_TEST_EXPECT_MSG_NE (key, LoraSubstreamRng::GetKey (LoraSubstreamRng::SHADOWING),
+                         "Different purposes share a key");
+
+  // Positions can be computed by several threads, and match GetNext
+  Ptr<SubstreamDiscPositionAllocator> allocator =
+    CreateObject<SubstreamDiscPositionAllocator> ();
+  allocator->SetAttribute ("rho", DoubleValue (1000));
+  std::vector<Vector> positions (100);
+  auto allocate = [&] (uint32_t begin, uint32_t end)
+    {
+      for (uint32_t i = begin; i < end; i++)
+        {
+          positions[i] = allocator->GetPosition (i);
+        }
+    };
+  std::thread thread (allocate, 50, 100);
+  allocate (0, 50);
+  thread.join ();
+  for (uint32_t i = 0; i < positions.size (); i++)
+    {
+      Vector next = allocator->GetNext ();
+      NS_TEST_EXPECT_MSG_EQ ((next.x == positions[i].x && next.y == positions[i].y), true,
+                             "Position " << i << " depends on the thread");
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (CalculateDistance (next, Vector (0, 0, 0)), 1000,
+                                   "Position " << i << " is out of the disc");
+    }
+
+  Config::SetGlobal ("LoraDeviceSubstreams", BooleanValue (true));
+
+  // The data rate of a device doesn't depend on the other devices
+  Ptr<LoraChannel> channel = CreateChannel ();
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  NodeContainer endDevices = CreateEndDevices (20, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+  std::vector<double> distribution (6, 1.0 / 6);
+  LorawanMacHelper::SetSpreadingFactorsGivenDistribution (endDevices, gateways, distribution);
+  std::vector<uint8_t> dataRates;
+  NodeContainer firstHalf;
+  NodeContainer secondHalf;
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      dataRates.push_back (GetMacLayerFromNode<ClassAEndDeviceLorawanMac>
+                             (endDevices.Get (i))->GetDataRate ());
+      (i < 10 ? firstHalf : secondHalf).Add (endDevices.Get (i));
+    }
+  LorawanMacHelper::SetSpreadingFactorsGivenDistribution (secondHalf, gateways, distribution);
+  LorawanMacHelper::SetSpreadingFactorsGivenDistribution (firstHalf, gateways, distribution);
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (unsigned (GetMacLayerFromNode<ClassAEndDeviceLorawanMac>
+                                         (endDevices.Get (i))->GetDataRate ()),
+                             unsigned (dataRates[i]),
+                             "Device " << i << " depends on the other devices");
+    }
+
+  // The shadowing of a link doesn't depend on the links evaluated before it
+  Ptr<CorrelatedShadowingPropagationLossModel> forward =
+    CreateObject<CorrelatedShadowingPropagationLossModel> ();
+  Ptr<CorrelatedShadowingPropagationLossModel> backward =
+    CreateObject<CorrelatedShadowingPropagationLossModel> ();
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0, 0, 0));
+  std::vector<Ptr<ConstantPositionMobilityModel> > b;
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      b.push_back (CreateObject<ConstantPositionMobilityModel> ());
+      b.back ()->SetPosition (Vector (100 * i + 30, 250 * i, 0));
+    }
+  std::vector<double> losses;
+  for (uint32_t i = 0; i < b.size (); i++)
+    {
+      losses.push_back (forward->CalcRxPower (14, a, b[i]));
+    }
+  for (uint32_t i = b.size (); i-- > 0; )
+    {
+      NS_TEST_EXPECT_MSG_EQ_TOL (backward->CalcRxPower (14, a, b[i]), losses[i], 1e-9,
+                                 "Link " << i << " depends on the order");
+    }
+
+  // The building loss of a link doesn't depend on the links evaluated before
+  // it, but changes from one transmission to the next
+  Ptr<Building> building = CreateObject<Building> ();
+  building->SetBoundaries (Box (-50, 50, -50, 50, 0, 10));
+  std::vector<Ptr<ConstantPositionMobilityModel> > indoor;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      indoor.push_back (CreateObject<ConstantPositionMobilityModel> ());
+      indoor.back ()->SetPosition (Vector (20.0 * i - 20, 10, 1));
+    }
+  Ptr<ConstantPositionMobilityModel> gateway = CreateObject<ConstantPositionMobilityModel> ();
+  gateway->SetPosition (Vector (500, 0, 15));
+  indoor.push_back (gateway);
+  for (uint32_t i = 0; i < indoor.size (); i++)
+    {
+      Ptr<MobilityBuildingInfo> info = CreateObject<MobilityBuildingInfo> ();
+      indoor[i]->AggregateObject (info);
+      info->MakeConsistent (indoor[i]);
+    }
+  indoor.pop_back ();
+  Ptr<BuildingPenetrationLoss> forwardBuilding = CreateObject<BuildingPenetrationLoss> ();
+  Ptr<BuildingPenetrationLoss> backwardBuilding = CreateObject<BuildingPenetrationLoss> ();
+  losses.clear ();
+  for (uint32_t i = 0; i < indoor.size (); i++)
+    {
+      losses.push_back (forwardBuilding->CalcRxPower (14, indoor[i], gateway));
+    }
+  for (uint32_t i = indoor.size (); i-- > 0; )
+    {
+      NS_TEST_EXPECT_MSG_EQ_TOL (backwardBuilding->CalcRxPower (14, indoor[i], gateway),
+                                 losses[i], 1e-9, "Building loss " << i << " depends on the order");
+    }
+  for (uint32_t i = 0; i < indoor.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (losses[i], 10, "Link " << i << " has no wall loss");
+      NS_TEST_EXPECT_MSG_NE (forwardBuilding->CalcRxPower (14, indoor[i], gateway), losses[i],
+                             "Link " << i << " has the same loss on every transmission");
+    }
+
+  Config::SetGlobal ("LoraDeviceSubstreams", BooleanValue (false));
+
+  Simulator::Destroy ();
+}
+
+/******************************
+ * GatewayPlacementHelperTest *
+ ******************************/
+
+class GatewayPlacementHelperTest : public TestCase
+{
+public:
+  GatewayPlacementHelperTest ();
+  virtual ~GatewayPlacementHelperTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+GatewayPlacementHelperTest::GatewayPlacementHelperTest ()
+    : TestCase ("Verify that GatewayPlacementHelper places gateways near the devices")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GatewayPlacementHelperTest::~GatewayPlacementHelperTest ()
+{
+}
+
+void
+GatewayPlacementHelperTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GatewayPlacementHelperTest");
+
+  // Two clusters of devices, too far apart for a gateway to serve both
+  std::vector<Vector> clusters;
+  clusters.push_back (Vector (-10000, 0, 0));
+  clusters.push_back (Vector (10000, 0, 0));
+  std::vector<Vector> devicePositions;
+  for (uint32_t i = 0; i < 40; i++)
+    {
+      Vector center = clusters[i % 2];
+      devicePositions.push_back (Vector (center.x + 20 * (i / 2), center.y - 10 * (i / 2), 1.2));
+    }
+
+  GatewayPlacementHelper helper;
+  helper.SetChannel (CreateChannel ());
+  helper.SetSiteSpacing (1000);
+  Ptr<ListPositionAllocator> allocator = helper.Optimize (devicePositions, 2);
+
+  std::vector<uint32_t> sfQuantity = helper.GetSfQuantity ();
+  NS_TEST_EXPECT_MSG_EQ (sfQuantity.size (), 7, "Unexpected number of SFs");
+  NS_TEST_EXPECT_MSG_EQ (sfQuantity[0], 40, "All devices should be reached at SF7");
+  NS_TEST_EXPECT_MSG_EQ (helper.GetLoads ().size (), 2, "Expected the load of 2 gateways");
+
+  std::vector<Vector> gateways;
+  gateways.push_back (allocator->GetNext ());
+  gateways.push_back (allocator->GetNext ());
+  for (const auto &cluster : clusters)
+    {
+      double distance = std::min (CalculateDistance (gateways[0], cluster),
+                                  CalculateDistance (gateways[1], cluster));
+      NS_TEST_EXPECT_MSG_LT (distance, 4000, "No gateway near cluster " << cluster);
+    }
+
+  // Threads only split the link budgets
+  helper.SetThreads (2);
+  Ptr<ListPositionAllocator> threaded = helper.Optimize (devicePositions, 2);
+  for (uint32_t g = 0; g < gateways.size (); g++)
+    {
+      Vector position = threaded->GetNext ();
+      NS_TEST_EXPECT_MSG_EQ ((position.x == gateways[g].x && position.y == gateways[g].y),
+                             true, "Gateway " << g << " depends on the threads");
+    }
+
+  // Candidate sites cover devices however many spacings away they are
+  helper.SetSiteSpacing (400);
+  std::vector<Vector> farPositions;
+  for (const auto &position : devicePositions)
+    {
+      farPositions.push_back (Vector (1.5 * position.x, position.y, position.z));
+    }
+  Ptr<ListPositionAllocator> far = helper.Optimize (farPositions, 2);
+  gateways.clear ();
+  gateways.push_back (far->GetNext ());
+  gateways.push_back (far->GetNext ());
+  for (const auto &cluster : clusters)
+    {
+      Vector farCluster (1.5 * cluster.x, cluster.y, cluster.z);
+      double distance = std::min (CalculateDistance (gateways[0], farCluster),
+                                  CalculateDistance (gateways[1], farCluster));
+      NS_TEST_EXPECT_MSG_LT (distance, 4000, "No gateway near cluster " << farCluster);
+    }
+
+  // Loss models with state, like the shadowing grid, are evaluated on one
+  // thread, giving the same placement as a single thread
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+  loss->SetNext (CreateObject<CorrelatedShadowingPropagationLossModel> ());
+  GatewayPlacementHelper shadowed;
+  shadowed.SetChannel (CreateObject<LoraChannel>
+                         (loss, CreateObject<ConstantSpeedPropagationDelayModel> ()));
+  shadowed.SetSiteSpacing (1000);
+  Ptr<ListPositionAllocator> single = shadowed.Optimize (devicePositions, 2);
+  shadowed.SetThreads (4);
+  Ptr<ListPositionAllocator> multiple = shadowed.Optimize (devicePositions, 2);
+  for (uint32_t g = 0; g < 2; g++)
+    {
+      Vector expected = single->GetNext ();
+      Vector position = multiple->GetNext ();
+      NS_TEST_EXPECT_MSG_EQ ((position.x == expected.x && position.y == expected.y),
+                             true, "Gateway " << g << " depends on the threads");
+    }
+
+  Simulator::Destroy ();
+}
+
 /*****************
  * TimeOnAirTest *
  *****************/
@@ -1393,6 +2543,399 @@ LorawanMacTest::DoRun (void)
   NS_LOG_DEBUG ("LorawanMacTest");
 }
 
+/*********************
+ * PacketTrackerTest *
+ *********************/
+
+class PacketTrackerTest : public TestCase
+{
+public:
+  PacketTrackerTest ();
+  virtual ~PacketTrackerTest ();
+
+  void SendPacket (LoraPacketTracker *tracker, uint32_t edId, uint8_t sf,
+                   bool received);
+  void ReceivePacket (LoraPacketTracker *tracker, Ptr<Packet const> packet,
+                      uint32_t gwId, bool received);
+  void RetransmitFirstPacket (LoraPacketTracker *tracker);
+
+private:
+  virtual void DoRun (void);
+
+  std::map<LoraPacketTracker *, Ptr<Packet> > m_firstPackets;
+};
+
+// Add some help text to this case to describe what it is intended to test
+PacketTrackerTest::PacketTrackerTest ()
+    : TestCase ("Verify that the LoraPacketTracker counts packets consistently"
+                " in its full and streaming modes")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PacketTrackerTest::~PacketTrackerTest ()
+{
+}
+
+void
+PacketTrackerTest::SendPacket (LoraPacketTracker *tracker, uint32_t edId,
+                               uint8_t sf, bool received)
+{
+  Ptr<Packet> packet = Create<Packet> (10);
+  LorawanMacHeader macHdr;
+  macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+  packet->AddHeader (macHdr);
+
+  tracker->MacTransmissionCallback (packet, sf);
+  tracker->TransmissionCallback (packet, edId);
+  if (m_firstPackets.find (tracker) == m_firstPackets.end ())
+    {
+      m_firstPackets[tracker] = packet;
+    }
+
+  // The packet reaches the gateway after some time on air
+  Simulator::ScheduleWithContext (100, MilliSeconds (500),
+                                  &PacketTrackerTest::ReceivePacket, this,
+                                  tracker, packet, 100, received);
+}
+
+void
+PacketTrackerTest::RetransmitFirstPacket (LoraPacketTracker *tracker)
+{
+  // Retransmissions only go through the PHY
+  Ptr<Packet> packet = m_firstPackets[tracker];
+  tracker->TransmissionCallback (packet, 1);
+  Simulator::ScheduleWithContext (100, MilliSeconds (500),
+                                  &PacketTrackerTest::ReceivePacket, this,
+                                  tracker, packet, 100, true);
+}
+
+void
+PacketTrackerTest::ReceivePacket (LoraPacketTracker *tracker,
+                                  Ptr<Packet const> packet, uint32_t gwId,
+                                  bool received)
+{
+  if (received)
+    {
+      tracker->PacketReceptionCallback (packet, gwId);
+      tracker->MacGwReceptionCallback (packet);
+    }
+  else
+    {
+      tracker->InterferenceCallback (packet, gwId);
+    }
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PacketTrackerTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("PacketTrackerTest");
+
+  LoraPacketTracker fullTracker;
+  LoraPacketTracker streamingTracker;
+  streamingTracker.EnableStreaming (Seconds (10), Seconds (5));
+  fullTracker.EnableLatencyHistograms (Seconds (10));
+  streamingTracker.EnableLatencyHistograms (Seconds (10));
+
+  // Send a packet every second, alternating SF7 and SF8, and have one out of
+  // three packets interfered at the gateway
+  for (int i = 1; i <= 40; i++)
+    {
+      uint8_t sf = 7 + i % 2;
+      bool received = i % 3 != 0;
+      Simulator::ScheduleWithContext (i % 5, Seconds (i),
+                                      &PacketTrackerTest::SendPacket, this,
+                                      &fullTracker, i % 5, sf, received);
+      Simulator::ScheduleWithContext (i % 5, Seconds (i),
+                                      &PacketTrackerTest::SendPacket, this,
+                                      &streamingTracker, i % 5, sf, received);
+    }
+
+  // A late retransmission of the first packet, which the streaming tracker
+  // has already folded, is not counted again
+  Simulator::ScheduleWithContext (1, Seconds (45),
+                                  &PacketTrackerTest::RetransmitFirstPacket, this,
+                                  &fullTracker);
+  Simulator::ScheduleWithContext (1, Seconds (45),
+                                  &PacketTrackerTest::RetransmitFirstPacket, this,
+                                  &streamingTracker);
+
+  Simulator::Stop (Seconds (50));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (fullTracker.CountMacPacketsGlobally (Seconds (0),
+                                                              Seconds (50)),
+                         std::to_string (40.0) + " " + std::to_string (27.0),
+                         "Unexpected MAC counts");
+
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.CountMacPacketsGlobally
+                           (Seconds (0), Seconds (50)),
+                         fullTracker.CountMacPacketsGlobally (Seconds (0),
+                                                              Seconds (50)),
+                         "Streaming MAC counts differ");
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.CountMacPacketsGlobally
+                           (Seconds (0), Seconds (50), 7),
+                         fullTracker.CountMacPacketsGlobally (Seconds (0),
+                                                              Seconds (50), 7),
+                         "Streaming MAC counts for SF7 differ");
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.PrintPhyPacketsPerGw (Seconds (0),
+                                                                Seconds (50),
+                                                                100),
+                         fullTracker.PrintPhyPacketsPerGw (Seconds (0),
+                                                           Seconds (50), 100),
+                         "Streaming PHY counts differ");
+
+  // Packets that were interfered were never received, and should not count
+  NS_TEST_EXPECT_MSG_EQ (fullTracker.CountMacPacketsGloballyDelay
+                           (Seconds (0), Seconds (50), 100, 1),
+                         std::to_string (0.5),
+                         "Unexpected delay");
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.CountMacPacketsGloballyDelay
+                           (Seconds (0), Seconds (50), 100, 1),
+                         std::to_string (0.5),
+                         "Unexpected streaming delay");
+  NS_TEST_EXPECT_MSG_EQ (fullTracker.CountMacPacketsGlobally (Seconds (10),
+                                                              Seconds (19)),
+                         std::to_string (10.0) + " " + std::to_string (7.0),
+                         "Unexpected MAC counts in a window");
+
+  // The numeric counters match the strings, in both modes
+  TrackerMetrics fullMetrics = fullTracker.GetMetrics (Seconds (0),
+                                                       Seconds (50));
+  TrackerMetrics streamingMetrics = streamingTracker.GetMetrics (Seconds (0),
+                                                                 Seconds (50));
+  NS_TEST_EXPECT_MSG_EQ (fullMetrics.GetMacCounters ().sent, 40,
+                         "Unexpected MAC packets sent");
+  NS_TEST_EXPECT_MSG_EQ (fullMetrics.GetMacCounters ().received, 27,
+                         "Unexpected MAC packets received");
+  NS_TEST_EXPECT_MSG_EQ (streamingMetrics.GetMacCounters (7).received,
+                         fullMetrics.GetMacCounters (7).received,
+                         "Streaming MAC counters for SF7 differ");
+  NS_TEST_EXPECT_MSG_EQ (streamingMetrics.PrintPhyPackets (100),
+                         fullTracker.PrintPhyPacketsPerGw (Seconds (0),
+                                                           Seconds (50), 100),
+                         "Streaming PHY counters differ");
+  NS_TEST_EXPECT_MSG_EQ (TrackerMetrics::GetAverageDelay
+                           (streamingMetrics.GetDelay (100, 1)),
+                         Seconds (0.5), "Unexpected average delay");
+
+  // All received packets took 0.5 seconds to reach the gateway
+  for (auto tracker : {&fullTracker, &streamingTracker})
+    {
+      LatencyHistogram uplink = tracker->GetUplinkLatency (Seconds (0),
+                                                           Seconds (50));
+      NS_TEST_EXPECT_MSG_EQ (uplink.GetCount (), 27, "Unexpected latencies");
+      NS_TEST_EXPECT_MSG_EQ (uplink.GetPercentile (99), Seconds (0.5),
+                             "Unexpected uplink latency");
+      NS_TEST_EXPECT_MSG_EQ (tracker->GetUplinkLatencyPerGw
+                               (Seconds (0), Seconds (50), 100).GetCount (),
+                             27, "Unexpected latencies at the gateway");
+      NS_TEST_EXPECT_MSG_EQ (tracker->GetUplinkLatencyPerSf
+                               (Seconds (10), Seconds (20), 7).GetCount (),
+                             3, "Unexpected latencies of SF7 in a window");
+    }
+
+  Simulator::Destroy ();
+}
+
+/***********************
+ * PacketTraceFileTest *
+ ***********************/
+
+class PacketTraceFileTest : public TestCase
+{
+public:
+  PacketTraceFileTest ();
+  virtual ~PacketTraceFileTest ();
+
+  void SendPacket (LoraPacketTracker *tracker, uint32_t edId, bool reversed);
+  void ReceivePacket (LoraPacketTracker *tracker, Ptr<Packet const> packet,
+                      uint32_t gwId, double receivePower);
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+PacketTraceFileTest::PacketTraceFileTest ()
+    : TestCase ("Verify that the packet trace file holds the delay and power of"
+                " each gateway reception")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PacketTraceFileTest::~PacketTraceFileTest ()
+{
+}
+
+void
+PacketTraceFileTest::SendPacket (LoraPacketTracker *tracker, uint32_t edId,
+                                 bool reversed)
+{
+  Ptr<Packet> packet = Create<Packet> (10);
+  LorawanMacHeader macHdr;
+  macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+  packet->AddHeader (macHdr);
+
+  tracker->MacTransmissionCallback (packet, 7);
+  tracker->TransmissionCallback (packet, edId);
+
+  // Gateway 100 receives first, unless reversed
+  Simulator::ScheduleWithContext (100, MilliSeconds (500),
+                                  &PacketTraceFileTest::ReceivePacket, this,
+                                  tracker, packet, 100, reversed ? -105.0 : -100.0);
+  Simulator::ScheduleWithContext (101, MilliSeconds (reversed ? 300 : 600),
+                                  &PacketTraceFileTest::ReceivePacket, this,
+                                  tracker, packet, 101, reversed ? -120.0 : -110.0);
+}
+
+void
+PacketTraceFileTest::ReceivePacket (LoraPacketTracker *tracker,
+                                    Ptr<Packet const> packet, uint32_t gwId,
+                                    double receivePower)
+{
+  // Each gateway tags its own copy with the power it received
+  Ptr<Packet> copy = packet->Copy ();
+  LoraTag tag;
+  tag.SetReceivePower (receivePower);
+  copy->ReplacePacketTag (tag);
+
+  tracker->PacketReceptionCallback (copy, gwId);
+  tracker->MacGwReceptionCallback (copy);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PacketTraceFileTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("PacketTraceFileTest");
+
+  LoraPacketTracker tracker;
+  std::string traceFile = CreateTempDirFilename ("packet-trace.bin");
+  tracker.EnableTraceFile (traceFile);
+
+  // The first packet gives gateway 100 index 0 and gateway 101 index 1, the
+  // second one reaches them in descending index order
+  Simulator::ScheduleWithContext (1, Seconds (1), &PacketTraceFileTest::SendPacket,
+                                  this, &tracker, 1, false);
+  Simulator::ScheduleWithContext (2, Seconds (2), &PacketTraceFileTest::SendPacket,
+                                  this, &tracker, 2, true);
+
+  Simulator::Stop (Seconds (5));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // The file is closed at Destroy: 16 bytes of header, then a block with a
+  // 16-byte header and 2 records of 55 bytes for 2 gateways, padded to 8 bytes
+  std::ifstream trace (traceFile.c_str (), std::ifstream::binary);
+  std::vector<char> bytes ((std::istreambuf_iterator<char> (trace)),
+                           std::istreambuf_iterator<char> ());
+  NS_TEST_ASSERT_MSG_EQ (bytes.size (), 16 + 16 + 112, "Unexpected trace file size");
+
+  uint32_t sizes[2];
+  std::memcpy (sizes, &bytes[16], sizeof (sizes));
+  NS_TEST_EXPECT_MSG_EQ (sizes[0], 2, "Unexpected number of records");
+  NS_TEST_EXPECT_MSG_EQ (sizes[1], 2, "Unexpected number of gateways");
+
+  // Delays of gateway 0, then of gateway 1, after the send times
+  int64_t delays[4];
+  std::memcpy (delays, &bytes[32 + 2 * 8], sizeof (delays));
+  NS_TEST_EXPECT_MSG_EQ (delays[0], MilliSeconds (500).GetNanoSeconds (),
+                         "Unexpected delay of packet 0 at gateway 0");
+  NS_TEST_EXPECT_MSG_EQ (delays[1], MilliSeconds (500).GetNanoSeconds (),
+                         "Unexpected delay of packet 1 at gateway 0");
+  NS_TEST_EXPECT_MSG_EQ (delays[2], MilliSeconds (600).GetNanoSeconds (),
+                         "Unexpected delay of packet 0 at gateway 1");
+  NS_TEST_EXPECT_MSG_EQ (delays[3], MilliSeconds (300).GetNanoSeconds (),
+                         "Unexpected delay of packet 1 at gateway 1");
+
+  // Powers of gateway 0, then of gateway 1, after the frequencies
+  double powers[4];
+  std::memcpy (powers, &bytes[32 + 2 * 8 + 4 * 8 + 2 * 8], sizeof (powers));
+  NS_TEST_EXPECT_MSG_EQ (powers[0], -100.0, "Unexpected power of packet 0 at gateway 0");
+  NS_TEST_EXPECT_MSG_EQ (powers[1], -105.0, "Unexpected power of packet 1 at gateway 0");
+  NS_TEST_EXPECT_MSG_EQ (powers[2], -110.0, "Unexpected power of packet 0 at gateway 1");
+  NS_TEST_EXPECT_MSG_EQ (powers[3], -120.0, "Unexpected power of packet 1 at gateway 1");
+}
+
+/************************
+ * LatencyHistogramTest *
+ ************************/
+
+class LatencyHistogramTest : public TestCase
+{
+public:
+  LatencyHistogramTest ();
+  virtual ~LatencyHistogramTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+LatencyHistogramTest::LatencyHistogramTest ()
+    : TestCase ("Verify that LatencyHistogram estimates percentiles and merges"
+                " histograms")
+{
+}
+
+// This destructor does nothing but we include it as a reminder that
+// the test case should clean up after itself
+LatencyHistogramTest::~LatencyHistogramTest ()
+{
+}
+
+void
+LatencyHistogramTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("LatencyHistogramTest");
+
+  // Latencies of 1, 2, ..., 1000 ms, split in two histograms
+  LatencyHistogram all;
+  LatencyHistogram odd;
+  LatencyHistogram even;
+  for (int i = 1; i <= 1000; i++)
+    {
+      all.Record (MilliSeconds (i));
+      (i % 2 ? odd : even).Record (MilliSeconds (i));
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (all.GetCount (), 1000, "Unexpected count");
+  NS_TEST_EXPECT_MSG_EQ (all.GetMin (), MilliSeconds (1), "Unexpected min");
+  NS_TEST_EXPECT_MSG_EQ (all.GetMax (), MilliSeconds (1000), "Unexpected max");
+  NS_TEST_EXPECT_MSG_EQ (all.GetMean (), MicroSeconds (500500),
+                         "Unexpected mean");
+
+  // With 5 significant bits, percentiles are within 1/64 of the real value
+  NS_TEST_EXPECT_MSG_EQ_TOL (all.GetPercentile (50).GetSeconds (), 0.5,
+                             0.5 / 64, "Unexpected median");
+  NS_TEST_EXPECT_MSG_EQ_TOL (all.GetPercentile (95).GetSeconds (), 0.95,
+                             0.95 / 64, "Unexpected 95th percentile");
+  NS_TEST_EXPECT_MSG_EQ_TOL (all.GetPercentile (99).GetSeconds (), 0.99,
+                             0.99 / 64, "Unexpected 99th percentile");
+
+  // Merging the two halves gives back the whole histogram, also through its
+  // serialized form
+  std::stringstream ss;
+  even.Serialize (ss);
+  LatencyHistogram merged;
+  merged.Deserialize (ss);
+  merged.Merge (odd);
+  NS_TEST_EXPECT_MSG_EQ (merged.GetCount (), all.GetCount (),
+                         "Unexpected count after merging");
+  NS_TEST_EXPECT_MSG_EQ (merged.GetMean (), all.GetMean (),
+                         "Unexpected mean after merging");
+  for (double percentile : {1.0, 50.0, 95.0, 99.0, 100.0})
+    {
+      NS_TEST_EXPECT_MSG_EQ (merged.GetPercentile (percentile),
+                             all.GetPercentile (percentile),
+                             "Unexpected percentile after merging");
+    }
+}
+
 /**************
  * Test Suite *
  **************/
@@ -1415,9 +2958,23 @@ LorawanTestSuite::LorawanTestSuite () : TestSuite ("lorawan", UNIT)
   AddTestCase (new AddressTest, TestCase::QUICK);
   AddTestCase (new HeaderTest, TestCase::QUICK);
   AddTestCase (new ReceivePathTest, TestCase::QUICK);
+  AddTestCase (new GatewayPhyCountersTest, TestCase::QUICK);
+  AddTestCase (new EventProfilerTest, TestCase::QUICK);
+  AddTestCase (new SpreadingFactorsSetupTest, TestCase::QUICK);
+  AddTestCase (new CapacityAwareSfTest, TestCase::QUICK);
   AddTestCase (new LogicalLoraChannelTest, TestCase::QUICK);
+  AddTestCase (new RegionalPlanTest, TestCase::QUICK);
+  AddTestCase (new VirtualPopulationTest, TestCase::QUICK);
+  AddTestCase (new VirtualPopulationBuildingTest, TestCase::QUICK);
+  AddTestCase (new TrafficGeneratorTest, TestCase::QUICK);
+  AddTestCase (new TraceReplayTest, TestCase::QUICK);
+  AddTestCase (new SubstreamRngTest, TestCase::QUICK);
+  AddTestCase (new GatewayPlacementHelperTest, TestCase::QUICK);
   AddTestCase (new TimeOnAirTest, TestCase::QUICK);
   AddTestCase (new PhyConnectivityTest, TestCase::QUICK);
+  AddTestCase (new PacketTrackerTest, TestCase::QUICK);
+  AddTestCase (new PacketTraceFileTest, TestCase::QUICK);
+  AddTestCase (new LatencyHistogramTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -15,6 +15,7 @@
 #include "ns3/callback.h"
 #include "ns3/network-server.h"
 #include "ns3/network-server-helper.h"
+#include "ns3/boolean.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -180,6 +181,309 @@ DownlinkPacketTest::DoRun (void)
   NS_ASSERT (m_receivedPacketAtEd);
 }
 
+/////////////////////////
+// DownlinkPlannerTest //
+/////////////////////////
+
+class DownlinkPlannerTest : public TestCase
+{
+public:
+  DownlinkPlannerTest ();
+  virtual ~DownlinkPlannerTest ();
+
+  void ReceivedPacketAtEndDevice (uint8_t requiredTransmissions, bool success,
+                                  Time time, Ptr<Packet> packet);
+  void SendPacket (Ptr<Node> endDevice);
+  int RunScenario (bool planning);
+
+private:
+  virtual void DoRun (void);
+  int m_acknowledgedPackets = 0;
+};
+
+// Add some help text to this case to describe what it is intended to test
+DownlinkPlannerTest::DownlinkPlannerTest ()
+  : TestCase ("Verify that the DownlinkPlanner serves devices whose receive"
+              " windows compete for the same gateway")
+{
+}
+
+// Reminder that the test case should clean up after itself
+DownlinkPlannerTest::~DownlinkPlannerTest ()
+{
+}
+
+void
+DownlinkPlannerTest::ReceivedPacketAtEndDevice (uint8_t requiredTransmissions,
+                                                bool success, Time time,
+                                                Ptr<Packet> packet)
+{
+  NS_LOG_DEBUG ("Packet acknowledged: " << success);
+  if (success)
+    {
+      m_acknowledgedPackets++;
+    }
+}
+
+void
+DownlinkPlannerTest::SendPacket (Ptr<Node> endDevice)
+{
+  endDevice->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac
+    ()->GetObject<EndDeviceLorawanMac> ()->SetMType
+    (LorawanMacHeader::CONFIRMED_DATA_UP);
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+int
+DownlinkPlannerTest::RunScenario (bool planning)
+{
+  m_acknowledgedPackets = 0;
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  // Device 0 is reached by both gateways, but best by gateway 0, while
+  // devices 1 and 2 are only reached by gateway 0
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  Ptr<ListPositionAllocator> edPositions = CreateObject<ListPositionAllocator> ();
+  edPositions->Add (Vector (1500, 0, 0));
+  edPositions->Add (Vector (-1000, 0, 0));
+  edPositions->Add (Vector (-1000, 200, 0));
+  mobility.SetPositionAllocator (edPositions);
+  NodeContainer endDevices = CreateEndDevices (3, mobility, channel);
+
+  Ptr<ListPositionAllocator> gwPositions = CreateObject<ListPositionAllocator> ();
+  gwPositions->Add (Vector (0, 0, 15));
+  gwPositions->Add (Vector (4000, 0, 15));
+  mobility.SetPositionAllocator (gwPositions);
+  NodeContainer gateways = CreateGateways (2, mobility, channel);
+
+  LorawanMacHelper ().SetSpreadingFactorsUp (endDevices, gateways, channel, false);
+
+  Ptr<Node> nsNode = CreateNetworkServer (endDevices, gateways);
+  nsNode->GetApplication (0)->SetAttribute ("DownlinkPlanning",
+                                            BooleanValue (planning));
+
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      Ptr<EndDeviceLorawanMac> mac = GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (i));
+      mac->SetAttribute ("MaxTransmissions", IntegerValue (1));
+      mac->TraceConnectWithoutContext ("RequiredTransmissions", MakeCallback (&DownlinkPlannerTest::ReceivedPacketAtEndDevice, this));
+    }
+
+  // All first receive windows open within the planning horizon. Served
+  // greedily, device 0 takes gateway 0 in RX1, whose duty cycle then pushes
+  // device 1 to RX2, which leaves no window for device 2. The planner sends
+  // the reply of device 0 through gateway 1 instead.
+  Simulator::Schedule (Seconds (1), &DownlinkPlannerTest::SendPacket, this,
+                       endDevices.Get (0));
+  Simulator::Schedule (Seconds (1.2), &DownlinkPlannerTest::SendPacket, this,
+                       endDevices.Get (1));
+  Simulator::Schedule (Seconds (1.4), &DownlinkPlannerTest::SendPacket, this,
+                       endDevices.Get (2));
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  return m_acknowledgedPackets;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+DownlinkPlannerTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("DownlinkPlannerTest");
+
+  NS_TEST_EXPECT_MSG_EQ (RunScenario (false), 2,
+                         "The greedy scheduler should have lost one reply");
+  NS_TEST_EXPECT_MSG_EQ (RunScenario (true), 3,
+                         "The planner should have served all devices");
+}
+
+////////////////////////
+// DeduplicationTest //
+////////////////////////
+
+class DeduplicationTest : public TestCase
+{
+public:
+  DeduplicationTest ();
+  virtual ~DeduplicationTest ();
+
+  void ReceivedPacket (Ptr<Packet const> packet);
+  void ReceivedPacketAtEndDevice (uint8_t requiredTransmissions, bool success,
+                                  Time time, Ptr<Packet> packet);
+  void SendPacket (Ptr<Node> endDevice);
+
+private:
+  virtual void DoRun (void);
+  int m_receivedPackets = 0;
+  bool m_receivedPacketAtEd = false;
+};
+
+// Add some help text to this case to describe what it is intended to test
+DeduplicationTest::DeduplicationTest ()
+  : TestCase ("Verify that the NetworkServer processes the copies of an"
+              " uplink packet once when a deduplication window is set")
+{
+}
+
+// Reminder that the test case should clean up after itself
+DeduplicationTest::~DeduplicationTest ()
+{
+}
+
+void
+DeduplicationTest::ReceivedPacket (Ptr<Packet const> packet)
+{
+  NS_LOG_DEBUG ("Dispatched a packet at the NS");
+  m_receivedPackets++;
+}
+
+void
+DeduplicationTest::ReceivedPacketAtEndDevice (uint8_t requiredTransmissions,
+                                              bool success, Time time,
+                                              Ptr<Packet> packet)
+{
+  m_receivedPacketAtEd = success;
+}
+
+void
+DeduplicationTest::SendPacket (Ptr<Node> endDevice)
+{
+  endDevice->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac
+    ()->GetObject<EndDeviceLorawanMac> ()->SetMType
+    (LorawanMacHeader::CONFIRMED_DATA_UP);
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+DeduplicationTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("DeduplicationTest");
+
+  // Several gateways may receive the same packet
+  NetworkComponents components = InitializeNetwork (1, 4);
+
+  NodeContainer endDevices = components.endDevices;
+  Ptr<Node> nsNode = components.nsNode;
+
+  nsNode->GetApplication (0)->SetAttribute ("DeduplicationWindow",
+                                            TimeValue (MilliSeconds (200)));
+  nsNode->GetApplication (0)->TraceConnectWithoutContext
+    ("ReceivedPacket",
+    MakeCallback (&DeduplicationTest::ReceivedPacket, this));
+  endDevices.Get (0)->GetDevice (0)->GetObject<LoraNetDevice>()->GetMac ()->GetObject<EndDeviceLorawanMac>()->TraceConnectWithoutContext ("RequiredTransmissions", MakeCallback (&DeduplicationTest::ReceivedPacketAtEndDevice, this));
+
+  Simulator::Schedule (Seconds (1), &DeduplicationTest::SendPacket, this,
+                       endDevices.Get (0));
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_receivedPackets, 1,
+                         "The uplink should have been processed once");
+  NS_TEST_EXPECT_MSG_EQ (m_receivedPacketAtEd, true,
+                         "The reply should have been timed from the first copy");
+}
+
+////////////////////////////
+// ComponentProfilingTest //
+////////////////////////////
+
+class ComponentProfilingTest : public TestCase
+{
+public:
+  ComponentProfilingTest ();
+  virtual ~ComponentProfilingTest ();
+
+  void ComponentCall (std::string component, std::string method,
+                      double wallTime);
+  void SendPacket (Ptr<Node> endDevice);
+
+private:
+  virtual void DoRun (void);
+  int m_componentCalls = 0;
+};
+
+// Add some help text to this case to describe what it is intended to test
+ComponentProfilingTest::ComponentProfilingTest ()
+  : TestCase ("Verify that the NetworkController measures the cost of its"
+              " components when profiling is enabled")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ComponentProfilingTest::~ComponentProfilingTest ()
+{
+}
+
+void
+ComponentProfilingTest::ComponentCall (std::string component,
+                                       std::string method, double wallTime)
+{
+  NS_LOG_DEBUG (component << "::" << method << " took " << wallTime << " s");
+  m_componentCalls++;
+}
+
+void
+ComponentProfilingTest::SendPacket (Ptr<Node> endDevice)
+{
+  endDevice->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac
+    ()->GetObject<EndDeviceLorawanMac> ()->SetMType
+    (LorawanMacHeader::CONFIRMED_DATA_UP);
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ComponentProfilingTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ComponentProfilingTest");
+
+  NetworkComponents components = InitializeNetwork (1, 1);
+
+  NodeContainer endDevices = components.endDevices;
+  Ptr<Node> nsNode = components.nsNode;
+
+  Ptr<NetworkServer> ns = nsNode->GetApplication (0)->GetObject<NetworkServer> ();
+  ns->SetAttribute ("ComponentProfiling", BooleanValue (true));
+  ns->GetNetworkController ()->TraceConnectWithoutContext
+    ("ComponentCall",
+    MakeCallback (&ComponentProfilingTest::ComponentCall, this));
+
+  Simulator::Schedule (Seconds (1), &ComponentProfilingTest::SendPacket, this,
+                       endDevices.Get (0));
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  std::vector<NetworkController::ComponentCost> costs =
+    ns->GetNetworkController ()->GetComponentCosts ();
+
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (costs.size (), 3,
+                         "Every installed component should be accounted for");
+  int calls = 0;
+  for (auto it = costs.begin (); it != costs.end (); ++it)
+    {
+      NS_TEST_EXPECT_MSG_EQ (it->receivedPacketCalls, 1,
+                             "Each component should have seen the uplink");
+      NS_TEST_EXPECT_MSG_EQ (it->beforeSendingReplyCalls, 1,
+                             "Each component should have seen the reply");
+      calls += it->receivedPacketCalls + it->beforeSendingReplyCalls;
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_componentCalls, calls,
+                         "The trace source should fire once per call");
+}
+
 //////////////////////////
 // LinkCheckSupportTest //
 //////////////////////////
@@ -305,6 +609,9 @@ NetworkServerTestSuite::NetworkServerTestSuite ()
   AddTestCase (new UplinkPacketTest, TestCase::QUICK);
   AddTestCase (new DownlinkPacketTest, TestCase::QUICK);
   AddTestCase (new LinkCheckTest, TestCase::QUICK);
+  AddTestCase (new DownlinkPlannerTest, TestCase::QUICK);
+  AddTestCase (new DeduplicationTest, TestCase::QUICK);
+  AddTestCase (new ComponentProfilingTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -12,11 +12,16 @@
 #include "ns3/log.h"
 #include "ns3/end-device-status.h"
 #include "ns3/network-status.h"
+#include "ns3/lora-device-address-generator.h"
+#include "ns3/lora-tag.h"
+#include "ns3/mac48-address.h"
 #include "utilities.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <limits>
+
 using namespace ns3;
 using namespace lorawan;
 
@@ -56,6 +61,51 @@ EndDeviceStatusTest::DoRun (void)
 
   // Create an EndDeviceStatus object
   EndDeviceStatus eds = EndDeviceStatus ();
+
+  // Receive the same uplink from two gateways
+  LoraDeviceAddress address (1, 42);
+  Ptr<EndDeviceStatus> edStatus = Create<EndDeviceStatus> (address, 0);
+
+  Ptr<Packet> uplink = Create<Packet> (10);
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  frameHdr.SetAddress (address);
+  frameHdr.SetFCnt (7);
+  uplink->AddHeader (frameHdr);
+  LorawanMacHeader macHdr;
+  macHdr.SetMType (LorawanMacHeader::CONFIRMED_DATA_UP);
+  uplink->AddHeader (macHdr);
+  LoraTag tag (7, 0);
+  tag.SetFrequency (868.1);
+  uplink->AddPacketTag (tag);
+
+  edStatus->InsertReceivedPacket (uplink, Mac48Address ("00:00:00:00:00:01"));
+  edStatus->InsertReceivedPacket (uplink, Mac48Address ("00:00:00:00:00:02"));
+
+  NS_TEST_EXPECT_MSG_EQ (edStatus->GetReceivedPacketList ().size (), 1,
+                         "Copies of the same uplink should be merged");
+  NS_TEST_EXPECT_MSG_EQ (edStatus->GetLastReceivedPacketInfo ().gwList.size (),
+                         2, "Both gateways should be listed");
+
+  // Build two replies in a row, resetting the reply in between
+  for (int i = 0; i < 2; i++)
+    {
+      edStatus->AddMACCommand (Create<LinkCheckAns> (10, 2));
+      Ptr<Packet> reply = edStatus->GetCompleteReplyPacket ();
+
+      LorawanMacHeader replyMacHdr;
+      reply->RemoveHeader (replyMacHdr);
+      LoraFrameHeader replyFrameHdr;
+      replyFrameHdr.SetAsDownlink ();
+      reply->RemoveHeader (replyFrameHdr);
+
+      NS_TEST_EXPECT_MSG_EQ (replyFrameHdr.GetFCnt (), 7,
+                             "The reply should carry the uplink's frame counter");
+      NS_TEST_EXPECT_MSG_EQ (replyFrameHdr.GetCommands ().size (), 1,
+                             "Only the commands of this reply should be sent");
+
+      edStatus->InitializeReply ();
+    }
 }
 
 /////////////////////////////
@@ -102,6 +152,111 @@ NetworkStatusTest::DoRun (void)
   NodeContainer gateways = components.gateways;
 
   ns.AddNode (GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (0)));
+
+  // Give the devices addresses from a generator, leaving out one address
+  // that belongs to a device of another server
+  NetworkComponents indexed = InitializeNetwork (2, 1);
+  Ptr<LoraDeviceAddressGenerator> generator =
+    CreateObject<LoraDeviceAddressGenerator> (5, 0);
+  LoraDeviceAddress first = generator->NextAddress ();
+  LoraDeviceAddress other = generator->NextAddress ();
+  LoraDeviceAddress last = generator->NextAddress ();
+  Ptr<ClassAEndDeviceLorawanMac> lastMac =
+    GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (indexed.endDevices.Get (0));
+  Ptr<ClassAEndDeviceLorawanMac> firstMac =
+    GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (indexed.endDevices.Get (1));
+  lastMac->SetDeviceAddress (last);
+  firstMac->SetDeviceAddress (first);
+
+  // With the generator, devices are indexed by their device index
+  Ptr<NetworkStatus> status = CreateObject<NetworkStatus> ();
+  status->SetAddressGenerator (generator);
+  status->AddNode (lastMac);
+  status->AddNode (firstMac);
+  status->AddNode (lastMac);
+  NS_TEST_EXPECT_MSG_EQ (status->CountEndDevices (), 2, "Wrong number of devices");
+  NS_TEST_EXPECT_MSG_EQ (status->GetEndDeviceIndex (first), 0u, "Wrong device index");
+  NS_TEST_EXPECT_MSG_EQ (status->GetEndDeviceIndex (last), 2u, "Wrong device index");
+  NS_TEST_EXPECT_MSG_EQ (status->HasEndDevice (other), false,
+                         "A device of another server is tracked");
+  NS_TEST_EXPECT_MSG_EQ (status->GetEndDeviceStatusAt (2)->GetMac (), lastMac,
+                         "Wrong device at its index");
+  NS_TEST_EXPECT_MSG_EQ (status->GetEndDeviceStatus (first)->GetMac (), firstMac,
+                         "Wrong device for its address");
+
+  // Without it, devices are indexed in the order they are added
+  Ptr<NetworkStatus> ordered = CreateObject<NetworkStatus> ();
+  ordered->AddNode (lastMac);
+  ordered->AddNode (firstMac);
+  NS_TEST_EXPECT_MSG_EQ (ordered->GetEndDeviceIndex (last), 0u, "Wrong device index");
+  NS_TEST_EXPECT_MSG_EQ (ordered->GetEndDeviceIndex (first), 1u, "Wrong device index");
+  NS_TEST_EXPECT_MSG_EQ (ordered->GetEndDeviceIndex (other),
+                         std::numeric_limits<uint32_t>::max (),
+                         "An unknown device has an index");
+
+  Simulator::Destroy ();
+}
+
+/////////////////////////////
+// GatewayStatus testing //
+/////////////////////////////
+
+class GatewayStatusLedgerTest : public TestCase
+{
+public:
+  GatewayStatusLedgerTest ();
+  virtual ~GatewayStatusLedgerTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+GatewayStatusLedgerTest::GatewayStatusLedgerTest ()
+  : TestCase ("Verify the duty cycle ledger of the GatewayStatus object")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GatewayStatusLedgerTest::~GatewayStatusLedgerTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+GatewayStatusLedgerTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GatewayStatusLedgerTest");
+
+  NetworkComponents components = InitializeNetwork (1, 1);
+
+  Ptr<GatewayLorawanMac> gwMac =
+    GetMacLayerFromNode<GatewayLorawanMac> (components.gateways.Get (0));
+  Ptr<GatewayStatus> gwStatus = Create<GatewayStatus> (Address (), 0, gwMac);
+
+  // A fresh gateway can transmit right away on any sub-band
+  NS_TEST_EXPECT_MSG_EQ (gwStatus->GetEarliestTransmissionTime (868.1),
+                         Seconds (0),
+                         "Unexpected earliest transmission time");
+  NS_TEST_EXPECT_MSG_EQ (gwStatus->IsAvailableForTransmission (869.525),
+                         true,
+                         "Gateway should be available for transmission");
+
+  // A transmission blocks the whole 1% sub-band for 99 times its duration,
+  // and leaves the 10% sub-band alone
+  gwStatus->RecordTransmission (868.1, Seconds (1));
+  NS_TEST_EXPECT_MSG_EQ (gwStatus->GetEarliestTransmissionTime (868.3),
+                         Seconds (99),
+                         "Unexpected earliest transmission time");
+  NS_TEST_EXPECT_MSG_EQ (gwStatus->GetSubBand (868.1),
+                         gwStatus->GetSubBand (868.5),
+                         "Frequencies should share the same SubBand");
+  NS_TEST_EXPECT_MSG_EQ (gwStatus->GetEarliestTransmissionTime (869.525),
+                         Seconds (0),
+                         "Unexpected earliest transmission time");
+
+  Simulator::Destroy ();
 }
 
 /**************
@@ -125,6 +280,7 @@ NetworkStatusTestSuite::NetworkStatusTestSuite ()
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new EndDeviceStatusTest, TestCase::QUICK);
   AddTestCase (new NetworkStatusTest, TestCase::QUICK);
+  AddTestCase (new GatewayStatusLedgerTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite